@@ -0,0 +1,206 @@
+#include "libprgr/AssetLoader.h"
+#include "libprgr/Profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <limits>
+
+#pragma region --- ASSET LOADER ---
+
+AssetLoader::AssetLoader(int threads)
+{
+	// El hilo GL y el de simulacion ya tienen su nucleo
+	threadTarget = threads > 0 ? threads : std::max(1, (int)std::thread::hardware_concurrency() - 2);
+}
+
+AssetLoader::~AssetLoader()
+{
+	cancel();
+}
+
+void AssetLoader::startWorkers()
+{
+	while ((int)workers.size() < threadTarget)
+		workers.emplace_back(&AssetLoader::workerLoop, this);
+}
+
+void AssetLoader::workerLoop()
+{
+	Profiler::setThreadName("carga");
+	for (;;) {
+		job_t* job;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [this] { return stopping || !queue.empty(); });
+			if (stopping) return;
+			job = queue.front();
+			queue.pop_front();
+		}
+
+		// Todo lo que no necesita GL: fichero, textura, LOD, empaquetado y colisionador
+		Mesh* mesh;
+		{
+			PROFILE_SCOPE("build mesh");
+			mesh = MeshLibrary::build(job->file);
+			if (mesh)
+				mesh->prepareCollider(sphere); // El de Object3D::setMesh
+		}
+
+		std::lock_guard<std::mutex> lock(mutex);
+		job->mesh = mesh;
+		built.push_back(job);
+		if (mesh) builtMeshes++;
+	}
+}
+
+void AssetLoader::load(Object3D* obj, const string& file)
+{
+	pendingObjects++;
+	auto it = jobs.find(file);
+	if (it != jobs.end()) {
+		it->second->objects.push_back(obj);
+		return;
+	}
+
+	job_t* job = new job_t();
+	job->file = file;
+	job->objects.push_back(obj);
+	jobs[file] = job;
+
+	// Ya cargada: solo falta terminar el objeto (y subir la malla si nadie la habia dibujado)
+	job->mesh = MeshLibrary::acquireLoaded(file);
+	if (job->mesh) {
+		job->registered = true;
+		uploading.push_back(job);
+		return;
+	}
+
+	startWorkers();
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		queue.push_back(job);
+	}
+	wake.notify_one();
+}
+
+vector<Object3D*> AssetLoader::update(double budgetMs)
+{
+	vector<Object3D*> ready;
+	if (pendingObjects == 0) return ready;
+
+	PROFILE_SCOPE("assets");
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		uploading.insert(uploading.end(), built.begin(), built.end());
+		built.clear();
+	}
+
+	// Los pasos son cortos (un nivel, una geometria, un objeto): se para en cuanto se pasa del limite
+	while (step(ready)) {
+		uploadSteps++;
+		if (std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() >= budgetMs)
+			break;
+	}
+	maxUpdateMs = std::max(maxUpdateMs, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+	return ready;
+}
+
+vector<Object3D*> AssetLoader::finish()
+{
+	vector<Object3D*> ready;
+	while (pendingObjects > 0) {
+		vector<Object3D*> done = update(std::numeric_limits<double>::infinity());
+		ready.insert(ready.end(), done.begin(), done.end());
+		if (done.empty() && uploading.empty())
+			std::this_thread::sleep_for(std::chrono::milliseconds(1)); // Los hilos aun estan leyendo
+	}
+	return ready;
+}
+
+bool AssetLoader::step(vector<Object3D*>& ready)
+{
+	if (uploading.empty()) return false;
+	job_t* job = uploading.front();
+
+	if (!job->mesh) {
+		// No se pudo leer: sus objetos se quedan sin malla, como con loadFromFile
+		cout << "ERROR: " << __FILE__ << ":" << __LINE__ << " (" << __func__ << ") No se pudo cargar " << job->file << endl;
+		failedObjects += (unsigned int)job->objects.size();
+		pendingObjects -= job->objects.size();
+		job->objects.clear();
+	}
+	else {
+		if (!job->registered) {
+			job->mesh = MeshLibrary::adopt(job->mesh);
+			job->registered = true;
+		}
+		if (!staging)
+			staging = new StagingBuffer();
+
+		// Textura, un nivel por paso (de mas grande a mas pequeno)
+		Texture* texture = job->mesh->texture;
+		if (texture && job->nextLevel < (int)texture->levels.size()) {
+			texture->uploadLevel(job->nextLevel++, staging);
+			if (job->nextLevel == (int)texture->levels.size())
+				texture->finishUpload();
+			return true;
+		}
+
+		// Geometria de todos los LOD
+		if (!job->mesh->uploaded) {
+			job->mesh->upload(staging);
+			return true;
+		}
+
+		// Un objeto por paso: su programa puede tener que compilarse
+		if (!job->objects.empty()) {
+			Object3D* obj = job->objects.front();
+			job->objects.erase(job->objects.begin());
+			obj->setMesh(MeshLibrary::acquireLoaded(job->file));
+			ready.push_back(obj);
+			loadedObjects++;
+			pendingObjects--;
+			return true;
+		}
+
+		// Los objetos tienen sus referencias: la del trabajo ya no hace falta
+		MeshLibrary::release(job->mesh);
+	}
+
+	jobs.erase(job->file);
+	uploading.erase(uploading.begin());
+	delete job;
+	return true;
+}
+
+void AssetLoader::cancel()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (std::thread& worker : workers)
+		worker.join();
+	workers.clear();
+	stopping = false;
+
+	// Ya no queda ningun hilo de carga: los trabajos son solo de este hilo
+	for (auto& [file, job] : jobs) {
+		if (job->registered)
+			MeshLibrary::release(job->mesh);
+		else
+			delete job->mesh;
+		delete job;
+	}
+	jobs.clear();
+	queue.clear();
+	built.clear();
+	uploading.clear();
+	pendingObjects = 0;
+
+	delete staging;
+	staging = nullptr;
+}
+
+#pragma endregion
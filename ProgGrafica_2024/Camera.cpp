@@ -74,12 +74,12 @@ void Camera::move(float timeStep)
 
     // Verificar colisión (implementar esta función en Render)
     if (r && r->cameraCollision(this)) {
-        cout << "Collision occurred, reverting position" << endl;
+        if (!r->headless) cout << "Collision occurred, reverting position" << endl;
         position = prevPosition;
         lookAt = prevLookAt;
         coll->update(make_translate(position.x, position.y, position.z));
     }
-    else {
+    else if (!r || !r->headless) {
         cout << "Movement successful to (" << position.x << ", "
             << position.y << ", " << position.z << ")" << endl;
     }
@@ -108,11 +108,15 @@ void CameraFirstPerson::move(float timeStep)
     if (pitch > 89.0f) pitch = 89.0f;
     if (pitch < -89.0f) pitch = -89.0f;
 
-    // Calcular nueva dirección
+    // Calcular nueva dirección (exacta: alimenta la matriz de vista)
+    float sinYaw, cosYaw, sinPitch, cosPitch;
+    mathExact::sincos(toRadians(yaw), sinYaw, cosYaw);
+    mathExact::sincos(toRadians(pitch), sinPitch, cosPitch);
+
     vector4f direction;
-    direction.x = cos(toRadians(yaw)) * cos(toRadians(pitch));
-    direction.y = sin(toRadians(pitch));
-    direction.z = sin(toRadians(yaw)) * cos(toRadians(pitch));
+    direction.x = cosYaw * cosPitch;
+    direction.y = sinPitch;
+    direction.z = sinYaw * cosPitch;
     direction.w = 0.0f;
     direction = normalize(direction);
 
@@ -151,12 +155,12 @@ void CameraFirstPerson::move(float timeStep)
 
     // Verificar colisión
     if (r && r->cameraCollision(this)) {
-        cout << "Collision occurred, reverting position" << endl;
+        if (!r->headless) cout << "Collision occurred, reverting position" << endl;
         position = prevPosition;
         lookAt = prevLookAt;
         coll->update(make_translate(position.x, position.y, position.z));
     }
-    else {
+    else if (!r || !r->headless) {
         cout << "Movement successful to (" << position.x << ", "
             << position.y << ", " << position.z << ")" << endl;
     }
@@ -1,4 +1,5 @@
 #include "libprgr/Collider.h"
+#include "libprgr/Profiler.h"
 
 // Sphere Implementation
 Sphere::Sphere() {
@@ -20,6 +21,12 @@ Sphere::~Sphere() {
     // Base class destructor will handle sons deletion
 }
 
+Collider* Sphere::clone() const {
+    Sphere* copy = new Sphere(*this);
+    copy->cloneSons();
+    return copy;
+}
+
 void Sphere::addParticle(particle part) {
     partList.push_back(part);
 
@@ -28,11 +35,12 @@ void Sphere::addParticle(particle part) {
 }
 
 bool Sphere::test(Collider* c2) {
+    PROFILE_COUNT(COUNTER_COLLISION_NODES, 1);
     if (c2->type == sphere) {
         Sphere* sph2 = static_cast<Sphere*>(c2);
 
         // Verificar si las esferas estn colisionando
-        float dist = distance(center, sph2->center);
+        float dist = distance<colliderMath>(center, sph2->center);
         bool result = dist <= (radius + sph2->radius);
 
         // Si tienen hijos y las esferas colisionan, verificar los hijos
@@ -83,9 +91,9 @@ void Sphere::update(matrix4x4f mat) {
     // Para el radio, vamos a usar el mayor factor de escala
     // de la matriz para escalarlo uniformemente
     vector4f scale = {
-        length(vector4f{mat.mat2D[0][0], mat.mat2D[0][1], mat.mat2D[0][2], 0}),
-        length(vector4f{mat.mat2D[1][0], mat.mat2D[1][1], mat.mat2D[1][2], 0}),
-        length(vector4f{mat.mat2D[2][0], mat.mat2D[2][1], mat.mat2D[2][2], 0}),
+        length<colliderMath>(vector4f{mat.mat2D[0][0], mat.mat2D[0][1], mat.mat2D[0][2], 0}),
+        length<colliderMath>(vector4f{mat.mat2D[1][0], mat.mat2D[1][1], mat.mat2D[1][2], 0}),
+        length<colliderMath>(vector4f{mat.mat2D[2][0], mat.mat2D[2][1], mat.mat2D[2][2], 0}),
         0
     };
 
@@ -245,6 +253,12 @@ AABB::~AABB() {
     // Base class destructor will handle sons deletion
 }
 
+Collider* AABB::clone() const {
+    AABB* copy = new AABB(*this);
+    copy->cloneSons();
+    return copy;
+}
+
 void AABB::addParticle(particle part) {
     partList.push_back(part);
 
@@ -253,6 +267,7 @@ void AABB::addParticle(particle part) {
 }
 
 bool AABB::test(Collider* c2) {
+    PROFILE_COUNT(COUNTER_COLLISION_NODES, 1);
     if (c2->type == AABB_t) {
         AABB* aabb2 = static_cast<AABB*>(c2);
 
@@ -304,7 +319,7 @@ bool AABB::test(Collider* c2) {
         closest.w = 1;
 
         // Calcular distancia al cuadrado entre el centro de la esfera y el punto ms cercano
-        float dist = distance(closest, sph->center);
+        float dist = distance<colliderMath>(closest, sph->center);
 
         // Hay colisin si la distancia es menor o igual al radio
         bool result = dist <= sph->radius;
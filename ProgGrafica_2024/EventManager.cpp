@@ -1,4 +1,5 @@
 #include "libprgr/EventManager.h"
+#include <cstring>
 
 void EventManager::init(GLFWwindow* window)
 {
@@ -11,6 +12,8 @@ void EventManager::init(GLFWwindow* window)
 
 void EventManager::mouseButtonManager(GLFWwindow* window, int button, int action, int mods)
 {
+	if (button < 0 || button > GLFW_MOUSE_BUTTON_LAST || isReplaying()) return;
+
 	switch (action) {
 	case GLFW_PRESS: {
 		mouseState.buttons[button] = true;
@@ -25,6 +28,8 @@ void EventManager::mouseButtonManager(GLFWwindow* window, int button, int action
 
 void EventManager::mousePosManager(GLFWwindow* window, double x, double y)
 {
+	if (isReplaying()) return;
+
 	mouseState.posX = x;
 	mouseState.posY = y;
 }
@@ -34,6 +39,9 @@ void EventManager::mousePosManager(GLFWwindow* window, double x, double y)
 
 void EventManager::keyEventManager(GLFWwindow* window, int key, int scancode, int action, int mods) 
 {
+	if (key < 0 || key > GLFW_KEY_LAST) return; // GLFW_KEY_UNKNOWN
+	if (isReplaying()) return;
+
 	switch (action) {
 
 		case GLFW_PRESS:
@@ -45,4 +53,205 @@ void EventManager::keyEventManager(GLFWwindow* window, int key, int scancode, in
 			break;
 	
 	}
-}
\ No newline at end of file
+}
+
+
+// --- GRABACION Y REPRODUCCION ---
+
+void EventManager::clearState()
+{
+	for (auto& key : keyState) key = false;
+	for (auto& button : mouseState.buttons) button = false;
+	mouseState.posX = 0;
+	mouseState.posY = 0;
+}
+
+bool EventManager::startRecording(const string& fileName, double simulationRate)
+{
+	stop();
+	// Se comprueba ahora que se puede escribir; los eventos se guardan en memoria hasta stop()
+	ofstream f(fileName, std::ios::binary);
+	if (!f.is_open()) {
+		cout << "ERROR: " << __FILE__ << ":" << __LINE__ << " (" << __func__ << ") No se pudo crear " << fileName << endl;
+		return false;
+	}
+
+	// Se graba contra un estado vacio: el primer tick guarda lo que ya estuviera pulsado y el raton
+	recordFileName = fileName;
+	recordSimulationRate = simulationRate;
+	for (auto& key : recordedKeys) key = false;
+	for (auto& button : recordedButtons) button = false;
+	recordedX = recordedY = 0;
+	recordBuffer.clear();
+	lastEventTick = 0;
+	tick = 0;
+	mode = MODE_RECORDING;
+	cout << "Grabando la entrada en " << fileName << endl;
+	return true;
+}
+
+bool EventManager::startReplay(const string& fileName)
+{
+	stop();
+	ifstream f(fileName, std::ios::binary);
+	if (!f.is_open()) {
+		cout << "ERROR: " << __FILE__ << ":" << __LINE__ << " (" << __func__ << ") No se pudo abrir " << fileName << endl;
+		return false;
+	}
+	vector<uint8_t> data((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+
+	inputFileHeader_t header;
+	const size_t headerSize = sizeof(header.magic) + sizeof(header.version) + sizeof(header.ticks) + sizeof(header.simulationRate);
+	if (data.size() < headerSize) {
+		cout << "ERROR: " << __FILE__ << ":" << __LINE__ << " (" << __func__ << ") " << fileName << " no es una grabacion de entrada" << endl;
+		return false;
+	}
+	size_t pos = 0;
+	auto read = [&](void* dst, size_t size) {
+		if (pos + size > data.size()) return false;
+		memcpy(dst, data.data() + pos, size);
+		pos += size;
+		return true;
+	};
+	read(header.magic, sizeof(header.magic));
+	read(&header.version, sizeof(header.version));
+	read(&header.ticks, sizeof(header.ticks));
+	read(&header.simulationRate, sizeof(header.simulationRate));
+	if (memcmp(header.magic, "PRGI", 4) != 0 || header.version != INPUT_FILE_VERSION) {
+		cout << "ERROR: " << __FILE__ << ":" << __LINE__ << " (" << __func__ << ") " << fileName << " no es una grabacion de entrada de la version " << INPUT_FILE_VERSION << endl;
+		return false;
+	}
+
+	replayEvents.clear();
+	uint32_t eventTick = 0;
+	while (pos < data.size()) {
+		// Ticks desde el evento anterior: 7 bits por byte, el bit alto indica que sigue
+		uint32_t delta = 0;
+		uint8_t byte = 0x80;
+		for (int shift = 0; (byte & 0x80) && shift < 35; shift += 7) {
+			if (!read(&byte, 1)) break;
+			delta |= (uint32_t)(byte & 0x7F) << shift;
+		}
+		eventTick += delta;
+
+		inputRecord_t ev = {};
+		ev.tick = eventTick;
+		bool ok = read(&ev.type, 1);
+		if (ok && ev.type == INPUT_MOUSE_POS)
+			ok = read(&ev.x, sizeof(ev.x)) && read(&ev.y, sizeof(ev.y));
+		else if (ok)
+			ok = read(&ev.code, sizeof(ev.code)) && ev.type <= INPUT_BUTTON_UP;
+		if (!ok) {
+			cout << "ERROR: " << __FILE__ << ":" << __LINE__ << " (" << __func__ << ") " << fileName << " esta cortado o corrupto (evento " << replayEvents.size() << ")" << endl;
+			return false;
+		}
+		replayEvents.push_back(ev);
+	}
+
+	replayLength = header.ticks;
+	replaySimulationRate = header.simulationRate;
+	replayCursor = 0;
+	tick = 0;
+	clearState();
+	mode = MODE_REPLAYING;
+	cout << "Reproduciendo " << fileName << ": " << replayLength << " ticks a " << replaySimulationRate << " por segundo, "
+		<< replayEvents.size() << " eventos" << endl;
+	return true;
+}
+
+void EventManager::writeEvent(inputEvent_e type, uint16_t code, double x, double y)
+{
+	uint32_t delta = tick - lastEventTick;
+	lastEventTick = tick;
+	do {
+		recordBuffer.push_back((uint8_t)((delta & 0x7F) | (delta > 0x7F ? 0x80 : 0)));
+		delta >>= 7;
+	} while (delta);
+
+	recordBuffer.push_back((uint8_t)type);
+	if (type == INPUT_MOUSE_POS) {
+		double pos[2] = { x, y };
+		recordBuffer.insert(recordBuffer.end(), (const uint8_t*)pos, (const uint8_t*)(pos + 2));
+	}
+	else {
+		recordBuffer.insert(recordBuffer.end(), (const uint8_t*)&code, (const uint8_t*)(&code + 1));
+	}
+}
+
+void EventManager::beginTick()
+{
+	int current = mode.load();
+	if (current == MODE_RECORDING) {
+		for (int key = 0; key <= GLFW_KEY_LAST; key++) {
+			bool pressed = keyState[key];
+			if (pressed != recordedKeys[key]) {
+				writeEvent(pressed ? INPUT_KEY_DOWN : INPUT_KEY_UP, (uint16_t)key);
+				recordedKeys[key] = pressed;
+			}
+		}
+		for (int button = 0; button <= GLFW_MOUSE_BUTTON_LAST; button++) {
+			bool pressed = mouseState.buttons[button];
+			if (pressed != recordedButtons[button]) {
+				writeEvent(pressed ? INPUT_BUTTON_DOWN : INPUT_BUTTON_UP, (uint16_t)button);
+				recordedButtons[button] = pressed;
+			}
+		}
+		double x = mouseState.posX, y = mouseState.posY;
+		if (x != recordedX || y != recordedY) {
+			writeEvent(INPUT_MOUSE_POS, 0, x, y);
+			recordedX = x;
+			recordedY = y;
+		}
+		tick++;
+	}
+	else if (current == MODE_REPLAYING) {
+		if (tick >= replayLength) {
+			// Fin de la grabacion: se suelta todo y vuelve la entrada normal
+			stop();
+			return;
+		}
+		for (; replayCursor < replayEvents.size() && replayEvents[replayCursor].tick <= tick; replayCursor++) {
+			const inputRecord_t& ev = replayEvents[replayCursor];
+			switch (ev.type) {
+			case INPUT_KEY_DOWN:
+			case INPUT_KEY_UP:
+				if (ev.code <= GLFW_KEY_LAST) keyState[ev.code] = ev.type == INPUT_KEY_DOWN;
+				break;
+			case INPUT_BUTTON_DOWN:
+			case INPUT_BUTTON_UP:
+				if (ev.code <= GLFW_MOUSE_BUTTON_LAST) mouseState.buttons[ev.code] = ev.type == INPUT_BUTTON_DOWN;
+				break;
+			case INPUT_MOUSE_POS:
+				mouseState.posX = ev.x;
+				mouseState.posY = ev.y;
+				break;
+			}
+		}
+		tick++;
+	}
+}
+
+void EventManager::stop()
+{
+	int current = mode.exchange(MODE_IDLE);
+	if (current == MODE_RECORDING) {
+		ofstream f(recordFileName, std::ios::binary);
+		inputFileHeader_t header = { { 'P', 'R', 'G', 'I' }, INPUT_FILE_VERSION, tick, recordSimulationRate };
+		f.write(header.magic, sizeof(header.magic));
+		f.write((const char*)&header.version, sizeof(header.version));
+		f.write((const char*)&header.ticks, sizeof(header.ticks));
+		f.write((const char*)&header.simulationRate, sizeof(header.simulationRate));
+		f.write((const char*)recordBuffer.data(), recordBuffer.size());
+		if (f.good())
+			cout << "Entrada grabada en " << recordFileName << ": " << tick << " ticks, " << recordBuffer.size() << " bytes de eventos" << endl;
+		else
+			cout << "ERROR: " << __FILE__ << ":" << __LINE__ << " (" << __func__ << ") No se pudo escribir " << recordFileName << endl;
+		recordBuffer.clear();
+	}
+	else if (current == MODE_REPLAYING) {
+		// El raton se queda donde estaba para que la camara no salte al volver la entrada normal
+		for (auto& key : keyState) key = false;
+		for (auto& button : mouseState.buttons) button = false;
+		replayEvents.clear();
+	}
+}
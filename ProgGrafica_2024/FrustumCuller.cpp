@@ -0,0 +1,321 @@
+#include "libprgr/FrustumCuller.h"
+#include <algorithm>
+
+#pragma region --- FRUSTUM CULLER ---
+
+void FrustumCuller::clear()
+{
+	centerX.clear(); centerY.clear(); centerZ.clear();
+	extentX.clear(); extentY.clear(); extentZ.clear();
+	radius.clear();
+}
+
+void FrustumCuller::addSphere(const vector4f& center, float r)
+{
+	centerX.push_back(center.x); centerY.push_back(center.y); centerZ.push_back(center.z);
+	extentX.push_back(0); extentY.push_back(0); extentZ.push_back(0);
+	radius.push_back(r);
+}
+
+void FrustumCuller::addAABB(const vector4f& min, const vector4f& max)
+{
+	centerX.push_back((min.x + max.x) * 0.5f);
+	centerY.push_back((min.y + max.y) * 0.5f);
+	centerZ.push_back((min.z + max.z) * 0.5f);
+	extentX.push_back((max.x - min.x) * 0.5f);
+	extentY.push_back((max.y - min.y) * 0.5f);
+	extentZ.push_back((max.z - min.z) * 0.5f);
+	radius.push_back(0);
+}
+
+void FrustumCuller::add(const Collider* collider)
+{
+	if (!collider) {
+		addSphere({ 0, 0, 0, 1 }, CULL_UNBOUNDED_RADIUS);
+	}
+	else if (collider->type == AABB_t) {
+		const AABB* box = static_cast<const AABB*>(collider);
+		addAABB(box->min, box->max);
+	}
+	else {
+		const Sphere* sph = static_cast<const Sphere*>(collider);
+		addSphere(sph->center, sph->radius);
+	}
+}
+
+// Test de un volumen contra numPlanes planos: true si no esta fuera de ninguno.
+static inline bool insideScalar(const FrustumCuller& b, size_t i, const vector4f* planes, int numPlanes)
+{
+	for (int p = 0; p < numPlanes; p++) {
+		const vector4f& pl = planes[p];
+		float d = pl.x * b.centerX[i] + pl.y * b.centerY[i] + pl.z * b.centerZ[i] + pl.w;
+		float r = b.radius[i] + fabsf(pl.x) * b.extentX[i] + fabsf(pl.y) * b.extentY[i] + fabsf(pl.z) * b.extentZ[i];
+		if (d + r < 0.0f)
+			return false;
+	}
+	return true;
+}
+
+size_t FrustumCuller::cullScalar(const vector4f planes[6], vector<unsigned char>& visible) const
+{
+	size_t n = size();
+	visible.resize(n);
+
+	size_t count = 0;
+	for (size_t i = 0; i < n; i++) {
+		visible[i] = insideScalar(*this, i, planes, 6) ? 1 : 0;
+		count += visible[i];
+	}
+	return count;
+}
+
+#ifdef PRGR_SSE2
+
+// Planos repetidos en los 4 carriles, calculados una vez por llamada.
+typedef struct {
+	__m128 nx, ny, nz, w;
+	__m128 ax, ay, az; // |n|
+} planeSSE_t;
+
+static inline void loadPlanes(const vector4f* planes, int numPlanes, planeSSE_t* out)
+{
+	for (int p = 0; p < numPlanes; p++) {
+		out[p].nx = _mm_set1_ps(planes[p].x);
+		out[p].ny = _mm_set1_ps(planes[p].y);
+		out[p].nz = _mm_set1_ps(planes[p].z);
+		out[p].w = _mm_set1_ps(planes[p].w);
+		out[p].ax = _mm_set1_ps(fabsf(planes[p].x));
+		out[p].ay = _mm_set1_ps(fabsf(planes[p].y));
+		out[p].az = _mm_set1_ps(fabsf(planes[p].z));
+	}
+}
+
+// Mascara de 4 bits con los volumenes que quedan fuera de algun plano.
+static inline int outsideSSE(const planeSSE_t* planes, int numPlanes, __m128 cx, __m128 cy, __m128 cz,
+	__m128 ex, __m128 ey, __m128 ez, __m128 rad)
+{
+	const __m128 zero = _mm_setzero_ps();
+	__m128 outside = zero;
+	for (int p = 0; p < numPlanes; p++) {
+		const planeSSE_t& pl = planes[p];
+		__m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(pl.nx, cx), _mm_mul_ps(pl.ny, cy)), _mm_add_ps(_mm_mul_ps(pl.nz, cz), pl.w));
+		__m128 r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(pl.ax, ex), _mm_mul_ps(pl.ay, ey)), _mm_add_ps(_mm_mul_ps(pl.az, ez), rad));
+		outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(d, r), zero));
+	}
+	return _mm_movemask_ps(outside);
+}
+
+#endif
+
+size_t FrustumCuller::cull(const vector4f planes[6], vector<unsigned char>& visible) const
+{
+	size_t n = size();
+	visible.resize(n);
+
+	size_t count = 0;
+	size_t i = 0;
+#ifdef PRGR_SSE2
+	planeSSE_t pl[6];
+	loadPlanes(planes, 6, pl);
+	for (; i + 4 <= n; i += 4) {
+		int mask = outsideSSE(pl, 6,
+			_mm_loadu_ps(&centerX[i]), _mm_loadu_ps(&centerY[i]), _mm_loadu_ps(&centerZ[i]),
+			_mm_loadu_ps(&extentX[i]), _mm_loadu_ps(&extentY[i]), _mm_loadu_ps(&extentZ[i]),
+			_mm_loadu_ps(&radius[i]));
+		for (int k = 0; k < 4; k++) {
+			visible[i + k] = (mask >> k) & 1 ? 0 : 1;
+			count += visible[i + k];
+		}
+	}
+#endif
+	// Resto (o todo sin SSE2)
+	for (; i < n; i++) {
+		visible[i] = insideScalar(*this, i, planes, 6) ? 1 : 0;
+		count += visible[i];
+	}
+	return count;
+}
+
+size_t FrustumCuller::cullIndices(const vector4f* planes, int numPlanes, const int* indices, size_t count, unsigned char* visible) const
+{
+	size_t visibleCount = 0;
+	size_t k = 0;
+#ifdef PRGR_SSE2
+	planeSSE_t pl[6];
+	loadPlanes(planes, numPlanes, pl);
+
+	// Los indices no son contiguos: se recogen de 4 en 4 en registros
+	auto gather = [&](const vector<float>& v) {
+		return _mm_set_ps(v[indices[k + 3]], v[indices[k + 2]], v[indices[k + 1]], v[indices[k]]);
+	};
+	for (; k + 4 <= count; k += 4) {
+		int mask = outsideSSE(pl, numPlanes, gather(centerX), gather(centerY), gather(centerZ),
+			gather(extentX), gather(extentY), gather(extentZ), gather(radius));
+		for (int j = 0; j < 4; j++) {
+			visible[indices[k + j]] = (mask >> j) & 1 ? 0 : 1;
+			visibleCount += visible[indices[k + j]];
+		}
+	}
+#endif
+	for (; k < count; k++) {
+		visible[indices[k]] = insideScalar(*this, indices[k], planes, numPlanes) ? 1 : 0;
+		visibleCount += visible[indices[k]];
+	}
+	return visibleCount;
+}
+
+#pragma endregion
+
+#pragma region --- CULLING BVH ---
+
+void CullingBVH::build(const FrustumCuller& bounds)
+{
+	int n = (int)bounds.size();
+	indices.resize(n);
+	for (int i = 0; i < n; i++)
+		indices[i] = i;
+
+	nodes.clear();
+	if (n == 0) return;
+
+	nodes.reserve(n / 4 + 1);
+	nodes.push_back({});
+	buildNode(bounds, 0, 0, n);
+}
+
+void CullingBVH::fitLeaf(const FrustumCuller& bounds, node_t& node) const
+{
+	for (int a = 0; a < 3; a++) {
+		node.min[a] = CULL_UNBOUNDED_RADIUS;
+		node.max[a] = -CULL_UNBOUNDED_RADIUS;
+	}
+
+	for (int k = node.first; k < node.first + node.count; k++) {
+		int i = indices[k];
+		float c[3] = { bounds.centerX[i], bounds.centerY[i], bounds.centerZ[i] };
+		float e[3] = { bounds.extentX[i], bounds.extentY[i], bounds.extentZ[i] };
+		for (int a = 0; a < 3; a++) {
+			node.min[a] = std::min(node.min[a], c[a] - e[a] - bounds.radius[i]);
+			node.max[a] = std::max(node.max[a], c[a] + e[a] + bounds.radius[i]);
+		}
+	}
+}
+
+void CullingBVH::buildNode(const FrustumCuller& bounds, int node, int first, int count)
+{
+	nodes[node].first = first;
+	nodes[node].count = count;
+	nodes[node].left = -1;
+
+	if (count <= LEAF_SIZE) {
+		fitLeaf(bounds, nodes[node]);
+		return;
+	}
+
+	// Eje mas largo de la caja de los centros
+	float cmin[3] = { CULL_UNBOUNDED_RADIUS, CULL_UNBOUNDED_RADIUS, CULL_UNBOUNDED_RADIUS };
+	float cmax[3] = { -CULL_UNBOUNDED_RADIUS, -CULL_UNBOUNDED_RADIUS, -CULL_UNBOUNDED_RADIUS };
+	const vector<float>* centers[3] = { &bounds.centerX, &bounds.centerY, &bounds.centerZ };
+	for (int k = first; k < first + count; k++) {
+		for (int a = 0; a < 3; a++) {
+			cmin[a] = std::min(cmin[a], (*centers[a])[indices[k]]);
+			cmax[a] = std::max(cmax[a], (*centers[a])[indices[k]]);
+		}
+	}
+	int axis = 0;
+	for (int a = 1; a < 3; a++)
+		if (cmax[a] - cmin[a] > cmax[axis] - cmin[axis]) axis = a;
+
+	// Mitad de los objetos a cada lado de la mediana
+	const vector<float>& c = *centers[axis];
+	int half = count / 2;
+	std::nth_element(indices.begin() + first, indices.begin() + first + half, indices.begin() + first + count,
+		[&c](int a, int b) { return c[a] < c[b]; });
+
+	int left = (int)nodes.size();
+	nodes[node].left = left;
+	nodes.push_back({});
+	nodes.push_back({});
+	buildNode(bounds, left, first, half);
+	buildNode(bounds, left + 1, first + half, count - half);
+
+	// Caja del padre: union de las de los hijos
+	const node_t& l = nodes[left];
+	const node_t& r = nodes[left + 1];
+	for (int a = 0; a < 3; a++) {
+		nodes[node].min[a] = std::min(l.min[a], r.min[a]);
+		nodes[node].max[a] = std::max(l.max[a], r.max[a]);
+	}
+}
+
+void CullingBVH::refit(const FrustumCuller& bounds)
+{
+	// Los hijos siempre tienen indice mayor que su padre: basta recorrer al reves
+	for (int i = (int)nodes.size() - 1; i >= 0; i--) {
+		node_t& node = nodes[i];
+		if (node.left < 0) {
+			fitLeaf(bounds, node);
+			continue;
+		}
+		const node_t& l = nodes[node.left];
+		const node_t& r = nodes[node.left + 1];
+		for (int a = 0; a < 3; a++) {
+			node.min[a] = std::min(l.min[a], r.min[a]);
+			node.max[a] = std::max(l.max[a], r.max[a]);
+		}
+	}
+}
+
+size_t CullingBVH::cull(const FrustumCuller& bounds, const vector4f planes[6], vector<unsigned char>& visible)
+{
+	visible.assign(bounds.size(), 0);
+	nodesVisited = 0;
+	if (nodes.empty()) return 0;
+
+	return cullNode(bounds, 0, planes, 0x3F, visible.data());
+}
+
+size_t CullingBVH::cullNode(const FrustumCuller& bounds, int index, const vector4f planes[6], int planeMask, unsigned char* visible)
+{
+	nodesVisited++;
+	const node_t& node = nodes[index];
+
+	float c[3], e[3];
+	for (int a = 0; a < 3; a++) {
+		c[a] = (node.min[a] + node.max[a]) * 0.5f;
+		e[a] = (node.max[a] - node.min[a]) * 0.5f;
+	}
+
+	// Solo los planos que el padre no tiene ya completamente dentro
+	for (int p = 0; p < 6; p++) {
+		if (!(planeMask & (1 << p))) continue;
+
+		const vector4f& pl = planes[p];
+		float d = pl.x * c[0] + pl.y * c[1] + pl.z * c[2] + pl.w;
+		float r = fabsf(pl.x) * e[0] + fabsf(pl.y) * e[1] + fabsf(pl.z) * e[2];
+		if (d + r < 0.0f)
+			return 0; // Todo el subarbol fuera
+		if (d - r >= 0.0f)
+			planeMask &= ~(1 << p); // Los hijos ya no necesitan este plano
+	}
+
+	// Dentro de todos los planos: todo el subarbol es visible sin probar objetos
+	if (planeMask == 0) {
+		for (int k = node.first; k < node.first + node.count; k++)
+			visible[indices[k]] = 1;
+		return node.count;
+	}
+
+	if (node.left < 0) {
+		vector4f active[6];
+		int numActive = 0;
+		for (int p = 0; p < 6; p++)
+			if (planeMask & (1 << p)) active[numActive++] = planes[p];
+		return bounds.cullIndices(active, numActive, &indices[node.first], node.count, visible);
+	}
+
+	int left = node.left;
+	return cullNode(bounds, left, planes, planeMask, visible) + cullNode(bounds, left + 1, planes, planeMask, visible);
+}
+
+#pragma endregion
@@ -0,0 +1,160 @@
+#include "libprgr/GeometryArena.h"
+#include "libprgr/Mesh.h"
+#include <algorithm>
+
+#pragma region --- GEOMETRY ARENA ---
+
+GeometryArena::GeometryArena(const VertexLayout* layout, GLenum indexType, size_t vertexCapacity, size_t indexCapacity) :
+	layout(layout), indexType(indexType), vertexCapacity(vertexCapacity), indexCapacity(indexCapacity)
+{
+	glGenVertexArrays(1, &idArray);
+	glGenBuffers(1, &idVertexArray);
+	glGenBuffers(1, &idIndexArray);
+
+	glBindBuffer(GL_ARRAY_BUFFER, idVertexArray);
+	glBufferData(GL_ARRAY_BUFFER, vertexCapacity * layout->stride, nullptr, GL_STATIC_DRAW);
+
+	// El IBO se enlaza con el VAO: queda guardado en el
+	glBindVertexArray(idArray);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, idIndexArray);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCapacity * indexSize(), nullptr, GL_STATIC_DRAW);
+	glBindVertexArray(0);
+
+	freeVertices.push_back({ 0, vertexCapacity });
+	freeIndices.push_back({ 0, indexCapacity });
+}
+
+GeometryArena::~GeometryArena()
+{
+	glDeleteBuffers(1, &idVertexArray);
+	glDeleteBuffers(1, &idIndexArray);
+	glDeleteVertexArrays(1, &idArray);
+}
+
+GeometryArena* GeometryArena::get(const VertexLayout* layout, GLenum indexType)
+{
+	for (GeometryArena* arena : arenas)
+		if (arena->layout == layout && arena->indexType == indexType)
+			return arena;
+
+	GeometryArena* arena = new GeometryArena(layout, indexType);
+	arenas.push_back(arena);
+	return arena;
+}
+
+void GeometryArena::clear()
+{
+	for (GeometryArena* arena : arenas)
+		delete arena;
+	arenas.clear();
+}
+
+void GeometryArena::grow(unsigned int& buffer, size_t oldBytes, size_t newBytes)
+{
+	unsigned int bigger;
+	glGenBuffers(1, &bigger);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, bigger);
+	glBufferData(GL_COPY_WRITE_BUFFER, newBytes, nullptr, GL_STATIC_DRAW);
+	glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, oldBytes);
+	glDeleteBuffers(1, &buffer);
+	buffer = bigger;
+}
+
+size_t GeometryArena::allocate(vector<range_t>& freeList, size_t& capacity, size_t count, unsigned int& buffer, size_t elementSize)
+{
+	for (;;) {
+		for (size_t i = 0; i < freeList.size(); i++) {
+			range_t& r = freeList[i];
+			if (r.count < count) continue;
+
+			size_t first = r.first;
+			r.first += count;
+			r.count -= count;
+			if (r.count == 0) freeList.erase(freeList.begin() + i);
+			return first;
+		}
+
+		// No cabe: el doble (o lo necesario) y el hueco nuevo se une al ultimo si estaba libre al final
+		size_t newCapacity = std::max(capacity * 2, capacity + count);
+		grow(buffer, capacity * elementSize, newCapacity * elementSize);
+		release(freeList, capacity, newCapacity - capacity);
+		capacity = newCapacity;
+	}
+}
+
+void GeometryArena::release(vector<range_t>& freeList, size_t first, size_t count)
+{
+	if (count == 0) return;
+
+	// Lista ordenada por posicion; se funde con los vecinos contiguos
+	auto it = std::lower_bound(freeList.begin(), freeList.end(), first, [](const range_t& r, size_t f) { return r.first < f; });
+	it = freeList.insert(it, { first, count });
+	if (it + 1 != freeList.end() && it->first + it->count == (it + 1)->first) {
+		it->count += (it + 1)->count;
+		freeList.erase(it + 1);
+	}
+	if (it != freeList.begin() && (it - 1)->first + (it - 1)->count == it->first) {
+		(it - 1)->count += it->count;
+		freeList.erase(it);
+	}
+}
+
+void GeometryArena::add(Mesh* mesh, const void* indices, size_t indexCount, StagingBuffer* staging)
+{
+	size_t vertexCount = mesh->vertexList.size();
+	unsigned int oldIndexBuffer = idIndexArray;
+
+	size_t baseVertex = allocate(freeVertices, vertexCapacity, vertexCount, idVertexArray, layout->stride);
+	size_t firstIndex = allocate(freeIndices, indexCapacity, indexCount, idIndexArray, indexSize());
+
+	// Si el IBO ha crecido es otro buffer: el VAO tiene que apuntar al nuevo
+	if (idIndexArray != oldIndexBuffer) {
+		glBindVertexArray(idArray);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, idIndexArray);
+		glBindVertexArray(0);
+	}
+
+	size_t indexBytes = indexCount * indexSize();
+	if (staging) {
+		// La copia del buffer de subida a la arena la hace la GPU, sin que el driver espere a los
+		// dibujados que aun leen la arena
+		size_t offset = staging->write(GL_COPY_READ_BUFFER, indices, indexBytes);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, idIndexArray);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, offset, firstIndex * indexSize(), indexBytes);
+
+		offset = staging->write(GL_COPY_READ_BUFFER, mesh->packedVertices.data(), mesh->packedVertices.size());
+		glBindBuffer(GL_COPY_WRITE_BUFFER, idVertexArray);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, offset, baseVertex * layout->stride, mesh->packedVertices.size());
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	}
+	else {
+		glBindVertexArray(idArray);
+		glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, firstIndex * indexSize(), indexBytes, indices);
+		glBindVertexArray(0);
+
+		glBindBuffer(GL_ARRAY_BUFFER, idVertexArray);
+		glBufferSubData(GL_ARRAY_BUFFER, baseVertex * layout->stride, mesh->packedVertices.size(), mesh->packedVertices.data());
+	}
+
+	mesh->arena = this;
+	mesh->baseVertex = (unsigned int)baseVertex;
+	mesh->arenaFirstIndex = (unsigned int)firstIndex;
+	usedVertices += vertexCount;
+	usedIndices += indexCount;
+}
+
+void GeometryArena::remove(Mesh* mesh)
+{
+	if (mesh->arena != this) return;
+
+	size_t indexCount = mesh->idList.size() + mesh->lodIdList.size();
+	release(freeVertices, mesh->baseVertex, mesh->vertexList.size());
+	release(freeIndices, mesh->arenaFirstIndex, indexCount);
+	usedVertices -= mesh->vertexList.size();
+	usedIndices -= indexCount;
+	mesh->arena = nullptr;
+}
+
+#pragma endregion
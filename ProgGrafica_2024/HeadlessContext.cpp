@@ -0,0 +1,179 @@
+#include "libprgr/HeadlessContext.h"
+#include <cstring>
+
+#ifdef __linux__
+// La copia de khrplatform.h de glad es anterior a KHRONOS_APIENTRY, que usan las cabeceras de EGL
+#ifndef KHRONOS_APIENTRY
+#define KHRONOS_APIENTRY
+#endif
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+#pragma region --- HEADLESS CONTEXT ---
+
+#ifdef __linux__
+
+bool HeadlessContext::createEGL(bool surfaceless)
+{
+	EGLDisplay dpy = EGL_NO_DISPLAY;
+	if (surfaceless) {
+		const char* extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+		if (!extensions || !strstr(extensions, "EGL_MESA_platform_surfaceless"))
+			return false;
+		auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+		if (getPlatformDisplay)
+			dpy = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+	}
+	else {
+		dpy = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	}
+	if (dpy == EGL_NO_DISPLAY || !eglInitialize(dpy, nullptr, nullptr))
+		return false;
+	if (!eglBindAPI(EGL_OPENGL_API)) {
+		eglTerminate(dpy);
+		return false;
+	}
+
+	// Sin superficie basta cualquier configuracion con GL; el pbuffer necesita una que lo admita
+	const EGLint configAttribs[] = {
+		EGL_SURFACE_TYPE, surfaceless ? 0 : EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_NONE
+	};
+	EGLConfig config;
+	EGLint numConfigs = 0;
+	if (!eglChooseConfig(dpy, configAttribs, &config, 1, &numConfigs) || numConfigs == 0) {
+		eglTerminate(dpy);
+		return false;
+	}
+
+	// Primero compatibilidad sin version (lo mismo que crea GLFW en escritorio: la mas alta que haya);
+	// si el driver solo da core, la mas alta de las que usa el Render
+	const EGLint attempts[][2] = { { 0, 0 }, { 4, 6 }, { 4, 5 }, { 4, 3 }, { 4, 1 }, { 3, 3 } };
+	EGLContext ctx = EGL_NO_CONTEXT;
+	int used = 0;
+	for (; used < 6 && ctx == EGL_NO_CONTEXT; used++) {
+		const EGLint* v = attempts[used];
+		vector<EGLint> attribs;
+		if (v[0])
+			attribs = { EGL_CONTEXT_MAJOR_VERSION, v[0], EGL_CONTEXT_MINOR_VERSION, v[1], EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT };
+		else
+			attribs = { EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_COMPATIBILITY_PROFILE_BIT };
+		attribs.push_back(EGL_NONE);
+		ctx = eglCreateContext(dpy, config, EGL_NO_CONTEXT, attribs.data());
+	}
+	if (ctx == EGL_NO_CONTEXT) {
+		eglTerminate(dpy);
+		return false;
+	}
+
+	EGLSurface surf = EGL_NO_SURFACE;
+	if (!surfaceless) {
+		const EGLint pbufferAttribs[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+		surf = eglCreatePbufferSurface(dpy, config, pbufferAttribs);
+		if (surf == EGL_NO_SURFACE) {
+			eglDestroyContext(dpy, ctx);
+			eglTerminate(dpy);
+			return false;
+		}
+	}
+	if (!eglMakeCurrent(dpy, surf, surf, ctx)) {
+		if (surf != EGL_NO_SURFACE) eglDestroySurface(dpy, surf);
+		eglDestroyContext(dpy, ctx);
+		eglTerminate(dpy);
+		return false;
+	}
+
+	display = dpy;
+	context = ctx;
+	surface = surf;
+	const EGLint* v = attempts[used - 1];
+	info = string(surfaceless ? "EGL sin superficie" : "EGL pbuffer") +
+		(v[0] ? ", core " + std::to_string(v[0]) + "." + std::to_string(v[1]) : ", compatibilidad");
+	return true;
+}
+
+bool HeadlessContext::create()
+{
+	if (created) return true;
+	created = createEGL(true) || createEGL(false);
+	if (!created)
+		cout << "ERROR: " << __FILE__ << ":" << __LINE__ << " (" << __func__ << ") No se pudo crear un contexto EGL (error 0x" << std::hex << eglGetError() << std::dec << ")" << endl;
+	return created;
+}
+
+void HeadlessContext::destroy()
+{
+	if (!created) return;
+	eglMakeCurrent((EGLDisplay)display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+	if (surface) eglDestroySurface((EGLDisplay)display, (EGLSurface)surface);
+	eglDestroyContext((EGLDisplay)display, (EGLContext)context);
+	eglTerminate((EGLDisplay)display);
+	display = context = surface = nullptr;
+	created = false;
+}
+
+GLADloadfunc HeadlessContext::loader()
+{
+	return (GLADloadfunc)eglGetProcAddress;
+}
+
+#else
+
+bool HeadlessContext::create()
+{
+	if (created) return true;
+	if (glfwInit() != GLFW_TRUE) {
+		cout << "ERROR: " << __FILE__ << ":" << __LINE__ << " (" << __func__ << ") al inicializar GLFW" << endl;
+		return false;
+	}
+
+	// Ventana de 1x1 que nunca se muestra: solo aporta el contexto
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+#ifdef __APPLE__
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
+	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+#endif
+	hiddenWindow = glfwCreateWindow(1, 1, "Headless", nullptr, nullptr);
+	if (!hiddenWindow) {
+		cout << "ERROR: " << __FILE__ << ":" << __LINE__ << " (" << __func__ << ") No se pudo crear la ventana oculta" << endl;
+		glfwTerminate();
+		return false;
+	}
+	glfwMakeContextCurrent(hiddenWindow);
+	info = "ventana GLFW oculta";
+	created = true;
+	return true;
+}
+
+void HeadlessContext::destroy()
+{
+	if (!created) return;
+	glfwDestroyWindow(hiddenWindow);
+	hiddenWindow = nullptr;
+	glfwTerminate();
+	created = false;
+}
+
+GLADloadfunc HeadlessContext::loader()
+{
+	return glfwGetProcAddress;
+}
+
+#endif
+
+bool HeadlessContext::hasExtension(const char* name)
+{
+	GLint count = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+	for (GLint i = 0; i < count; i++) {
+		const char* ext = (const char*)glGetStringi(GL_EXTENSIONS, i);
+		if (ext && strcmp(ext, name) == 0) return true;
+	}
+	return false;
+}
+
+#pragma endregion
@@ -0,0 +1,96 @@
+#include "libprgr/ImageWriter.h"
+
+#pragma region --- IMAGE WRITER ---
+
+uint32_t ImageWriter::crc32(uint32_t crc, const uint8_t* data, size_t size)
+{
+	static uint32_t table[256];
+	static bool tableReady = false;
+	if (!tableReady) {
+		for (uint32_t n = 0; n < 256; n++) {
+			uint32_t c = n;
+			for (int k = 0; k < 8; k++)
+				c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+			table[n] = c;
+		}
+		tableReady = true;
+	}
+
+	crc = ~crc;
+	for (size_t i = 0; i < size; i++)
+		crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+	return ~crc;
+}
+
+bool ImageWriter::writePNG(const string& fileName, int width, int height, const uint8_t* rgba, bool flipY)
+{
+	ofstream f(fileName, std::ios::binary);
+	if (!f.is_open()) {
+		cout << "ERROR: " << __FILE__ << ":" << __LINE__ << " (" << __func__ << ") No se pudo crear " << fileName << endl;
+		return false;
+	}
+
+	auto put32 = [](vector<uint8_t>& out, uint32_t v) {
+		out.push_back((uint8_t)(v >> 24));
+		out.push_back((uint8_t)(v >> 16));
+		out.push_back((uint8_t)(v >> 8));
+		out.push_back((uint8_t)v);
+	};
+
+	// Cada chunk: longitud, tipo + datos y CRC del tipo + datos
+	auto writeChunk = [&](const char* type, const vector<uint8_t>& data) {
+		vector<uint8_t> chunk;
+		put32(chunk, (uint32_t)data.size());
+		chunk.insert(chunk.end(), type, type + 4);
+		chunk.insert(chunk.end(), data.begin(), data.end());
+		put32(chunk, crc32(0, chunk.data() + 4, chunk.size() - 4));
+		f.write((const char*)chunk.data(), chunk.size());
+	};
+
+	static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	f.write((const char*)signature, sizeof(signature));
+
+	// Cabecera: 8 bits por canal, RGBA (tipo 6), sin entrelazado
+	vector<uint8_t> header;
+	put32(header, (uint32_t)width);
+	put32(header, (uint32_t)height);
+	header.insert(header.end(), { 8, 6, 0, 0, 0 });
+	writeChunk("IHDR", header);
+
+	// Filas con el filtro 0 (ninguno) delante
+	size_t rowBytes = (size_t)width * 4;
+	vector<uint8_t> raw;
+	raw.reserve((rowBytes + 1) * height);
+	for (int y = 0; y < height; y++) {
+		const uint8_t* row = rgba + (size_t)(flipY ? height - 1 - y : y) * rowBytes;
+		raw.push_back(0);
+		raw.insert(raw.end(), row, row + rowBytes);
+	}
+
+	// zlib: cabecera, bloques deflate almacenados (como mucho 65535 bytes cada uno) y Adler-32
+	vector<uint8_t> zlib = { 0x78, 0x01 };
+	for (size_t pos = 0; pos < raw.size() || pos == 0; ) {
+		size_t len = std::min<size_t>(raw.size() - pos, 65535);
+		bool last = pos + len == raw.size();
+		zlib.push_back(last ? 1 : 0);
+		zlib.push_back((uint8_t)len);
+		zlib.push_back((uint8_t)(len >> 8));
+		zlib.push_back((uint8_t)~len);
+		zlib.push_back((uint8_t)(~len >> 8));
+		zlib.insert(zlib.end(), raw.begin() + pos, raw.begin() + pos + len);
+		pos += len;
+		if (last) break;
+	}
+	uint32_t a = 1, b = 0;
+	for (uint8_t byte : raw) {
+		a = (a + byte) % 65521;
+		b = (b + a) % 65521;
+	}
+	put32(zlib, (b << 16) | a);
+	writeChunk("IDAT", zlib);
+	writeChunk("IEND", {});
+
+	return f.good();
+}
+
+#pragma endregion
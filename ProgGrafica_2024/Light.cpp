@@ -17,11 +17,11 @@ vector4f Light::normalizeColor(vector4f col) {
     return col;
 }
 
-OrbitalLight::OrbitalLight(vector4f center, float radius, float speed,
+OrbitalLight::OrbitalLight(vector4f center, float orbitRadius, float speed,
     vector4f color, float intensity, vector4f rotationAxis) :
     Light(POINT, center, color, intensity),
     center(center),
-    radius(radius),
+    orbitRadius(orbitRadius),
     speed(speed),
     rotationAxis(normalize(rotationAxis))
 {
@@ -31,11 +31,11 @@ OrbitalLight::OrbitalLight(vector4f center, float radius, float speed,
 vector4f OrbitalLight::calculateOrbitPosition(float angle) const 
 {
     // Usamos tus operadores vectoriales existentes
-    vector4f initialPoint = { radius, 0, 0, 1.0f }; // Punto inicial en el eje X
+    vector4f initialPoint = { orbitRadius, 0, 0, 1.0f }; // Punto inicial en el eje X
 
     // Rotacin usando la frmula de Rodrigues con tus operadores
-    float cosTheta = cos(angle);
-    float sinTheta = sin(angle);
+    float cosTheta, sinTheta;
+    mathFast::sincos(angle, sinTheta, cosTheta);
 
     // Usamos tus operadores * (producto escalar) y ^ (producto cruz)
     vector4f term1 = initialPoint * cosTheta;
@@ -0,0 +1,201 @@
+#include "libprgr/LightClusters.h"
+#include <algorithm>
+
+#pragma region --- LIGHT CLUSTERS ---
+
+void LightClusters::setGrid(int tilesX, int tilesY, int slices)
+{
+	tilesX = std::max(tilesX, 1);
+	tilesY = std::max(tilesY, 1);
+	slices = std::max(slices, 1);
+	if (tilesX == gridX && tilesY == gridY && slices == gridZ)
+		return;
+	gridX = tilesX;
+	gridY = tilesY;
+	gridZ = slices;
+	boxesDirty = true;
+}
+
+void LightClusters::setProjection(const matrix4x4f& projection, float zNear, float zFar)
+{
+	// Vista -> clip: x' = [0][0] * x, y' = [1][1] * y, w = [3][2] * z + [3][3] con z = -profundidad
+	float scaleX = projection.mat2D[0][0], scaleY = projection.mat2D[1][1];
+	float wScale = -projection.mat2D[3][2], wOffset = projection.mat2D[3][3];
+	if (scaleX == projX && scaleY == projY && wScale == projW && wOffset == projW0 && zNear == nearZ && zFar == farZ)
+		return;
+	projX = scaleX;
+	projY = scaleY;
+	projW = wScale;
+	projW0 = wOffset;
+	nearZ = zNear;
+	farZ = zFar;
+	boxesDirty = true;
+}
+
+int LightClusters::sliceOf(float depth) const
+{
+	int slice = (int)(logf(std::max(depth, nearZ) / nearZ) * sliceFactor);
+	return std::clamp(slice, 0, gridZ - 1);
+}
+
+int LightClusters::tileOf(float ndc, int tiles) const
+{
+	return std::clamp((int)floorf((ndc * 0.5f + 0.5f) * tiles), 0, tiles - 1);
+}
+
+void LightClusters::buildBoxes()
+{
+	boxesDirty = false;
+	sliceFactor = gridZ / logf(farZ / nearZ);
+
+	size_t n = clusterCount();
+	for (vector<float>* v : { &minX, &minY, &minZ, &maxX, &maxY, &maxZ })
+		v->assign(n + 3, 0.0f);
+
+	// Cada froxel es un tronco de piramide: su caja cubre las esquinas de la celda en sus dos cortes
+	for (int k = 0; k < gridZ; k++) {
+		float dNear = nearZ * powf(farZ / nearZ, (float)k / gridZ);
+		float dFar = nearZ * powf(farZ / nearZ, (float)(k + 1) / gridZ);
+		for (int j = 0; j < gridY; j++) {
+			float y0 = -1.0f + 2.0f * j / gridY, y1 = -1.0f + 2.0f * (j + 1) / gridY;
+			for (int i = 0; i < gridX; i++) {
+				float x0 = -1.0f + 2.0f * i / gridX, x1 = -1.0f + 2.0f * (i + 1) / gridX;
+				size_t c = ((size_t)k * gridY + j) * gridX + i;
+				// Esquinas en vista: x = ndc * w / escala (con escala negativa la imagen sale invertida)
+				float wNear = clipW(dNear), wFar = clipW(dFar);
+				float xs[4] = { x0 * wNear / projX, x0 * wFar / projX, x1 * wNear / projX, x1 * wFar / projX };
+				float ys[4] = { y0 * wNear / projY, y0 * wFar / projY, y1 * wNear / projY, y1 * wFar / projY };
+				minX[c] = *std::min_element(xs, xs + 4);
+				maxX[c] = *std::max_element(xs, xs + 4);
+				minY[c] = *std::min_element(ys, ys + 4);
+				maxY[c] = *std::max_element(ys, ys + 4);
+				minZ[c] = -dFar;
+				maxZ[c] = -dNear;
+			}
+		}
+	}
+}
+
+size_t LightClusters::assign(const matrix4x4f& view, const pointLight_t* lights, const pointLight_t* previous, size_t count)
+{
+	if (boxesDirty)
+		buildBoxes();
+
+	size_t n = clusterCount();
+	counts.assign(n, 0);
+	pairCluster.clear();
+	pairLight.clear();
+	visibleLights = 0;
+
+	for (size_t l = 0; l < count; l++) {
+		// Esfera en mundo; interpolada, la luz recorre el segmento entre las dos posiciones
+		const vector4f& p = lights[l].positionRadius;
+		float wx = p.x, wy = p.y, wz = p.z, r = p.w;
+		if (previous) {
+			const vector4f& q = previous[l].positionRadius;
+			float dx = p.x - q.x, dy = p.y - q.y, dz = p.z - q.z;
+			wx = (p.x + q.x) * 0.5f;
+			wy = (p.y + q.y) * 0.5f;
+			wz = (p.z + q.z) * 0.5f;
+			r += 0.5f * sqrtf(dx * dx + dy * dy + dz * dz);
+		}
+		if (r <= 0.0f) continue;
+
+		// A espacio de vista (componente a componente: los operadores de vector4f fijan w = 1)
+		const float (*m)[4] = view.mat2D;
+		float cx = m[0][0] * wx + m[0][1] * wy + m[0][2] * wz + m[0][3];
+		float cy = m[1][0] * wx + m[1][1] * wy + m[1][2] * wz + m[1][3];
+		float cz = m[2][0] * wx + m[2][1] * wy + m[2][2] * wz + m[2][3];
+
+		float depth = -cz;
+		float dMin = depth - r, dMax = depth + r;
+		if (dMax < nearZ || dMin > farZ) continue;
+		int k0 = sliceOf(dMin), k1 = sliceOf(std::min(dMax, farZ));
+
+		// Celdas que puede cubrir: la caja de la esfera proyectada en sus profundidades extremas.
+		// Si la esfera llega a w = 0 la proyeccion no esta acotada y se prueban todas
+		int i0 = 0, i1 = gridX - 1, j0 = 0, j1 = gridY - 1;
+		float wMin = clipW(dMin), wMax = clipW(dMax);
+		if (wMin > 0.0f) {
+			// x / w de la caja de la esfera: minimo y maximo en su profundidad mas cercana o mas lejana
+			auto ndcRange = [&](float center, float scale, int tiles, int& first, int& last) {
+				float lo = center - r, hi = center + r;
+				float a = scale * (lo < 0 ? lo / wMin : lo / wMax);
+				float b = scale * (hi > 0 ? hi / wMin : hi / wMax);
+				if (scale < 0) std::swap(a, b);
+				if (b < -1.0f || a > 1.0f) return false;
+				first = tileOf(a, tiles);
+				last = tileOf(b, tiles);
+				return true;
+			};
+			if (!ndcRange(cx, projX, gridX, i0, i1) || !ndcRange(cy, projY, gridY, j0, j1))
+				continue;
+		}
+
+		// Esfera contra caja: distancia del centro a la caja (0 dentro) frente al radio
+		float r2 = r * r;
+		size_t pairsBefore = pairCluster.size();
+#ifdef PRGR_SSE2
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 vx = _mm_set1_ps(cx), vy = _mm_set1_ps(cy), vz = _mm_set1_ps(cz), vr2 = _mm_set1_ps(r2);
+#endif
+		for (int k = k0; k <= k1; k++) {
+			for (int j = j0; j <= j1; j++) {
+				size_t row = ((size_t)k * gridY + j) * gridX;
+				int i = i0;
+#ifdef PRGR_SSE2
+				for (; i <= i1; i += 4) {
+					size_t c = row + i;
+					__m128 dx = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&minX[c]), vx), _mm_sub_ps(vx, _mm_loadu_ps(&maxX[c]))), zero);
+					__m128 dy = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&minY[c]), vy), _mm_sub_ps(vy, _mm_loadu_ps(&maxY[c]))), zero);
+					__m128 dz = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&minZ[c]), vz), _mm_sub_ps(vz, _mm_loadu_ps(&maxZ[c]))), zero);
+					__m128 d2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+					int mask = _mm_movemask_ps(_mm_cmple_ps(d2, vr2));
+
+					// Los carriles pasados de i1 son de otra fila (o del relleno)
+					mask &= (1 << std::min(4, i1 - i + 1)) - 1;
+					for (int lane = 0; lane < 4; lane++) {
+						if (!((mask >> lane) & 1)) continue;
+						pairCluster.push_back((uint32_t)(c + lane));
+						pairLight.push_back((uint32_t)l);
+						counts[c + lane]++;
+					}
+				}
+#endif
+				// Sin SSE2
+				for (; i <= i1; i++) {
+					size_t c = row + i;
+					float dx = std::max(std::max(minX[c] - cx, cx - maxX[c]), 0.0f);
+					float dy = std::max(std::max(minY[c] - cy, cy - maxY[c]), 0.0f);
+					float dz = std::max(std::max(minZ[c] - cz, cz - maxZ[c]), 0.0f);
+					if (dx * dx + dy * dy + dz * dz <= r2) {
+						pairCluster.push_back((uint32_t)c);
+						pairLight.push_back((uint32_t)l);
+						counts[c]++;
+					}
+				}
+			}
+		}
+		if (pairCluster.size() > pairsBefore)
+			visibleLights++;
+	}
+
+	// Tramos por cluster (suma de prefijos) y luces de cada tramo en el orden de entrada
+	table.resize(n * 2);
+	maxLightsPerCluster = 0;
+	uint32_t offset = 0;
+	for (size_t c = 0; c < n; c++) {
+		table[c * 2] = offset;
+		table[c * 2 + 1] = 0;
+		offset += counts[c];
+		maxLightsPerCluster = std::max(maxLightsPerCluster, counts[c]);
+	}
+	indices.resize(pairCluster.size());
+	for (size_t k = 0; k < pairCluster.size(); k++) {
+		uint32_t c = pairCluster[k];
+		indices[table[c * 2] + table[c * 2 + 1]++] = pairLight[k];
+	}
+	return pairCluster.size();
+}
+
+#pragma endregion
@@ -1,5 +1,9 @@
 #define GLAD_BIN
 #include "libprgr/Render.h"
+#include "libprgr/MathBenchmark.h"
+#include "libprgr/OcclusionValidator.h"
+#include "libprgr/RenderBenchmark.h"
+#include "libprgr/ProgramLibrary.h"
 
 using namespace libPRGR;
 using namespace std;
@@ -9,30 +13,230 @@ using namespace std;
 
 int main(int argc, char** argv)
 {
+    // Sin ventana ni pantalla: "--headless [frames] [imagen.png] [salida.json]" dibuja la escena normal y
+    // "--headless --bench-..." lanza ese benchmark. El resto de argumentos se leen como sin --headless
+    bool headless = argc > 1 && string(argv[1]) == "--headless";
+    if (headless) {
+        argc--;
+        argv++;
+    }
+
+    // Entrada grabada (despues de --headless si lo hay): "--record fichero" guarda el teclado y el raton
+    // de cada tick y "--replay fichero" los reproduce en su lugar, siempre con el mismo recorrido
+    string recordFile, replayFile;
+    if (argc > 2 && (string(argv[1]) == "--record" || string(argv[1]) == "--replay")) {
+        (string(argv[1]) == "--record" ? recordFile : replayFile) = argv[2];
+        argc -= 2;
+        argv += 2;
+    }
+
+    // Benchmark de vectorMath.h (no necesita ventana): --bench-math [salida.json]
+    if (argc > 1 && string(argv[1]) == "--bench-math") {
+        MathBenchmark bench;
+        bench.run();
+        bench.print();
+        bench.writeJSON(argc > 2 ? argv[2] : "math_benchmark.json");
+        return bench.accuracyPassed() ? 0 : 1;
+    }
+
+    // Culling por oclusion contra el rasterizado de referencia (no necesita ventana): --test-occlusion [salida.json]
+    if (argc > 1 && string(argv[1]) == "--test-occlusion") {
+        OcclusionValidator validator;
+        validator.run();
+        validator.print();
+        validator.writeJSON(argc > 2 ? argv[2] : "occlusion_validation.json");
+        return validator.passed() ? 0 : 1;
+    }
+
+    // Sin la cache de shaders de Mesa el arranque en frio de --bench-programs es real
+    bool benchPrograms = argc > 1 && string(argv[1]) == "--bench-programs";
+    if (benchPrograms) {
+#ifdef _WIN32
+        _putenv_s("MESA_SHADER_CACHE_DISABLE", "true");
+#else
+        setenv("MESA_SHADER_CACHE_DISABLE", "true", 1);
+#endif
+    }
+
     // Iniciamos la clase Render.
     Render render;
-    render.initGL(WINDOW_WIDTH, WINDOW_HEIGHT);
+    if (headless) {
+        if (!render.initHeadless(WINDOW_WIDTH, WINDOW_HEIGHT))
+            return 1;
+    }
+    else {
+        render.initGL(WINDOW_WIDTH, WINDOW_HEIGHT);
+    }
+
+    // Cache de binarios de programa en frio y en caliente: --bench-programs [salida.json]
+    if (benchPrograms) {
+        RenderBenchmark bench(&render);
+        bench.runPrograms();
+        bench.print();
+        bench.writeJSON(argc > 2 ? argv[2] : "program_benchmark.json");
+        render.deinitGLFW();
+        return 0;
+    }
+
+    // Coste de CPU por dibujado segun el numero de luces: --bench-uniforms [salida.json]
+    if (argc > 1 && string(argv[1]) == "--bench-uniforms") {
+        RenderBenchmark bench(&render);
+        bench.runUniforms();
+        bench.print();
+        bench.writeJSON(argc > 2 ? argv[2] : "uniform_benchmark.json");
+        render.deinitGLFW();
+        return 0;
+    }
+
+    // Muchas copias de la misma malla, instanciado frente a un dibujado por objeto: --bench-instancing [salida.json]
+    if (argc > 1 && string(argv[1]) == "--bench-instancing") {
+        RenderBenchmark bench(&render, 20, 10000, 3);
+        bench.runInstancing(10000);
+        bench.print();
+        bench.writeJSON(argc > 2 ? argv[2] : "instancing_benchmark.json");
+        render.deinitGLFW();
+        return 0;
+    }
+
+    // Culling de una escena de 50000 objetos casi toda fuera de camara: --bench-culling [salida.json]
+    if (argc > 1 && string(argv[1]) == "--bench-culling") {
+        RenderBenchmark bench(&render, 20, 50000, 3);
+        bench.runCulling(50000);
+        bench.print();
+        bench.writeJSON(argc > 2 ? argv[2] : "culling_benchmark.json");
+        render.deinitGLFW();
+        return 0;
+    }
+
+    // Triangulos enviados con y sin LOD segun la distancia: --bench-lod [salida.json]
+    if (argc > 1 && string(argv[1]) == "--bench-lod") {
+        RenderBenchmark bench(&render, 20, 1000, 3);
+        bench.runLOD(1000);
+        bench.print();
+        bench.writeJSON(argc > 2 ? argv[2] : "lod_benchmark.json");
+        render.deinitGLFW();
+        return 0;
+    }
+
+    // Memoria, precision y lectura de vertices de cada formato: --bench-vertex [salida.json]
+    if (argc > 1 && string(argv[1]) == "--bench-vertex") {
+        RenderBenchmark bench(&render, 20, 16, 3);
+        bench.runVertexFormats(512, 16);
+        bench.print();
+        bench.writeJSON(argc > 2 ? argv[2] : "vertex_benchmark.json");
+        render.deinitGLFW();
+        return 0;
+    }
+
+    // Muchas mallas distintas, una llamada por lote frente a multi-draw indirecto: --bench-mdi [salida.json]
+    if (argc > 1 && string(argv[1]) == "--bench-mdi") {
+        RenderBenchmark bench(&render, 20, 16000, 3);
+        for (int objects : { 1000, 4000, 16000 })
+            bench.runMultiDraw(objects);
+        bench.print();
+        bench.writeJSON(argc > 2 ? argv[2] : "mdi_benchmark.json");
+        render.deinitGLFW();
+        return 0;
+    }
+
+    // ACMR/ATVR, overdraw y bytes antes y despues de optimizar las mallas: --bench-meshopt [salida.json]
+    if (argc > 1 && string(argv[1]) == "--bench-meshopt") {
+        RenderBenchmark bench(&render);
+        bench.runMeshOptimizer(128);
+        bench.print();
+        bench.writeJSON(argc > 2 ? argv[2] : "meshopt_benchmark.json");
+        render.deinitGLFW();
+        return 0;
+    }
+
+    // Muchas luces puntuales con clusters frente a un solo cluster: --bench-lights [salida.json]
+    if (argc > 1 && string(argv[1]) == "--bench-lights") {
+        RenderBenchmark bench(&render, 5, 1, 2);
+        for (int lights : { 64, 512, 4096 })
+            bench.runLighting(lights);
+        bench.print();
+        bench.writeJSON(argc > 2 ? argv[2] : "lighting_benchmark.json");
+        render.deinitGLFW();
+        return 0;
+    }
+
+    // Mipmaps y compresion por bloques de las texturas: --bench-textures [salida.json]
+    if (argc > 1 && string(argv[1]) == "--bench-textures") {
+        RenderBenchmark bench(&render, 5, 1, 2);
+        bench.runTextures();
+        bench.runTextureSampling(4096);
+        bench.print();
+        bench.writeJSON(argc > 2 ? argv[2] : "texture_benchmark.json");
+        render.deinitGLFW();
+        return 0;
+    }
+
+    // Carga de golpe frente a carga en segundo plano con cada vez mas ficheros: --bench-streaming [salida.json]
+    if (argc > 1 && string(argv[1]) == "--bench-streaming") {
+        RenderBenchmark bench(&render);
+        for (int copies : { 4, 16, 64 })
+            bench.runStreaming(copies);
+        bench.print();
+        bench.writeJSON(argc > 2 ? argv[2] : "streaming_benchmark.json");
+        render.deinitGLFW();
+        return 0;
+    }
+
+    // Una textura por objeto frente a capas de TextureArray: --bench-texarrays [salida.json]
+    if (argc > 1 && string(argv[1]) == "--bench-texarrays") {
+        RenderBenchmark bench(&render, 10, 1, 2);
+        bench.runTextureArrays(1024);
+        bench.print();
+        bench.writeJSON(argc > 2 ? argv[2] : "texarray_benchmark.json");
+        render.deinitGLFW();
+        return 0;
+    }
+
+    // Alpha test en todo frente a opacos ordenados y prepass de profundidad: --bench-prepass [salida.json]
+    if (argc > 1 && string(argv[1]) == "--bench-prepass") {
+        RenderBenchmark bench(&render, 5, 1, 2);
+        bench.runDepthPrepass(4096);
+        bench.print();
+        bench.writeJSON(argc > 2 ? argv[2] : "prepass_benchmark.json");
+        render.deinitGLFW();
+        return 0;
+    }
+
+    // Perfilador con y sin activar y coste de tenerlo compilado: --bench-profiler [salida.json]
+    if (argc > 1 && string(argv[1]) == "--bench-profiler") {
+        RenderBenchmark bench(&render, 50, 1000, 3);
+        bench.runProfiler(1000);
+        bench.print();
+        bench.writeJSON(argc > 2 ? argv[2] : "profiler_benchmark.json");
+        render.deinitGLFW();
+        return 0;
+    }
+
+    // Perfilador activo desde el arranque, medias cada [frames] y traza al salir: --profile [traza.json] [frames]
+    bool profile = argc > 1 && string(argv[1]) == "--profile";
+    if (profile) {
+        if (argc > 3)
+            Profiler::statsInterval = atoi(argv[3]);
+        Profiler::setEnabled(true);
+    }
 
     // --- OBJETOS ---
     /*Object3D* esfera = new Object3D();
-    esfera->loadFromFile("data/icosfera.fiis");
     esfera->position = { 0, 1.0f, 0, 0 };
     esfera->updateModelMatrix();*/
 
+    // Los ficheros se leen en segundo plano (Render::loadObject) y cada objeto aparece cuando esta listo
     Object3D* cubo = new Object3D();
-    cubo->loadFromFile("data/cubo.fiis");
     cubo->position = { -2.5f, 1.0f, 0, 0 };
     cubo->updateModelMatrix();
 
     /*Object3D* floor = new Object3D();
-    floor->loadFromFile("data/floor.fiis");
     floor->position = { 0, 0, 0, 0 };
     floor->scale = { 100.0f, 0.1f, 100.0f, 0 };
     floor->standartRotation = false;
     floor->updateModelMatrix();*/
 
     /*Object3D* sun = new Object3D();
-    sun->loadFromFile("data/sun.fiis");
     sun->position = { 100.0f, 100.0f, 100.0f, 0 };
     sun->scale = { 10.0f, 0.1f, 10.0f, 0 };
     sun->standartRotation = false;
@@ -88,17 +292,48 @@ int main(int argc, char** argv)
     cameraFPS->setRenderer(&render);
 
     // Colocamos objetos y cmara
-    //render.putObject(esfera);
-    render.putObject(cubo);
-    //render.putObject(floor);
-    //render.putObject(sun);
+    //render.loadObject(esfera, "data/icosfera.fiis");
+    render.loadObject(cubo, "data/cubo.fiis");
+    //render.loadObject(floor, "data/floor.fiis");
+    //render.loadObject(sun, "data/sun.fiis");
     render.putCamera(cameraFPS);
 
-    // Bucle principal
-    render.mainLoop();
+    // Grabando o reproduciendo, la escena tiene que estar entera en el primer tick: si los objetos
+    // entrasen cuando acaba cada carga, el tick en que aparecen (y las colisiones) cambiaria de una vez a otra
+    if (!replayFile.empty() || !recordFile.empty())
+        render.finishLoading();
 
-    // Liberacin de memoria
-    render.deinitGLFW();
+    // Los ticks se cuentan desde aqui: la reproduccion usa los mismos por segundo que la grabacion
+    if (!replayFile.empty() && EventManager::startReplay(replayFile))
+        render.simulationRate = EventManager::replayRate();
+    if (!recordFile.empty())
+        EventManager::startRecording(recordFile, render.simulationRate);
+
+    // Bucle principal, o frames fijos sin ventana. Reproduciendo sin ventana, por defecto (o con 0 frames)
+    // uno por tick de la grabacion (el de calentamiento de runHeadless es el primero)
+    if (headless) {
+        int frames = argc > 1 ? atoi(argv[1]) : 0;
+        if (frames <= 0)
+            frames = EventManager::isReplaying() ? std::max(1, (int)EventManager::replayTicks() - 1) : 300;
+        RenderBenchmark bench(&render);
+        bench.runHeadless(frames, argc > 2 ? argv[2] : "");
+        bench.print();
+        bench.writeJSON(argc > 3 ? argv[3] : "headless_benchmark.json");
+    }
+    else {
+        render.mainLoop();
+    }
+    EventManager::stop();
+
+    // Un programa por combinacion de shaders, no por objeto
+    cout << "Programas compilados: " << ProgramLibrary::compiledPrograms << ", de cache: " << ProgramLibrary::cachedPrograms
+        << " para " << Render::objectList.size() << " objetos" << endl;
+    cout << "Mallas leidas: " << MeshLibrary::loadedMeshes << endl;
+
+    if (profile)
+        Profiler::writeTrace(argc > 2 ? argv[2] : "profile_trace.json");
+
+    // Liberacin de memoria: los objetos antes que el contexto (sus mallas y texturas estan en arenas y arrays de GL)
     //delete esfera;
     delete cubo;
     //delete floor;
@@ -107,6 +342,7 @@ int main(int argc, char** argv)
     delete orbitalLightY;
     delete orbitalLightX;
     delete orbitalLightDiagonal;
+    render.deinitGLFW();
 
     return 0;
 }
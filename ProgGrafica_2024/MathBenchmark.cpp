@@ -0,0 +1,575 @@
+#include "libprgr/MathBenchmark.h"
+#include <chrono>
+#include <random>
+#include <limits>
+#include <cstring>
+#include <iomanip>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Mascara que vale 0 pero que el compilador no puede conocer: sirve para encadenar
+// cada iteracion con el resultado de la anterior en el modo LATENCY.
+static volatile unsigned int benchZero = 0;
+
+#pragma region --- UTILIDADES ---
+
+// Obliga al compilador a materializar el valor (evita que elimine la operacion medida).
+template <typename T>
+static inline void doNotOptimize(const T& value)
+{
+#ifdef _MSC_VER
+	static const volatile T* sink;
+	sink = &value;
+	_ReadWriteBarrier();
+#else
+	asm volatile("" : : "m"(value) : "memory");
+#endif
+}
+
+static inline float scalarOf(float v) { return v; }
+static inline float scalarOf(vector3f v) { return v.x; }
+static inline float scalarOf(vector4f v) { return v.x; }
+static inline float scalarOf(const matrix3x3f& m) { return m.mat1[0] + m.mat1[2]; }
+static inline float scalarOf(const matrix4x4f& m) { return m.mat1[0] + m.mat1[3]; }
+
+static inline unsigned int floatBits(float f)
+{
+	unsigned int bits;
+	memcpy(&bits, &f, sizeof(bits));
+	return bits;
+}
+
+#pragma endregion
+
+#pragma region --- REFERENCIA EN DOBLE PRECISION ---
+
+typedef struct { double m[4][4]; } dmatrix4_t;
+typedef struct { double x, y, z, w; } dvector4_t;
+
+static dmatrix4_t toDouble(const matrix4x4f& m)
+{
+	dmatrix4_t r;
+	for (int i = 0; i < 4; i++)
+		for (int j = 0; j < 4; j++)
+			r.m[i][j] = m.mat2D[i][j];
+	return r;
+}
+
+static dvector4_t toDouble(vector4f v)
+{
+	return { v.x, v.y, v.z, v.w };
+}
+
+static dmatrix4_t dIdentity()
+{
+	dmatrix4_t r = {};
+	for (int i = 0; i < 4; i++) r.m[i][i] = 1;
+	return r;
+}
+
+static dmatrix4_t dMul(const dmatrix4_t& a, const dmatrix4_t& b)
+{
+	dmatrix4_t r = {};
+	for (int i = 0; i < 4; i++)
+		for (int j = 0; j < 4; j++)
+			for (int k = 0; k < 4; k++)
+				r.m[i][j] += a.m[i][k] * b.m[k][j];
+	return r;
+}
+
+static double dDet3(double a, double b, double c, double d, double e, double f, double g, double h, double i)
+{
+	return a * (e * i - f * h) - b * (d * i - f * g) + c * (d * h - e * g);
+}
+
+// Menor (i, j) de una matriz 4x4.
+static double dMinor(const dmatrix4_t& m, int row, int col)
+{
+	double s[9];
+	int n = 0;
+	for (int i = 0; i < 4; i++) {
+		if (i == row) continue;
+		for (int j = 0; j < 4; j++) {
+			if (j == col) continue;
+			s[n++] = m.m[i][j];
+		}
+	}
+	return dDet3(s[0], s[1], s[2], s[3], s[4], s[5], s[6], s[7], s[8]);
+}
+
+static double dDet4(const dmatrix4_t& m)
+{
+	double det = 0;
+	for (int j = 0; j < 4; j++)
+		det += ((j % 2) ? -1.0 : 1.0) * m.m[0][j] * dMinor(m, 0, j);
+	return det;
+}
+
+// Matriz de cofactores (mismo convenio que libPRGR::adjoint, sin transponer).
+static dmatrix4_t dCofactors(const dmatrix4_t& m)
+{
+	dmatrix4_t r;
+	for (int i = 0; i < 4; i++)
+		for (int j = 0; j < 4; j++)
+			r.m[i][j] = (((i + j) % 2) ? -1.0 : 1.0) * dMinor(m, i, j);
+	return r;
+}
+
+// Inversa por Gauss-Jordan con pivotaje parcial.
+static dmatrix4_t dInverse(dmatrix4_t m)
+{
+	dmatrix4_t inv = dIdentity();
+	for (int c = 0; c < 4; c++) {
+		int pivot = c;
+		for (int r = c + 1; r < 4; r++)
+			if (fabs(m.m[r][c]) > fabs(m.m[pivot][c])) pivot = r;
+		for (int k = 0; k < 4; k++) {
+			std::swap(m.m[c][k], m.m[pivot][k]);
+			std::swap(inv.m[c][k], inv.m[pivot][k]);
+		}
+		double p = m.m[c][c];
+		for (int k = 0; k < 4; k++) {
+			m.m[c][k] /= p;
+			inv.m[c][k] /= p;
+		}
+		for (int r = 0; r < 4; r++) {
+			if (r == c) continue;
+			double f = m.m[r][c];
+			for (int k = 0; k < 4; k++) {
+				m.m[r][k] -= f * m.m[c][k];
+				inv.m[r][k] -= f * inv.m[c][k];
+			}
+		}
+	}
+	return inv;
+}
+
+static dmatrix4_t dRotate(double ax, double ay, double az)
+{
+	ax = ax * M_PI / 180.0;
+	ay = ay * M_PI / 180.0;
+	az = az * M_PI / 180.0;
+	dmatrix4_t rx = dIdentity(), ry = dIdentity(), rz = dIdentity();
+	rx.m[1][1] = cos(ax); rx.m[1][2] = -sin(ax); rx.m[2][1] = sin(ax); rx.m[2][2] = cos(ax);
+	ry.m[0][0] = cos(ay); ry.m[0][2] = sin(ay); ry.m[2][0] = -sin(ay); ry.m[2][2] = cos(ay);
+	rz.m[0][0] = cos(az); rz.m[0][1] = -sin(az); rz.m[1][0] = sin(az); rz.m[1][1] = cos(az);
+	return dMul(dMul(rx, ry), rz);
+}
+
+// Acumulador de errores: guarda el maximo absoluto y el relativo mixto.
+typedef struct {
+	double maxAbs = 0;
+	double maxRel = 0;
+
+	void add(double value, double reference) {
+		double abs = fabs(value - reference);
+		double rel = abs / std::max(1.0, fabs(reference));
+		if (!(abs <= maxAbs)) maxAbs = abs; // Tambien captura NaN
+		if (!(rel <= maxRel)) maxRel = rel;
+	}
+
+	void add(const matrix4x4f& value, const dmatrix4_t& reference) {
+		for (int i = 0; i < 4; i++)
+			for (int j = 0; j < 4; j++)
+				add(value.mat2D[i][j], reference.m[i][j]);
+	}
+
+	void add(vector4f value, dvector4_t reference, int components = 3) {
+		double ref[4] = { reference.x, reference.y, reference.z, reference.w };
+		for (int i = 0; i < components; i++)
+			add(value.data[i], ref[i]);
+	}
+} errorAccumulator_t;
+
+#pragma endregion
+
+MathBenchmark::MathBenchmark(unsigned int seed, size_t numInputs, size_t iterations, int repetitions) :
+	seed(seed), numInputs(numInputs), iterations(iterations), repetitions(repetitions)
+{
+	if (numInputs == 0 || (numInputs & (numInputs - 1)) != 0) {
+		cout << "ERROR: " << __FILE__ << ":" << __LINE__ << " (" << __func__ << ") numInputs debe ser potencia de dos" << endl;
+		this->numInputs = 4096;
+	}
+	generateInputs();
+}
+
+void MathBenchmark::generateInputs()
+{
+	std::mt19937 rng(seed);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	std::uniform_real_distribution<float> angle(-180.0f, 180.0f);
+	std::uniform_real_distribution<float> scaleDist(0.5f, 2.0f);
+
+	scalars.resize(numInputs);
+	angles.resize(numInputs);
+	vectorsA.resize(numInputs);
+	vectorsB.resize(numInputs);
+	matrices3.resize(numInputs);
+	matricesA.resize(numInputs);
+	matricesB.resize(numInputs);
+	transforms.resize(numInputs);
+
+	for (size_t i = 0; i < numInputs; i++) {
+		scalars[i] = scaleDist(rng);
+		angles[i] = angle(rng);
+		vectorsA[i] = make_vector(unit(rng), unit(rng), unit(rng), 1.0f);
+		vectorsB[i] = make_vector(unit(rng), unit(rng), unit(rng), 1.0f);
+
+		// Evitamos vectores nulos en normalize
+		if (length(vectorsA[i]) < 1e-3f) vectorsA[i].x = 1.0f;
+
+		for (int k = 0; k < 9; k++) matrices3[i].mat1[k] = unit(rng);
+		for (int k = 0; k < 16; k++) {
+			matricesA[i].mat1[k] = unit(rng);
+			matricesB[i].mat1[k] = unit(rng);
+		}
+
+		transforms[i] = make_translate(unit(rng) * 10, unit(rng) * 10, unit(rng) * 10) *
+			make_rotate(angle(rng), angle(rng), angle(rng)) *
+			make_scale(scaleDist(rng), scaleDist(rng), scaleDist(rng));
+	}
+}
+
+template <typename F>
+double MathBenchmark::timeMode(benchMode_e mode, F op)
+{
+	const size_t mask = numInputs - 1;
+	const unsigned int zero = benchZero;
+	double best = numeric_limits<double>::max();
+
+	// La primera repeticion hace de calentamiento: nos quedamos con el minimo.
+	for (int rep = 0; rep < repetitions; rep++) {
+		auto start = chrono::steady_clock::now();
+
+		if (mode == THROUGHPUT) {
+			for (size_t i = 0; i < iterations; i++) {
+				auto r = op(i & mask);
+				doNotOptimize(r);
+			}
+		}
+		else {
+			size_t dep = 0;
+			for (size_t i = 0; i < iterations; i++) {
+				auto r = op((i + dep) & mask);
+				dep = floatBits(scalarOf(r)) & zero; // La siguiente carga depende de este resultado
+			}
+			doNotOptimize(dep);
+		}
+
+		auto end = chrono::steady_clock::now();
+		double ns = chrono::duration<double, std::nano>(end - start).count() / (double)iterations;
+		best = std::min(best, ns);
+	}
+	return best;
+}
+
+template <typename F>
+void MathBenchmark::time(string name, F op)
+{
+	results.push_back({ name, LATENCY, iterations, timeMode(LATENCY, op) });
+	results.push_back({ name, THROUGHPUT, iterations, timeMode(THROUGHPUT, op) });
+}
+
+template <typename F>
+void MathBenchmark::timeBatch(string name, F batch)
+{
+	vector<float> s(numInputs), c(numInputs);
+	size_t passes = std::max<size_t>(1, iterations / numInputs);
+	double best = numeric_limits<double>::max();
+
+	for (int rep = 0; rep < repetitions; rep++) {
+		auto start = chrono::steady_clock::now();
+		for (size_t p = 0; p < passes; p++) {
+			batch(angles.data(), s.data(), c.data(), numInputs);
+			doNotOptimize(s[p & (numInputs - 1)]);
+		}
+		auto end = chrono::steady_clock::now();
+		double ns = chrono::duration<double, std::nano>(end - start).count() / (double)(passes * numInputs);
+		best = std::min(best, ns);
+	}
+	results.push_back({ name, THROUGHPUT, passes * numInputs, best });
+}
+
+void MathBenchmark::run()
+{
+	runTimings();
+	runAccuracy();
+}
+
+void MathBenchmark::runTimings()
+{
+	results.clear();
+
+	// Referencias locales para que las lambdas no pasen por this en cada acceso
+	const vector<float>& s = scalars;
+	const vector<float>& a = angles;
+	const vector<vector4f>& va = vectorsA;
+	const vector<vector4f>& vb = vectorsB;
+	const vector<matrix3x3f>& m3 = matrices3;
+	const vector<matrix4x4f>& ma = matricesA;
+	const vector<matrix4x4f>& mb = matricesB;
+	const vector<matrix4x4f>& tr = transforms;
+
+	// --- ESCALARES Y VECTORES ---
+	time("toRadians", [&](size_t i) { return toRadians(a[i]); });
+	time("make_vector3", [&](size_t i) { return make_vector(va[i].x, va[i].y, va[i].z); });
+	time("make_vector4", [&](size_t i) { return make_vector(va[i].x, va[i].y, va[i].z, va[i].w); });
+	time("normalize", [&](size_t i) { return normalize(va[i]); });
+	time("length", [&](size_t i) { return length(va[i]); });
+	time("distance", [&](size_t i) { return distance(va[i], vb[i]); });
+	time("vector_add", [&](size_t i) { return va[i] + vb[i]; });
+	time("vector_sub", [&](size_t i) { return va[i] - vb[i]; });
+	time("vector_dot", [&](size_t i) { return va[i] * vb[i]; });
+	time("vector_cross", [&](size_t i) { return va[i] ^ vb[i]; });
+	time("scalar_mul_vector", [&](size_t i) { return s[i] * va[i]; });
+	time("vector_mul_scalar", [&](size_t i) { return va[i] * s[i]; });
+	time("vector_div_scalar", [&](size_t i) { return va[i] / s[i]; });
+
+	// --- MATRICES ---
+	time("make_identity", [&](size_t i) { return make_identity(); });
+	time("make_translate", [&](size_t i) { return make_translate(va[i].x, va[i].y, va[i].z); });
+	time("make_scale", [&](size_t i) { return make_scale(va[i].x, va[i].y, va[i].z); });
+	time("make_rotate", [&](size_t i) { return make_rotate(a[i], a[(i + 1) & (numInputs - 1)], a[(i + 2) & (numInputs - 1)]); });
+	time("matrix3_mul", [&](size_t i) { return m3[i] * m3[(i + 1) & (numInputs - 1)]; });
+	time("matrix4_mul", [&](size_t i) { return ma[i] * mb[i]; });
+	time("matrix4_mul_vector", [&](size_t i) { return ma[i] * va[i]; });
+	time("scalar_mul_matrix4", [&](size_t i) { return s[i] * ma[i]; });
+	time("matrix4_div_scalar", [&](size_t i) { return ma[i] / s[i]; });
+	time("matrix4_add", [&](size_t i) { return ma[i] + mb[i]; });
+	time("matrix4_sub", [&](size_t i) { return ma[i] - mb[i]; });
+	time("transpose", [&](size_t i) { return transpose(ma[i]); });
+	time("determinant3", [&](size_t i) { return determinant(m3[i]); });
+	time("determinant4", [&](size_t i) { return determinant(ma[i]); });
+	time("adjoint", [&](size_t i) { return adjoint(ma[i]); });
+	time("inverse", [&](size_t i) { return inverse(tr[i]); });
+
+	// --- CUATERNIONES ---
+	time("make_quaternion", [&](size_t i) { return make_quaternion(va[i].x, va[i].y, va[i].z, a[i]); });
+	time("make_rotate_quaternion", [&](size_t i) { return make_rotate_quaternion(normalize(va[i])); });
+
+	// --- NIVELES DE PRECISION (fastMath.h) ---
+	time("normalize_fast", [&](size_t i) { return normalize<mathFast>(va[i]); });
+	time("length_fast", [&](size_t i) { return length<mathFast>(va[i]); });
+	time("distance_fast", [&](size_t i) { return distance<mathFast>(va[i], vb[i]); });
+	time("sin_exact", [&](size_t i) { return mathExact::sin(a[i]); });
+	time("sin_fast", [&](size_t i) { return mathFast::sin(a[i]); });
+	time("cos_exact", [&](size_t i) { return mathExact::cos(a[i]); });
+	time("cos_fast", [&](size_t i) { return mathFast::cos(a[i]); });
+	timeBatch("sincos_batch_exact", [](const float* x, float* s, float* c, size_t n) { mathExact::sincos(x, s, c, n); });
+	timeBatch("sincos_batch_fast", [](const float* x, float* s, float* c, size_t n) { mathFast::sincos(x, s, c, n); });
+	timeBatch("sincos_batch_simd", [](const float* x, float* s, float* c, size_t n) { mathSimd::sincos(x, s, c, n); });
+}
+
+void MathBenchmark::addAccuracy(string name, double maxAbs, double maxRel, double tolerance)
+{
+	accuracy.push_back({ name, maxAbs, maxRel, tolerance, maxRel <= tolerance });
+}
+
+void MathBenchmark::runAccuracy()
+{
+	accuracy.clear();
+	const size_t n = numInputs;
+
+	{
+		errorAccumulator_t e;
+		for (size_t i = 0; i < n; i++) e.add(toRadians(angles[i]), angles[i] * M_PI / 180.0);
+		addAccuracy("toRadians", e.maxAbs, e.maxRel, 1e-6);
+	}
+	{
+		errorAccumulator_t e;
+		for (size_t i = 0; i < n; i++) {
+			dvector4_t v = toDouble(vectorsA[i]);
+			double l = sqrt(v.x * v.x + v.y * v.y + v.z * v.z);
+			e.add(normalize(vectorsA[i]), { v.x / l, v.y / l, v.z / l, v.w });
+		}
+		addAccuracy("normalize", e.maxAbs, e.maxRel, 1e-6);
+	}
+	{
+		errorAccumulator_t e;
+		for (size_t i = 0; i < n; i++) {
+			dvector4_t v = toDouble(vectorsA[i]);
+			e.add(length(vectorsA[i]), sqrt(v.x * v.x + v.y * v.y + v.z * v.z));
+		}
+		addAccuracy("length", e.maxAbs, e.maxRel, 1e-6);
+	}
+	{
+		errorAccumulator_t e;
+		for (size_t i = 0; i < n; i++) {
+			dvector4_t p = toDouble(vectorsA[i]), q = toDouble(vectorsB[i]);
+			double dx = q.x - p.x, dy = q.y - p.y, dz = q.z - p.z;
+			e.add(distance(vectorsA[i], vectorsB[i]), sqrt(dx * dx + dy * dy + dz * dz));
+		}
+		addAccuracy("distance", e.maxAbs, e.maxRel, 1e-6);
+	}
+	{
+		errorAccumulator_t dot, cross;
+		for (size_t i = 0; i < n; i++) {
+			dvector4_t p = toDouble(vectorsA[i]), q = toDouble(vectorsB[i]);
+			dot.add(vectorsA[i] * vectorsB[i], p.x * q.x + p.y * q.y + p.z * q.z);
+			cross.add(vectorsA[i] ^ vectorsB[i], { p.y * q.z - p.z * q.y, p.z * q.x - p.x * q.z, p.x * q.y - p.y * q.x, 0 });
+		}
+		addAccuracy("vector_dot", dot.maxAbs, dot.maxRel, 1e-6);
+		addAccuracy("vector_cross", cross.maxAbs, cross.maxRel, 1e-6);
+	}
+	{
+		errorAccumulator_t mul, mulVec;
+		for (size_t i = 0; i < n; i++) {
+			dmatrix4_t a = toDouble(matricesA[i]), b = toDouble(matricesB[i]);
+			mul.add(matricesA[i] * matricesB[i], dMul(a, b));
+
+			dvector4_t v = toDouble(vectorsA[i]);
+			double r[4];
+			for (int k = 0; k < 4; k++) r[k] = a.m[k][0] * v.x + a.m[k][1] * v.y + a.m[k][2] * v.z + a.m[k][3] * v.w;
+			mulVec.add(matricesA[i] * vectorsA[i], { r[0], r[1], r[2], r[3] }, 4);
+		}
+		addAccuracy("matrix4_mul", mul.maxAbs, mul.maxRel, 1e-5);
+		addAccuracy("matrix4_mul_vector", mulVec.maxAbs, mulVec.maxRel, 1e-5);
+	}
+	{
+		errorAccumulator_t det3, det4, adj;
+		for (size_t i = 0; i < n; i++) {
+			const float* m = matrices3[i].mat1;
+			det3.add(determinant(matrices3[i]), dDet3(m[0], m[1], m[2], m[3], m[4], m[5], m[6], m[7], m[8]));
+
+			dmatrix4_t a = toDouble(matricesA[i]);
+			det4.add(determinant(matricesA[i]), dDet4(a));
+			adj.add(adjoint(matricesA[i]), dCofactors(a));
+		}
+		addAccuracy("determinant3", det3.maxAbs, det3.maxRel, 1e-5);
+		addAccuracy("determinant4", det4.maxAbs, det4.maxRel, 1e-5);
+		addAccuracy("adjoint", adj.maxAbs, adj.maxRel, 1e-5);
+	}
+	{
+		errorAccumulator_t e;
+		for (size_t i = 0; i < n; i++)
+			e.add(inverse(transforms[i]), dInverse(toDouble(transforms[i])));
+		addAccuracy("inverse", e.maxAbs, e.maxRel, 1e-4);
+	}
+	{
+		errorAccumulator_t e;
+		for (size_t i = 0; i < n; i++) {
+			float ax = angles[i], ay = angles[(i + 1) % n], az = angles[(i + 2) % n];
+			e.add(make_rotate(ax, ay, az), dRotate(ax, ay, az));
+		}
+		addAccuracy("make_rotate", e.maxAbs, e.maxRel, 1e-5);
+	}
+	{
+		errorAccumulator_t quat, quatMat;
+		for (size_t i = 0; i < n; i++) {
+			dvector4_t v = toDouble(vectorsA[i]);
+			double l = sqrt(v.x * v.x + v.y * v.y + v.z * v.z);
+			double half = angles[i] * M_PI / 180.0 / 2.0;
+			dvector4_t q = { v.x / l * sin(half), v.y / l * sin(half), v.z / l * sin(half), cos(half) };
+			vector4f qf = make_quaternion(vectorsA[i].x, vectorsA[i].y, vectorsA[i].z, angles[i]);
+			quat.add(qf, q, 4);
+
+			// Matriz a partir del cuaternion en doble precision
+			dmatrix4_t r = dIdentity();
+			r.m[0][0] = 1 - 2 * (q.y * q.y + q.z * q.z); r.m[0][1] = 2 * (q.x * q.y - q.z * q.w); r.m[0][2] = 2 * (q.x * q.z + q.y * q.w);
+			r.m[1][0] = 2 * (q.x * q.y + q.z * q.w); r.m[1][1] = 1 - 2 * (q.x * q.x + q.z * q.z); r.m[1][2] = 2 * (q.y * q.z - q.x * q.w);
+			r.m[2][0] = 2 * (q.x * q.z - q.y * q.w); r.m[2][1] = 2 * (q.y * q.z + q.x * q.w); r.m[2][2] = 1 - 2 * (q.x * q.x + q.y * q.y);
+			quatMat.add(make_rotate_quaternion(qf), r);
+		}
+		addAccuracy("make_quaternion", quat.maxAbs, quat.maxRel, 1e-6);
+		addAccuracy("make_rotate_quaternion", quatMat.maxAbs, quatMat.maxRel, 1e-5);
+	}
+
+	// Niveles de precision de fastMath.h
+	runTierAccuracy<mathExact>("exact");
+	runTierAccuracy<mathFast>("fast");
+	runTierAccuracy<mathSimd>("simd");
+}
+
+template <typename P>
+void MathBenchmark::runTierAccuracy(string tier)
+{
+	const size_t n = numInputs;
+	errorAccumulator_t norm, len, dist, sc, batch;
+	vector<float> s(n), c(n);
+	P::sincos(angles.data(), s.data(), c.data(), n);
+
+	for (size_t i = 0; i < n; i++) {
+		dvector4_t p = toDouble(vectorsA[i]), q = toDouble(vectorsB[i]);
+		double l = sqrt(p.x * p.x + p.y * p.y + p.z * p.z);
+		double dx = q.x - p.x, dy = q.y - p.y, dz = q.z - p.z;
+
+		norm.add(normalize<P>(vectorsA[i]), { p.x / l, p.y / l, p.z / l, p.w });
+		len.add(length<P>(vectorsA[i]), l);
+		dist.add(distance<P>(vectorsA[i], vectorsB[i]), sqrt(dx * dx + dy * dy + dz * dz));
+
+		float fs, fc;
+		P::sincos(angles[i], fs, fc);
+		sc.add(fs, sin((double)angles[i]));
+		sc.add(fc, cos((double)angles[i]));
+		batch.add(s[i], sin((double)angles[i]));
+		batch.add(c[i], cos((double)angles[i]));
+	}
+
+	// Las cotas de cada nivel son las documentadas en fastMath.h (relativas para sqrt, sobre vectores unidad o menores)
+	addAccuracy("normalize_" + tier, norm.maxAbs, norm.maxRel, P::maxRelErrorSqrt * 2);
+	addAccuracy("length_" + tier, len.maxAbs, len.maxRel, P::maxRelErrorSqrt * 2);
+	addAccuracy("distance_" + tier, dist.maxAbs, dist.maxRel, P::maxRelErrorSqrt * 2);
+	addAccuracy("sincos_" + tier, sc.maxAbs, sc.maxRel, P::maxAbsErrorSinCos);
+	addAccuracy("sincos_batch_" + tier, batch.maxAbs, batch.maxRel, P::maxAbsErrorSinCos);
+}
+
+bool MathBenchmark::accuracyPassed() const
+{
+	for (const auto& acc : accuracy)
+		if (!acc.passed) return false;
+	return true;
+}
+
+bool MathBenchmark::writeJSON(string fileName) const
+{
+	ofstream f(fileName);
+	if (!f.is_open()) {
+		cout << "ERROR: " << __FILE__ << ":" << __LINE__ << " (" << __func__ << ") No se pudo crear " << fileName << endl;
+		return false;
+	}
+
+	f << "{\n";
+	f << "  \"seed\": " << seed << ",\n";
+	f << "  \"inputs\": " << numInputs << ",\n";
+	f << "  \"iterations\": " << iterations << ",\n";
+	f << "  \"repetitions\": " << repetitions << ",\n";
+
+	f << "  \"timings\": [\n";
+	for (size_t i = 0; i < results.size(); i++) {
+		const benchResult_t& r = results[i];
+		f << "    { \"name\": \"" << r.name << "\", \"mode\": \"" << (r.mode == LATENCY ? "latency" : "throughput")
+			<< "\", \"ns_per_op\": " << std::fixed << std::setprecision(4) << r.nsPerOp
+			<< ", \"mops_per_s\": " << (r.nsPerOp > 0 ? 1000.0 / r.nsPerOp : 0.0) << " }"
+			<< (i + 1 < results.size() ? "," : "") << "\n";
+	}
+	f << "  ],\n";
+
+	f << "  \"accuracy\": [\n";
+	for (size_t i = 0; i < accuracy.size(); i++) {
+		const accuracyResult_t& a = accuracy[i];
+		f << "    { \"name\": \"" << a.name << "\", \"max_abs_error\": " << std::scientific << std::setprecision(6) << a.maxAbsError
+			<< ", \"max_rel_error\": " << a.maxRelError << ", \"tolerance\": " << a.tolerance
+			<< ", \"passed\": " << (a.passed ? "true" : "false") << " }"
+			<< (i + 1 < accuracy.size() ? "," : "") << "\n";
+	}
+	f << "  ],\n";
+	f << "  \"accuracy_passed\": " << (accuracyPassed() ? "true" : "false") << "\n";
+	f << "}\n";
+	return true;
+}
+
+void MathBenchmark::print() const
+{
+	cout << std::left << std::setw(26) << "funcion" << std::setw(12) << "modo" << "ns/op" << endl;
+	for (const auto& r : results) {
+		cout << std::left << std::setw(26) << r.name << std::setw(12) << (r.mode == LATENCY ? "latency" : "throughput")
+			<< std::fixed << std::setprecision(3) << r.nsPerOp << endl;
+	}
+	cout << endl;
+	for (const auto& a : accuracy) {
+		cout << std::left << std::setw(26) << a.name << std::scientific << std::setprecision(3) << a.maxRelError
+			<< (a.passed ? "  OK" : "  FALLO") << endl;
+	}
+	cout << std::defaultfloat;
+}
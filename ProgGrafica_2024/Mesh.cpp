@@ -0,0 +1,401 @@
+#include "libprgr/Mesh.h"
+#include "libprgr/MeshSimplifier.h"
+#include "libprgr/MeshOptimizer.h"
+#include <limits>
+#include <algorithm>
+
+#pragma region --- MESH ---
+
+Mesh::~Mesh()
+{
+	if (arena)
+		arena->remove(this);
+	delete prototypes[0];
+	delete prototypes[1];
+	delete texture;
+}
+
+bool Mesh::loadFromFile(string file)
+{
+	ifstream f(file);
+	if (!f.is_open())
+		return false;
+
+	fileName = file;
+	leerVertices(f);
+	leerColores(f);
+	leerNormales(f);
+	leerTexturas(f);
+	leerCaras(f);
+	return true;
+}
+
+void Mesh::weldVertices()
+{
+	vector<int> remap = MeshOptimizer::weldVertices(vertexList);
+	MeshOptimizer::remapIndices(idList, remap);
+	MeshOptimizer::remapIndices(lodIdList, remap);
+}
+
+void Mesh::buildLods()
+{
+	lods.clear();
+	lodIdList.clear();
+	lods.push_back({ 0, (unsigned int)idList.size(), 0.0f });
+
+	MeshSimplifier simplifier(vertexList);
+	boundsCenter = simplifier.getCenter();
+	boundsRadius = simplifier.getExtent();
+	if (idList.size() < MESH_LOD_MIN_TRIANGLES * 3)
+		return;
+
+	// Cada nivel parte del anterior con la mitad de triangulos como objetivo
+	vector<int> current = idList;
+	for (int level = 1; level < MESH_MAX_LODS; level++) {
+		float error = 0.0f;
+		vector<int> lod = simplifier.simplify(current, current.size() / 6 * 3, MESH_LOD_MAX_ERROR * boundsRadius, &error);
+
+		// Si ya no baja al menos un 20% no compensa otro nivel
+		if (lod.empty() || lod.size() > current.size() * 4 / 5)
+			break;
+
+		// Los errores de cada paso se suman: cota del error respecto al original
+		lods.push_back({ (unsigned int)(idList.size() + lodIdList.size()), (unsigned int)lod.size(), lods.back().error + error });
+		lodIdList.insert(lodIdList.end(), lod.begin(), lod.end());
+		current = std::move(lod);
+	}
+}
+
+void Mesh::optimize()
+{
+	if (lods.empty()) buildLods();
+
+	// Cada LOD se dibuja por separado: se reordena su tramo de indices sin mezclarlo con los demas
+	vector<unsigned int> clusters;
+	for (const meshLod_t& lod : lods) {
+		if (lod.indexCount == 0) continue;
+		int* ids = lod.firstIndex < idList.size() ?
+			idList.data() + lod.firstIndex : lodIdList.data() + (lod.firstIndex - idList.size());
+		MeshOptimizer::optimizeVertexCache(ids, lod.indexCount, vertexList.size(), &clusters);
+		MeshOptimizer::optimizeOverdraw(ids, lod.indexCount, vertexList, clusters);
+	}
+
+	// Vertices en el orden en que los pide el nivel 0 (y luego los que solo usan los LOD)
+	vector<int> all = idList;
+	all.insert(all.end(), lodIdList.begin(), lodIdList.end());
+	vector<int> remap = MeshOptimizer::optimizeVertexFetch(vertexList, all);
+	MeshOptimizer::remapIndices(idList, remap);
+	MeshOptimizer::remapIndices(lodIdList, remap);
+}
+
+void Mesh::pack()
+{
+	layout->pack(vertexList, packedVertices);
+	vertexBytes = packedVertices.size();
+}
+
+void Mesh::upload(StagingBuffer* staging)
+{
+	if (uploaded) return;
+
+	// La textura se decodifico al leer el fichero (quiza en otro hilo): se sube con la geometria
+	if (texture)
+		texture->updateGPU(staging);
+
+	if (lods.empty()) buildLods();
+	if (packedVertices.empty()) pack();
+
+	// Indices de todos los LOD seguidos, relativos al primer vertice de la malla
+	size_t indexCount = idList.size() + lodIdList.size();
+	if (vertexList.size() <= 65536) {
+		// Caben en 16 bits: la mitad de IBO y de lectura de indices
+		indexType = GL_UNSIGNED_SHORT;
+		vector<unsigned short> shortIds;
+		shortIds.reserve(indexCount);
+		shortIds.insert(shortIds.end(), idList.begin(), idList.end());
+		shortIds.insert(shortIds.end(), lodIdList.begin(), lodIdList.end());
+		GeometryArena::get(layout, indexType)->add(this, shortIds.data(), indexCount, staging);
+	}
+	else {
+		indexType = GL_UNSIGNED_INT;
+		vector<int> ids = idList;
+		ids.insert(ids.end(), lodIdList.begin(), lodIdList.end());
+		GeometryArena::get(layout, indexType)->add(this, ids.data(), indexCount, staging);
+	}
+	vector<unsigned char>().swap(packedVertices); // Ya esta en GPU
+	uploaded = true;
+}
+
+Collider* Mesh::createCollider(collTypes type)
+{
+	prepareCollider(type);
+	return prototypes[type] ? prototypes[type]->clone() : nullptr;
+}
+
+void Mesh::prepareCollider(collTypes type)
+{
+	if (!prototypes[type] && !vertexList.empty())
+		prototypes[type] = buildCollider(type);
+}
+
+Collider* Mesh::buildCollider(collTypes type) const
+{
+	// Calcular los limites de la malla (minimos y maximos)
+	vector4f min = { numeric_limits<float>::max(),
+					 numeric_limits<float>::max(),
+					 numeric_limits<float>::max(), 1 };
+	vector4f max = { -numeric_limits<float>::max(),
+					 -numeric_limits<float>::max(),
+					 -numeric_limits<float>::max(), 1 };
+
+	for (const auto& vertex : vertexList) {
+		min.x = std::min(min.x, vertex.vPos.x);
+		min.y = std::min(min.y, vertex.vPos.y);
+		min.z = std::min(min.z, vertex.vPos.z);
+		max.x = std::max(max.x, vertex.vPos.x);
+		max.y = std::max(max.y, vertex.vPos.y);
+		max.z = std::max(max.z, vertex.vPos.z);
+	}
+
+	Collider* collider;
+	if (type == AABB_t) {
+		collider = new AABB(min, max);
+	}
+	else {
+		vector4f center = (min + max) * 0.5f;
+		center.w = 1;
+		float radius = distance(center, max) * 1.0;
+		collider = new Sphere(center, radius);
+	}
+
+	// Todos los vertices como particulas del colisionador
+	for (const auto& vertex : vertexList) {
+		collider->addVertex(vertex.vPos);
+	}
+
+	// Subdividir el colisionador si hay muchos vertices
+	if (vertexList.size() > 10) {
+		collider->subdivide();
+	}
+	return collider;
+}
+
+void Mesh::leerVertices(std::ifstream& f)
+{
+	// Leer linea hasta encontrar un end
+	string linea;
+	do {
+		std::getline(f, linea);
+		// Averiguar si no es comentario
+		if ((linea[0] != '/' && linea[1] != '/') && (linea != "end"))
+		{
+			// Separar linea en identificador y posiciones
+			std::stringstream l(linea);
+			string identificador;
+			string posiciones;
+
+			l >> identificador;
+			l >> posiciones;
+
+			std::vector<float> pos = splitString<float>(posiciones, ','); // Divide la palabra posiciones
+
+			// Asignar posiciones a nuevo vertice
+			vertex_t v;
+			v.vPos.x = pos[0];
+			v.vPos.y = pos[1];
+			v.vPos.z = pos[2];
+			v.vPos.w = 1; // Lo dejamos a 1 porque es una posicion
+			this->vertexList.push_back(v);
+		}
+	} while (linea != "end");
+}
+
+void Mesh::leerColores(std::ifstream& f)
+{
+	// Leer linea hasta encontrar un end
+	string linea;
+	do {
+		std::getline(f, linea);
+		// Averiguar si no es comentario
+		if ((linea[0] != '/' && linea[1] != '/') && (linea != "end"))
+		{
+			// Separar linea en identificador y colores
+			std::stringstream l(linea);
+			string identificador;
+			string colores;
+
+			l >> identificador;
+			l >> colores;
+
+			std::vector<float> color = splitString<float>(colores, ',');
+
+			int vertexId = splitString<int>(identificador, ';')[0];
+
+			this->vertexList[vertexId - 1].vColor = { color[0], color[1], color[2], color[3] };
+		}
+	} while (linea != "end");
+}
+
+void Mesh::leerNormales(std::ifstream& f)
+{
+	string linea = "";
+	do {
+		std::getline(f, linea);
+
+		// Si no es comentario
+		if ((linea[0] != '/' && linea[1] != '/') && (linea != "end"))
+		{
+			// Separar linea en identificador y normal
+			std::stringstream l(linea);
+			string identificador;
+			string normal;
+			l >> identificador;
+			l >> normal;
+			std::vector<float> n = splitString<float>(normal, ',');
+			int vertexId = splitString<int>(identificador, ':')[0];
+			this->vertexList[vertexId - 1].vNormal = { n[0],n[1],n[2],n[3] };
+		}
+		// Hasta "end"
+	} while (linea != "end");
+}
+
+void Mesh::leerCaras(std::ifstream& f)
+{
+	// Leer linea hasta encontrar un end
+	string linea;
+	do {
+		std::getline(f, linea);
+		// Averiguar si no es comentario
+		if ((linea[0] != '/' && linea[1] != '/') && (linea != "end"))
+		{
+			// Separar linea en identificador e indices
+			std::stringstream l(linea);
+			string identificador;
+			string vertexIds;
+
+			l >> identificador;
+			l >> vertexIds;
+
+			std::vector<int> vIds = splitString<int>(vertexIds, ',');
+			this->idList.push_back(vIds[0] - 1);
+			this->idList.push_back(vIds[1] - 1);
+			this->idList.push_back(vIds[2] - 1);
+		}
+	} while (linea != "end");
+}
+
+void Mesh::leerTexturas(std::ifstream& f)
+{
+	string linea = "";
+	do { // Primer bucle: leer coordenadas de textura hasta "end"
+		std::getline(f, linea);
+
+		// Si no es comentario
+		if ((linea[0] != '/' && linea[1] != '/') && (linea != "end"))
+		{
+			// Separar linea en identificador y coordenadas
+			std::stringstream l(linea);
+			string identificador;
+			string textureCoord;
+			l >> identificador;
+			l >> textureCoord;
+			std::vector<float> tc = splitString<float>(textureCoord, ',');
+			int vertexId = splitString<int>(identificador, ':')[0];
+			this->vertexList[vertexId - 1].vTextureCoord = { tc[0],tc[1],-1,-1 };
+		}
+	} while (linea != "end");
+
+	do { // Segundo bucle: fichero de textura
+		std::getline(f, linea);
+		if ((linea[0] != '/' && linea[1] != '/') && (linea != "end"))
+		{
+			this->texture = new Texture(linea, false); // Se sube con la malla (upload)
+		}
+	} while (linea != "end");
+}
+
+#pragma endregion
+
+#pragma region --- MESH LIBRARY ---
+
+Mesh* MeshLibrary::acquire(const string& fileName)
+{
+	Mesh* mesh = acquireLoaded(fileName);
+	if (mesh) return mesh;
+
+	mesh = build(fileName);
+	return mesh ? adopt(mesh) : nullptr;
+}
+
+Mesh* MeshLibrary::acquireLoaded(const string& fileName)
+{
+	auto it = meshes.find(fileName);
+	if (it == meshes.end()) return nullptr;
+
+	it->second->refCount++;
+	return it->second;
+}
+
+Mesh* MeshLibrary::build(const string& fileName)
+{
+	Mesh* mesh = new Mesh();
+	if (!mesh->loadFromFile(fileName)) {
+		delete mesh;
+		return nullptr;
+	}
+	prepare(mesh);
+	return mesh;
+}
+
+Mesh* MeshLibrary::adopt(Mesh* mesh)
+{
+	Mesh* loaded = acquireLoaded(mesh->fileName);
+	if (loaded) {
+		delete mesh;
+		return loaded;
+	}
+
+	mesh->refCount = 1;
+	meshes[mesh->fileName] = mesh;
+	loadedMeshes++;
+	return mesh;
+}
+
+void MeshLibrary::prepare(Mesh* mesh)
+{
+	if (optimizeMeshes) mesh->weldVertices();
+	mesh->buildLods();
+	if (optimizeMeshes) mesh->optimize();
+	mesh->layout = vertexLayout;
+	mesh->pack();
+}
+
+Mesh* MeshLibrary::acquireProcedural(const string& name, void (*build)(Mesh* mesh))
+{
+	auto it = meshes.find(name);
+	if (it != meshes.end()) {
+		it->second->refCount++;
+		return it->second;
+	}
+
+	Mesh* mesh = new Mesh();
+	mesh->fileName = name;
+	build(mesh);
+	prepare(mesh);
+
+	mesh->refCount = 1;
+	meshes[name] = mesh;
+	return mesh;
+}
+
+void MeshLibrary::release(Mesh* mesh)
+{
+	if (!mesh) return;
+
+	if (--mesh->refCount > 0) return;
+
+	meshes.erase(mesh->fileName);
+	delete mesh;
+}
+
+#pragma endregion
@@ -0,0 +1,312 @@
+#include "libprgr/MeshOptimizer.h"
+#include <algorithm>
+#include <cstring>
+
+#pragma region --- MESH OPTIMIZER ---
+
+// FNV-1a sobre los 16 floats del vertice (como enteros: -0 y 0 se consideran distintos, igual que en memcmp)
+static size_t hashVertex(const vertex_t& v)
+{
+	unsigned int words[sizeof(vertex_t) / 4];
+	memcpy(words, &v, sizeof(vertex_t));
+	size_t h = 2166136261u;
+	for (unsigned int w : words) {
+		h ^= w;
+		h *= 16777619u;
+	}
+	return h;
+}
+
+vector<int> MeshOptimizer::weldVertices(vector<vertex_t>& vertices)
+{
+	size_t n = vertices.size();
+	size_t tableSize = 1;
+	while (tableSize < n * 2) tableSize <<= 1;
+
+	// Tabla hash con sondeo lineal: cada hueco guarda el indice del vertice ya soldado
+	vector<int> table(tableSize, -1);
+	vector<int> remap(n);
+	vector<vertex_t> welded;
+	welded.reserve(n);
+	for (size_t i = 0; i < n; i++) {
+		size_t h = hashVertex(vertices[i]) & (tableSize - 1);
+		while (table[h] >= 0 && memcmp(&welded[table[h]], &vertices[i], sizeof(vertex_t)) != 0)
+			h = (h + 1) & (tableSize - 1);
+		if (table[h] < 0) {
+			table[h] = (int)welded.size();
+			welded.push_back(vertices[i]);
+		}
+		remap[i] = table[h];
+	}
+	vertices.swap(welded);
+	return remap;
+}
+
+vector<int> MeshOptimizer::optimizeVertexFetch(vector<vertex_t>& vertices, const vector<int>& indices)
+{
+	vector<int> remap(vertices.size(), -1);
+	vector<vertex_t> ordered;
+	ordered.reserve(vertices.size());
+	for (int i : indices) {
+		if (remap[i] < 0) {
+			remap[i] = (int)ordered.size();
+			ordered.push_back(vertices[i]);
+		}
+	}
+	vertices.swap(ordered);
+	return remap;
+}
+
+void MeshOptimizer::remapIndices(vector<int>& indices, const vector<int>& remap)
+{
+	for (int& i : indices)
+		i = remap[i];
+}
+
+void MeshOptimizer::optimizeVertexCache(int* indices, size_t count, size_t vertexCount, vector<unsigned int>* clusters)
+{
+	if (clusters) clusters->clear();
+	size_t triCount = count / 3;
+	if (triCount == 0) return;
+
+	// Triangulos de cada vertice y cuantos quedan por emitir (live)
+	vector<unsigned int> start(vertexCount + 1, 0), adjacency(triCount * 3);
+	for (size_t i = 0; i < triCount * 3; i++)
+		start[indices[i] + 1]++;
+	for (size_t v = 0; v < vertexCount; v++)
+		start[v + 1] += start[v];
+	vector<int> live(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++)
+		live[v] = (int)(start[v + 1] - start[v]);
+	{
+		vector<unsigned int> cursor(start.begin(), start.end() - 1);
+		for (size_t i = 0; i < triCount * 3; i++)
+			adjacency[cursor[indices[i]]++] = (unsigned int)(i / 3);
+	}
+
+	vector<int> timestamp(vertexCount, 0), deadEnd, candidates, output;
+	vector<unsigned char> emitted(triCount, 0);
+	output.reserve(triCount * 3);
+	int time = CACHE_SIZE + 1;
+	size_t cursor = 0;
+
+	// Vertice siguiente cuando no queda ningun candidato: el mas reciente con triangulos pendientes
+	// (pila de callejones sin salida) o el siguiente en orden de indice
+	auto skipDeadEnd = [&]() {
+		while (!deadEnd.empty()) {
+			int d = deadEnd.back();
+			deadEnd.pop_back();
+			if (live[d] > 0) return d;
+		}
+		for (; cursor < vertexCount; cursor++)
+			if (live[cursor] > 0) return (int)cursor;
+		return -1;
+	};
+
+	int fanning = skipDeadEnd();
+	if (clusters) clusters->push_back(0);
+	while (fanning >= 0) {
+		// Emite todos los triangulos pendientes alrededor del vertice
+		candidates.clear();
+		for (unsigned int k = start[fanning]; k < start[fanning + 1]; k++) {
+			unsigned int t = adjacency[k];
+			if (emitted[t]) continue;
+			for (int c = 0; c < 3; c++) {
+				int v = indices[t * 3 + c];
+				output.push_back(v);
+				deadEnd.push_back(v);
+				candidates.push_back(v);
+				live[v]--;
+				if (time - timestamp[v] > CACHE_SIZE) {
+					timestamp[v] = time;
+					time++;
+				}
+			}
+			emitted[t] = 1;
+		}
+
+		// El candidato mas antiguo que seguira en cache despues de emitir su abanico
+		int next = -1, best = -1;
+		for (int v : candidates) {
+			if (live[v] <= 0) continue;
+			int priority = 0;
+			if (time - timestamp[v] + 2 * live[v] <= CACHE_SIZE)
+				priority = time - timestamp[v];
+			if (priority > best) {
+				best = priority;
+				next = v;
+			}
+		}
+		if (next < 0) {
+			next = skipDeadEnd();
+			if (next >= 0 && clusters) clusters->push_back((unsigned int)(output.size() / 3));
+		}
+		fanning = next;
+	}
+
+	std::copy(output.begin(), output.end(), indices);
+}
+
+void MeshOptimizer::optimizeOverdraw(int* indices, size_t count, const vector<vertex_t>& vertices,
+	const vector<unsigned int>& clusters, float threshold)
+{
+	size_t triCount = count / 3;
+	if (clusters.size() <= 1 || triCount == 0) return;
+
+	// Normal (ponderada por area) y centro de cada triangulo
+	vector<vector4f> normals(triCount), centers(triCount);
+	vector4f meshCenter = { 0, 0, 0, 1 };
+	float totalArea = 0.0f;
+	for (size_t t = 0; t < triCount; t++) {
+		const vector4f& p0 = vertices[indices[t * 3]].vPos;
+		const vector4f& p1 = vertices[indices[t * 3 + 1]].vPos;
+		const vector4f& p2 = vertices[indices[t * 3 + 2]].vPos;
+		normals[t] = (p1 - p0) ^ (p2 - p0);
+		centers[t] = { (p0.x + p1.x + p2.x) / 3.0f, (p0.y + p1.y + p2.y) / 3.0f, (p0.z + p1.z + p2.z) / 3.0f, 1 };
+		float area = length(normals[t]);
+		meshCenter = { meshCenter.x + centers[t].x * area, meshCenter.y + centers[t].y * area, meshCenter.z + centers[t].z * area, 1 };
+		totalArea += area;
+	}
+	if (totalArea > 0.0f)
+		meshCenter = { meshCenter.x / totalArea, meshCenter.y / totalArea, meshCenter.z / totalArea, 1 };
+
+	// Cuanto mira hacia fuera cada grupo: los que mas, primero (tapan a los de dentro)
+	typedef struct {
+		unsigned int first, count;
+		float key;
+	} cluster_t;
+	vector<cluster_t> groups;
+	for (size_t c = 0; c < clusters.size(); c++) {
+		unsigned int first = clusters[c];
+		unsigned int end = c + 1 < clusters.size() ? clusters[c + 1] : (unsigned int)triCount;
+		vector4f normal = { 0, 0, 0, 0 }, center = { 0, 0, 0, 1 };
+		float area = 0.0f;
+		for (unsigned int t = first; t < end; t++) {
+			float a = length(normals[t]);
+			normal = { normal.x + normals[t].x, normal.y + normals[t].y, normal.z + normals[t].z, 0 };
+			center = { center.x + centers[t].x * a, center.y + centers[t].y * a, center.z + centers[t].z * a, 1 };
+			area += a;
+		}
+		float key = 0.0f, len = length(normal);
+		if (area > 0.0f && len > 0.0f) {
+			center = { center.x / area, center.y / area, center.z / area, 1 };
+			key = ((center - meshCenter) * normal) / len;
+		}
+		groups.push_back({ first, end - first, key });
+	}
+	std::stable_sort(groups.begin(), groups.end(), [](const cluster_t& a, const cluster_t& b) { return a.key > b.key; });
+
+	vector<int> sorted;
+	sorted.reserve(triCount * 3);
+	for (const cluster_t& g : groups)
+		sorted.insert(sorted.end(), indices + g.first * 3, indices + (g.first + g.count) * 3);
+
+	// Solo si la cache no pierde mas de lo permitido
+	size_t vertexCount = vertices.size();
+	size_t before = cacheMisses(indices, triCount * 3, vertexCount);
+	size_t after = cacheMisses(sorted.data(), sorted.size(), vertexCount);
+	if (after > before * threshold)
+		return;
+	std::copy(sorted.begin(), sorted.end(), indices);
+}
+
+size_t MeshOptimizer::cacheMisses(const int* indices, size_t count, size_t vertexCount, int cacheSize)
+{
+	// Un vertice esta en la FIFO si entro en las ultimas cacheSize inserciones
+	vector<unsigned int> insertedAt(vertexCount, 0);
+	unsigned int time = cacheSize + 1;
+	size_t misses = 0;
+	for (size_t i = 0; i < count; i++) {
+		int v = indices[i];
+		if (time - insertedAt[v] > (unsigned int)cacheSize) {
+			insertedAt[v] = time++;
+			misses++;
+		}
+	}
+	return misses;
+}
+
+float MeshOptimizer::overdraw(const vector<vertex_t>& vertices, const int* indices, size_t count, int gridSize)
+{
+	size_t triCount = count / 3;
+	if (triCount == 0) return 0.0f;
+
+	vector4f min = vertices[indices[0]].vPos, max = min;
+	for (size_t i = 0; i < triCount * 3; i++) {
+		const vector4f& p = vertices[indices[i]].vPos;
+		min = { std::min(min.x, p.x), std::min(min.y, p.y), std::min(min.z, p.z), 1 };
+		max = { std::max(max.x, p.x), std::max(max.y, p.y), std::max(max.z, p.z), 1 };
+	}
+
+	vector<float> depth(gridSize * gridSize);
+	size_t shaded = 0, covered = 0;
+	for (int view = 0; view < 6; view++) {
+		// Vista desde +eje (par) o -eje (impar): mas cerca = menor profundidad
+		int axis = view / 2;
+		float sign = (view & 1) ? 1.0f : -1.0f;
+		int au = (axis + 1) % 3, av = (axis + 2) % 3;
+		float su = (gridSize - 1) / std::max(max.data[au] - min.data[au], 1e-6f);
+		float sv = (gridSize - 1) / std::max(max.data[av] - min.data[av], 1e-6f);
+		std::fill(depth.begin(), depth.end(), 1e30f);
+
+		for (size_t t = 0; t < triCount; t++) {
+			float x[3], y[3], z[3];
+			for (int c = 0; c < 3; c++) {
+				const vector4f& p = vertices[indices[t * 3 + c]].vPos;
+				x[c] = (p.data[au] - min.data[au]) * su;
+				y[c] = (p.data[av] - min.data[av]) * sv;
+				z[c] = p.data[axis] * sign;
+			}
+			// Caras traseras fuera: antihorario visto desde +eje, horario desde -eje (la pantalla queda en espejo)
+			float area = (x[1] - x[0]) * (y[2] - y[0]) - (y[1] - y[0]) * (x[2] - x[0]);
+			if (area * -sign <= 0.0f) continue;
+
+			int x0 = std::max(0, (int)floorf(std::min({ x[0], x[1], x[2] })));
+			int x1 = std::min(gridSize - 1, (int)ceilf(std::max({ x[0], x[1], x[2] })));
+			int y0 = std::max(0, (int)floorf(std::min({ y[0], y[1], y[2] })));
+			int y1 = std::min(gridSize - 1, (int)ceilf(std::max({ y[0], y[1], y[2] })));
+			for (int py = y0; py <= y1; py++) {
+				for (int px = x0; px <= x1; px++) {
+					float cx = px + 0.5f, cy = py + 0.5f;
+					// Coordenadas baricentricas (dentro si las tres tienen el signo del area)
+					float w0 = ((x[1] - cx) * (y[2] - cy) - (y[1] - cy) * (x[2] - cx)) / area;
+					float w1 = ((x[2] - cx) * (y[0] - cy) - (y[2] - cy) * (x[0] - cx)) / area;
+					float w2 = 1.0f - w0 - w1;
+					if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f) continue;
+
+					float d = w0 * z[0] + w1 * z[1] + w2 * z[2];
+					float& stored = depth[py * gridSize + px];
+					if (d < stored) {
+						stored = d;
+						shaded++;
+					}
+				}
+			}
+		}
+		for (float d : depth)
+			if (d < 1e30f) covered++;
+	}
+	return covered ? (float)shaded / covered : 0.0f;
+}
+
+MeshOptimizer::meshStats_t MeshOptimizer::analyze(const vector<vertex_t>& vertices, const int* indices, size_t count,
+	unsigned int vertexStride, unsigned int indexSize)
+{
+	meshStats_t s = {};
+	s.triangles = count / 3;
+	vector<unsigned char> used(vertices.size(), 0);
+	for (size_t i = 0; i < count; i++) {
+		if (!used[indices[i]]) s.vertices++;
+		used[indices[i]] = 1;
+	}
+
+	size_t misses = cacheMisses(indices, count, vertices.size());
+	s.acmr = s.triangles ? (float)misses / s.triangles : 0.0f;
+	s.atvr = s.vertices ? (float)misses / s.vertices : 0.0f;
+	s.overdraw = overdraw(vertices, indices, count);
+	s.vertexBytes = vertices.size() * vertexStride;
+	s.indexBytes = count * indexSize;
+	return s;
+}
+
+#pragma endregion
@@ -0,0 +1,292 @@
+#include "libprgr/MeshSimplifier.h"
+#include <algorithm>
+#include <array>
+#include <unordered_map>
+
+#pragma region --- MESH SIMPLIFIER ---
+
+MeshSimplifier::MeshSimplifier(const vector<vertex_t>& vertices) : vertices(vertices)
+{
+	size_t n = vertices.size();
+	attributeRemap.resize(n);
+	positionRemap.resize(n);
+	seam.assign(n, 0);
+
+	// Los ficheros .fiis repiten vertices por cara: se sueldan los identicos y se agrupan por posicion
+	map<std::array<float, 12>, int> byVertex;
+	map<std::array<float, 3>, int> byPosition;
+	for (size_t i = 0; i < n; i++) {
+		const vertex_t& v = vertices[i];
+		std::array<float, 12> key = { v.vPos.x, v.vPos.y, v.vPos.z,
+			v.vNormal.x, v.vNormal.y, v.vNormal.z, v.vTextureCoord.x, v.vTextureCoord.y,
+			v.vColor.x, v.vColor.y, v.vColor.z, v.vColor.w };
+		attributeRemap[i] = byVertex.emplace(key, (int)i).first->second;
+		positionRemap[i] = byPosition.emplace(std::array<float, 3>{ v.vPos.x, v.vPos.y, v.vPos.z }, (int)i).first->second;
+	}
+
+	// Costura: mas de un vertice soldado en la misma posicion
+	vector<int> wedges(n, 0);
+	for (size_t i = 0; i < n; i++)
+		if (attributeRemap[i] == (int)i && ++wedges[positionRemap[i]] > 1)
+			seam[positionRemap[i]] = 1;
+
+	// Esfera envolvente para escalar los errores
+	if (n > 0) {
+		vector4f min = vertices[0].vPos, max = vertices[0].vPos;
+		for (const vertex_t& v : vertices) {
+			min = { std::min(min.x, v.vPos.x), std::min(min.y, v.vPos.y), std::min(min.z, v.vPos.z), 1 };
+			max = { std::max(max.x, v.vPos.x), std::max(max.y, v.vPos.y), std::max(max.z, v.vPos.z), 1 };
+		}
+		center = { (min.x + max.x) * 0.5f, (min.y + max.y) * 0.5f, (min.z + max.z) * 0.5f, 1 };
+		for (const vertex_t& v : vertices) {
+			float dx = v.vPos.x - center.x, dy = v.vPos.y - center.y, dz = v.vPos.z - center.z;
+			extent = std::max(extent, sqrtf(dx * dx + dy * dy + dz * dz));
+		}
+	}
+}
+
+void MeshSimplifier::attributes(int v, double* out) const
+{
+	// Escalados para que una diferencia de 1 con peso 1 equivalga a desplazarse el radio de la malla
+	const vertex_t& vx = vertices[v];
+	double n = sqrt(normalWeight) * extent, t = sqrt(uvWeight) * extent, c = sqrt(colorWeight) * extent;
+	out[0] = vx.vNormal.x * n;
+	out[1] = vx.vNormal.y * n;
+	out[2] = vx.vNormal.z * n;
+	out[3] = vx.vTextureCoord.x * t;
+	out[4] = vx.vTextureCoord.y * t;
+	out[5] = vx.vColor.x * c;
+	out[6] = vx.vColor.y * c;
+	out[7] = vx.vColor.z * c;
+	out[8] = vx.vColor.w * c;
+}
+
+void MeshSimplifier::addTriangle(vector<quadric_t>& quadrics, int i0, int i1, int i2) const
+{
+	const vector4f& p0 = vertices[i0].vPos;
+	const vector4f& p1 = vertices[i1].vPos;
+	const vector4f& p2 = vertices[i2].vPos;
+
+	double ux = p1.x - p0.x, uy = p1.y - p0.y, uz = p1.z - p0.z;
+	double vx = p2.x - p0.x, vy = p2.y - p0.y, vz = p2.z - p0.z;
+	double nx = uy * vz - uz * vy, ny = uz * vx - ux * vz, nz = ux * vy - uy * vx;
+	double len = sqrt(nx * nx + ny * ny + nz * nz);
+	if (len == 0.0) return;
+
+	double area = len * 0.5;
+	nx /= len; ny /= len; nz /= len;
+	double d = -(nx * p0.x + ny * p0.y + nz * p0.z);
+
+	int corners[3] = { i0, i1, i2 };
+	for (int v : corners) {
+		quadric_t& q = quadrics[v];
+		q.a00 += area * nx * nx; q.a01 += area * nx * ny; q.a02 += area * nx * nz; q.a03 += area * nx * d;
+		q.a11 += area * ny * ny; q.a12 += area * ny * nz; q.a13 += area * ny * d;
+		q.a22 += area * nz * nz; q.a23 += area * nz * d;
+		q.a33 += area * d * d;
+
+		double attr[ATTRIBUTES];
+		attributes(v, attr);
+		for (int k = 0; k < ATTRIBUTES; k++) {
+			q.attrB[k] += area * attr[k];
+			q.attrC += area * attr[k] * attr[k];
+		}
+		q.weight += area;
+	}
+}
+
+double MeshSimplifier::collapseError(const quadric_t& qa, const quadric_t& qb, int b) const
+{
+	double weight = qa.weight + qb.weight;
+	if (weight <= 0.0) return 0.0;
+
+	// Error de posicion: p^T Q p con p = (x, y, z, 1)
+	const vector4f& p = vertices[b].vPos;
+	double x = p.x, y = p.y, z = p.z;
+	double position =
+		(qa.a00 + qb.a00) * x * x + (qa.a11 + qb.a11) * y * y + (qa.a22 + qb.a22) * z * z +
+		2.0 * ((qa.a01 + qb.a01) * x * y + (qa.a02 + qb.a02) * x * z + (qa.a12 + qb.a12) * y * z) +
+		2.0 * ((qa.a03 + qb.a03) * x + (qa.a13 + qb.a13) * y + (qa.a23 + qb.a23) * z) +
+		(qa.a33 + qb.a33);
+
+	// Error de atributos: sum w |a - a_i|^2 = W |a|^2 - 2 B.a + C
+	double attr[ATTRIBUTES];
+	attributes(b, attr);
+	double attribute = qa.attrC + qb.attrC;
+	for (int k = 0; k < ATTRIBUTES; k++)
+		attribute += weight * attr[k] * attr[k] - 2.0 * (qa.attrB[k] + qb.attrB[k]) * attr[k];
+
+	// Media ponderada por area: distancia al cuadrado
+	return std::max(0.0, (position + attribute) / weight);
+}
+
+bool MeshSimplifier::flips(const vector<int>& indices, const int* triangles, int count, int a, int b) const
+{
+	const vector4f& pb = vertices[b].vPos;
+	for (int t = 0; t < count; t++) {
+		const int* tri = &indices[triangles[t] * 3];
+		if (positionRemap[tri[0]] == positionRemap[b] || positionRemap[tri[1]] == positionRemap[b] ||
+			positionRemap[tri[2]] == positionRemap[b])
+			continue; // Este triangulo desaparece con el colapso
+
+		vector4f p[3], q[3];
+		for (int k = 0; k < 3; k++) {
+			p[k] = vertices[tri[k]].vPos;
+			q[k] = tri[k] == a ? pb : p[k];
+		}
+		vector4f n0 = (p[1] - p[0]) ^ (p[2] - p[0]);
+		vector4f n1 = (q[1] - q[0]) ^ (q[2] - q[0]);
+
+		// Rechaza giros y triangulos que quedan casi degenerados
+		if (n0 * n1 <= 0.25f * length(n0) * length(n1))
+			return true;
+	}
+	return false;
+}
+
+vector<int> MeshSimplifier::simplify(const vector<int>& indices, size_t targetIndexCount, float maxError, float* error)
+{
+	size_t n = vertices.size();
+	vector<int> idx(indices.size());
+	for (size_t i = 0; i < indices.size(); i++)
+		idx[i] = attributeRemap[indices[i]];
+
+	// Borde: arista (por posicion) sin su opuesta
+	vector<unsigned char> locked(n, 0);
+	{
+		std::unordered_map<unsigned long long, int> edges;
+		auto key = [](int a, int b) { return ((unsigned long long)(unsigned int)a << 32) | (unsigned int)b; };
+		for (size_t t = 0; t + 2 < idx.size(); t += 3)
+			for (int e = 0; e < 3; e++)
+				edges[key(positionRemap[idx[t + e]], positionRemap[idx[t + (e + 1) % 3]])]++;
+		for (const auto& [k, count] : edges) {
+			int a = (int)(k >> 32), b = (int)(k & 0xffffffffu);
+			if (edges.find(key(b, a)) == edges.end())
+				locked[a] = locked[b] = 1;
+		}
+	}
+	auto isLocked = [&](int v) { return locked[positionRemap[v]] || seam[positionRemap[v]]; };
+
+	vector<quadric_t> quadrics(n, quadric_t{});
+	for (size_t t = 0; t + 2 < idx.size(); t += 3)
+		addTriangle(quadrics, idx[t], idx[t + 1], idx[t + 2]);
+
+	typedef struct {
+		double cost;
+		int a, b; // a se funde en b
+	} collapse_t;
+
+	vector<int> triStart, triList, collapseTo(n);
+	vector<unsigned char> touched;
+	vector<unsigned long long> edgeKeys;
+	vector<collapse_t> candidates;
+	double maxErrorSq = (double)maxError * maxError;
+	double applied = 0.0;
+
+	// Por pasadas: en cada una se aplican los colapsos mas baratos que no se tocan entre si
+	while (idx.size() > targetIndexCount) {
+		size_t triCount = idx.size() / 3;
+
+		// Triangulos de cada vertice
+		triStart.assign(n + 1, 0);
+		for (int v : idx)
+			triStart[v + 1]++;
+		for (size_t v = 0; v < n; v++)
+			triStart[v + 1] += triStart[v];
+		triList.resize(idx.size());
+		{
+			vector<int> cursor(triStart.begin(), triStart.end() - 1);
+			for (size_t i = 0; i < idx.size(); i++)
+				triList[cursor[idx[i]]++] = (int)(i / 3);
+		}
+
+		// Aristas unicas y el sentido de colapso mas barato de cada una
+		edgeKeys.clear();
+		for (size_t t = 0; t < triCount; t++) {
+			for (int e = 0; e < 3; e++) {
+				unsigned int u = idx[t * 3 + e], v = idx[t * 3 + (e + 1) % 3];
+				if (u > v) std::swap(u, v);
+				edgeKeys.push_back(((unsigned long long)u << 32) | v);
+			}
+		}
+		std::sort(edgeKeys.begin(), edgeKeys.end());
+		edgeKeys.erase(std::unique(edgeKeys.begin(), edgeKeys.end()), edgeKeys.end());
+
+		candidates.clear();
+		for (unsigned long long k : edgeKeys) {
+			int u = (int)(k >> 32), v = (int)(k & 0xffffffffu);
+			if (positionRemap[u] == positionRemap[v]) continue;
+
+			collapse_t best = { maxErrorSq, -1, -1 };
+			if (!isLocked(u)) {
+				double c = collapseError(quadrics[u], quadrics[v], v);
+				if (c <= best.cost) best = { c, u, v };
+			}
+			if (!isLocked(v)) {
+				double c = collapseError(quadrics[v], quadrics[u], u);
+				if (c <= best.cost) best = { c, v, u };
+			}
+			if (best.a >= 0)
+				candidates.push_back(best);
+		}
+		std::sort(candidates.begin(), candidates.end(), [](const collapse_t& x, const collapse_t& y) { return x.cost < y.cost; });
+
+		touched.assign(n, 0);
+		for (size_t v = 0; v < n; v++)
+			collapseTo[v] = (int)v;
+
+		size_t targetTris = targetIndexCount / 3, removed = 0, collapses = 0;
+		for (const collapse_t& c : candidates) {
+			if (triCount - removed <= targetTris) break;
+			if (touched[c.a] || touched[c.b]) continue;
+
+			const int* tris = &triList[triStart[c.a]];
+			int count = triStart[c.a + 1] - triStart[c.a];
+
+			// Arista interior normal: exactamente dos triangulos la comparten
+			int shared = 0;
+			for (int t = 0; t < count; t++) {
+				const int* tri = &idx[tris[t] * 3];
+				if (positionRemap[tri[0]] == positionRemap[c.b] || positionRemap[tri[1]] == positionRemap[c.b] ||
+					positionRemap[tri[2]] == positionRemap[c.b])
+					shared++;
+			}
+			if (shared != 2 || flips(idx, tris, count, c.a, c.b)) continue;
+
+			collapseTo[c.a] = c.b;
+			double* qa = (double*)&quadrics[c.a];
+			double* qb = (double*)&quadrics[c.b];
+			for (size_t k = 0; k < sizeof(quadric_t) / sizeof(double); k++)
+				qb[k] += qa[k];
+			applied = std::max(applied, c.cost);
+
+			// El abanico de a cambia: sus vertices no pueden colapsar en esta pasada
+			touched[c.a] = touched[c.b] = 1;
+			for (int t = 0; t < count; t++)
+				for (int k = 0; k < 3; k++)
+					touched[idx[tris[t] * 3 + k]] = 1;
+
+			removed += 2;
+			collapses++;
+		}
+		if (collapses == 0) break;
+
+		// Reescribe los indices y quita los triangulos degenerados
+		size_t out = 0;
+		for (size_t t = 0; t < triCount; t++) {
+			int i0 = collapseTo[idx[t * 3]], i1 = collapseTo[idx[t * 3 + 1]], i2 = collapseTo[idx[t * 3 + 2]];
+			if (positionRemap[i0] == positionRemap[i1] || positionRemap[i1] == positionRemap[i2] ||
+				positionRemap[i0] == positionRemap[i2])
+				continue;
+			idx[out++] = i0;
+			idx[out++] = i1;
+			idx[out++] = i2;
+		}
+		idx.resize(out);
+	}
+
+	if (error) *error = (float)sqrt(applied);
+	return idx;
+}
+
+#pragma endregion
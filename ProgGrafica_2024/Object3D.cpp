@@ -1,5 +1,6 @@
 #include "libprgr/Object3D.h"
 #include "libprgr/EventManager.h"
+#include "libprgr/ProgramLibrary.h"
 
 
 int Object3D::idCounter = 0;
@@ -17,6 +18,15 @@ Object3D::Object3D() // Constructor por defecto, crea un objeto en la posicion (
 }
 
 
+Object3D::~Object3D()
+{
+	// Devuelve sus referencias a la malla y al programa compartidos: con la ultima se liberan
+	MeshLibrary::release(mesh);
+	ProgramLibrary::release(program);
+	delete collider;
+}
+
+
 Object3D::Object3D(string file) {
 	id = idCounter++;
 	this->position = { 0,0,0,1 };
@@ -45,21 +55,40 @@ void Object3D::createTriangle()
 	this->scale = { 1.0, 1.0, 1.0, 1.0 };
 	this->rotation = { 0.0, 0.0, 0.0, 1.0 };
 
-	this->vertexList.push_back({ {  0.0,  0.5, 0.0, 1.0 },{1,0,0,1} }); // pushback es una funcion que agrega un elemento al final del vector
-	this->vertexList.push_back({ { -0.5, -0.5, 0.0, 1.0 },{0,1,0,1} });
-	this->vertexList.push_back({ {  0.5, -0.5, 0.0, 1.0 },{0,0,1,1} });
+	// Todos los triangulos comparten la misma malla
+	MeshLibrary::release(mesh);
+	mesh = MeshLibrary::acquireProcedural("#triangle", [](Mesh* m) {
+		m->vertexList.push_back({ {  0.0,  0.5, 0.0, 1.0 },{1,0,0,1} }); // pushback es una funcion que agrega un elemento al final del vector
+		m->vertexList.push_back({ { -0.5, -0.5, 0.0, 1.0 },{0,1,0,1} });
+		m->vertexList.push_back({ {  0.5, -0.5, 0.0, 1.0 },{0,0,1,1} });
 
-	this->idList = { 0, 1, 2 }; // lista de indices de vertices, orden en que se dibujan
+		m->idList = { 0, 1, 2 }; // lista de indices de vertices, orden en que se dibujan
+	});
 
 	modelMatrix = make_identity();
 }
 
 void Object3D::updateModelMatrix()
 {
+	// Si la transformacion no ha cambiado nos ahorramos make_rotate y las multiplicaciones
+	if (transformCached &&
+		memcmp(&position, &lastPosition, sizeof(vector4f)) == 0 &&
+		memcmp(&rotation, &lastRotation, sizeof(vector4f)) == 0 &&
+		memcmp(&scale, &lastScale, sizeof(vector4f)) == 0)
+		return;
+
 	matrix4x4f scaleMatrix = make_scale(scale.x, scale.y, scale.z); // No se pedia, pero no cuesta nada
 	matrix4x4f rotationMatrix = make_rotate(rotation.x, rotation.y, rotation.z);  // matriz de rotacion
 	matrix4x4f translationMatrix = make_translate(position.x, position.y, position.z); // matriz de traslacion
-	modelMatrix = translationMatrix * rotationMatrix * scaleMatrix; // matriz de modelo que se consigue multiplicando las 3 matrices anteriores
+	localMatrix = translationMatrix * rotationMatrix * scaleMatrix; // matriz de modelo que se consigue multiplicando las 3 matrices anteriores
+
+	// Sin padre la matriz de mundo es la local; con padre la sobrescribe Render tras actualizar el SceneGraph
+	modelMatrix = localMatrix;
+
+	lastPosition = position;
+	lastRotation = rotation;
+	lastScale = scale;
+	transformCached = true;
 }
 
 void Object3D::move(double timeStep) 
@@ -75,76 +104,51 @@ void Object3D::move(double timeStep)
 
 void Object3D::loadFromFile(string file)
 {
-	ifstream f(file);
-	if (f.is_open())
-	{
-		
-		leerVertices(f);
-		leerColores(f);
-		leerNormales(f);
-		leerTexturas(f);
-		leerCaras(f);
-		// Crear el colisionador (usar COLLIDER_SPHERE por defecto)
-		createCollider();
-		// createCollider(COLLIDER_AABB);  // Fuerza el tipo AABB
-
-		// Actualizar el colisionador con la matriz modelo inicial
-		updateCollider();
-		program = new Program();
-		program->addShader("data/shader.frag");
-		program->addShader("data/shader.vert");
-		program->linkProgram();
-		program->checkErrors();
-	}
-	else {
+	// La malla (vertices, indices, textura y buffers) solo se lee la primera vez que se pide el fichero
+	Mesh* loaded = MeshLibrary::acquire(file);
+	if (loaded)
+		setMesh(loaded);
+	else
 		cout << "Error al abrir el archivo" << endl;
-	}
 }
 
-void Object3D::leerNormales(std::ifstream& f)
+void Object3D::setMesh(Mesh* loaded)
+{
+	MeshLibrary::release(mesh);
+	mesh = loaded;
+	material.texture = mesh->texture;
+
+	// Crear el colisionador (usar COLLIDER_SPHERE por defecto)
+	createCollider();
+	// createCollider(COLLIDER_AABB);  // Fuerza el tipo AABB
+
+	// Actualizar el colisionador con la matriz modelo inicial
+	updateCollider();
+
+	// Sin texels transparentes el fragment shader no necesita discard
+	alphaTested = material.texture && !material.texture->opaque;
+	updateProgram();
+}
+
+void Object3D::updateProgram()
 {
-	//repetir
-	string linea = "";
-	do {
-		//	leer linea
-		std::getline(f, linea);
-
-		//si no es comentario
-		if ((linea[0] != '/' && linea[1] != '/') && (linea != "end"))
-		{
-			// // separar linea en identificador y posiciones
-			std::stringstream l(linea);
-			string identificador;
-			string normal;
-			l >> identificador;
-			l >> normal;
-			std::vector<float> n = splitString<float>(normal, ',');
-			int vertexId = splitString<int>(identificador, ':')[0];
-			this->vertexList[vertexId - 1].vNormal = { n[0],n[1],n[2],n[3] };
-		}
-		//hasta "end"
-	} while (linea != "end");
+	if (!mesh) return;
+
+	// Todos los objetos con los mismos shaders comparten un unico programa (uno por formato de vertices,
+	// otro si la textura va en un TextureArray y otro con alpha test)
+	vector<string> defines = mesh->layout->shaderDefines();
+	if (material.texture && material.texture->layered)
+		defines.push_back("TEXTURE_ARRAY");
+	if (alphaTested)
+		defines.push_back("ALPHA_TEST");
+	// Primero el nuevo: si es el mismo programa, soltar antes el viejo lo borraria y lo volveria a compilar
+	Program* previous = program;
+	program = ProgramLibrary::acquire({ "data/shader.frag", "data/shader.vert" }, defines);
+	ProgramLibrary::release(previous);
 }
 
 void Object3D::createCollider(ColliderType type) {
-	if (vertexList.empty()) return;
-
-	// Calcular los lmites del objeto (mnimos y mximos)
-	vector4f min = { numeric_limits<float>::max(),
-					 numeric_limits<float>::max(),
-					 numeric_limits<float>::max(), 1 };
-	vector4f max = { -numeric_limits<float>::max(),
-					 -numeric_limits<float>::max(),
-					 -numeric_limits<float>::max(), 1 };
-
-	for (const auto& vertex : vertexList) {
-		min.x = std::min(min.x, vertex.vPos.x);
-		min.y = std::min(min.y, vertex.vPos.y);
-		min.z = std::min(min.z, vertex.vPos.z);
-		max.x = std::max(max.x, vertex.vPos.x);
-		max.y = std::max(max.y, vertex.vPos.y);
-		max.z = std::max(max.z, vertex.vPos.z);
-	}
+	if (!mesh) return;
 
 	// Eliminar el colisionador existente si lo hay
 	if (collider) {
@@ -152,171 +156,14 @@ void Object3D::createCollider(ColliderType type) {
 		collider = nullptr;
 	}
 
-	// Crear el colisionador segn el tipo especificado
-	switch (type) {
-	case COLLIDER_SPHERE: {
-		vector4f center = (min + max) * 0.5f;
-		center.w = 1;
-		float radius = distance(center, max) * 1.0;
-		collider = new Sphere(center, radius);
-		break;
-	}
-	case COLLIDER_AABB: {
-		collider = new AABB(min, max);
-		break;
-	}
-					  // Podemos aadir ms  (ej: COLLIDER_CAPSULE, COLLIDER_MESH, etc.), como quieras
-	default:
-		collider = new Sphere((min + max) * 0.5f, distance(min, max) * 0.5f);
-		break;
-	}
-
-	// Aadir todos los vrtices como partculas al colisionador
-	for (const auto& vertex : vertexList) {
-		collider->addVertex(vertex.vPos);
-	}
-
-	// Opcional: Subdividir el colisionador si hay muchos vrtices
-	if (vertexList.size() > 10) {
-		collider->subdivide();
-	}
+	// Copia del prototipo de la malla: limites, particulas y subdivision ya estan calculados
+	collider = mesh->createCollider(type == COLLIDER_AABB ? AABB_t : sphere);
 }
 
 void Object3D::updateCollider() {
 	if (!collider) {
 		createCollider(colliderType);  // Crear el colisionador con el tipo actual
 	}
-	collider->update(modelMatrix);     // Actualizar con la matriz modelo
-}
-
-
-void Object3D::leerVertices(std::ifstream& f)
-{
-	// Leer linea hasta encontrar un end
-	string linea;
-	do {
-		std::getline(f, linea);
-		// Averiguar si no es comentario
-		if ((linea[0] != '/' && linea[1] != '/') && (linea != "end"))
-		{
-			// Seprara lnea en identificador y posiciones
-			std::stringstream l(linea);
-			string identificador;
-			string posiciones;
-
-			l >> identificador;
-			l >> posiciones;
-
-			std::vector<float> pos = splitString<float>(posiciones, ','); // Divide la palabra posiciones
-
-			// Asignar posiciones a nuevo vrtice
-			vertex_t v;
-			v.vPos.x = pos[0];
-			v.vPos.y = pos[1];
-			v.vPos.z = pos[2];
-			v.vPos.w = 1; // Lo dejamos a 1 porque es una posicion
-			this->vertexList.push_back(v);
-
-
-		}
-	} while (linea != "end");
-
-
-}
-
-
-void Object3D::leerColores(std::ifstream& f)
-{
-	// Leer linea hasta encontrar un end
-	string linea;
-	do {
-		std::getline(f, linea);
-		// Averiguar si no es comentario
-		if ((linea[0] != '/' && linea[1] != '/') && (linea != "end"))
-		{
-			// Seprara lnea en identificador y posiciones
-			std::stringstream l(linea);
-			string identificador;
-			string colores;
-
-			l >> identificador;
-			l >> colores;
-
-			std::vector<float> color = splitString<float>(colores, ','); // Divide la palabra posiciones
-
-			int vertexId = splitString<int>(identificador, ';')[0];
-
-			this->vertexList[vertexId - 1].vColor = { color[0], color[1], color[2], color[3] };
-
-		}
-	} while (linea != "end");
-
-
-}
-
-
-
-void Object3D::leerCaras(std::ifstream& f)
-{
-	// Leer linea hasta encontrar un end
-	string linea;
-	do {
-		std::getline(f, linea);
-		// Averiguar si no es comentario
-		if ((linea[0] != '/' && linea[1] != '/') && (linea != "end"))
-		{
-			// Seprara lnea en identificador y posiciones
-			std::stringstream l(linea);
-			string identificador;
-			string vertexIds;
-
-			l >> identificador;
-			l >> vertexIds;
-
-			std::vector<int> vIds = splitString<int>(vertexIds, ','); // Divide la palabra posiciones
-			this->idList.push_back(vIds[0] - 1);
-			this->idList.push_back(vIds[1] - 1);
-			this->idList.push_back(vIds[2] - 1);
-
-		}
-	} while (linea != "end");
-
-
+	if (collider)
+		collider->update(modelMatrix);     // Actualizar con la matriz modelo
 }
-void Object3D::leerTexturas(std::ifstream& f)
-{
-	//repetir
-	string linea = "";
-	do { //primer bucle: leer coordenadas de textura hasta "end"
-		//	leer linea
-		std::getline(f, linea);
-
-		//si no es comentario
-		if ((linea[0] != '/' && linea[1] != '/') && (linea != "end"))
-		{
-			// // separar linea en identificador y posiciones
-			std::stringstream l(linea);
-			string identificador;
-			string textureCoord;
-			l >> identificador;
-			l >> textureCoord;
-			std::vector<float> tc = splitString<float>(textureCoord, ',');
-			int vertexId = splitString<int>(identificador, ':')[0];
-			this->vertexList[vertexId - 1].vTextureCoord = { tc[0],tc[1],-1,-1 };
-		}
-		//hasta "end"
-	} while (linea != "end");
-
-	do {//leer fichero de textura
-		//	leer linea
-		std::getline(f, linea);
-		//si no es comentario
-		if ((linea[0] != '/' && linea[1] != '/') && (linea != "end"))
-		{
-			//fichero de textura en variable linea
-			this->material.texture = new Texture(linea);
-		}
-		//hasta "end"
-	} while (linea != "end");
-}
-
@@ -0,0 +1,333 @@
+#include "libprgr/OcclusionCuller.h"
+#include <algorithm>
+
+#pragma region --- OCCLUSION CULLER ---
+
+OcclusionCuller::OcclusionCuller(int width, int height, int tilesX, int tilesY, int threads) :
+	width(width), height(height), tilesX(tilesX), tilesY(tilesY), threads(threads)
+{
+	if (this->threads <= 0)
+		this->threads = std::max(1u, std::thread::hardware_concurrency());
+
+	viewProjection = make_identity();
+	hiZ.push_back(vector<float>(width * height, 1.0f));
+}
+
+OcclusionCuller::~OcclusionCuller()
+{
+	stopWorkers();
+}
+
+void OcclusionCuller::startWorkers(int count)
+{
+	std::lock_guard<std::mutex> lock(poolMutex);
+	stopping = false;
+	for (int w = 0; w < count; w++)
+		workers.emplace_back(&OcclusionCuller::workerLoop, this, generation);
+}
+
+void OcclusionCuller::stopWorkers()
+{
+	{
+		std::lock_guard<std::mutex> lock(poolMutex);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (std::thread& worker : workers)
+		worker.join();
+	workers.clear();
+}
+
+void OcclusionCuller::workerLoop(unsigned long long seen)
+{
+	for (;;) {
+		{
+			std::unique_lock<std::mutex> lock(poolMutex);
+			wake.wait(lock, [&]() { return stopping || generation != seen; });
+			if (stopping) return;
+			seen = generation;
+		}
+
+		rasterizeTiles();
+
+		std::lock_guard<std::mutex> lock(poolMutex);
+		if (--pending == 0)
+			done.notify_one();
+	}
+}
+
+void OcclusionCuller::rasterizeTiles()
+{
+	int numTiles = tilesX * tilesY;
+	for (int t = nextTile.fetch_add(1); t < numTiles; t = nextTile.fetch_add(1))
+		rasterizeTile(t);
+}
+
+void OcclusionCuller::begin(const matrix4x4f& vp)
+{
+	viewProjection = vp;
+	triangles.clear();
+}
+
+void OcclusionCuller::addOccluder(const vector<vertex_t>& vertices, const vector<int>& indices, const matrix4x4f& model)
+{
+	matrix4x4f mvp = viewProjection * model;
+
+	// Vertices a pantalla una sola vez (los triangulos comparten vertices)
+	vector<vector4f> screen(vertices.size());
+	vector<unsigned char> valid(vertices.size());
+	for (size_t i = 0; i < vertices.size(); i++) {
+		vector4f clip = mvp * vertices[i].vPos;
+
+		// Delante del plano cercano (o detras de la camara): no se puede proyectar
+		valid[i] = clip.w > 1e-5f && clip.z >= -clip.w;
+		if (!valid[i]) continue;
+
+		float invW = 1.0f / clip.w;
+		screen[i].x = (clip.x * invW * 0.5f + 0.5f) * width;
+		screen[i].y = (clip.y * invW * 0.5f + 0.5f) * height;
+		screen[i].z = clip.z * invW * 0.5f + 0.5f;
+	}
+
+	for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+		int i0 = indices[t], i1 = indices[t + 1], i2 = indices[t + 2];
+
+		// Un triangulo que cruza el plano cercano se descarta: ocluir menos siempre es correcto
+		if (!valid[i0] || !valid[i1] || !valid[i2]) continue;
+
+		vector4f v[3] = { screen[i0], screen[i1], screen[i2] };
+		float area = (v[1].x - v[0].x) * (v[2].y - v[0].y) - (v[1].y - v[0].y) * (v[2].x - v[0].x);
+		if (area == 0.0f) continue;
+		if (area < 0.0f) std::swap(v[1], v[2]); // Sentido antihorario: dentro si las 3 aristas >= 0
+
+		screenTriangle_t tri;
+		for (int e = 0; e < 3; e++) {
+			const vector4f& p = v[e];
+			const vector4f& q = v[(e + 1) % 3];
+			tri.a[e] = p.y - q.y;
+			tri.b[e] = q.x - p.x;
+			tri.c[e] = (q.y - p.y) * p.x - (q.x - p.x) * p.y;
+		}
+		tri.depth = std::max(v[0].z, std::max(v[1].z, v[2].z));
+
+		float minX = std::min(v[0].x, std::min(v[1].x, v[2].x));
+		float maxX = std::max(v[0].x, std::max(v[1].x, v[2].x));
+		float minY = std::min(v[0].y, std::min(v[1].y, v[2].y));
+		float maxY = std::max(v[0].y, std::max(v[1].y, v[2].y));
+		tri.minX = std::max(0, (int)floorf(minX));
+		tri.minY = std::max(0, (int)floorf(minY));
+		tri.maxX = std::min(width - 1, (int)floorf(maxX));
+		tri.maxY = std::min(height - 1, (int)floorf(maxY));
+		if (tri.minX > tri.maxX || tri.minY > tri.maxY) continue;
+
+		triangles.push_back(tri);
+	}
+}
+
+void OcclusionCuller::rasterizeRowsScalar(const screenTriangle_t& tri, int x0, int x1, int y0, int y1, float* depth) const
+{
+	for (int y = y0; y <= y1; y++) {
+		float py = (float)y + 0.5f;
+		float row[3];
+		for (int e = 0; e < 3; e++)
+			row[e] = tri.b[e] * py + tri.c[e];
+
+		float* line = depth + y * width;
+		for (int x = x0; x <= x1; x++) {
+			float px = (float)x + 0.5f;
+			if (tri.a[0] * px + row[0] >= 0.0f && tri.a[1] * px + row[1] >= 0.0f && tri.a[2] * px + row[2] >= 0.0f)
+				line[x] = std::min(line[x], tri.depth);
+		}
+	}
+}
+
+void OcclusionCuller::rasterizeRows(const screenTriangle_t& tri, int x0, int x1, int y0, int y1, float* depth) const
+{
+#ifdef PRGR_SSE2
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 offsets = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+	const __m128 triDepth = _mm_set1_ps(tri.depth);
+	const __m128 a0 = _mm_set1_ps(tri.a[0]), a1 = _mm_set1_ps(tri.a[1]), a2 = _mm_set1_ps(tri.a[2]);
+
+	for (int y = y0; y <= y1; y++) {
+		float py = (float)y + 0.5f;
+		__m128 row0 = _mm_set1_ps(tri.b[0] * py + tri.c[0]);
+		__m128 row1 = _mm_set1_ps(tri.b[1] * py + tri.c[1]);
+		__m128 row2 = _mm_set1_ps(tri.b[2] * py + tri.c[2]);
+
+		float* line = depth + y * width;
+		int x = x0;
+		// 4 pixeles por iteracion; nunca se escribe fuera de [x0, x1] (otro hilo puede tener el tile vecino)
+		for (; x + 3 <= x1; x += 4) {
+			__m128 px = _mm_add_ps(_mm_set1_ps((float)x), offsets);
+			__m128 inside = _mm_and_ps(
+				_mm_and_ps(_mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a0, px), row0), zero),
+					_mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a1, px), row1), zero)),
+				_mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a2, px), row2), zero));
+			if (_mm_movemask_ps(inside) == 0) continue;
+
+			__m128 old = _mm_loadu_ps(line + x);
+			__m128 closer = _mm_min_ps(old, triDepth);
+			_mm_storeu_ps(line + x, _mm_or_ps(_mm_and_ps(inside, closer), _mm_andnot_ps(inside, old)));
+		}
+		if (x <= x1)
+			rasterizeRowsScalar(tri, x, x1, y, y, depth);
+	}
+#else
+	rasterizeRowsScalar(tri, x0, x1, y0, y1, depth);
+#endif
+}
+
+void OcclusionCuller::rasterizeTile(int tile)
+{
+	int tx = tile % tilesX;
+	int ty = tile / tilesX;
+	int x0 = tx * width / tilesX;
+	int x1 = (tx + 1) * width / tilesX - 1;
+	int y0 = ty * height / tilesY;
+	int y1 = (ty + 1) * height / tilesY - 1;
+
+	float* depth = hiZ[0].data();
+	for (const screenTriangle_t& tri : triangles) {
+		int minX = std::max(x0, tri.minX), maxX = std::min(x1, tri.maxX);
+		int minY = std::max(y0, tri.minY), maxY = std::min(y1, tri.maxY);
+		if (minX > maxX || minY > maxY) continue;
+		rasterizeRows(tri, minX, maxX, minY, maxY, depth);
+	}
+}
+
+void OcclusionCuller::rasterize()
+{
+	hiZ.resize(1);
+	hiZ[0].assign(width * height, 1.0f);
+
+	// Los tiles no se solapan: cada hilo escribe solo en los que coge
+	int numTiles = tilesX * tilesY;
+	int helpers = std::min(threads, numTiles) - 1;
+	if (helpers <= 0 || triangles.empty()) {
+		for (int t = 0; t < numTiles; t++)
+			rasterizeTile(t);
+	}
+	else {
+		// Los hilos se crean una vez (o de nuevo si cambia threads): crearlos cada frame cuesta mas
+		// que rasterizar el buffer
+		if ((int)workers.size() != helpers) {
+			stopWorkers();
+			startWorkers(helpers);
+		}
+		nextTile = 0;
+		{
+			std::lock_guard<std::mutex> lock(poolMutex);
+			pending = helpers;
+			generation++;
+		}
+		wake.notify_all();
+
+		// El que llama tambien rasteriza y despues espera a los demas
+		rasterizeTiles();
+		std::unique_lock<std::mutex> lock(poolMutex);
+		done.wait(lock, [&]() { return pending == 0; });
+	}
+
+	buildHiZ();
+}
+
+void OcclusionCuller::buildHiZ()
+{
+	// Cada nivel redondea hacia arriba: el texel x del nivel k cubre los pixeles [x << k, (x + 1) << k)
+	int w = width, h = height;
+	while (w > 1 || h > 1) {
+		int w2 = (w + 1) / 2, h2 = (h + 1) / 2;
+		const vector<float>& src = hiZ.back();
+		vector<float> dst(w2 * h2);
+		for (int y = 0; y < h2; y++) {
+			int sy0 = 2 * y, sy1 = std::min(2 * y + 1, h - 1);
+			for (int x = 0; x < w2; x++) {
+				int sx0 = 2 * x, sx1 = std::min(2 * x + 1, w - 1);
+				dst[y * w2 + x] = std::max(std::max(src[sy0 * w + sx0], src[sy0 * w + sx1]),
+					std::max(src[sy1 * w + sx0], src[sy1 * w + sx1]));
+			}
+		}
+		hiZ.push_back(std::move(dst));
+		w = w2;
+		h = h2;
+	}
+}
+
+OcclusionCuller::screenRect_t OcclusionCuller::projectBox(const vector4f& min, const vector4f& max) const
+{
+	screenRect_t r = {};
+	float sxMin = 1e30f, syMin = 1e30f, sxMax = -1e30f, syMax = -1e30f;
+	r.nearDepth = 1e30f;
+
+	for (int i = 0; i < 8; i++) {
+		vector4f corner = { (i & 1) ? max.x : min.x, (i & 2) ? max.y : min.y, (i & 4) ? max.z : min.z, 1 };
+		vector4f clip = viewProjection * corner;
+
+		// La caja toca el plano cercano: se considera visible
+		if (clip.w <= 1e-5f || clip.z < -clip.w)
+			return r;
+
+		float invW = 1.0f / clip.w;
+		float sx = (clip.x * invW * 0.5f + 0.5f) * width;
+		float sy = (clip.y * invW * 0.5f + 0.5f) * height;
+		sxMin = std::min(sxMin, sx); sxMax = std::max(sxMax, sx);
+		syMin = std::min(syMin, sy); syMax = std::max(syMax, sy);
+		r.nearDepth = std::min(r.nearDepth, clip.z * invW * 0.5f + 0.5f);
+	}
+
+	// Fuera de la pantalla lo decide el frustum culling
+	if (sxMax < 0.0f || syMax < 0.0f || sxMin >= (float)width || syMin >= (float)height)
+		return r;
+
+	r.minX = std::max(0, (int)floorf(sxMin));
+	r.minY = std::max(0, (int)floorf(syMin));
+	r.maxX = std::min(width - 1, (int)floorf(sxMax));
+	r.maxY = std::min(height - 1, (int)floorf(syMax));
+	r.testable = true;
+	return r;
+}
+
+bool OcclusionCuller::isVisible(const vector4f& min, const vector4f& max) const
+{
+	screenRect_t r = projectBox(min, max);
+	if (!r.testable) return true;
+
+	// Nivel en el que el rectangulo ocupa como mucho 4x4 texeles
+	int level = 0;
+	while (level + 1 < (int)hiZ.size() &&
+		((r.maxX >> level) - (r.minX >> level) > 3 || (r.maxY >> level) - (r.minY >> level) > 3))
+		level++;
+
+	int w = width;
+	for (int k = 0; k < level; k++)
+		w = (w + 1) / 2;
+
+	const vector<float>& depth = hiZ[level];
+	for (int y = r.minY >> level; y <= (r.maxY >> level); y++)
+		for (int x = r.minX >> level; x <= (r.maxX >> level); x++)
+			if (r.nearDepth <= depth[y * w + x])
+				return true;
+	return false;
+}
+
+void OcclusionCuller::rasterizeReference(vector<float>& depthOut) const
+{
+	depthOut.assign(width * height, 1.0f);
+	for (const screenTriangle_t& tri : triangles)
+		rasterizeRowsScalar(tri, tri.minX, tri.maxX, tri.minY, tri.maxY, depthOut.data());
+}
+
+bool OcclusionCuller::isVisibleReference(const vector<float>& depthRef, const vector4f& min, const vector4f& max) const
+{
+	screenRect_t r = projectBox(min, max);
+	if (!r.testable) return true;
+
+	for (int y = r.minY; y <= r.maxY; y++)
+		for (int x = r.minX; x <= r.maxX; x++)
+			if (r.nearDepth <= depthRef[y * width + x])
+				return true;
+	return false;
+}
+
+#pragma endregion
@@ -0,0 +1,164 @@
+#include "libprgr/OcclusionValidator.h"
+#include <chrono>
+#include <random>
+#include <iomanip>
+#include <thread>
+
+#pragma region --- ESCENAS ---
+
+// Cubo unidad centrado en el origen (8 vertices, 12 triangulos).
+static void makeBox(vector<vertex_t>& vertices, vector<int>& indices)
+{
+	vertices.clear();
+	for (int i = 0; i < 8; i++) {
+		vertex_t v = {};
+		v.vPos = { (i & 1) ? 0.5f : -0.5f, (i & 2) ? 0.5f : -0.5f, (i & 4) ? 0.5f : -0.5f, 1 };
+		vertices.push_back(v);
+	}
+	indices = {
+		0, 1, 3, 0, 3, 2, // -z
+		4, 6, 7, 4, 7, 5, // +z
+		0, 4, 5, 0, 5, 1, // -y
+		2, 3, 7, 2, 7, 6, // +y
+		0, 2, 6, 0, 6, 4, // -x
+		1, 5, 7, 1, 7, 3  // +x
+	};
+}
+
+// Proyeccion perspectiva estandar de OpenGL (camara en el origen mirando a -z).
+static matrix4x4f perspective(float fovyDeg, float aspect, float zNear, float zFar)
+{
+	matrix4x4f p = {};
+	float f = 1.0f / tanf(toRadians(fovyDeg) * 0.5f);
+	p.mat2D[0][0] = f / aspect;
+	p.mat2D[1][1] = f;
+	p.mat2D[2][2] = -(zFar + zNear) / (zFar - zNear);
+	p.mat2D[2][3] = -2.0f * zFar * zNear / (zFar - zNear);
+	p.mat2D[3][2] = -1.0f;
+	return p;
+}
+
+#pragma endregion
+
+OcclusionValidator::OcclusionValidator(unsigned int seed, int scenes, int occluders, int objects) :
+	seed(seed), scenes(scenes), occluders(occluders), objects(objects)
+{
+}
+
+OcclusionValidator::validationResult_t OcclusionValidator::runScenes(int threads)
+{
+	validationResult_t res = {};
+	res.threads = threads;
+	res.scenes = scenes;
+
+	// Misma semilla para todas las configuraciones: mismas escenas
+	std::mt19937 rng(seed);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	auto range = [&](float a, float b) { return a + (b - a) * unit(rng); };
+
+	vector<vertex_t> boxVertices;
+	vector<int> boxIndices;
+	makeBox(boxVertices, boxIndices);
+
+	OcclusionCuller culler(256, 128, 4, 4, threads);
+	vector<float> reference;
+
+	for (int s = 0; s < scenes; s++) {
+		// Camara con algo de giro para que las aristas no esten alineadas con los pixeles
+		matrix4x4f view = make_rotate(range(-10, 10), range(-30, 30), 0);
+		culler.begin(perspective(60.0f, 2.0f, 0.1f, 100.0f) * view);
+
+		// Oclusores: mitad paredes grandes y finas, mitad cajas
+		for (int o = 0; o < occluders; o++) {
+			bool wall = (o % 2) == 0;
+			matrix4x4f model = make_translate(range(-15, 15), range(-5, 5), range(-40, -5)) *
+				make_rotate(range(-20, 20), range(-45, 45), range(-10, 10)) *
+				(wall ? make_scale(range(6, 20), range(3, 10), 0.2f) : make_scale(range(1, 5), range(1, 5), range(1, 5)));
+			culler.addOccluder(boxVertices, boxIndices, model);
+		}
+
+		auto start = std::chrono::high_resolution_clock::now();
+		culler.rasterize();
+		auto middle = std::chrono::high_resolution_clock::now();
+		culler.rasterizeReference(reference);
+		auto end = std::chrono::high_resolution_clock::now();
+		res.msRasterize += std::chrono::duration<double, std::milli>(middle - start).count() / scenes;
+		res.msReference += std::chrono::duration<double, std::milli>(end - middle).count() / scenes;
+
+		const vector<float>& depth = culler.getDepth();
+		for (size_t i = 0; i < depth.size(); i++)
+			if (depth[i] != reference[i]) res.depthMismatches++;
+
+		// Objetos: cajas pequenas, la mayoria detras de los oclusores
+		for (int i = 0; i < objects; i++) {
+			vector4f center = { range(-20, 20), range(-8, 8), range(-80, -10), 1 };
+			vector4f half = { range(0.2f, 2.0f), range(0.2f, 2.0f), range(0.2f, 2.0f), 0 };
+			vector4f min = { center.x - half.x, center.y - half.y, center.z - half.z, 1 };
+			vector4f max = { center.x + half.x, center.y + half.y, center.z + half.z, 1 };
+
+			bool visibleRef = culler.isVisibleReference(reference, min, max);
+			bool visibleHiZ = culler.isVisible(min, max);
+			res.objects++;
+			if (!visibleRef) res.occludedReference++;
+			if (!visibleHiZ) res.occludedHiZ++;
+			if (visibleRef && !visibleHiZ) res.falseOcclusions++;
+		}
+	}
+	return res;
+}
+
+void OcclusionValidator::run()
+{
+	results.clear();
+	results.push_back(runScenes(1));
+
+	// Al menos 4 hilos aunque la maquina tenga menos nucleos: lo que se valida es el reparto por tiles
+	results.push_back(runScenes(std::max(4, (int)std::thread::hardware_concurrency())));
+}
+
+bool OcclusionValidator::passed() const
+{
+	for (const auto& r : results)
+		if (r.falseOcclusions > 0 || r.depthMismatches > 0)
+			return false;
+	return !results.empty();
+}
+
+bool OcclusionValidator::writeJSON(string fileName) const
+{
+	ofstream f(fileName);
+	if (!f.is_open()) {
+		cout << "ERROR: " << __FILE__ << ":" << __LINE__ << " (" << __func__ << ") No se pudo crear " << fileName << endl;
+		return false;
+	}
+
+	f << "{\n";
+	f << "  \"seed\": " << seed << ",\n";
+	f << "  \"passed\": " << (passed() ? "true" : "false") << ",\n";
+	f << "  \"results\": [\n";
+	for (size_t i = 0; i < results.size(); i++) {
+		const validationResult_t& r = results[i];
+		f << "    { \"threads\": " << r.threads << ", \"scenes\": " << r.scenes << ", \"objects\": " << r.objects
+			<< ", \"occluded_reference\": " << r.occludedReference << ", \"occluded_hiz\": " << r.occludedHiZ
+			<< ", \"false_occlusions\": " << r.falseOcclusions << ", \"depth_mismatches\": " << r.depthMismatches
+			<< std::fixed << std::setprecision(4)
+			<< ", \"ms_rasterize\": " << r.msRasterize << ", \"ms_reference\": " << r.msReference << " }"
+			<< (i + 1 < results.size() ? "," : "") << "\n";
+	}
+	f << "  ]\n";
+	f << "}\n";
+	return true;
+}
+
+void OcclusionValidator::print() const
+{
+	cout << std::left << std::setw(8) << "hilos" << std::setw(10) << "objetos" << std::setw(12) << "ocultos ref"
+		<< std::setw(12) << "ocultos hiz" << std::setw(14) << "falsos ocult." << std::setw(14) << "pixeles dist."
+		<< std::setw(14) << "ms raster" << "ms referencia" << endl;
+	for (const auto& r : results) {
+		cout << std::left << std::setw(8) << r.threads << std::setw(10) << r.objects << std::setw(12) << r.occludedReference
+			<< std::setw(12) << r.occludedHiZ << std::setw(14) << r.falseOcclusions << std::setw(14) << r.depthMismatches
+			<< std::fixed << std::setprecision(4) << std::setw(14) << r.msRasterize << r.msReference << endl << std::defaultfloat;
+	}
+	cout << (passed() ? "OK" : "FALLO") << endl;
+}
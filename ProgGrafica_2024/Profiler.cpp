@@ -0,0 +1,259 @@
+#include "libprgr/Profiler.h"
+#include <iomanip>
+
+#pragma region --- PROFILER ---
+
+void Profiler::setEnabled(bool value)
+{
+	// El primer frame empieza al activarlo, no en el ultimo endFrame con el perfilador activo
+	if (value && !isEnabled())
+		frameStart = now();
+	enabled.store(value, std::memory_order_relaxed);
+}
+
+Profiler::threadRing_t* Profiler::threadRing()
+{
+	if (!localRing) {
+		threadRing_t* ring = new threadRing_t();
+		std::lock_guard<std::mutex> lock(ringsMutex);
+		ring->tid = (int)rings.size() + 1; // 0 es la GPU
+		ring->name = "hilo " + std::to_string(ring->tid);
+		rings.push_back(ring);
+		localRing = ring;
+	}
+	return localRing;
+}
+
+void Profiler::record(const char* name, int64_t start, int64_t end)
+{
+	// Solo este hilo escribe en su anillo; written se publica despues de la zona
+	threadRing_t* ring = threadRing();
+	uint64_t written = ring->written.load(std::memory_order_relaxed);
+	ring->zones[written & (RING_SIZE - 1)] = { name, start, end };
+	ring->written.store(written + 1, std::memory_order_release);
+}
+
+void Profiler::setThreadName(const string& name)
+{
+	threadRing_t* ring = threadRing();
+	std::lock_guard<std::mutex> lock(ringsMutex);
+	ring->name = name;
+}
+
+uint64_t Profiler::zonesRecorded()
+{
+	std::lock_guard<std::mutex> lock(ringsMutex);
+	uint64_t total = 0;
+	for (threadRing_t* ring : rings)
+		total += ring->written.load(std::memory_order_acquire);
+	return total;
+}
+
+int Profiler::beginGpu(const char* name)
+{
+	// GL_TIME_ELAPSED no admite dos consultas abiertas a la vez; existe desde GL 3.3
+	if (gpuOpen || !GLAD_GL_VERSION_3_3)
+		return -1;
+	if (!queriesCreated) {
+		glGenQueries(GPU_FRAMES_IN_FLIGHT * GPU_QUERIES_PER_FRAME, &queries[0][0]);
+		queriesCreated = true;
+	}
+
+	int i = queriesUsed[gpuSlot];
+	if (i >= GPU_QUERIES_PER_FRAME)
+		return -1;
+	queriesUsed[gpuSlot]++;
+	queryNames[gpuSlot][i] = name;
+	queryStarts[gpuSlot][i] = now();
+	glBeginQuery(GL_TIME_ELAPSED, queries[gpuSlot][i]);
+	gpuOpen = true;
+	return i;
+}
+
+void Profiler::endGpu()
+{
+	glEndQuery(GL_TIME_ELAPSED);
+	gpuOpen = false;
+}
+
+void Profiler::collectGpu(int slot)
+{
+	for (int i = 0; i < queriesUsed[slot]; i++) {
+		// Varios frames despues casi siempre esta lista; si no, se pierde antes que esperar a la GPU
+		GLuint available = 0;
+		glGetQueryObjectuiv(queries[slot][i], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available) continue;
+
+		GLuint64 ns = 0;
+		glGetQueryObjectui64v(queries[slot][i], GL_QUERY_RESULT, &ns);
+		zone_t zone = { queryNames[slot][i], queryStarts[slot][i], queryStarts[slot][i] + (int64_t)ns };
+		if (gpuZones.size() >= RING_SIZE)
+			gpuZones.erase(gpuZones.begin(), gpuZones.begin() + RING_SIZE / 2);
+		gpuZones.push_back(zone);
+
+		zoneStats_t& s = windowGpu[zone.name];
+		s.ms += ns / 1e6;
+		s.calls++;
+	}
+	queriesUsed[slot] = 0;
+}
+
+void Profiler::endFrame()
+{
+	if (!isEnabled())
+		return;
+	int64_t end = now();
+
+	// Las consultas del frame mas antiguo en vuelo se leen y su hueco pasa al frame siguiente
+	gpuSlot = (gpuSlot + 1) % GPU_FRAMES_IN_FLIGHT;
+	collectGpu(gpuSlot);
+
+	// Zonas de CPU terminadas en este frame. Cada anillo esta ordenado por fin de zona, asi que
+	// se recorre hacia atras hasta la primera que termino antes del frame
+	{
+		std::lock_guard<std::mutex> lock(ringsMutex);
+		for (threadRing_t* ring : rings) {
+			uint64_t written = ring->written.load(std::memory_order_acquire);
+			uint64_t oldest = written > RING_SIZE / 2 ? written - RING_SIZE / 2 : 0;
+			for (uint64_t i = written; i > oldest; i--) {
+				const zone_t& zone = ring->zones[(i - 1) & (RING_SIZE - 1)];
+				if (zone.end <= frameStart) break;
+				if (zone.end > end) continue; // Del frame siguiente
+
+				zoneStats_t& s = windowCpu[zone.name];
+				s.ms += (zone.end - zone.start) / 1e6;
+				s.calls++;
+			}
+		}
+	}
+
+	frameRecord_t frame = { end, (end - frameStart) / 1e6, {} };
+	for (int c = 0; c < COUNTER_COUNT; c++) {
+		frame.counters[c] = counters[c].exchange(0, std::memory_order_relaxed);
+		windowCounters[c] += (double)frame.counters[c];
+	}
+	if (history.size() < HISTORY_SIZE)
+		history.push_back(frame);
+	else
+		history[framesRecorded % HISTORY_SIZE] = frame;
+	framesRecorded++;
+
+	windowMs += frame.ms;
+	windowFrames++;
+	frameStart = end;
+
+	if (statsInterval > 0 && windowFrames >= statsInterval)
+		printStats();
+}
+
+const char* Profiler::counterName(profileCounter_e counter)
+{
+	static const char* names[COUNTER_COUNT] = { "draw calls", "program switches", "uniform uploads", "triangles", "collision nodes" };
+	return names[counter];
+}
+
+void Profiler::printStats()
+{
+	if (windowFrames == 0) return;
+
+	// Medias por frame de la ventana
+	auto average = [](map<string, zoneStats_t>& window, map<string, zoneStats_t>& last, int frames) {
+		last.clear();
+		for (auto& [name, s] : window)
+			last[name] = { s.ms / frames, s.calls / frames };
+		window.clear();
+	};
+	average(windowCpu, lastCpu, windowFrames);
+	average(windowGpu, lastGpu, windowFrames);
+	for (int c = 0; c < COUNTER_COUNT; c++) {
+		lastCounters[c] = windowCounters[c] / windowFrames;
+		windowCounters[c] = 0;
+	}
+	lastFrameMs = windowMs / windowFrames;
+
+	if (statsInterval > 0) {
+		cout << "--- Perfil: " << windowFrames << " frames, " << std::fixed << std::setprecision(3) << lastFrameMs << " ms/frame ---" << endl;
+		cout << std::left << std::setw(28) << "zona" << std::setw(12) << "ms/frame" << "veces/frame" << endl;
+		for (auto& [name, s] : lastCpu)
+			cout << "  " << std::setw(26) << name << std::setw(12) << s.ms << std::setprecision(1) << s.calls << std::setprecision(3) << endl;
+		for (auto& [name, s] : lastGpu)
+			cout << "  " << std::setw(26) << ("GPU " + name) << std::setw(12) << s.ms << std::setprecision(1) << s.calls << std::setprecision(3) << endl;
+		cout << std::setprecision(1);
+		for (int c = 0; c < COUNTER_COUNT; c++)
+			cout << "  " << std::setw(26) << counterName((profileCounter_e)c) << lastCounters[c] << endl;
+		cout << std::defaultfloat << std::right;
+	}
+
+	windowFrames = 0;
+	windowMs = 0;
+}
+
+bool Profiler::writeTrace(const string& fileName)
+{
+	ofstream f(fileName);
+	if (!f.is_open()) {
+		cout << "ERROR: " << __FILE__ << ":" << __LINE__ << " (" << __func__ << ") No se pudo crear " << fileName << endl;
+		return false;
+	}
+
+	// Tiempos en microsegundos (los de las trazas de Chrome)
+	bool first = true;
+	auto event = [&]() -> ofstream& {
+		f << (first ? "    " : ",\n    ");
+		first = false;
+		return f;
+	};
+	auto writeZone = [&](const zone_t& z, int tid, const char* category) {
+		event() << "{ \"name\": \"" << z.name << "\", \"cat\": \"" << category << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << tid
+			<< ", \"ts\": " << z.start / 1e3 << ", \"dur\": " << (z.end - z.start) / 1e3 << " }";
+	};
+
+	f << std::fixed << std::setprecision(3);
+	f << "{\n  \"displayTimeUnit\": \"ms\",\n  \"traceEvents\": [\n";
+	event() << "{ \"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"args\": { \"name\": \"ProgGrafica_2024\" } }";
+
+	// Las pasadas de GPU van en el instante de CPU en que se enviaron, con la duracion medida en GPU
+	event() << "{ \"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 0, \"args\": { \"name\": \"GPU\" } }";
+	for (const zone_t& z : gpuZones)
+		writeZone(z, 0, "gpu");
+
+	{
+		std::lock_guard<std::mutex> lock(ringsMutex);
+		for (threadRing_t* ring : rings) {
+			event() << "{ \"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << ring->tid
+				<< ", \"args\": { \"name\": \"" << ring->name << "\" } }";
+			uint64_t written = ring->written.load(std::memory_order_acquire);
+			for (uint64_t i = written > RING_SIZE ? written - RING_SIZE : 0; i < written; i++)
+				writeZone(ring->zones[i & (RING_SIZE - 1)], ring->tid, "cpu");
+		}
+	}
+
+	// Contadores y duracion de cada frame, del mas antiguo al mas reciente
+	size_t count = history.size();
+	for (size_t n = 0; n < count; n++) {
+		const frameRecord_t& frame = history[(framesRecorded - count + n) % HISTORY_SIZE];
+		event() << "{ \"name\": \"frame ms\", \"ph\": \"C\", \"pid\": 1, \"ts\": " << frame.end / 1e3
+			<< ", \"args\": { \"value\": " << frame.ms << " } }";
+		for (int c = 0; c < COUNTER_COUNT; c++) {
+			event() << "{ \"name\": \"" << counterName((profileCounter_e)c) << "\", \"ph\": \"C\", \"pid\": 1, \"ts\": " << frame.end / 1e3
+				<< ", \"args\": { \"value\": " << frame.counters[c] << " } }";
+		}
+	}
+
+	f << "\n  ]\n}\n";
+	cout << "Traza del perfilador guardada en " << fileName << endl;
+	return true;
+}
+
+void Profiler::deinit()
+{
+	if (queriesCreated) {
+		glDeleteQueries(GPU_FRAMES_IN_FLIGHT * GPU_QUERIES_PER_FRAME, &queries[0][0]);
+		queriesCreated = false;
+	}
+	for (int slot = 0; slot < GPU_FRAMES_IN_FLIGHT; slot++)
+		queriesUsed[slot] = 0;
+	gpuOpen = false;
+}
+
+#pragma endregion
@@ -1,16 +1,20 @@
 #include "libprgr/Program.h"
+#include "libprgr/Profiler.h"
+#include <filesystem>
+#include <cstdint>
 
 Program::Program() 
 {
+	generation = ++generations;
 	idProgram = glCreateProgram();
 	if (idProgram == -1) {
 		cout << "ERROR: " << __FILE__ << ":" << __LINE__ << " (" << __func__ << ") Error al crear el programa" << endl;
 	}
 }
 
-void Program::addShader(string fileName) 
+void Program::addShader(string fileName, const vector<string>& defines) 
 {
-	Shader* shader = new Shader(fileName);
+	Shader* shader = new Shader(fileName, defines);
 	glAttachShader(idProgram, shader->shaderId);
 	shaderList.push_back(shader);
 	shader->clean();
@@ -81,6 +85,151 @@ GLint Program::getUniformMLocation() const
 
 
 
+// Cabecera de los ficheros de la cache de binarios
+typedef struct {
+	char magic[4];          // "PRGB"
+	uint32_t version;       // Version del formato del fichero
+	uint32_t binaryFormat;  // Formato devuelto por glGetProgramBinary
+	uint32_t length;        // Bytes de binario que siguen a la cabecera
+} binaryHeader_t;
+
+static const uint32_t BINARY_CACHE_VERSION = 1;
+
+// FNV-1a de 64 bits
+static uint64_t fnv1a(const void* data, size_t size, uint64_t hash = 14695981039346656037ull)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	for (size_t i = 0; i < size; i++) {
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+string Program::binaryCacheKey(const vector<Shader*>& shaders)
+{
+	uint64_t hash = fnv1a(&BINARY_CACHE_VERSION, sizeof(BINARY_CACHE_VERSION));
+
+	// Un binario solo vale para el mismo driver: entra en la clave
+	const GLenum driverStrings[] = { GL_VENDOR, GL_RENDERER, GL_VERSION, GL_SHADING_LANGUAGE_VERSION };
+	for (GLenum name : driverStrings) {
+		const char* str = (const char*)glGetString(name);
+		if (str) hash = fnv1a(str, strlen(str) + 1, hash);
+	}
+
+	// Las fuentes ya llevan los defines insertados
+	for (Shader* shader : shaders) {
+		hash = fnv1a(&shader->shaderType, sizeof(shader->shaderType), hash);
+		hash = fnv1a(shader->source.data(), shader->source.size() + 1, hash);
+	}
+
+	char hex[17];
+	snprintf(hex, sizeof(hex), "%016llx", (unsigned long long)hash);
+	return hex;
+}
+
+bool Program::isLinked() const
+{
+	GLint linked = GL_FALSE;
+	glGetProgramiv(idProgram, GL_LINK_STATUS, &linked);
+	return linked == GL_TRUE;
+}
+
+bool Program::loadBinary(const string& fileName)
+{
+	ifstream f(fileName, ios::binary);
+	if (!f.is_open()) return false;
+
+	binaryHeader_t header;
+	if (!f.read((char*)&header, sizeof(header)) || memcmp(header.magic, "PRGB", 4) != 0 || header.version != BINARY_CACHE_VERSION)
+		return false;
+
+	// La longitud viene del archivo: si esta corrupto o truncado no se reserva mas de lo que queda
+	std::streampos start = f.tellg();
+	f.seekg(0, ios::end);
+	std::streamoff remaining = f.tellg() - start;
+	f.seekg(start);
+	if (header.length == 0 || (std::streamoff)header.length > remaining)
+		return false;
+
+	vector<char> binary(header.length);
+	if (!f.read(binary.data(), header.length))
+		return false;
+
+	// El driver puede rechazarlo aunque la clave coincida (p.ej. tras actualizarse): no es un error
+	glProgramBinary(idProgram, header.binaryFormat, binary.data(), header.length);
+	return isLinked();
+}
+
+bool Program::saveBinary(const string& fileName) const
+{
+	GLint length = 0;
+	glGetProgramiv(idProgram, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0) return false;
+
+	vector<char> binary(length);
+	GLenum format = 0;
+	glGetProgramBinary(idProgram, length, &length, &format, binary.data());
+
+	std::error_code ec;
+	std::filesystem::create_directories(std::filesystem::path(fileName).parent_path(), ec);
+
+	ofstream f(fileName, ios::binary);
+	if (!f.is_open()) {
+		cout << "ERROR: " << __FILE__ << ":" << __LINE__ << " (" << __func__ << ") No se pudo crear " << fileName << endl;
+		return false;
+	}
+
+	binaryHeader_t header = { { 'P', 'R', 'G', 'B' }, BINARY_CACHE_VERSION, format, (uint32_t)length };
+	f.write((const char*)&header, sizeof(header));
+	f.write(binary.data(), length);
+	return true;
+}
+
+bool Program::build(const vector<string>& shaderFiles, const vector<string>& defines, const string& cacheDir)
+{
+	// Fuentes con los defines insertados, todavia sin compilar
+	vector<Shader*> shaders;
+	for (const string& file : shaderFiles)
+		shaders.push_back(new Shader(file, defines, false));
+
+	GLint numFormats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+
+	string binaryFile;
+	if (!cacheDir.empty() && numFormats > 0) {
+		binaryFile = cacheDir + "/" + binaryCacheKey(shaders) + ".bin";
+		if (loadBinary(binaryFile)) {
+			for (Shader* shader : shaders) delete shader;
+			readVarList();
+			return true;
+		}
+	}
+
+	// Se lanzan todas las compilaciones y el enlazado antes de consultar ningun estado:
+	// con KHR_parallel_shader_compile el driver compila los shaders en paralelo
+	for (Shader* shader : shaders) {
+		shader->compileShader();
+		glAttachShader(idProgram, shader->shaderId);
+	}
+	if (!binaryFile.empty())
+		glProgramParameteri(idProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
+	linkProgram();
+	if (!isLinked()) {
+		for (Shader* shader : shaders) shader->checkErrors();
+	}
+
+	for (Shader* shader : shaders) {
+		shaderList.push_back(shader);
+		shader->clean();
+	}
+
+	if (!binaryFile.empty() && isLinked())
+		saveBinary(binaryFile);
+	return false;
+}
+
 void Program::linkProgram() 
 {
 	glLinkProgram(idProgram);
@@ -106,7 +255,9 @@ void Program::clean() {
 	for (auto shader : shaderList) {
 		glDetachShader(idProgram, shader->shaderId);
 		shader->clean();
+		delete shader;
 	}
+	shaderList.clear();
 	glDeleteProgram(idProgram);
 }
 
@@ -124,6 +275,8 @@ void Program::readVarList()
 		varList[std::string(varName)] = glGetAttribLocation(this->idProgram, varName);
 
 	}
+	uniformList.clear();
+	uniformHandles.clear();
 	glGetProgramiv(this->idProgram, GL_ACTIVE_UNIFORMS, &numUniforms);
 	for (int i = 0; i < numUniforms; i++)
 	{
@@ -138,11 +291,88 @@ void Program::readVarList()
 			{
 				std::string arrNameIdx = arrName + "[" + std::to_string(i) + "]";
 				varList[arrNameIdx] = glGetUniformLocation(idProgram, arrNameIdx.c_str());
+				addUniform(arrNameIdx, type);
 			}
 		}
 		else
+		{
 			varList[varName] = glGetUniformLocation(idProgram, varName.c_str());
+			addUniform(varName, type);
+		}
+	}
+}
+
+void Program::addUniform(const string& nombre, GLenum type)
+{
+	uniform_t u;
+	u.name = nombre;
+	u.location = glGetUniformLocation(idProgram, nombre.c_str());
+	u.glType = type;
+
+	// Los miembros de bloques uniform no tienen localizacion: se escriben en su UBO
+	if (u.location < 0) return;
+
+	memset(u.shadow, 0, sizeof(u.shadow));
+	u.uploaded = false;
+
+	uniformHandles[nombre] = (int)uniformList.size();
+	uniformList.push_back(u);
+}
+
+int Program::getUniformHandle(const string& nombre) const
+{
+	auto it = uniformHandles.find(nombre);
+	return (it != uniformHandles.end()) ? it->second : -1;
+}
+
+bool Program::updateShadow(int handle, const void* dato, size_t bytes)
+{
+	uniform_t& u = uniformList[handle];
+	if (u.uploaded && memcmp(u.shadow, dato, bytes) == 0) {
+		uniformSkips++;
+		return false;
 	}
+	memcpy(u.shadow, dato, bytes);
+	u.uploaded = true;
+	uniformUploads++;
+	return true;
+}
+
+bool Program::bindUniformBlock(const string& blockName, unsigned int bindingPoint)
+{
+	GLuint index = glGetUniformBlockIndex(idProgram, blockName.c_str());
+	if (index == GL_INVALID_INDEX) return false;
+
+	glUniformBlockBinding(idProgram, index, bindingPoint);
+	return true;
+}
+
+void Program::setUniform(int handle, int value)
+{
+	if (handle < 0 || !updateShadow(handle, &value, sizeof(value))) return;
+	glUniform1i(uniformList[handle].location, value);
+	PROFILE_COUNT(COUNTER_UNIFORM_UPLOADS, 1);
+}
+
+void Program::setUniform(int handle, float value)
+{
+	if (handle < 0 || !updateShadow(handle, &value, sizeof(value))) return;
+	glUniform1f(uniformList[handle].location, value);
+	PROFILE_COUNT(COUNTER_UNIFORM_UPLOADS, 1);
+}
+
+void Program::setUniform(int handle, const vector4f& value)
+{
+	if (handle < 0 || !updateShadow(handle, value.data, sizeof(value.data))) return;
+	glUniform4fv(uniformList[handle].location, 1, value.data);
+	PROFILE_COUNT(COUNTER_UNIFORM_UPLOADS, 1);
+}
+
+void Program::setUniform(int handle, const matrix4x4f& value)
+{
+	if (handle < 0 || !updateShadow(handle, value.mat1, sizeof(value.mat1))) return;
+	glUniformMatrix4fv(uniformList[handle].location, 1, GL_TRUE, value.mat1);
+	PROFILE_COUNT(COUNTER_UNIFORM_UPLOADS, 1);
 }
 
 void Program::use() 
@@ -150,8 +380,10 @@ void Program::use()
 	glUseProgram(idProgram);
 }
 
-void Program::setUniformData(dataType_e tipo, void* dato, string nombre) {
-	if (varList.find(nombre) == varList.end())
+void Program::setUniformData(dataType_e tipo, void* dato, const string& nombre) {
+	// Una sola busqueda por nombre; el resto pasa por los setters con handle (y su copia)
+	int handle = getUniformHandle(nombre);
+	if (handle < 0)
 	{
 		cout << "ERROR: Variable no encontrada " << __FILE__ << ":" << __LINE__ << " (" << __func__ << ") " << nombre << "\n";
 
@@ -162,20 +394,19 @@ void Program::setUniformData(dataType_e tipo, void* dato, string nombre) {
 		{
 		case matrix4:
 		{
-			glUniformMatrix4fv(varList[nombre], 1, GL_TRUE, (float*)dato);
+			setUniform(handle, *(matrix4x4f*)dato);
 		} break;
 		case integer:
 		{
-			glUniform1i(varList[nombre], ((int*)dato)[0]);
+			setUniform(handle, ((int*)dato)[0]);
 		} break;
 		case floatpoint:
 		{
-			glUniform1f(varList[nombre], ((float*)dato)[0]);
+			setUniform(handle, ((float*)dato)[0]);
 		} break;
 		case vector4:
 		{
-			//glUniform4f(varList[nombre], ((float*)dato)[0], ((float*)dato)[1], ((float*)dato)[2], ((float*)dato)[3]); VALIDA TAMBIEN
-			glUniform4fv(varList[nombre], 1, (float*)dato);
+			setUniform(handle, *(vector4f*)dato);
 		} break;
 
 		default:
@@ -186,23 +417,33 @@ void Program::setUniformData(dataType_e tipo, void* dato, string nombre) {
 	}
 }
 
-void Program::setAttributeData(string nombre, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const GLvoid* pointer) {
-	if (varList.find(nombre) == varList.end())
+int Program::getAttributeLocation(const string& nombre) const
+{
+	auto it = varList.find(nombre);
+	return (it != varList.end()) ? (int)it->second : -1;
+}
+
+void Program::setAttributeData(const string& nombre, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const GLvoid* pointer, GLuint divisor) {
+	int location = getAttributeLocation(nombre);
+	if (location < 0)
 	{
 		cout << "ERROR: Variable no encontrada " << __FILE__ << ":" << __LINE__ << " (" << __func__ << ") " << nombre << "\n";
+		return;
 	}
-	else
-	{
-		unsigned int index = varList[nombre];
-		glEnableVertexAttribArray(index);
-		glVertexAttribPointer(index, size, type, normalized, stride, pointer);
-	}
+	setAttributeData(location, size, type, normalized, stride, pointer, divisor);
+}
+
+void Program::setAttributeData(int location, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const GLvoid* pointer, GLuint divisor) {
+	if (location < 0) return;
+	glEnableVertexAttribArray(location);
+	glVertexAttribPointer(location, size, type, normalized, stride, pointer);
+	glVertexAttribDivisor(location, divisor); // 0: por vertice, 1: por instancia
 }
 
 void Program::setLightUniform(const Light& light, int index) { // funcion para establecer los datos de la luz en el shader
 	string base = "uLights[" + std::to_string(index) + "]"; // base de la variable, ejemplo: uLights[0]
 	glUniform1i(varList[base + ".type"], light.type); // tipo de luz
-	glUniform4fv(varList[base + ".position"], 1, (light.position.data)); // posicion de la luz
+	glUniform4fv(varList[base + ".position"], 1, (light.worldPosition.data)); // posicion de la luz (en mundo)
 	glUniform4fv(varList[base + ".color"], 1, (light.color.data)); // color de la luz
 	glUniform1f(varList[base + ".intensity"], light.i); // intensidad de la luz
 	glUniform4fv(varList[base + ".direction"], 1, (light.direction.data));	// direccion de la luz
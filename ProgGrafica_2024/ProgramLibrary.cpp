@@ -0,0 +1,75 @@
+#include "libprgr/ProgramLibrary.h"
+#include "libprgr/HeadlessContext.h"
+#include <algorithm>
+
+string ProgramLibrary::makeKey(const vector<string>& shaderFiles, const vector<string>& defines)
+{
+	// El orden de ficheros y defines no cambia el programa resultante
+	vector<string> files = shaderFiles;
+	vector<string> defs = defines;
+	std::sort(files.begin(), files.end());
+	std::sort(defs.begin(), defs.end());
+
+	string key;
+	for (const string& f : files) key += f + "|";
+	key += "#";
+	for (const string& d : defs) key += d + "|";
+	return key;
+}
+
+// GL_KHR_parallel_shader_compile no esta en glad: la funcion se carga a mano
+typedef void (GLAD_API_PTR *PFNGLMAXSHADERCOMPILERTHREADSPROC)(GLuint count);
+
+bool ProgramLibrary::enableParallelCompile()
+{
+	// Sin ventana (EGL) GLFW no tiene contexto: la funcion se pide al cargador del contexto headless
+	GLADloadfunc load = HeadlessContext::active() ? HeadlessContext::loader() : glfwGetProcAddress;
+	PFNGLMAXSHADERCOMPILERTHREADSPROC maxThreads = nullptr;
+	if (HeadlessContext::hasExtension("GL_KHR_parallel_shader_compile"))
+		maxThreads = (PFNGLMAXSHADERCOMPILERTHREADSPROC)load("glMaxShaderCompilerThreadsKHR");
+	else if (HeadlessContext::hasExtension("GL_ARB_parallel_shader_compile"))
+		maxThreads = (PFNGLMAXSHADERCOMPILERTHREADSPROC)load("glMaxShaderCompilerThreadsARB");
+
+	if (!maxThreads) return false;
+
+	maxThreads(0xFFFFFFFFu); // Tantos hilos como decida el driver
+	return true;
+}
+
+Program* ProgramLibrary::acquire(const vector<string>& shaderFiles, const vector<string>& defines)
+{
+	if (!initialized) {
+		enableParallelCompile();
+		initialized = true;
+	}
+
+	string key = makeKey(shaderFiles, defines);
+
+	auto it = programs.find(key);
+	if (it != programs.end()) {
+		it->second->refCount++;
+		return it->second;
+	}
+
+	Program* program = new Program();
+	if (program->build(shaderFiles, defines, binaryCacheDir))
+		cachedPrograms++;
+	else
+		compiledPrograms++;
+
+	program->libraryKey = key;
+	program->refCount = 1;
+	programs[key] = program;
+	return program;
+}
+
+void ProgramLibrary::release(Program* program)
+{
+	if (!program || program->libraryKey.empty()) return;
+
+	if (--program->refCount > 0) return;
+
+	programs.erase(program->libraryKey);
+	program->clean();
+	delete program;
+}
@@ -1,4 +1,11 @@
 #include "libprgr/Render.h"
+#include "libprgr/ProgramLibrary.h"
+#include <cstring>
+#include <cfloat>
+#include <cassert>
+#include <algorithm>
+#include <thread>
+#include <chrono>
 
 void Render::initGL(int width, int height)
 {
@@ -19,41 +26,127 @@ void Render::initGL(int width, int height)
 	window = glfwCreateWindow(width, height, "Window", nullptr, nullptr); // Crear ventana con parametros de ancho y alto y nombre
 	glfwMakeContextCurrent(window); // Hacer que la ventana creada sea la ventana actual
 	gladLoadGL(glfwGetProcAddress); //usarla despus de haber iniciado GLFW
+	setSwapInterval(swapInterval);
 	EventManager::init(window); // Inicializar el EventManager con la ventana creada
 	glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED); // Hacer que las teclas se queden presionadas
-	glEnable(GL_DEPTH_TEST); // Habilitar el uso de profundidad
-	glDepthFunc(GL_LESS); // Habilitar el uso de profundidad
+	initGLState();
 }
 
-void Render::deinitGLFW()
+bool Render::initHeadless(int width, int height)
 {
-	glfwTerminate();
+	if (!HeadlessContext::create())
+		return false;
+	gladLoadGL(HeadlessContext::loader());
+	headless = true;
+
+	// Todo se dibuja en un FBO del tamano pedido; el contexto no tiene framebuffer propio que usar
+	offscreenWidth = width;
+	offscreenHeight = height;
+	glGenFramebuffers(1, &offscreenFBO);
+	glGenRenderbuffers(1, &offscreenColor);
+	glGenRenderbuffers(1, &offscreenDepth);
+	glBindRenderbuffer(GL_RENDERBUFFER, offscreenColor);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, offscreenDepth);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, offscreenFBO);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, offscreenColor);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, offscreenDepth);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		cout << "ERROR: " << __FILE__ << ":" << __LINE__ << " (" << __func__ << ") El FBO de " << width << "x" << height << " no esta completo" << endl;
+		return false;
+	}
+	glViewport(0, 0, width, height);
+
+	cout << "Sin ventana (" << HeadlessContext::description() << "): " << glGetString(GL_VERSION) << ", " << glGetString(GL_RENDERER) << endl;
+	initGLState();
+	updateFramebufferSize();
+	return true;
 }
 
-void Render::setUpObject(Object3D* obj)
+void Render::initGLState()
 {
-	bufferObject bo;
+	glEnable(GL_DEPTH_TEST); // Habilitar el uso de profundidad
+	glDepthFunc(GL_LESS); // Habilitar el uso de profundidad
 
-	// Generar un buffer de datos
-	glGenVertexArrays(1, &bo.idArray); // Generar un buffer de arrays y guardarlo en idArray
-	glGenBuffers(1, &bo.idVertexArray); // Generar un buffer de vertices y guardarlo en idVertexArray
-	glGenBuffers(1, &bo.idIndexArray); // Generar un buffer de indices y guardarlo en idIndexArray
+	uniformBuffer = new UniformBuffer(); // Necesita el contexto GL ya creado
+	Texture::queryGLSupport(); // Idem: formatos comprimidos y filtro anisotropico que admite la GPU
+	glGenBuffers(1, &instanceBuffer); // Se dimensiona en prepareFrame
+	glGenBuffers(1, &indirectBuffer); // Idem
 
-	// Por cada buffer
-	glBindVertexArray(bo.idArray); // Activar buffer de arrays con idArray 
+	// Luces puntuales y clusters: buffers que el shader lee como texturas (se rellenan en cada frame)
+	const unsigned int formats[3] = { GL_RGBA32F, GL_RG32UI, GL_R32UI };
+	unsigned int* buffers[3] = { &pointLightBuffer, &clusterTableBuffer, &clusterLightBuffer };
+	unsigned int* textures[3] = { &pointLightTexture, &clusterTableTexture, &clusterLightTexture };
+	for (int i = 0; i < 3; i++) {
+		glGenBuffers(1, buffers[i]);
+		glBindBuffer(GL_TEXTURE_BUFFER, *buffers[i]);
+		glBufferData(GL_TEXTURE_BUFFER, sizeof(pointLight_t), nullptr, GL_STREAM_DRAW);
+		glGenTextures(1, textures[i]);
+		glBindTexture(GL_TEXTURE_BUFFER, *textures[i]);
+		glTexBuffer(GL_TEXTURE_BUFFER, formats[i], *buffers[i]);
+	}
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
 
-	// Activar buffer
-	glBindBuffer(GL_ARRAY_BUFFER, bo.idVertexArray); // Activar buffer de vertices
+void Render::setSwapInterval(int interval)
+{
+	// La adaptativa (intervalo negativo: no espera si el frame llega tarde) es una extension
+	if (interval < 0 && !glfwExtensionSupported("WGL_EXT_swap_control_tear") && !glfwExtensionSupported("GLX_EXT_swap_control_tear"))
+		interval = 1;
+	swapInterval = interval;
+	if (window)
+		glfwSwapInterval(interval);
+}
 
-	// Subir por cada buffer sus datos
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertex_t) * obj->vertexList.size(), obj->vertexList.data(), GL_STATIC_DRAW);
+void Render::deinitGLFW()
+{
+	// Lo que quede a medio cargar se descarta mientras el contexto existe
+	assetLoader.cancel();
+	Profiler::deinit();
+	delete uniformBuffer;
+	uniformBuffer = nullptr;
+	ProgramLibrary::release(depthProgram);
+	depthProgram = nullptr;
+	glDeleteBuffers(1, &instanceBuffer);
+	instanceBuffer = 0;
+	instanceCapacity = 0;
+	glDeleteBuffers(1, &indirectBuffer);
+	indirectBuffer = 0;
+	indirectCapacity = 0;
+	for (unsigned int* texture : { &pointLightTexture, &clusterTableTexture, &clusterLightTexture }) {
+		glDeleteTextures(1, texture);
+		*texture = 0;
+	}
+	for (unsigned int* buffer : { &pointLightBuffer, &clusterTableBuffer, &clusterLightBuffer }) {
+		glDeleteBuffers(1, buffer);
+		*buffer = 0;
+	}
+
+	// Arenas y arrays son estaticos y sobreviven a las mallas y texturas que los usaban
+	GeometryArena::clear();
+	TextureArray::clear();
 
-	// Activar buffer
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, bo.idIndexArray);
+	if (headless) {
+		glDeleteFramebuffers(1, &offscreenFBO);
+		glDeleteRenderbuffers(1, &offscreenColor);
+		glDeleteRenderbuffers(1, &offscreenDepth);
+		offscreenFBO = offscreenColor = offscreenDepth = 0;
+		HeadlessContext::destroy();
+		headless = false;
+		return;
+	}
+	glfwTerminate();
+}
 
-	// Subir por cada buffer sus datos
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * obj->idList.size(), obj->idList.data(), GL_STATIC_DRAW);
-	bufferList[obj->id] = bo;
+void Render::setUpObject(Object3D* obj)
+{
+	// Los buffers son de la malla: los objetos que la comparten no suben nada
+	if (obj->mesh)
+		obj->mesh->upload();
 }
 
 void Render::putObject(Object3D* obj) {
@@ -61,11 +154,64 @@ void Render::putObject(Object3D* obj) {
 }
 
 void Render::putObject(int ID, Object3D* obj) {
+	setUpObject(obj);
+	insertObject(ID, obj);
+}
+
+void Render::insertObject(int ID, Object3D* obj) {
 	if (objectList.find(ID) != objectList.end()) {
 		removeObject(objectList[ID]);
 	}
 	objectList[ID] = obj;
-	setUpObject(obj);
+	drawListDirty = true;
+
+	// Cada objeto dibujado tiene un nodo en la jerarquia (raiz hasta que se engancha a otro)
+	if (!sceneGraph.isValid(obj->sceneNode)) {
+		obj->sceneNode = sceneGraph.createNode();
+		bindNode(obj->sceneNode, obj, nullptr);
+	}
+	sceneGraph.setLocalMatrix(obj->sceneNode, obj->localMatrix);
+}
+
+void Render::loadObject(Object3D* obj, const string& file)
+{
+	assetLoader.load(obj, file);
+}
+
+void Render::finishLoading()
+{
+	vector<Object3D*> ready = assetLoader.finish();
+	{
+		std::lock_guard<std::mutex> lock(loadedMutex);
+		loadedObjects.insert(loadedObjects.end(), ready.begin(), ready.end());
+	}
+	addLoadedObjects();
+}
+
+void Render::streamAssets()
+{
+	if (assetLoader.pending() == 0) return;
+
+	vector<Object3D*> ready = assetLoader.update(assetBudgetMs);
+	if (ready.empty()) return;
+	std::lock_guard<std::mutex> lock(loadedMutex);
+	loadedObjects.insert(loadedObjects.end(), ready.begin(), ready.end());
+}
+
+void Render::addLoadedObjects()
+{
+	vector<Object3D*> ready;
+	{
+		std::lock_guard<std::mutex> lock(loadedMutex);
+		ready.swap(loadedObjects);
+	}
+
+	// La malla ya la subio el hilo GL (streamAssets): sin setUpObject, que haria llamadas GL desde este hilo
+	for (Object3D* obj : ready) {
+		assert(!obj->mesh || obj->mesh->uploaded);
+		obj->updateModelMatrix();
+		insertObject(obj->id, obj);
+	}
 }
 
 Object3D* Render::getObject(int ID) {
@@ -74,147 +220,1028 @@ Object3D* Render::getObject(int ID) {
 }
 
 
-void Render::drawGl(Object3D* obj)
+bool Render::useMultiDraw() const
+{
+	return multiDrawIndirect && GLAD_GL_VERSION_4_3;
+}
+
+void Render::bindLightBuffers()
+{
+	glActiveTexture(GL_TEXTURE0 + TEXTURE_UNIT_POINT_LIGHTS);
+	glBindTexture(GL_TEXTURE_BUFFER, pointLightTexture);
+	glActiveTexture(GL_TEXTURE0 + TEXTURE_UNIT_CLUSTER_TABLE);
+	glBindTexture(GL_TEXTURE_BUFFER, clusterTableTexture);
+	glActiveTexture(GL_TEXTURE0 + TEXTURE_UNIT_CLUSTER_LIGHTS);
+	glBindTexture(GL_TEXTURE_BUFFER, clusterLightTexture);
+	glActiveTexture(GL_TEXTURE0);
+}
+
+void Render::drawBatches()
+{
+	PROFILE_SCOPE("drawBatches");
+	PROFILE_GPU_SCOPE("draw");
+	bindLightBuffers(); // Lo mismo para todos los lotes
+	currentTexture = nullptr; // Las subidas entre frames enlazan otras texturas en la unidad 0
+
+	// Con prepass los opacos ya tienen su profundidad: pasan los fragmentos que la igualan y no se
+	// vuelve a escribir. Los de alpha test (despues de todos los opacos) la escriben como siempre.
+	if (depthPrepass) {
+		drawDepthPrepass();
+		glDepthFunc(GL_LEQUAL);
+		glDepthMask(GL_FALSE);
+	}
+	for (const drawGroup_t& group : drawGroups) {
+		if (depthPrepass && batches[group.firstBatch].alphaTested)
+			glDepthMask(GL_TRUE);
+		drawGroup(group);
+	}
+	if (depthPrepass) {
+		glDepthFunc(GL_LESS);
+		glDepthMask(GL_TRUE);
+	}
+}
+
+void Render::drawDepthPrepass()
+{
+	PROFILE_SCOPE("depthPrepass");
+	if (!depthProgram)
+		depthProgram = ProgramLibrary::acquire({ "data/depth.frag", "data/shader.vert" }, {});
+
+	glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+	for (const drawGroup_t& group : drawGroups) {
+		if (batches[group.firstBatch].alphaTested) break; // Los opacos van todos delante
+		drawGroup(group, depthProgram);
+	}
+	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+}
+
+void Render::drawGroup(const drawGroup_t& group, Program* depthOnly)
+{
+	if (!useMultiDraw()) {
+		for (unsigned int b = group.firstBatch; b < group.firstBatch + group.batchCount; b++)
+			drawBatch(batches[b], depthOnly);
+		return;
+	}
+
+	// Programa, material y textura son los del primer lote: iguales en todo el grupo
+	drawBatch_t first = batches[group.firstBatch];
+	if (depthOnly)
+		first.program = depthOnly;
+	setupProgram(first);
+	if (!depthOnly)
+		setupMaterial(first);
+
+	// Atributos desde la instancia 0: cada comando se desplaza con su baseInstance
+	setupVertexAttributes(first, 0, depthOnly != nullptr);
+
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+	glMultiDrawElementsIndirect(GL_TRIANGLES, first.mesh->arena->indexType,
+		(void*)(group.firstBatch * sizeof(drawIndirectCommand_t)), (GLsizei)group.batchCount, 0);
+	drawCalls++;
+	PROFILE_COUNT(COUNTER_DRAW_CALLS, 1);
+	PROFILE_COUNT(COUNTER_TRIANGLES, groupTriangles(group));
+}
+
+uint64_t Render::groupTriangles(const drawGroup_t& group) const
 {
-	if (!obj || !obj->program) return;
+	uint64_t triangles = 0;
+	for (unsigned int b = group.firstBatch; b < group.firstBatch + group.batchCount; b++)
+		triangles += (uint64_t)drawCommands[b].count / 3 * drawCommands[b].instanceCount;
+	return triangles;
+}
 
-	// Configuracin bsica del programa y matrices
-	setupProgramAndMatrices(obj);
+void Render::drawBatch(const drawBatch_t& batch, Program* depthOnly)
+{
+	if (depthOnly) {
+		drawBatch_t depth = batch;
+		depth.program = depthOnly;
+		setupProgram(depth);
+		setupVertexAttributes(depth, depth.firstInstance, true);
+		renderBatch(depth);
+		return;
+	}
 
-	// Configuracin de luces
-	setupLights(obj->program);
+	// Configuracin bsica del programa
+	setupProgram(batch);
 
 	// Configuracin de materiales y texturas
-	setupMaterial(obj);
+	setupMaterial(batch);
 
-	// Configuracin de atributos de vrtices usando setAttributeData
-	setupVertexAttributes(obj);
+	// Atributos de la malla y de las instancias del lote
+	setupVertexAttributes(batch, batch.firstInstance);
 
-	// Dibujado del objeto
-	renderObject(obj);
+	// Todas las instancias del lote en una llamada
+	renderBatch(batch);
 }
 
-void Render::setupProgramAndMatrices(Object3D* obj)
+void Render::setupProgram(const drawBatch_t& batch)
 {
 	// Preparamos el programa y lo usamos
-	Program* prg = obj->program;
-	prg->use();
+	Program* prg = batch.program;
+	if (prg != currentProgram) {
+		prg->use();
+		currentProgram = prg;
+		programSwitches++;
+		PROFILE_COUNT(COUNTER_PROGRAM_SWITCHES, 1);
+	}
+	getUniforms(prg); // Enlaza los bloques la primera vez que se usa el programa
+}
+
+// Planos del frustum a partir de la matriz vista-proyeccion (metodo de Gribb-Hartmann).
+// Un punto p esta dentro del plano si -w <= x,y,z <= w en clip, es decir fila3 +- filaN.
+static void extractFrustumPlanes(const matrix4x4f& m, vector4f planes[6])
+{
+	// Componente a componente: los operadores de vector4f fijan w = 1
+	for (int i = 0; i < 3; i++) {
+		for (int c = 0; c < 4; c++) {
+			planes[i * 2].data[c] = m.mat2D[3][c] + m.mat2D[i][c];
+			planes[i * 2 + 1].data[c] = m.mat2D[3][c] - m.mat2D[i][c];
+		}
+	}
 
-	// Matriz de modelo
-	matrix4x4f M = obj->modelMatrix;
-	prg->setUniformData(Program::matrix4, M.mat1, "uModel");
+	// Normalizados para que la distancia con signo sea la distancia real
+	for (int i = 0; i < 6; i++) {
+		float len = sqrtf(planes[i].x * planes[i].x + planes[i].y * planes[i].y + planes[i].z * planes[i].z);
+		if (len > 0.0f) {
+			planes[i].x /= len;
+			planes[i].y /= len;
+			planes[i].z /= len;
+			planes[i].w /= len;
+		}
+	}
+}
 
-	// Matrices de vista y proyeccin si hay cmara
+void Render::updateView()
+{
 	if (camera) {
-		prg->setUniformData(Program::matrix4, camera->computeViewMatrix().mat1, "uView");
-		prg->setUniformData(Program::matrix4, camera->computeProjectionMatrix().mat1, "uProjection");
+		view.view = camera->computeViewMatrix();
+		view.projection = camera->computeProjectionMatrix();
+		view.position = { camera->position.x, camera->position.y, camera->position.z, 1 };
+		view.zNear = camera->zNear;
+		view.zFar = camera->zFar;
+	}
+	else {
+		view.view = make_identity();
+		view.projection = make_identity();
+		view.position = { 0, 0, 0, 1 };
+		view.zNear = 0.1f;
+		view.zFar = 100.0f;
+	}
+	view.viewProjection = view.projection * view.view;
+	extractFrustumPlanes(view.viewProjection, view.frustumPlanes);
 
-		// Posicin de la cmara
-		vector4f camPos = { camera->position.x, camera->position.y, camera->position.z, 1 };
-		prg->setUniformData(Program::vector4, &camPos, "uViewPos");
+	// El tamano del framebuffer lo lee el hilo principal (GLFW no permite hacerlo desde otro)
+	int height = framebufferHeight.load(std::memory_order_relaxed);
+	view.pixelScale = fabsf(view.projection.mat2D[1][1]) * height * 0.5f;
+}
+
+// Distancia desde la camara, a lo largo de su eje, al origen del objeto (la z en vista con el signo cambiado)
+static inline float viewDepth(const matrix4x4f& view, const matrix4x4f& model)
+{
+	const vector4f& r = view.rows[2];
+	return -(r.x * model.rows[0].w + r.y * model.rows[1].w + r.z * model.rows[2].w + r.w);
+}
+
+// Lo que hay que enlazar para dibujar con una textura: ella misma o el TextureArray en el que esta
+static inline const void* textureBinding(const Texture* texture)
+{
+	return texture ? texture->binding() : nullptr;
+}
+
+const vector<Object3D*>& Render::getDrawList()
+{
+	if (drawListDirty) {
+		drawList.clear();
+		for (auto& [id, obj] : objectList)
+			drawList.push_back(obj);
+
+		// Los opacos antes que los de alpha test. Objetos con el mismo programa seguidos (un glUseProgram
+		// por grupo), dentro de cada programa con la misma textura (o array de texturas) y arena (un
+		// multi-draw por grupo) y despues con la misma malla (un lote instanciado)
+		std::stable_sort(drawList.begin(), drawList.end(), [](const Object3D* a, const Object3D* b) {
+			if (a->alphaTested != b->alphaTested) return !a->alphaTested;
+			if (a->program != b->program) return a->program < b->program;
+			if (textureBinding(a->material.texture) != textureBinding(b->material.texture))
+				return textureBinding(a->material.texture) < textureBinding(b->material.texture);
+			GeometryArena* arenaA = a->mesh ? a->mesh->arena : nullptr;
+			GeometryArena* arenaB = b->mesh ? b->mesh->arena : nullptr;
+			if (arenaA != arenaB) return arenaA < arenaB;
+			return a->mesh < b->mesh;
+		});
+		drawListDirty = false;
+		bvhDirty = true;
 	}
+	return drawList;
 }
 
-void Render::setupLights(Program* prg)
+void Render::cullObjects(const vector<Object3D*>& list)
 {
-	// Usamos setUniformData en lugar de glUniform* directo
-	int numLights = static_cast<int>(lights.size());
-	prg->setUniformData(Program::integer, &numLights, "uNumLights");
+	PROFILE_SCOPE("cullObjects");
+	visibility.assign(list.size(), 1);
+	visibleObjects = (unsigned int)list.size();
+	culledObjects = 0;
+	occludedObjects = 0;
+	if (!frustumCulling && !occlusionCulling)
+		return;
 
-	for (size_t i = 0; i < lights.size(); ++i)
-	{
-		const auto& light = lights[i];
-		std::string base = "uLights[" + std::to_string(i) + "]";
+	// Colisionadores en mundo (actualizados en updateSceneGraph) en SoA
+	culler.clear();
+	for (Object3D* obj : list)
+		culler.add(obj->collider);
+
+	if (!frustumCulling) {
+		// Solo oclusion
+	}
+	else if (cullingBVH) {
+		// La topologia solo cambia con la lista de objetos; cada frame basta reajustar las cajas
+		if (bvhDirty || bvh.size() != list.size()) {
+			bvh.build(culler);
+			bvhDirty = false;
+		}
+		else {
+			bvh.refit(culler);
+		}
+		visibleObjects = (unsigned int)bvh.cull(culler, view.frustumPlanes, visibility);
+	}
+	else {
+		visibleObjects = (unsigned int)culler.cull(view.frustumPlanes, visibility);
+	}
+
+	if (occlusionCulling)
+		cullOccluded(list);
+
+	culledObjects = (unsigned int)list.size() - visibleObjects;
+}
+
+void Render::cullOccluded(const vector<Object3D*>& list)
+{
+	PROFILE_SCOPE("cullOccluded");
+	// Oclusores visibles al buffer de profundidad de CPU
+	occlusion.begin(view.viewProjection);
+	for (size_t i = 0; i < list.size(); i++) {
+		Object3D* obj = list[i];
+		if (visibility[i] && obj->occluder && obj->mesh)
+			occlusion.addOccluder(obj->mesh->vertexList, obj->mesh->idList, obj->modelMatrix);
+	}
+	if (occlusion.triangleCount() == 0)
+		return;
+
+	occlusion.rasterize();
+
+	// El resto se prueba con la caja de su colisionador (las esferas con la caja que las envuelve)
+	for (size_t i = 0; i < list.size(); i++) {
+		if (!visibility[i] || list[i]->occluder) continue;
+
+		float r = culler.radius[i];
+		vector4f min = { culler.centerX[i] - culler.extentX[i] - r, culler.centerY[i] - culler.extentY[i] - r, culler.centerZ[i] - culler.extentZ[i] - r, 1 };
+		vector4f max = { culler.centerX[i] + culler.extentX[i] + r, culler.centerY[i] + culler.extentY[i] + r, culler.centerZ[i] + culler.extentZ[i] + r, 1 };
+		if (!occlusion.isVisible(min, max)) {
+			visibility[i] = 0;
+			occludedObjects++;
+		}
+	}
+	visibleObjects -= occludedObjects;
+}
+
+int Render::selectLod(Object3D* obj)
+{
+	const vector<meshLod_t>& lods = obj->mesh->lods;
+	int levels = (int)lods.size();
+	// obj->lod es el que usan los lotes: tambien se pone a 0 cuando no se elige
+	if (!meshLOD || levels <= 1 || view.pixelScale <= 0.0f) {
+		obj->lod = 0;
+		return 0;
+	}
+
+	// Esfera de la malla en mundo: la escala es la de la columna mas larga de la matriz de modelo
+	const matrix4x4f& m = obj->modelMatrix;
+	float scale = 0.0f;
+	for (int c = 0; c < 3; c++)
+		scale = std::max(scale, sqrtf(m.mat2D[0][c] * m.mat2D[0][c] + m.mat2D[1][c] * m.mat2D[1][c] + m.mat2D[2][c] * m.mat2D[2][c]));
+	vector4f center = m * obj->mesh->boundsCenter;
+	float dist = length(center - view.position) - obj->mesh->boundsRadius * scale;
+	if (dist <= 0.0f) {
+		obj->lod = 0; // Camara dentro de la esfera
+		return 0;
+	}
+
+	// Error de cada nivel en pixeles: su error en mundo por el tamano en pantalla de una unidad a esa distancia
+	float pixelsPerUnit = scale * view.pixelScale / dist;
+	int lod = std::min(obj->lod, levels - 1);
+
+	// Mas detalle en cuanto el error del nivel actual se ve; menos solo con margen, para no alternar en la frontera
+	while (lod > 0 && lods[lod].error * pixelsPerUnit > lodPixelError)
+		lod--;
+	while (lod + 1 < levels && lods[lod + 1].error * pixelsPerUnit <= lodPixelError * (1.0f - lodHysteresis))
+		lod++;
+
+	obj->lod = lod;
+	return lod;
+}
+
+void Render::updateFramebufferSize()
+{
+	int width = 0, height = 0;
+	if (window)
+		glfwGetFramebufferSize(window, &width, &height);
+	else if (headless)
+		height = offscreenHeight;
+	framebufferHeight.store(height, std::memory_order_relaxed);
+}
+
+vector<double> Render::runFrames(int frames)
+{
+	// Un tick por frame: el resultado no depende de lo rapido que vaya la maquina
+	vector<double> frameMs;
+	frameMs.reserve(frames);
+	prepareFrame();
+	Profiler::setThreadName("GL + simulacion");
+	for (int f = 0; f < frames; f++) {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		streamAssets();
+		updateScene(1.0 / simulationRate);
+		prepareFrame();
+		clearFrame();
+		drawBatches();
+
+		// Sin swap que espere a la GPU: se espera aqui para medir el frame entero
+		glFinish();
+		frameMs.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+		Profiler::endFrame();
+	}
+	return frameMs;
+}
+
+vector<uint8_t> Render::readFramebuffer(int& width, int& height)
+{
+	width = headless ? offscreenWidth : 0;
+	height = headless ? offscreenHeight : 0;
+	if (window)
+		glfwGetFramebufferSize(window, &width, &height);
+
+	vector<uint8_t> pixels((size_t)width * height * 4);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, headless ? offscreenFBO : 0);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+	return pixels;
+}
+
+void Render::prepareFrame()
+{
+	updateFramebufferSize();
+	buildSnapshot(frameSnapshot);
+	submitSnapshot(frameSnapshot);
+	interpolateFrame(1.0f);
+}
+
+void Render::buildSnapshot(frameSnapshot_t& snap)
+{
+	PROFILE_SCOPE("buildSnapshot");
+	updateView();
+
+	// Lotes: tramos seguidos de la lista de dibujado con el mismo programa, malla y textura (o array:
+	// cada instancia lleva su capa), partidos en un lote por cada LOD usado
+	const vector<Object3D*>& list = getDrawList();
+	cullObjects(list);
+
+	snap.batches.clear();
+	snap.instanceData.clear();
+	snap.previousInstanceData.clear();
+	renderedTriangles = 0;
+	for (size_t i = 0, end = 0; i < list.size(); i = end) {
+		Object3D* first = list[i];
+		for (end = i + 1; end < list.size(); end++) {
+			if (list[end]->program != first->program || list[end]->mesh != first->mesh ||
+				textureBinding(list[end]->material.texture) != textureBinding(first->material.texture))
+				break;
+		}
+		if (!first->program || !first->mesh) continue;
+
+		unsigned int usedLods = 0;
+		for (size_t j = i; j < end; j++)
+			if (visibility[j])
+				usedLods |= 1u << selectLod(list[j]);
 
-		// Tipo de luz
-		prg->setUniformData(Program::integer, &(light->type), (base + ".type").c_str());
+		for (int lod = 0; lod < MESH_MAX_LODS; lod++) {
+			if (!(usedLods & (1u << lod))) continue;
 
-		// Posicin de la luz
-		prg->setUniformData(Program::vector4, &(light->position), (base + ".position").c_str());
+			// Las instancias de los opacos de delante atras: la primera que cubre un pixel tapa a las demas
+			instanceOrder.clear();
+			for (size_t j = i; j < end; j++)
+				if (visibility[j] && list[j]->lod == lod)
+					instanceOrder.push_back({ viewDepth(view.view, list[j]->modelMatrix), j });
+			if (sortFrontToBack && !first->alphaTested)
+				std::sort(instanceOrder.begin(), instanceOrder.end());
 
-		// Color de la luz
-		prg->setUniformData(Program::vector4, &(light->color), (base + ".color").c_str());
+			drawBatch_t batch = { first->program, first->mesh, first->material.texture, lod, (unsigned int)snap.instanceData.size(), 0,
+				first->alphaTested, FLT_MAX };
+			for (const auto& [depth, j] : instanceOrder) {
+				Object3D* obj = list[j];
+				batch.depth = std::min(batch.depth, depth);
 
-		// Intensidad de la luz
-		prg->setUniformData(Program::floatpoint, &(light->i), (base + ".intensity").c_str());
+				// Filas 0..2 de las matrices de modelo y normal (la fila 3 es constante), ahora y en el tick anterior
+				instanceData_t inst, previous;
+				for (int r = 0; r < 3; r++) {
+					inst.model[r] = obj->modelMatrix.rows[r];
+					inst.normal[r] = obj->normalMatrix.rows[r];
+					previous.model[r] = obj->previousModelMatrix.rows[r];
+					previous.normal[r] = obj->previousNormalMatrix.rows[r];
+				}
 
-		// Direccin de la luz
-		prg->setUniformData(Program::vector4, &(light->direction), (base + ".direction").c_str());
+				// Capa de su textura en la w de la primera fila de la normal, que el shader no usa
+				const Texture* texture = obj->material.texture;
+				inst.normal[0].w = previous.normal[0].w = texture && texture->array ? (float)texture->layer : 0.0f;
+				snap.instanceData.push_back(inst);
+				snap.previousInstanceData.push_back(previous);
+				batch.instanceCount++;
+			}
+			renderedTriangles += first->mesh->lods[lod].indexCount / 3 * batch.instanceCount;
+			snap.batches.push_back(batch);
+		}
+	}
+
+	// Un comando indirecto por lote; los lotes seguidos con el mismo programa, textura y arena forman un grupo
+	snap.drawCommands.clear();
+	snap.drawGroups.clear();
+	for (size_t b = 0; b < snap.batches.size(); b++) {
+		const drawBatch_t& batch = snap.batches[b];
+		const meshLod_t& lod = batch.mesh->lods[batch.lod];
+		snap.drawCommands.push_back({ lod.indexCount, batch.instanceCount, batch.mesh->arenaFirstIndex + lod.firstIndex,
+			(int)batch.mesh->baseVertex, batch.firstInstance });
+
+		const drawBatch_t* prev = b > 0 ? &snap.batches[b - 1] : nullptr;
+		if (prev && prev->program == batch.program && textureBinding(prev->texture) == textureBinding(batch.texture) &&
+			prev->mesh->arena == batch.mesh->arena) {
+			snap.drawGroups.back().batchCount++;
+			snap.drawGroups.back().depth = std::min(snap.drawGroups.back().depth, batch.depth);
+		}
+		else
+			snap.drawGroups.push_back({ (unsigned int)b, 1, batch.depth });
+	}
+
+	// Grupos de delante atras sin mezclar programas (cada glUseProgram cuesta mas que lo que se ahorra
+	// de sombreado) y con los opacos siempre delante
+	if (sortFrontToBack) {
+		std::stable_sort(snap.drawGroups.begin(), snap.drawGroups.end(), [&](const drawGroup_t& a, const drawGroup_t& b) {
+			const drawBatch_t& batchA = snap.batches[a.firstBatch];
+			const drawBatch_t& batchB = snap.batches[b.firstBatch];
+			if (batchA.alphaTested != batchB.alphaTested) return !batchA.alphaTested;
+			if (batchA.program != batchB.program) return batchA.program < batchB.program;
+			return a.depth < b.depth;
+		});
+	}
+
+	// Se suman a los que tuviera el hueco: si el hilo GL no llego a leerlo, no se pierden
+	snap.retiredPrograms.insert(snap.retiredPrograms.end(), retiredPrograms.begin(), retiredPrograms.end());
+	retiredPrograms.clear();
+
+	// Bloque por frame: se escribe una vez y lo leen todos los programas
+	fillFrameBlock(snap.frame);
+	snap.previousFrame = simulationTicks > 0 ? previousTickFrame : snap.frame;
+	clusterPointLights(snap);
+}
+
+void Render::clusterPointLights(frameSnapshot_t& snap)
+{
+	PROFILE_SCOPE("clusterLights");
+	snap.pointLights.clear();
+	snap.previousPointLights.clear();
+	for (Light* light : lights) {
+		if (light->type != Light::POINT) continue;
+		const vector4f& p = light->worldPosition;
+		const vector4f& q = light->previousWorldPosition;
+		vector4f color = { light->color.x, light->color.y, light->color.z, light->i };
+		snap.pointLights.push_back({ { p.x, p.y, p.z, light->radius }, color });
+		snap.previousPointLights.push_back({ { q.x, q.y, q.z, light->radius }, color });
+	}
+
+	// Con la vista de este tick; el fragment shader busca su cluster con la misma (clusterView)
+	if (clusteredLighting)
+		lightClusters.setGrid(CLUSTER_TILES_X, CLUSTER_TILES_Y, CLUSTER_SLICES);
+	else
+		lightClusters.setGrid(1, 1, 1);
+	lightClusters.setProjection(view.projection, view.zNear, view.zFar);
+	lightClusters.assign(view.view, snap.pointLights.data(), simulationTicks > 0 ? snap.previousPointLights.data() : nullptr,
+		snap.pointLights.size());
+	clusteredLights = lightClusters.visibleLights;
+	snap.clusterTable = lightClusters.table;
+	snap.clusterLights = lightClusters.indices;
+
+	// La ultima fila de la vista es (0, 0, 0, 1): se cambia por la de w de clip
+	snap.frame.clusterView = view.view;
+	snap.frame.clusterView.rows[3] = view.viewProjection.rows[3];
+	snap.frame.clusterParams = { view.projection.mat2D[0][0], view.projection.mat2D[1][1], view.zNear, lightClusters.sliceScale() };
+	snap.frame.clusterGrid[0] = lightClusters.tilesX();
+	snap.frame.clusterGrid[1] = lightClusters.tilesY();
+	snap.frame.clusterGrid[2] = lightClusters.slices();
+	snap.frame.clusterGrid[3] = (int)snap.pointLights.size();
+}
+
+void Render::fillFrameBlock(frameBlock_t& frame)
+{
+	frame = {};
+	frame.view = view.view;
+	frame.projection = view.projection;
+	frame.viewProjection = view.viewProjection;
+	frame.viewPos = view.position;
+
+	// Solo las direccionales (las puntuales van por clusters); mas de MAX_SHADER_LIGHTS se ignoran
+	frame.numLights = 0;
+	for (Light* light : lights) {
+		if (light->type != Light::DIRECTIONAL || frame.numLights == MAX_SHADER_LIGHTS) continue;
+		lightBlock_t& block = frame.lights[frame.numLights++];
+		block.position = light->worldPosition;
+		block.color = light->color;
+		block.direction = light->direction;
+		block.type = light->type;
+		block.intensity = light->i;
+	}
+}
+
+// Reescribe un buffer de textura entero (huerfanandolo); nunca vacio, para que la textura siempre tenga datos
+static void uploadTextureBuffer(unsigned int buffer, const void* data, size_t size)
+{
+	glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+	glBufferData(GL_TEXTURE_BUFFER, std::max<size_t>(size, sizeof(pointLight_t)), nullptr, GL_STREAM_DRAW);
+	if (size)
+		glBufferSubData(GL_TEXTURE_BUFFER, 0, size, data);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void Render::submitSnapshot(frameSnapshot_t& snap)
+{
+	PROFILE_SCOPE("submitSnapshot");
+	// Otro codigo puede haber cambiado el programa en uso fuera de Render
+	currentProgram = nullptr;
+	programSwitches = 0;
+	drawCalls = 0;
+	textureBinds = 0;
+
+	for (unsigned int generation : snap.retiredPrograms) {
+		uniformCache.erase(generation);
+		attributeCache.erase(attributeCache.lower_bound({ generation, nullptr }), attributeCache.lower_bound({ generation + 1, nullptr }));
+	}
+	snap.retiredPrograms.clear();
+
+	// Las listas pasan a Render sin copiarse; la instantanea se queda con las del frame anterior
+	// y el hilo de simulacion reutiliza su memoria
+	batches.swap(snap.batches);
+	drawCommands.swap(snap.drawCommands);
+	drawGroups.swap(snap.drawGroups);
+	instancesTo.swap(snap.instanceData);
+	instancesFrom.swap(snap.previousInstanceData);
+	pointLightsTo.swap(snap.pointLights);
+	pointLightsFrom.swap(snap.previousPointLights);
+	frameTo = snap.frame;
+	frameFrom = snap.previousFrame;
+
+	// Los clusters no se interpolan: se suben tal cual una vez por instantanea
+	uploadTextureBuffer(clusterTableBuffer, snap.clusterTable.data(), snap.clusterTable.size() * sizeof(uint32_t));
+	uploadTextureBuffer(clusterLightBuffer, snap.clusterLights.data(), snap.clusterLights.size() * sizeof(uint32_t));
+
+	if (useMultiDraw()) {
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+		if (drawCommands.size() > indirectCapacity)
+			indirectCapacity = std::max(drawCommands.size(), indirectCapacity * 2);
+		glBufferData(GL_DRAW_INDIRECT_BUFFER, indirectCapacity * sizeof(drawIndirectCommand_t), nullptr, GL_STREAM_DRAW);
+		if (!drawCommands.empty())
+			glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, drawCommands.size() * sizeof(drawIndirectCommand_t), drawCommands.data());
+	}
+}
+
+// a + (b - a) * t componente a componente (los operadores de vector4f fijan w = 1)
+static inline vector4f lerpVector(const vector4f& a, const vector4f& b, float t)
+{
+	return { a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t, a.z + (b.z - a.z) * t, a.w + (b.w - a.w) * t };
+}
+
+static matrix4x4f lerpMatrix(const matrix4x4f& a, const matrix4x4f& b, float t)
+{
+	matrix4x4f m;
+	for (int i = 0; i < 16; i++)
+		m.mat1[i] = a.mat1[i] + (b.mat1[i] - a.mat1[i]) * t;
+	return m;
+}
+
+void Render::interpolateFrame(float alpha)
+{
+	PROFILE_SCOPE("interpolateFrame");
+	// Instancias: las del ultimo tick tal cual o mezcladas con las del anterior. Interpolar las filas
+	// de la matriz no conserva la escala en giros grandes, pero en un tick el giro es pequeno
+	if (alpha >= 1.0f) {
+		instanceData = instancesTo;
+	}
+	else {
+		instanceData.resize(instancesTo.size());
+		for (size_t i = 0; i < instancesTo.size(); i++) {
+			for (int r = 0; r < 3; r++) {
+				instanceData[i].model[r] = lerpVector(instancesFrom[i].model[r], instancesTo[i].model[r], alpha);
+				instanceData[i].normal[r] = lerpVector(instancesFrom[i].normal[r], instancesTo[i].normal[r], alpha);
+			}
+		}
+	}
+
+	// El buffer se huerfana y se reescribe entero con una sola subida
+	glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+	if (instanceData.size() > instanceCapacity)
+		instanceCapacity = std::max(instanceData.size(), instanceCapacity * 2);
+	glBufferData(GL_ARRAY_BUFFER, instanceCapacity * sizeof(instanceData_t), nullptr, GL_STREAM_DRAW);
+	if (!instanceData.empty())
+		glBufferSubData(GL_ARRAY_BUFFER, 0, instanceData.size() * sizeof(instanceData_t), instanceData.data());
+
+	// Camara y luces
+	frameBlock_t frame = frameTo;
+	if (alpha < 1.0f) {
+		frame.view = lerpMatrix(frameFrom.view, frameTo.view, alpha);
+		frame.viewProjection = frame.projection * frame.view;
+		frame.viewPos = lerpVector(frameFrom.viewPos, frameTo.viewPos, alpha);
+		for (int i = 0; i < std::min(frameFrom.numLights, frameTo.numLights); i++) {
+			frame.lights[i].position = lerpVector(frameFrom.lights[i].position, frameTo.lights[i].position, alpha);
+			frame.lights[i].direction = lerpVector(frameFrom.lights[i].direction, frameTo.lights[i].direction, alpha);
+		}
+	}
+
+	// Luces puntuales: los clusters se calcularon con esferas que cubren las dos posiciones
+	pointLightData = pointLightsTo;
+	if (alpha < 1.0f && pointLightsFrom.size() == pointLightsTo.size()) {
+		for (size_t i = 0; i < pointLightData.size(); i++)
+			pointLightData[i].positionRadius = lerpVector(pointLightsFrom[i].positionRadius, pointLightsTo[i].positionRadius, alpha);
+	}
+	uploadTextureBuffer(pointLightBuffer, pointLightData.data(), pointLightData.size() * sizeof(pointLight_t));
+
+	PROFILE_SCOPE("uniforms");
+	uniformBuffer->beginFrame(uniformBuffer->alignedSize(sizeof(frameBlock_t)) + uniformBuffer->alignedSize(sizeof(materialBlock_t)));
+	size_t frameOffset = uniformBuffer->push(&frame, sizeof(frameBlock_t));
+
+	// Todos los lotes tienen el mismo material: un solo bloque por frame (las matrices van en el buffer de instancias)
+	materialBlock_t block = {};
+	block.kd = 0.8f;
+	block.ks = 0.5f;
+	block.shininess = 32;
+	size_t materialOffset = uniformBuffer->push(&block, sizeof(block));
+
+	uniformBuffer->endFrame();
+	uniformBuffer->bindRange(UBO_FRAME_BINDING, frameOffset, sizeof(frameBlock_t));
+	uniformBuffer->bindRange(UBO_MATERIAL_BINDING, materialOffset, sizeof(materialBlock_t));
+}
+
+const Render::renderUniforms_t& Render::getUniforms(Program* prg)
+{
+	auto it = uniformCache.find(prg->generation);
+	if (it != uniformCache.end()) return it->second;
+
+	// Primera vez que se dibuja con este programa: bloques y nombres se resuelven una vez
+	prg->bindUniformBlock("FrameData", UBO_FRAME_BINDING);
+	prg->bindUniformBlock("MaterialData", UBO_MATERIAL_BINDING);
+
+	renderUniforms_t u;
+	u.texture = prg->getUniformHandle("uTexture");
+
+	// Los buffers de luces van siempre en las mismas unidades: sus samplers se fijan una vez
+	u.pointLights = prg->getUniformHandle("uPointLights");
+	u.clusterTable = prg->getUniformHandle("uClusterTable");
+	u.clusterLights = prg->getUniformHandle("uClusterLights");
+	prg->setUniform(u.pointLights, TEXTURE_UNIT_POINT_LIGHTS);
+	prg->setUniform(u.clusterTable, TEXTURE_UNIT_CLUSTER_TABLE);
+	prg->setUniform(u.clusterLights, TEXTURE_UNIT_CLUSTER_LIGHTS);
+
+	return uniformCache[prg->generation] = u;
+}
+
+const Render::renderAttributes_t& Render::getAttributes(Program* prg, const VertexLayout* layout)
+{
+	auto key = std::make_pair(prg->generation, layout);
+	auto it = attributeCache.find(key);
+	if (it != attributeCache.end()) return it->second;
+
+	// Primera vez que se dibuja con este programa y formato: los nombres se resuelven una vez
+	static const char* modelRows[3] = { "iModel0", "iModel1", "iModel2" };
+	static const char* normalRows[3] = { "iNormal0", "iNormal1", "iNormal2" };
+
+	renderAttributes_t a;
+	for (const vertexAttribute_t& attribute : layout->attributes)
+		a.vertex.push_back(prg->getAttributeLocation(attribute.name));
+	for (int r = 0; r < 3; r++) {
+		a.modelRows[r] = prg->getAttributeLocation(modelRows[r]);
+		a.normalRows[r] = prg->getAttributeLocation(normalRows[r]);
+	}
+
+	return attributeCache[key] = a;
+}
+
+void Render::attachObject(Object3D* child, Object3D* parent)
+{
+	if (!child || !sceneGraph.isValid(child->sceneNode)) {
+		cout << "ERROR: " << __FILE__ << ":" << __LINE__ << " (" << __func__ << ") El objeto no esta en el Render" << endl;
+		return;
+	}
+	if (parent && !sceneGraph.isValid(parent->sceneNode)) {
+		cout << "ERROR: " << __FILE__ << ":" << __LINE__ << " (" << __func__ << ") El padre no esta en el Render" << endl;
+		return;
+	}
+	sceneGraph.setParent(child->sceneNode, parent ? parent->sceneNode : SceneGraph::NO_PARENT);
+}
+
+void Render::attachLight(Light* light, Object3D* parent)
+{
+	if (parent && !sceneGraph.isValid(parent->sceneNode)) {
+		cout << "ERROR: " << __FILE__ << ":" << __LINE__ << " (" << __func__ << ") El padre no esta en el Render" << endl;
+		return;
+	}
+	if (!sceneGraph.isValid(light->sceneNode)) {
+		light->sceneNode = sceneGraph.createNode();
+		bindNode(light->sceneNode, nullptr, light);
+	}
+	sceneGraph.setParent(light->sceneNode, parent ? parent->sceneNode : SceneGraph::NO_PARENT);
+	sceneGraph.setLocalMatrix(light->sceneNode, make_translate(light->position.x, light->position.y, light->position.z));
+}
+
+void Render::bindNode(int node, Object3D* obj, Light* light)
+{
+	if (node >= (int)nodeObjects.size()) {
+		nodeObjects.resize(node + 1, nullptr);
+		nodeLights.resize(node + 1, nullptr);
 	}
+	nodeObjects[node] = obj;
+	nodeLights[node] = light;
 }
 
-void Render::setupMaterial(Object3D* obj)
+void Render::updateSceneGraph()
 {
-	Program* prg = obj->program;
+	PROFILE_SCOPE("updateSceneGraph");
+	sceneGraph.update();
 
-	// Parmetros de material bsicos usando setUniformData
-	float kd = 0.8f;
-	prg->setUniformData(Program::floatpoint, &kd, "uKd");
+	// Solo se visitan los nodos recalculados (los subarboles que cambiaron)
+	for (int node : sceneGraph.getUpdatedNodes()) {
+		if (Object3D* obj = nodeObjects[node]) {
+			obj->modelMatrix = sceneGraph.getWorldMatrix(node);
+			obj->normalMatrix = transpose(inverse(obj->modelMatrix)); // Antes se hacia por vertice en el shader
+			obj->updateCollider();
+		}
+		else if (Light* light = nodeLights[node]) {
+			light->worldPosition = sceneGraph.getWorldPosition(node);
+		}
+	}
+}
 
-	float ks = 0.5f;
-	prg->setUniformData(Program::floatpoint, &ks, "uKs");
 
-	int shininess = 32;
-	prg->setUniformData(Program::integer, &shininess, "uShininess");
+void Render::setupMaterial(const drawBatch_t& batch)
+{
+	Program* prg = batch.program;
+	const renderUniforms_t& u = getUniforms(prg);
 
-	// Textura si existe
-	if (obj->material.texture)
+	// Los parmetros de material van en MaterialData (enlazado una vez por frame). Textura si existe
+	if (batch.texture)
 	{
-		obj->material.texture->bind(0);
-		int textureUnit = 0;
-		prg->setUniformData(Program::integer, &textureUnit, "uTexture");
+		// Los lotes seguidos con texturas del mismo array no vuelven a enlazar nada
+		if (batch.texture->binding() != currentTexture) {
+			batch.texture->bind(0);
+			currentTexture = batch.texture->binding();
+			textureBinds++;
+		}
+		prg->setUniform(u.texture, 0);
 	}
 }
 
-void Render::setupVertexAttributes(Object3D* obj)
+void Render::setupVertexAttributes(const drawBatch_t& batch, unsigned int firstInstance, bool positionOnly)
 {
-	auto& bo = bufferList[obj->id];
-	Program* prg = obj->program;
+	const GeometryArena* arena = batch.mesh->arena;
+	Program* prg = batch.program;
 
-	glBindVertexArray(bo.idArray);
-	glBindBuffer(GL_ARRAY_BUFFER, bo.idVertexArray);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, bo.idIndexArray);
+	// VAO y buffers de la arena: los comparten todas las mallas del mismo formato
+	glBindVertexArray(arena->idArray);
+	glBindBuffer(GL_ARRAY_BUFFER, arena->idVertexArray);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, arena->idIndexArray);
 
-	// Usando setAttributeData para cada atributo
-	prg->setAttributeData("vPos", 4, GL_FLOAT, GL_FALSE, sizeof(vertex_t),
-		(void*)offsetof(vertex_t, vPos));
+	// Atributos por vertice segun el formato de la malla
+	const VertexLayout* layout = batch.mesh->layout;
+	const renderAttributes_t& locations = getAttributes(prg, layout);
+	for (size_t i = 0; i < layout->attributes.size(); i++) {
+		const vertexAttribute_t& a = layout->attributes[i];
+		if (positionOnly && a.semantic != VERTEX_POSITION) continue; // El resto no llega al prepass
+		prg->setAttributeData(locations.vertex[i], VertexLayout::components(a.format), VertexLayout::glType(a.format),
+			VertexLayout::normalized(a.format), layout->stride, (void*)(size_t)a.offset);
+	}
 
-	prg->setAttributeData("vColor", 4, GL_FLOAT, GL_FALSE, sizeof(vertex_t),
-		(void*)offsetof(vertex_t, vColor));
+	// Atributos por instancia apuntando a firstInstance: la primera del lote en el camino de un
+	// dibujado por lote (glDrawElementsInstancedBaseInstance no existe en GL 4.1) o 0 con multi-draw
+	size_t base = (size_t)firstInstance * sizeof(instanceData_t);
 
-	prg->setAttributeData("vNormal", 4, GL_FLOAT, GL_FALSE, sizeof(vertex_t),
-		(void*)offsetof(vertex_t, vNormal));
+	glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+	for (int r = 0; r < 3; r++) {
+		prg->setAttributeData(locations.modelRows[r], 4, GL_FLOAT, GL_FALSE, sizeof(instanceData_t),
+			(void*)(base + offsetof(instanceData_t, model) + r * sizeof(vector4f)), 1);
+		if (positionOnly) continue;
+		prg->setAttributeData(locations.normalRows[r], 4, GL_FLOAT, GL_FALSE, sizeof(instanceData_t),
+			(void*)(base + offsetof(instanceData_t, normal) + r * sizeof(vector4f)), 1);
+	}
+}
 
-	prg->setAttributeData("vTextureCoord", 4, GL_FLOAT, GL_FALSE, sizeof(vertex_t),
-		(void*)offsetof(vertex_t, vTextureCoord));
+void Render::renderBatch(const drawBatch_t& batch)
+{
+	const meshLod_t& lod = batch.mesh->lods[batch.lod];
+	glDrawElementsInstancedBaseVertex(GL_TRIANGLES, (GLsizei)lod.indexCount, batch.mesh->indexType,
+		(void*)((size_t)(batch.mesh->arenaFirstIndex + lod.firstIndex) * batch.mesh->indexSize()),
+		batch.instanceCount, (GLint)batch.mesh->baseVertex);
+	drawCalls++;
+	PROFILE_COUNT(COUNTER_DRAW_CALLS, 1);
+	PROFILE_COUNT(COUNTER_TRIANGLES, (uint64_t)lod.indexCount / 3 * batch.instanceCount);
 }
 
-void Render::renderObject(Object3D* obj)
+// Espera hasta deadline: sleep_for mientras falte mas de lo que puede pasarse el planificador
+// del sistema (varios ms en Windows) y el resto cediendo el hilo
+static void waitUntil(std::chrono::steady_clock::time_point deadline)
 {
-	glDrawElements(GL_TRIANGLES, obj->idList.size(), GL_UNSIGNED_INT, nullptr);
+	using namespace std::chrono;
+	for (;;) {
+		auto left = deadline - steady_clock::now();
+		if (left <= steady_clock::duration::zero()) return;
+		if (left > milliseconds(2))
+			std::this_thread::sleep_for(left - milliseconds(2));
+		else
+			std::this_thread::yield();
+	}
 }
 
 void Render::mainLoop() {
+	// Primer frame con la escena tal cual, para tener algo que dibujar antes del primer tick
+	prepareFrame();
+
+	if (threadedSimulation) {
+		mainLoopThreaded();
+		return;
+	}
+
+	using clock = std::chrono::steady_clock;
+	const double tick = 1.0 / simulationRate;
+	double accumulator = 0.0;
+	clock::time_point last = clock::now();
+	Profiler::setThreadName("GL + simulacion");
+
+	while (!glfwWindowShouldClose(window)) {
+		clock::time_point frameStart = clock::now();
+		pollInput();
+		streamAssets();
+		clearFrame();
+
+		// Ticks fijos por el tiempo real transcurrido. Tras un paron (ventana arrastrada, depurador)
+		// no se recupera mas de un cuarto de segundo para no encadenar frames cada vez mas lentos
+		accumulator += std::min(std::chrono::duration<double>(frameStart - last).count(), 0.25);
+		last = frameStart;
+		bool ticked = false;
+		while (accumulator >= tick) {
+			updateScene(tick);
+			accumulator -= tick;
+			ticked = true;
+		}
+
+		// Culling, lotes e instancias solo cuando la escena ha cambiado; cada frame se interpola
+		if (ticked) {
+			updateFramebufferSize();
+			buildSnapshot(frameSnapshot);
+			submitSnapshot(frameSnapshot);
+		}
+		interpolateFrame((float)(accumulator / tick));
+
+		// Una llamada por lote de programa + malla + textura
+		drawBatches();
+
+		endFrame(frameStart);
+	}
+}
+
+void Render::pollInput()
+{
+	PROFILE_SCOPE("input");
+	glfwPollEvents();
+}
+
+void Render::clearFrame()
+{
+	PROFILE_GPU_SCOPE("clear");
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
+
+void Render::endFrame(std::chrono::steady_clock::time_point frameStart)
+{
+	{
+		PROFILE_SCOPE("swap");
+		glfwSwapBuffers(window);
+	}
+	if (maxFrameRate > 0) {
+		PROFILE_SCOPE("pacing");
+		waitUntil(frameStart + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / maxFrameRate)));
+	}
+	Profiler::endFrame();
+}
+
+void Render::mainLoopThreaded()
+{
+	using clock = std::chrono::steady_clock;
+	const clock::duration tick = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(1.0 / simulationRate));
+	const clock::time_point start = clock::now();
+	auto seconds = [start](clock::time_point t) { return std::chrono::duration<double>(t - start).count(); };
+
+	// Hilo de simulacion: un tick cada 1 / simulationRate segundos de reloj real, y tras cada tick la
+	// instantanea del frame. Duerme hasta el siguiente tick, asi que su coste por segundo no depende
+	// de cuantos frames dibuje el hilo GL. Si se retrasa encadena ticks (como mucho un cuarto de segundo)
+	std::atomic<bool> running = true;
+	std::thread simulation([&]() {
+		Profiler::setThreadName("simulacion");
+		clock::time_point next = start + tick;
+		while (running.load(std::memory_order_relaxed)) {
+			waitUntil(next);
+			clock::time_point now = clock::now();
+			if (now - next > std::chrono::milliseconds(250))
+				next = now - std::chrono::milliseconds(250);
+
+			while (next <= now) {
+				updateScene(1.0 / simulationRate);
+				next += tick;
+			}
+
+			frameSnapshot_t& snap = snapshots.writeBuffer();
+			buildSnapshot(snap);
+			snap.tickTime = seconds(next - tick);
+			snapshots.publish();
+		}
+	});
+
+	// Hilo GL: eventos, ultima instantanea e interpolacion segun el tiempo pasado desde su tick.
+	// Se dibuja un tick por detras: alpha 0 es el tick anterior y 1 el ultimo
+	double tickTime = 0.0;
+	Profiler::setThreadName("GL");
 	while (!glfwWindowShouldClose(window)) {
-		glfwPollEvents();
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		clock::time_point frameStart = clock::now();
+		pollInput();
+		streamAssets();
+		updateFramebufferSize();
+		clearFrame();
 
-		camera->move(0.008);
+		if (snapshots.acquire()) {
+			tickTime = snapshots.readBuffer().tickTime;
+			submitSnapshot(snapshots.readBuffer());
+		}
+		double alpha = (seconds(frameStart) - tickTime) * simulationRate;
+		interpolateFrame((float)std::clamp(alpha, 0.0, 1.0));
+		drawBatches();
+
+		endFrame(frameStart);
+	}
+
+	running = false;
+	simulation.join();
+}
 
+void Render::updateScene(double timeStep)
+{
+	PROFILE_SCOPE("updateScene");
+	// Los objetos que termino de cargar el hilo GL entran en la escena al empezar el tick
+	addLoadedObjects();
+
+	// Estado al empezar el tick: desde el se interpola hasta el del final
+	updateView();
+	fillFrameBlock(previousTickFrame);
+	for (auto& [id, obj] : objectList) {
+		obj->previousModelMatrix = obj->modelMatrix;
+		obj->previousNormalMatrix = obj->normalMatrix;
+	}
+	for (Light* light : lights)
+		light->previousWorldPosition = light->worldPosition;
+
+	// Entrada que ve este tick: se graba o, si se esta reproduciendo una grabacion, se sustituye por la suya
+	EventManager::beginTick();
+
+	// Los move() reciben lo mismo que antes en cada frame a MOVE_REFERENCE_RATE, escalado por el tiempo real del tick
+	double scale = timeStep * MOVE_REFERENCE_RATE;
+	if (camera) {
+		PROFILE_SCOPE("camera");
+		camera->move((float)(0.008 * scale));
+	}
+
+	{
+		PROFILE_SCOPE("move");
 		for (auto light : lights) {
-			light->move(0.001);
+			light->move(0.001 * scale);
+
+			// Las luces enganchadas a la jerarquia usan su posicion como local
+			if (light->sceneNode >= 0)
+				sceneGraph.setLocalMatrix(light->sceneNode, make_translate(light->position.x, light->position.y, light->position.z));
+			else
+				light->worldPosition = light->position;
 		}
 
-		// Updated object loop
+		// Movimiento: setLocalMatrix solo marca los nodos cuya matriz local cambia
 		for (auto& [id, obj] : objectList) {
-			obj->updateCollider(); // Added collider update
-			obj->move(0.001);
+			obj->move(0.001 * scale);
 			obj->updateModelMatrix();
-			drawGl(obj);
+			sceneGraph.setLocalMatrix(obj->sceneNode, obj->localMatrix);
 		}
-
-		glfwSwapBuffers(window);
 	}
+
+	// Matrices de mundo y colisionadores de los subarboles modificados
+	updateSceneGraph();
+	simulationTicks++;
 }
 
 void Render::putCamera(Camera* cam)
@@ -223,34 +1250,40 @@ void Render::putCamera(Camera* cam)
 }
 
 bool Render::cameraCollision(Camera* camera) {
+	PROFILE_SCOPE("cameraCollision");
 	if (!camera || !camera->coll) {
 		cout << "Camera or camera collider is null" << endl;
 		return false;
 	}
 
-	cout << "Checking collisions for camera at (" << camera->position.x << ", "
-		<< camera->position.y << ", " << camera->position.z << ") with radius: "
-		<< static_cast<Sphere*>(camera->coll)->radius << endl;
+	// Se llama en cada tick: sin ventana (benchmarks, repeticiones) no se escribe la traza
+	bool verbose = !headless;
+	if (verbose)
+		cout << "Checking collisions for camera at (" << camera->position.x << ", "
+			<< camera->position.y << ", " << camera->position.z << ") with radius: "
+			<< static_cast<Sphere*>(camera->coll)->radius << endl;
 
 	for (auto& [id, obj] : objectList) {
 		if (obj->collider) {
-			cout << "  Testing against object ID: " << id << " at (" << obj->position.x
-				<< ", " << obj->position.y << ", " << obj->position.z << ")";
+			if (verbose) {
+				cout << "  Testing against object ID: " << id << " at (" << obj->position.x
+					<< ", " << obj->position.y << ", " << obj->position.z << ")";
 
-			if (obj->collider->type == sphere) {
-				Sphere* objSphere = static_cast<Sphere*>(obj->collider);
-				cout << " with radius: " << objSphere->radius;
+				if (obj->collider->type == sphere) {
+					Sphere* objSphere = static_cast<Sphere*>(obj->collider);
+					cout << " with radius: " << objSphere->radius;
+				}
+				cout << endl;
 			}
-			cout << endl;
 
 			bool collision = obj->collider->test(camera->coll);
 			if (collision) {
-				cout << "  COLLISION DETECTED with object ID: " << id << endl;
+				if (verbose) cout << "  COLLISION DETECTED with object ID: " << id << endl;
 				return true;
 			}
 		}
 	}
-	cout << "No collisions detected" << endl;
+	if (verbose) cout << "No collisions detected" << endl;
 	return false;
 }
 
@@ -266,17 +1299,25 @@ void Render::putLight(vector<Light*> newLights)
 
 
 void Render::removeObject(Object3D* obj) {
-	auto bufferIter = bufferList.find(obj->id);
-	if (bufferIter != bufferList.end()) {
-		bufferObject bo = bufferIter->second;
-		glDeleteBuffers(1, &bo.idVertexArray);
-		glDeleteBuffers(1, &bo.idIndexArray);
-		glDeleteVertexArrays(1, &bo.idArray);
-		bufferList.erase(bufferIter);
-	}
-
+	// Los buffers de GPU son de la malla compartida y se liberan con ella (MeshLibrary::release)
 	auto objIter = objectList.find(obj->id);
 	if (objIter != objectList.end()) {
 		objectList.erase(objIter);
+		drawListDirty = true;
+	}
+
+	// Los programas son compartidos: sus handles solo se olvidan si ningun objeto lo usa ya. La cache
+	// es del hilo GL, asi que lo hace al recibir la siguiente instantanea
+	bool programInUse = false;
+	for (auto& [id, other] : objectList)
+		programInUse = programInUse || other->program == obj->program;
+	if (!programInUse && obj->program)
+		retiredPrograms.push_back(obj->program->generation);
+
+	// Sus hijos pasan a ser raices
+	if (sceneGraph.isValid(obj->sceneNode)) {
+		bindNode(obj->sceneNode, nullptr, nullptr);
+		sceneGraph.removeNode(obj->sceneNode);
+		obj->sceneNode = -1;
 	}
 }
@@ -0,0 +1,1554 @@
+#include "libprgr/RenderBenchmark.h"
+#include "libprgr/ProgramLibrary.h"
+#include "libprgr/ImageWriter.h"
+#include <chrono>
+#include <iomanip>
+#include <filesystem>
+#include <random>
+#include <cstring>
+#include <GLFW/stb_image.h>
+
+#pragma region --- CAMINO POR NOMBRES ---
+
+// Copia del setUniformData original: dos busquedas en el map por llamada y subida siempre.
+void RenderBenchmark::setUniformByName(Program* prg, Program::dataType_e tipo, const void* dato, string nombre)
+{
+	if (prg->varList.find(nombre) == prg->varList.end())
+		return; // El original imprimia un error; aqui solo se mide la busqueda
+
+	stringCalls++;
+	switch (tipo)
+	{
+	case Program::matrix4: glUniformMatrix4fv(prg->varList[nombre], 1, GL_TRUE, (const float*)dato); break;
+	case Program::integer: glUniform1i(prg->varList[nombre], ((const int*)dato)[0]); break;
+	case Program::floatpoint: glUniform1f(prg->varList[nombre], ((const float*)dato)[0]); break;
+	case Program::vector4: glUniform4fv(prg->varList[nombre], 1, (const float*)dato); break;
+	default: break;
+	}
+}
+
+void RenderBenchmark::drawWithStrings(Object3D* obj)
+{
+	Program* prg = obj->program;
+	Camera* camera = render->camera;
+	prg->use();
+
+	matrix4x4f M = obj->modelMatrix;
+	setUniformByName(prg, Program::matrix4, M.mat1, "uModel");
+	if (camera) {
+		setUniformByName(prg, Program::matrix4, camera->computeViewMatrix().mat1, "uView");
+		setUniformByName(prg, Program::matrix4, camera->computeProjectionMatrix().mat1, "uProjection");
+		vector4f camPos = { camera->position.x, camera->position.y, camera->position.z, 1 };
+		setUniformByName(prg, Program::vector4, &camPos, "uViewPos");
+	}
+
+	int numLights = static_cast<int>(render->lights.size());
+	setUniformByName(prg, Program::integer, &numLights, "uNumLights");
+	for (size_t i = 0; i < render->lights.size(); ++i) {
+		const Light* light = render->lights[i];
+		std::string base = "uLights[" + std::to_string(i) + "]";
+		int type = light->type;
+		setUniformByName(prg, Program::integer, &type, (base + ".type").c_str());
+		setUniformByName(prg, Program::vector4, &(light->worldPosition), (base + ".position").c_str());
+		setUniformByName(prg, Program::vector4, &(light->color), (base + ".color").c_str());
+		setUniformByName(prg, Program::floatpoint, &(light->i), (base + ".intensity").c_str());
+		setUniformByName(prg, Program::vector4, &(light->direction), (base + ".direction").c_str());
+	}
+
+	float kd = 0.8f, ks = 0.5f;
+	int shininess = 32;
+	setUniformByName(prg, Program::floatpoint, &kd, "uKd");
+	setUniformByName(prg, Program::floatpoint, &ks, "uKs");
+	setUniformByName(prg, Program::integer, &shininess, "uShininess");
+
+	const Mesh* mesh = obj->mesh;
+	glBindVertexArray(mesh->arena->idArray);
+	glDrawElementsBaseVertex(GL_TRIANGLES, (GLsizei)mesh->idList.size(), mesh->indexType,
+		(void*)((size_t)mesh->arenaFirstIndex * mesh->indexSize()), (GLint)mesh->baseVertex);
+}
+
+void RenderBenchmark::drawPerObject()
+{
+	// Cada instancia como un lote de uno: mismo trabajo de estado que antes del instanciado
+	for (const drawBatch_t& batch : render->batches) {
+		for (unsigned int i = 0; i < batch.instanceCount; i++) {
+			drawBatch_t single = batch;
+			single.firstInstance = batch.firstInstance + i;
+			single.instanceCount = 1;
+			render->drawBatch(single);
+		}
+	}
+}
+
+#pragma endregion
+
+RenderBenchmark::RenderBenchmark(Render* render, int frames, int objectsPerFrame, int repetitions) :
+	render(render), frames(frames), objectsPerFrame(objectsPerFrame), repetitions(repetitions)
+{
+}
+
+// Pone la camara en el Render mientras exista y deja la anterior al salir del benchmark
+class ScopedCamera {
+public:
+	ScopedCamera(Render* render, Camera* camera) : render(render), saved(render->camera) { render->camera = camera; }
+	~ScopedCamera() { render->camera = saved; }
+
+private:
+	Render* render;
+	Camera* saved;
+};
+
+template <typename F>
+double RenderBenchmark::timeFrames(F frame, int itemsPerFrame)
+{
+	double best = 1e30;
+	for (int r = 0; r < repetitions; r++) {
+		// La GPU se vacia fuera de la medicion: solo se mide el trabajo de CPU
+		glFinish();
+		auto start = std::chrono::high_resolution_clock::now();
+		for (int f = 0; f < frames; f++)
+			frame();
+		auto end = std::chrono::high_resolution_clock::now();
+		double ns = std::chrono::duration<double, std::nano>(end - start).count() / ((double)frames * itemsPerFrame);
+		best = std::min(best, ns);
+	}
+	glFinish();
+	return best;
+}
+
+void RenderBenchmark::renderFrame(bool waitGPU)
+{
+	render->prepareFrame();
+	if (waitGPU)
+		render->clearFrame();
+	render->drawBatches();
+	if (waitGPU)
+		glFinish();
+}
+
+double RenderBenchmark::timeRenderFrames(bool waitGPU)
+{
+	renderFrame(waitGPU);
+	return timeFrames([&]() { renderFrame(waitGPU); }, 1) / 1e6;
+}
+
+vector<Object3D*> RenderBenchmark::buildCubeGrid(int objects, float spacing, bool centered, bool shuffled)
+{
+	int side = (int)ceil(sqrt((double)objects));
+	vector<int> cells(objects);
+	for (int i = 0; i < objects; i++)
+		cells[i] = i;
+	if (shuffled) {
+		std::mt19937 rng(1);
+		std::shuffle(cells.begin(), cells.end(), rng);
+	}
+
+	vector<Object3D*> list;
+	list.reserve(objects);
+	for (int cell : cells) {
+		Object3D* obj = new Object3D();
+		obj->loadFromFile("data/cubo.fiis");
+		obj->position = { (float)(cell % side - (centered ? side / 2 : 0)) * spacing, 0.0f, -(float)(cell / side) * spacing, 1.0f };
+		obj->updateModelMatrix();
+		render->putObject(obj);
+		list.push_back(obj);
+	}
+	return list;
+}
+
+void RenderBenchmark::removeObjects(vector<Object3D*>& list)
+{
+	for (Object3D* obj : list) {
+		render->removeObject(obj);
+		delete obj;
+	}
+	list.clear();
+}
+
+void RenderBenchmark::runUniforms()
+{
+	// Todos los objetos comparten programa y malla, como en la escena normal
+	vector<Object3D*> objects;
+	for (int i = 0; i < objectsPerFrame; i++) {
+		Object3D* obj = new Object3D();
+		obj->loadFromFile("data/cubo.fiis");
+		obj->position = { (float)(i % 8) * 2.0f, 0.0f, (float)(i / 8) * 2.0f, 1.0f };
+		obj->updateModelMatrix();
+		render->putObject(obj);
+		objects.push_back(obj);
+	}
+
+	// Un frame de calentamiento deja los VAO configurados y los bloques enlazados
+	render->updateSceneGraph();
+	render->prepareFrame();
+	render->drawBatches();
+
+	vector<Light*> savedLights = render->lights;
+	const int lightCounts[] = { 1, 8, 64 };
+
+	for (int numLights : lightCounts) {
+		vector<Light*> lights;
+		for (int i = 0; i < numLights; i++) {
+			Light* light = new Light(Light::POINT, { (float)i, 2.0f, 0.0f, 1.0f }, { 1, 1, 1, 1 }, 1.0f);
+			light->worldPosition = light->position;
+			lights.push_back(light);
+		}
+		render->lights = lights;
+
+		for (int moving = 0; moving < 2; moving++) {
+			int tick = 0;
+			auto animate = [&]() {
+				tick++;
+				if (!moving) return;
+				for (Light* light : lights)
+					light->worldPosition.y = 2.0f + (float)(tick & 7) * 0.125f;
+			};
+
+			uniformResult_t res;
+			res.numLights = numLights;
+			res.movingLights = moving != 0;
+
+			stringCalls = 0;
+			res.nsPerDrawStrings = timeFrames([&]() {
+				animate();
+				for (Object3D* obj : objects) drawWithStrings(obj);
+			}, objectsPerFrame);
+
+			unsigned int uploadsBefore = 0;
+			for (Object3D* obj : objects) uploadsBefore += obj->program->uniformUploads;
+			res.nsPerDrawBlocks = timeFrames([&]() {
+				animate();
+				renderFrame(false);
+			}, objectsPerFrame);
+			unsigned int uploads = 0;
+			for (Object3D* obj : objects) uploads += obj->program->uniformUploads;
+
+			double totalDraws = (double)frames * objectsPerFrame * repetitions;
+			res.callsPerDrawStrings = stringCalls / totalDraws;
+			res.callsPerDrawBlocks = (uploads - uploadsBefore) / totalDraws
+				+ (double)render->batches.size() / objectsPerFrame; // + glBindBufferRange de cada lote
+
+			uniformResults.push_back(res);
+		}
+
+		for (Light* light : lights) delete light;
+	}
+
+	render->lights = savedLights;
+	removeObjects(objects);
+}
+
+void RenderBenchmark::runPrograms(int variants)
+{
+	// Cache propia del benchmark, vacia al empezar: la primera carga siempre es en frio
+	const string cacheDir = "cache/bench_programs";
+	std::error_code ec;
+	std::filesystem::remove_all(cacheDir, ec);
+
+	const vector<string> files = { "data/shader.frag", "data/shader.vert" };
+	for (int v = 0; v < variants; v++) {
+		vector<string> defines = { "BENCH_VARIANT " + to_string(v) };
+
+		programResult_t res;
+		res.defines = defines[0];
+
+		// build() espera al estado de enlazado, asi que los tiempos incluyen todo el trabajo del driver
+		auto start = std::chrono::high_resolution_clock::now();
+		Program* cold = new Program();
+		cold->build(files, defines, cacheDir);
+		auto middle = std::chrono::high_resolution_clock::now();
+		Program* warm = new Program();
+		res.fromCache = warm->build(files, defines, cacheDir);
+		auto end = std::chrono::high_resolution_clock::now();
+
+		res.coldMs = std::chrono::duration<double, std::milli>(middle - start).count();
+		res.warmMs = std::chrono::duration<double, std::milli>(end - middle).count();
+		programResults.push_back(res);
+
+		cold->clean();
+		warm->clean();
+		delete cold;
+		delete warm;
+	}
+}
+
+void RenderBenchmark::runInstancing(int objects)
+{
+	instancingResult_t res = {};
+	res.objects = objects;
+
+	// Rejilla cuadrada de cubos
+	unsigned int meshesBefore = MeshLibrary::loadedMeshes;
+	auto start = std::chrono::high_resolution_clock::now();
+	vector<Object3D*> list = buildCubeGrid(objects);
+	auto end = std::chrono::high_resolution_clock::now();
+	res.loadMs = std::chrono::duration<double, std::milli>(end - start).count();
+	res.meshesLoaded = MeshLibrary::loadedMeshes - meshesBefore;
+
+	// Matrices de mundo; el frame de calentamiento deja los VAO y los bloques listos
+	render->updateSceneGraph();
+	res.msPerFrameInstanced = timeRenderFrames(false);
+	res.drawCallsInstanced = render->drawCalls;
+
+	res.msPerFrameObjects = timeFrames([&]() {
+		render->prepareFrame();
+		drawPerObject();
+	}, 1) / 1e6;
+	res.drawCallsObjects = render->drawCalls;
+
+	instancingResults.push_back(res);
+	removeObjects(list);
+}
+
+void RenderBenchmark::runMultiDraw(int objects)
+{
+	multiDrawResult_t res = {};
+	res.objects = objects;
+	res.multiDrawSupported = GLAD_GL_VERSION_4_3;
+
+	// Cubo unidad con normales por cara; cada objeto lo pide con otro nombre para tener su propia malla
+	auto buildCube = [](Mesh* m) {
+		const float n[6][3] = { {1,0,0}, {-1,0,0}, {0,1,0}, {0,-1,0}, {0,0,1}, {0,0,-1} };
+		for (int f = 0; f < 6; f++) {
+			int a = f / 2, u = (a + 1) % 3, v = (a + 2) % 3;
+			float s = n[f][a];
+			for (int c = 0; c < 4; c++) {
+				vertex_t vx = {};
+				vx.vPos.data[a] = 0.5f * s;
+				vx.vPos.data[u] = (c == 1 || c == 2) ? 0.5f : -0.5f;
+				vx.vPos.data[v] = (c >= 2) ? 0.5f * s : -0.5f * s;
+				vx.vPos.w = 1;
+				vx.vColor = { 1, 1, 1, 1 };
+				vx.vNormal = { n[f][0], n[f][1], n[f][2], 0 };
+				vx.vTextureCoord = { (c == 1 || c == 2) ? 1.0f : 0.0f, c >= 2 ? 1.0f : 0.0f, 0, 0 };
+				m->vertexList.push_back(vx);
+			}
+			int b = f * 4;
+			m->idList.insert(m->idList.end(), { b, b + 1, b + 2, b, b + 2, b + 3 });
+		}
+	};
+
+	int side = (int)ceil(sqrt((double)objects));
+	vector<Object3D*> list;
+	list.reserve(objects);
+	for (int i = 0; i < objects; i++) {
+		Object3D* obj = new Object3D(make_vector((float)(i % side) * 2.0f, 0.0f, -(float)(i / side) * 2.0f, 1.0f));
+		obj->mesh = MeshLibrary::acquireProcedural("#mdi_cube_" + std::to_string(i), buildCube);
+		obj->updateProgram();
+		render->putObject(obj);
+		list.push_back(obj);
+	}
+
+	bool savedCulling = render->frustumCulling, savedMultiDraw = render->multiDrawIndirect;
+	render->frustumCulling = false; // Todos los objetos cuentan, esten o no en camara
+	render->updateSceneGraph();
+
+	render->multiDrawIndirect = false;
+	res.msPerFrameBatches = timeRenderFrames(false);
+	res.drawCallsBatches = render->drawCalls;
+
+	render->multiDrawIndirect = true;
+	res.msPerFrameMultiDraw = timeRenderFrames(false);
+	res.drawCallsMultiDraw = render->drawCalls;
+	res.batches = (unsigned int)render->batches.size();
+	res.groups = (unsigned int)render->drawGroups.size();
+	multiDrawResults.push_back(res);
+
+	render->frustumCulling = savedCulling;
+	render->multiDrawIndirect = savedMultiDraw;
+	removeObjects(list);
+}
+
+void RenderBenchmark::runProfiler(int objects)
+{
+	profilerResult_t res = {};
+	res.objects = objects;
+
+	vector<Object3D*> list = buildCubeGrid(objects);
+
+	// Un frame del bucle sin hilos: un tick, instantanea, dibujado y cierre del frame del perfilador
+	auto frame = [&]() {
+		render->updateScene(1.0 / render->simulationRate);
+		renderFrame(false);
+		Profiler::endFrame();
+	};
+
+	int savedInterval = Profiler::statsInterval;
+	Profiler::statsInterval = 0;
+	Profiler::setEnabled(false);
+	frame();
+	res.msFrameDisabled = timeFrames(frame, 1) / 1e6;
+
+	// Activado: zonas y contadores por frame salen de la ventana de estadisticas
+	Profiler::setEnabled(true);
+	frame();
+	Profiler::printStats();
+	uint64_t zonesBefore = Profiler::zonesRecorded();
+	res.msFrameEnabled = timeFrames(frame, 1) / 1e6;
+	double framesRun = (double)frames * repetitions;
+	double zonesPerFrame = (Profiler::zonesRecorded() - zonesBefore) / framesRun;
+	Profiler::printStats();
+	res.zones = Profiler::cpuStats();
+	for (auto& [name, s] : Profiler::gpuStats())
+		res.zones["GPU " + name] = s;
+	res.checksPerFrame = zonesPerFrame + 2 * Profiler::counterStats(COUNTER_DRAW_CALLS) + Profiler::counterStats(COUNTER_PROGRAM_SWITCHES)
+		+ Profiler::counterStats(COUNTER_UNIFORM_UPLOADS) + Profiler::counterStats(COUNTER_COLLISION_NODES);
+
+	// Una zona vacia, activado y desactivado
+	const int iterations = 1000000;
+	volatile int sink = 0;
+	auto timeZones = [&]() {
+		auto start = std::chrono::high_resolution_clock::now();
+		for (int i = 0; i < iterations; i++) {
+			PROFILE_SCOPE("bench");
+			sink = sink + 1;
+		}
+		auto end = std::chrono::high_resolution_clock::now();
+		return std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+	};
+	res.nsPerEnabledZone = timeZones();
+	Profiler::setEnabled(false);
+	res.nsPerDisabledCheck = timeZones();
+	res.disabledOverheadPct = res.checksPerFrame * res.nsPerDisabledCheck / (res.msFrameDisabled * 1e6) * 100.0;
+	profilerResults.push_back(res);
+
+	Profiler::statsInterval = savedInterval;
+	removeObjects(list);
+}
+
+void RenderBenchmark::runHeadless(int frames, string imageFile)
+{
+	headlessResult_t res = {};
+	res.frames = frames;
+	res.context = render->headless ? HeadlessContext::description() : "ventana";
+	res.renderer = (const char*)glGetString(GL_RENDERER);
+
+	// La escena entera desde el primer frame medido: lo pedido con loadObject se termina aqui
+	render->finishLoading();
+
+	// Un frame de calentamiento (compilacion perezosa del driver, primeras subidas) fuera de la medicion
+	render->updateSceneGraph();
+	render->runFrames(1);
+	vector<double> times = render->runFrames(frames);
+	if (!times.empty()) {
+		vector<double> sorted = times;
+		std::sort(sorted.begin(), sorted.end());
+		auto percentile = [&](double p) { return sorted[std::min(sorted.size() - 1, (size_t)(p * sorted.size()))]; };
+		double sum = 0;
+		for (double t : times) sum += t;
+		res.msMean = sum / times.size();
+		res.msMin = sorted.front();
+		res.msP50 = percentile(0.50);
+		res.msP95 = percentile(0.95);
+		res.msP99 = percentile(0.99);
+		res.msMax = sorted.back();
+	}
+	res.frameMs = times;
+	if (render->camera)
+		res.cameraPosition = render->camera->position;
+
+	// En pantalla el alfa no se ve: la imagen se guarda opaca
+	vector<uint8_t> pixels = render->readFramebuffer(res.width, res.height);
+	for (size_t i = 3; i < pixels.size(); i += 4)
+		pixels[i] = 255;
+	if (!imageFile.empty() && ImageWriter::writePNG(imageFile, res.width, res.height, pixels.data()))
+		res.image = imageFile;
+	headlessResults.push_back(res);
+}
+
+void RenderBenchmark::runLighting(int lights, int singleLimit)
+{
+	lightingResult_t res = {};
+	res.lights = lights;
+
+	// Suelo de 100x100 visto en diagonal desde arriba, con las luces repartidas justo encima
+	Camera camera({ 0, 12, 45, 1 }, { 0, 0, 0, 1 }, { 0, 1, 0, 1 }, 90.0f, 16.0f / 9.0f, 0.01f, 100.0f);
+	ScopedCamera scopedCamera(render, &camera);
+
+	Object3D* floor = new Object3D();
+	floor->loadFromFile("data/cubo.fiis");
+	floor->scale = { 100.0f, 0.1f, 100.0f, 0 };
+	floor->standartRotation = false;
+	floor->updateModelMatrix();
+	render->putObject(floor);
+
+	std::mt19937 rng(1);
+	std::uniform_real_distribution<float> position(-50.0f, 50.0f), height(0.5f, 2.0f), channel(0.2f, 1.0f);
+	vector<Light*> savedLights = render->lights;
+	vector<Light*> list;
+	for (int i = 0; i < lights; i++) {
+		Light* light = new Light(Light::POINT, { position(rng), height(rng), position(rng), 1 }, { channel(rng), channel(rng), channel(rng), 1 }, 1.0f);
+		light->radius = 3.0f;
+		list.push_back(light);
+	}
+	render->lights = list;
+	render->updateSceneGraph();
+
+	// Cada frame espera a la GPU: con muchas luces el coste esta en el fragment shader
+	bool savedClustered = render->clusteredLighting;
+	render->clusteredLighting = true;
+	res.msFrameClustered = timeRenderFrames(true);
+
+	LightClusters& clusters = render->lightClusters;
+	res.visibleLights = clusters.visibleLights;
+	res.lightClusterPairs = (unsigned int)clusters.indices.size();
+	res.maxLightsPerCluster = clusters.maxLightsPerCluster;
+	size_t usedClusters = 0;
+	for (size_t c = 0; c < clusters.clusterCount(); c++)
+		usedClusters += clusters.table[c * 2 + 1] > 0;
+	res.lightsPerCluster = usedClusters ? (double)clusters.indices.size() / usedClusters : 0.0;
+
+	// Solo el reparto, con las luces ya convertidas por el ultimo frame
+	res.msAssign = timeFrames([&]() {
+		clusters.assign(render->view.view, render->pointLightsTo.data(), nullptr, render->pointLightsTo.size());
+	}, 1) / 1e6;
+
+	if (lights <= singleLimit) {
+		render->clusteredLighting = false;
+		res.msFrameSingle = timeRenderFrames(true);
+	}
+	render->clusteredLighting = savedClustered;
+	lightingResults.push_back(res);
+
+	render->lights = savedLights;
+	for (Light* light : list) delete light;
+	render->removeObject(floor);
+	delete floor;
+}
+
+void RenderBenchmark::runTextures()
+{
+	vector<string> files;
+	std::error_code ec;
+	for (const auto& entry : std::filesystem::directory_iterator("data/textures", ec))
+		if (entry.path().extension() == ".png")
+			files.push_back(entry.path().generic_string());
+	std::sort(files.begin(), files.end());
+
+	for (const string& file : files) {
+		textureResult_t res = {};
+		res.file = file;
+
+		// Sin cache la primera carga lo hace todo y la deja escrita; la segunda lee la cache
+		std::filesystem::remove(Texture::cacheFileName(file), ec);
+		glFinish();
+		auto start = std::chrono::high_resolution_clock::now();
+		Texture* texture = new Texture(file);
+		glFinish();
+		auto middle = std::chrono::high_resolution_clock::now();
+		texture->loadFile(file);
+		auto loaded = std::chrono::high_resolution_clock::now();
+		res.fromCache = texture->fromCache;
+		texture->updateGPU();
+		glFinish();
+		auto end = std::chrono::high_resolution_clock::now();
+
+		res.coldMs = std::chrono::duration<double, std::milli>(middle - start).count();
+		res.warmMs = std::chrono::duration<double, std::milli>(loaded - middle).count();
+		res.uploadMs = std::chrono::duration<double, std::milli>(end - loaded).count();
+		res.width = texture->w;
+		res.height = texture->h;
+		res.format = texture->format;
+		res.levels = texture->mipLevels;
+		res.bytesBaseline = (size_t)texture->w * texture->h * 4;
+		res.bytesGPU = texture->gpuBytes;
+
+		// Calidad: el nivel 0 tal como lo descomprime la GPU frente al fichero
+		int w = 0, h = 0, channels = 4;
+		unsigned char* source = stbi_load(file.c_str(), &w, &h, &channels, 4);
+		if (source && w == texture->w && h == texture->h) {
+			vector<uint8_t> decoded((size_t)w * h * 4);
+			glBindTexture(GL_TEXTURE_2D, texture->textureID);
+			glPixelStorei(GL_PACK_ALIGNMENT, 1);
+			glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, decoded.data());
+			double squared = 0;
+			for (size_t i = 0; i < (size_t)w * h; i++)
+				for (int c = 0; c < 3; c++) {
+					double d = (double)decoded[i * 4 + c] - source[i * 4 + c];
+					squared += d * d;
+				}
+			double mse = squared / (3.0 * w * h);
+			res.psnr = mse > 0 ? 10.0 * log10(255.0 * 255.0 / mse) : 100.0;
+		}
+		if (source) stbi_image_free(source);
+
+		delete texture;
+		textureResults.push_back(res);
+	}
+}
+
+void RenderBenchmark::runTextureSampling(int objects)
+{
+	textureSamplingResult_t res = {};
+	res.objects = objects;
+
+	// Camara baja mirando a lo largo de la rejilla: las filas del fondo ocupan muy pocos pixeles
+	Camera camera({ 0, 3, 4, 1 }, { 0, 0, -20, 1 }, { 0, 1, 0, 1 }, 90.0f, 16.0f / 9.0f, 0.01f, 100.0f);
+	ScopedCamera scopedCamera(render, &camera);
+	vector<Object3D*> list = buildCubeGrid(objects, 2.0f, true);
+
+	// La textura del cubo cargada como antes (un nivel RGBA8) y con las opciones actuales
+	Texture* original = list.empty() ? nullptr : list[0]->material.texture;
+	string file = original ? original->fileName : "data/textures/texture.png";
+	textureFormat_e savedCompression = Texture::compression;
+	bool savedMipmaps = Texture::mipmaps, savedCache = Texture::useCache;
+	Texture::compression = TEXTURE_RGBA8;
+	Texture::mipmaps = false;
+	Texture::useCache = false;
+	Texture* baseline = new Texture(file);
+	Texture::compression = savedCompression;
+	Texture::mipmaps = savedMipmaps;
+	Texture::useCache = savedCache;
+	Texture* compressed = new Texture(file);
+	float savedAnisotropy = Texture::anisotropy;
+	Texture::anisotropy = 1.0f;
+	Texture* trilinear = new Texture(file);
+	Texture::anisotropy = savedAnisotropy;
+	res.bytesBaseline = baseline->gpuBytes;
+	res.bytesCompressed = compressed->gpuBytes;
+
+	// Cada frame espera a la GPU: la diferencia esta en leer las texturas
+	auto useTexture = [&](Texture* texture) {
+		for (Object3D* obj : list)
+			obj->material.texture = texture;
+	};
+
+	render->updateSceneGraph();
+	useTexture(baseline);
+	res.msFrameBaseline = timeRenderFrames(true);
+	useTexture(trilinear);
+	res.msFrameTrilinear = timeRenderFrames(true);
+	useTexture(compressed);
+	res.msFrameCompressed = timeRenderFrames(true);
+	textureSamplingResults.push_back(res);
+
+	removeObjects(list);
+	delete baseline;
+	delete trilinear;
+	delete compressed;
+}
+
+void RenderBenchmark::runStreaming(int copies)
+{
+	Camera camera({ 0, 20, 40, 1 }, { 0, 0, 0, 1 }, { 0, 1, 0, 1 }, 90.0f, 16.0f / 9.0f, 0.01f, 100.0f);
+	ScopedCamera scopedCamera(render, &camera);
+
+	// Las mallas de data/ con textura (la de spaceShip.fiis no existe y triangulos.fiis no se puede leer)
+	const vector<string> sources = { "data/cubo.fiis", "data/floor.fiis", "data/icosfera.fiis", "data/sun.fiis" };
+
+	// Calentamiento: caches .ptex escritas y programa compilado, igual para los dos modos
+	size_t bytesPerCopy = 0;
+	std::error_code ec;
+	for (const string& source : sources) {
+		Object3D* warm = new Object3D();
+		warm->loadFromFile(source);
+		bytesPerCopy += std::filesystem::file_size(source, ec);
+		if (warm->mesh && warm->mesh->texture) {
+			const string& texture = warm->mesh->texture->fileName;
+			bytesPerCopy += std::filesystem::file_size(texture, ec) + std::filesystem::file_size(Texture::cacheFileName(texture), ec);
+		}
+		delete warm;
+	}
+
+	// Cada copia es un fichero distinto: MeshLibrary no reutiliza nada y cada una lee su textura
+	std::filesystem::path dir = std::filesystem::temp_directory_path(ec) / "prgr_streaming";
+	std::filesystem::create_directories(dir, ec);
+	int side = (int)ceil(sqrt((double)copies * sources.size()));
+	for (bool async : { false, true }) {
+		streamingResult_t res = {};
+		res.async = async;
+		res.objects = copies * (int)sources.size();
+		res.assetBytes = bytesPerCopy * copies;
+
+		vector<string> files;
+		for (int c = 0; c < copies; c++)
+			for (const string& source : sources) {
+				std::filesystem::path copy = dir / ((async ? "async_" : "sync_") + to_string(c) + "_" + std::filesystem::path(source).filename().string());
+				std::filesystem::copy_file(source, copy, std::filesystem::copy_options::overwrite_existing, ec);
+				files.push_back(copy.generic_string());
+			}
+
+		size_t objectsBefore = render->objectList.size();
+		render->assetLoader.maxUpdateMs = 0.0;
+		vector<Object3D*> list;
+		auto start = std::chrono::high_resolution_clock::now();
+		auto elapsed = [&]() { return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count(); };
+		for (size_t i = 0; i < files.size(); i++) {
+			Object3D* obj = new Object3D();
+			obj->position = { (float)((int)i % side - side / 2) * 3.0f, 0.0f, -(float)((int)i / side) * 3.0f, 1.0f };
+			obj->updateModelMatrix();
+			if (async)
+				render->loadObject(obj, files[i]);
+			else {
+				obj->loadFromFile(files[i]);
+				render->putObject(obj);
+			}
+			list.push_back(obj);
+		}
+
+		// Frames hasta que esten todos en la escena; cada uno espera a la GPU. El frame se mide desde
+		// el final del anterior (el primero desde los pedidos): es lo que se veria congelado en pantalla
+		double frameEnd = 0.0;
+		do {
+			render->runFrames(1);
+			res.msFrameMax = std::max(res.msFrameMax, elapsed() - frameEnd);
+			frameEnd = elapsed();
+			if (res.framesLoading++ == 0)
+				res.msFirstFrame = frameEnd;
+		} while (render->objectList.size() < objectsBefore + files.size());
+		res.msAllLoaded = frameEnd;
+		res.msFrameLoaded = render->runFrames(1)[0];
+		res.threads = async ? render->assetLoader.threadCount() : 0;
+		res.msUpdateMax = async ? render->assetLoader.maxUpdateMs : 0.0;
+		streamingResults.push_back(res);
+		removeObjects(list);
+	}
+	std::filesystem::remove_all(dir, ec);
+}
+
+void RenderBenchmark::runTextureArrays(int objects, int layerSize)
+{
+	Camera camera({ 0, 60, 0, 1 }, { 0, 0, -30, 1 }, { 0, 1, 0, 1 }, 90.0f, 16.0f / 9.0f, 0.01f, 200.0f);
+	ScopedCamera scopedCamera(render, &camera);
+
+	vector<string> files;
+	std::error_code ec;
+	for (const auto& entry : std::filesystem::directory_iterator("data/textures", ec))
+		if (entry.path().extension() == ".png")
+			files.push_back(entry.path().generic_string());
+	std::sort(files.begin(), files.end());
+
+	bool savedArrays = Texture::useArrays, savedCache = Texture::useCache;
+	int savedLayerSize = Texture::layerSize;
+	bool savedCulling = render->frustumCulling, savedMultiDraw = render->multiDrawIndirect;
+	render->frustumCulling = false; // Todos los objetos cuentan, esten o no en camara
+
+	// Cada modo lee su propia copia de cubo.fiis: la textura de la malla decide el programa (TEXTURE_ARRAY o no)
+	std::filesystem::path dir = std::filesystem::temp_directory_path(ec) / "prgr_texarrays";
+	std::filesystem::create_directories(dir, ec);
+	const struct { bool arrays; int layerSize; } modes[] = { { false, 0 }, { true, 0 }, { true, layerSize } };
+	int side = (int)ceil(sqrt((double)objects));
+	for (int m = 0; m < 3; m++) {
+		textureArrayResult_t res = {};
+		res.mode = !modes[m].arrays ? "texturas" : modes[m].layerSize > 0 ? "arrays " + to_string(modes[m].layerSize) : "arrays";
+		res.objects = objects;
+		res.textures = (int)files.size();
+
+		// La cache .ptex guarda un solo tamano: las reescaladas no sustituyen a las de la escena
+		Texture::useArrays = modes[m].arrays;
+		Texture::layerSize = modes[m].layerSize;
+		Texture::useCache = modes[m].layerSize == 0;
+
+		std::filesystem::path cube = dir / ("cubo_" + to_string(m) + ".fiis");
+		std::filesystem::copy_file("data/cubo.fiis", cube, std::filesystem::copy_options::overwrite_existing, ec);
+		vector<Texture*> textures;
+		for (const string& file : files)
+			textures.push_back(new Texture(file));
+
+		// La misma malla en todos; las texturas alternan de un objeto al siguiente
+		vector<Object3D*> list;
+		vector<const void*> bindings;
+		for (int i = 0; i < objects; i++) {
+			Object3D* obj = new Object3D(make_vector((float)(i % side - side / 2) * 2.0f, 0.0f, -(float)(i / side) * 2.0f, 1.0f));
+			obj->loadFromFile(cube.generic_string());
+			obj->material.texture = textures[i % textures.size()];
+			render->putObject(obj);
+			list.push_back(obj);
+		}
+		for (Texture* texture : textures) {
+			if (std::find(bindings.begin(), bindings.end(), texture->binding()) != bindings.end()) continue;
+			bindings.push_back(texture->binding());
+			res.textureBytes += texture->array ? texture->array->gpuBytes : texture->gpuBytes;
+		}
+		res.bindings = (unsigned int)bindings.size();
+
+		// Cada frame espera a la GPU
+		render->updateSceneGraph();
+		render->multiDrawIndirect = false;
+		res.msFrameBatches = timeRenderFrames(true);
+		res.drawCallsBatches = render->drawCalls;
+		res.textureBindsBatches = render->textureBinds;
+		render->multiDrawIndirect = true;
+		res.msFrameMultiDraw = timeRenderFrames(true);
+		res.drawCallsMultiDraw = render->drawCalls;
+		res.textureBindsMultiDraw = render->textureBinds;
+		res.batches = (unsigned int)render->batches.size();
+		res.groups = (unsigned int)render->drawGroups.size();
+		textureArrayResults.push_back(res);
+
+		removeObjects(list);
+		for (Texture* texture : textures)
+			delete texture;
+	}
+
+	std::filesystem::remove_all(dir, ec);
+	Texture::useArrays = savedArrays;
+	Texture::layerSize = savedLayerSize;
+	Texture::useCache = savedCache;
+	render->frustumCulling = savedCulling;
+	render->multiDrawIndirect = savedMultiDraw;
+}
+
+// Consultas GL_FRAGMENT_SHADER_INVOCATIONS: GL 4.6 o GL_ARB_pipeline_statistics_query
+static bool hasPipelineStatistics()
+{
+	return GLAD_GL_VERSION_4_6 || HeadlessContext::hasExtension("GL_ARB_pipeline_statistics_query");
+}
+
+void RenderBenchmark::runDepthPrepass(int objects)
+{
+	// Camara baja mirando a lo largo de la rejilla: cada cubo tapa parte de los de las filas de detras
+	Camera camera({ 0, 1.5f, 4, 1 }, { 0, 0, -20, 1 }, { 0, 1, 0, 1 }, 90.0f, 16.0f / 9.0f, 0.01f, 100.0f);
+	ScopedCamera scopedCamera(render, &camera);
+
+	// Las casillas en desorden: sin ordenar, los cubos llegan con cualquier profundidad
+	vector<Object3D*> list = buildCubeGrid(objects, 2.0f, true, true);
+
+	bool savedSort = render->sortFrontToBack, savedPrepass = render->depthPrepass;
+	bool statistics = hasPipelineStatistics();
+	unsigned int queries[2];
+	glGenQueries(2, queries);
+
+	const struct { const char* mode; bool alphaTest, sort, prepass; } modes[] = {
+		{ "alpha test", true, false, false }, { "opacos", false, false, false },
+		{ "opacos + orden", false, true, false }, { "opacos + orden + prepass", false, true, true } };
+	// Los objetos se clasifican una vez: solo los de textura con transparencias necesitan alpha test.
+	// Con alpha test en todos es el shader de antes (discard en todos los fragmentos posibles); los
+	// modos opacos comparten programas y solo cambian el orden y el prepass
+	vector<bool> transparent;
+	transparent.reserve(list.size());
+	for (Object3D* obj : list)
+		transparent.push_back(obj->material.texture && !obj->material.texture->opaque);
+	bool allAlphaTested = false;
+	auto setAlphaTest = [&](bool all) {
+		for (size_t i = 0; i < list.size(); i++) {
+			list[i]->alphaTested = all || transparent[i];
+			list[i]->updateProgram();
+		}
+		render->drawListDirty = true;
+		allAlphaTested = all;
+	};
+	setAlphaTest(modes[0].alphaTest);
+
+	vector<uint8_t> reference;
+	render->updateSceneGraph();
+	for (const auto& m : modes) {
+		depthPrepassResult_t res = {};
+		res.mode = m.mode;
+		res.objects = objects;
+
+		if (m.alphaTest != allAlphaTested)
+			setAlphaTest(m.alphaTest);
+		render->sortFrontToBack = m.sort;
+		render->depthPrepass = m.prepass;
+
+		// Cada frame espera a la GPU
+		res.msFrame = timeRenderFrames(true);
+		res.drawCalls = render->drawCalls;
+
+		// Un frame mas con las consultas solo alrededor del dibujado
+		render->prepareFrame();
+		render->clearFrame();
+		glBeginQuery(GL_SAMPLES_PASSED, queries[0]);
+		if (statistics)
+			glBeginQuery(GL_FRAGMENT_SHADER_INVOCATIONS, queries[1]);
+		render->drawBatches();
+		glEndQuery(GL_SAMPLES_PASSED);
+		GLuint64 count = 0;
+		glGetQueryObjectui64v(queries[0], GL_QUERY_RESULT, &count);
+		res.samplesPassed = (int64_t)count;
+		res.fragmentInvocations = -1;
+		if (statistics) {
+			glEndQuery(GL_FRAGMENT_SHADER_INVOCATIONS);
+			glGetQueryObjectui64v(queries[1], GL_QUERY_RESULT, &count);
+			res.fragmentInvocations = (int64_t)count;
+		}
+
+		// Los cuatro modos tienen que dar la misma imagen
+		int w, h;
+		vector<uint8_t> pixels = render->readFramebuffer(w, h);
+		if (reference.empty())
+			reference = pixels;
+		for (size_t i = 0; i < pixels.size() && i < reference.size(); i++)
+			res.maxDiff = std::max(res.maxDiff, abs((int)pixels[i] - (int)reference[i]));
+		depthPrepassResults.push_back(res);
+	}
+
+	glDeleteQueries(2, queries);
+	removeObjects(list);
+	render->sortFrontToBack = savedSort;
+	render->depthPrepass = savedPrepass;
+}
+
+void RenderBenchmark::runCulling(int objects)
+{
+	cullingResult_t res = {};
+	res.objects = objects;
+
+	// Camara como la de la escena principal, mirando a -z desde el centro del plano
+	Camera camera({ 0, 1.8f, 0, 1 }, { 0, 1.8f, -1, 1 }, { 0, 1, 0, 1 }, 90.0f, 16.0f / 9.0f, 0.01f, 100.0f);
+	ScopedCamera scopedCamera(render, &camera);
+
+	// Rejilla de 4 unidades: el plano mide unos 900x900 y la camara ve hasta 100
+	int side = (int)ceil(sqrt((double)objects));
+	float half = side * 2.0f;
+	vector<Object3D*> list;
+	list.reserve(objects);
+	for (int i = 0; i < objects; i++) {
+		Object3D* obj = new Object3D();
+		obj->loadFromFile("data/cubo.fiis");
+		obj->position = { (float)(i % side) * 4.0f - half, 0.0f, (float)(i / side) * 4.0f - half, 1.0f };
+		obj->updateModelMatrix();
+		render->putObject(obj);
+		list.push_back(obj);
+	}
+
+	render->updateSceneGraph();
+	render->prepareFrame();
+	render->drawBatches();
+	res.visible = render->visibleObjects;
+
+	// Solo el test de volumenes, con el SoA ya relleno por prepareFrame
+	vector<unsigned char> visible;
+	res.msCullScalar = timeFrames([&]() {
+		render->culler.cullScalar(render->view.frustumPlanes, visible);
+	}, 1) / 1e6;
+	res.msCullSSE = timeFrames([&]() {
+		render->culler.cull(render->view.frustumPlanes, visible);
+	}, 1) / 1e6;
+	render->bvh.build(render->culler);
+	res.msCullBVH = timeFrames([&]() {
+		render->bvh.refit(render->culler);
+		render->bvh.cull(render->culler, render->view.frustumPlanes, visible);
+	}, 1) / 1e6;
+	res.bvhNodesVisited = render->bvh.nodesVisited;
+
+	// Frame completo de CPU con cada modo
+	bool savedCulling = render->frustumCulling;
+	bool savedBVH = render->cullingBVH;
+	render->frustumCulling = false;
+	res.msFrameNoCulling = timeRenderFrames(false);
+	render->frustumCulling = true;
+	render->cullingBVH = false;
+	res.msFrameCulling = timeRenderFrames(false);
+	render->cullingBVH = true;
+	res.msFrameBVH = timeRenderFrames(false);
+	render->frustumCulling = savedCulling;
+	render->cullingBVH = savedBVH;
+
+	cullingResults.push_back(res);
+	removeObjects(list);
+}
+
+void RenderBenchmark::runLOD(int objects)
+{
+	Camera camera({ 0, 0, 0, 1 }, { 0, 0, -1, 1 }, { 0, 1, 0, 1 }, 60.0f, 16.0f / 9.0f, 0.01f, 500.0f);
+	ScopedCamera scopedCamera(render, &camera);
+
+	vector<Object3D*> list;
+	list.reserve(objects);
+	for (int i = 0; i < objects; i++) {
+		Object3D* obj = new Object3D();
+		obj->loadFromFile("data/icosfera.fiis");
+		render->putObject(obj);
+		list.push_back(obj);
+	}
+
+	// Rejilla delante de la camara con separacion proporcional a la distancia: siempre entra entera
+	int side = (int)ceil(sqrt((double)objects));
+	float distances[] = { 4.0f, 8.0f, 16.0f, 32.0f, 64.0f, 128.0f };
+	bool savedLOD = render->meshLOD;
+	for (float d : distances) {
+		float spacing = d * 0.02f;
+		for (int i = 0; i < objects; i++) {
+			Object3D* obj = list[i];
+			obj->position = { (i % side - side * 0.5f) * spacing, (i / side - side * 0.5f) * spacing, -d, 1.0f };
+			obj->updateModelMatrix();
+			render->sceneGraph.setLocalMatrix(obj->sceneNode, obj->localMatrix);
+		}
+		render->updateSceneGraph();
+
+		lodResult_t res = {};
+		res.distance = d;
+		res.objects = objects;
+
+		render->meshLOD = false;
+		res.msFrameFull = timeRenderFrames(false);
+		res.trianglesFull = render->renderedTriangles;
+
+		// Varios frames para que la histeresis se asiente partiendo del LOD anterior
+		render->meshLOD = true;
+		for (int f = 0; f < 4; f++)
+			renderFrame(false);
+		res.msFrameLOD = timeRenderFrames(false);
+		res.trianglesLOD = render->renderedTriangles;
+
+		float radiusPixels = list[0]->mesh->boundsRadius * render->view.pixelScale / d;
+		res.pixelsPerObject = 3.14159265 * radiusPixels * radiusPixels;
+		lodResults.push_back(res);
+	}
+	render->meshLOD = savedLOD;
+	removeObjects(list);
+}
+
+void RenderBenchmark::runVertexFormats(int side, int copies)
+{
+	// triangulos.fiis no tiene normales ni texturas y Mesh::loadFromFile no la puede leer
+	const char* samples[] = { "data/cubo.fiis", "data/floor.fiis", "data/icosfera.fiis",
+		"data/spaceShip.fiis", "data/sun.fiis" };
+	vector<Mesh*> sampleMeshes;
+	for (const char* file : samples) {
+		Mesh* mesh = new Mesh();
+		if (mesh->loadFromFile(file))
+			sampleMeshes.push_back(mesh);
+		else
+			delete mesh;
+	}
+
+	// Esfera UV con coordenadas de textura y colores variados
+	vector<vertex_t> sphere;
+	vector<int> sphereIds;
+	for (int r = 0; r <= side; r++) {
+		for (int s = 0; s <= side; s++) {
+			float theta = 3.14159265f * r / side, phi = 6.2831853f * s / side;
+			vertex_t v;
+			v.vNormal = { sinf(theta) * cosf(phi), cosf(theta), sinf(theta) * sinf(phi), 0 };
+			v.vPos = { v.vNormal.x, v.vNormal.y, v.vNormal.z, 1 };
+			v.vColor = { (float)s / side, (float)r / side, 0.5f, 1 };
+			v.vTextureCoord = { (float)s / side, (float)r / side, 0, 0 };
+			sphere.push_back(v);
+		}
+	}
+	for (int r = 0; r < side; r++) {
+		for (int s = 0; s < side; s++) {
+			int a = r * (side + 1) + s, b = a + side + 1;
+			sphereIds.insert(sphereIds.end(), { a, b, a + 1, a + 1, b, b + 1 });
+		}
+	}
+
+	bool savedCulling = render->frustumCulling, savedLOD = render->meshLOD;
+	render->frustumCulling = false;
+	render->meshLOD = false;
+	GLuint query;
+	glGenQueries(1, &query);
+
+	const VertexLayout* layouts[] = { &VertexLayout::full(), &VertexLayout::packed(), &VertexLayout::packedOctahedral() };
+	for (const VertexLayout* layout : layouts) {
+		vertexFormatResult_t res = {};
+		res.layout = layout->name;
+		res.stride = layout->stride;
+
+		// Precision: cada vertice empaquetado y vuelto a vertex_t
+		auto measure = [&](const vector<vertex_t>& vertices) {
+			vector<unsigned char> packed;
+			layout->pack(vertices, packed);
+			for (size_t i = 0; i < vertices.size(); i++) {
+				vertex_t v = layout->unpack(packed.data() + i * layout->stride);
+				const vertex_t& o = vertices[i];
+				float lo = length(o.vNormal), lv = length(v.vNormal);
+				if (lo > 0.0f && lv > 0.0f) {
+					float c = std::clamp((v.vNormal * o.vNormal) / (lo * lv), -1.0f, 1.0f);
+					res.maxNormalErrorDeg = std::max(res.maxNormalErrorDeg, (float)(acos(c) * 180.0 / 3.14159265));
+				}
+				res.maxUVError = std::max({ res.maxUVError, fabsf(v.vTextureCoord.x - o.vTextureCoord.x), fabsf(v.vTextureCoord.y - o.vTextureCoord.y) });
+			}
+			return packed.size();
+		};
+		for (Mesh* mesh : sampleMeshes)
+			res.sampleBytes += measure(mesh->vertexList);
+		res.largeBytes = measure(sphere);
+		res.largeVertices = sphere.size();
+
+		// Malla en GPU con este formato (sin LOD: solo se mide la lectura de vertices). Fuera de MeshLibrary,
+		// pero con una referencia por objeto: la suelta el ultimo que se borra
+		Mesh* mesh = new Mesh();
+		mesh->fileName = "#vertex_" + layout->name;
+		mesh->vertexList = sphere;
+		mesh->idList = sphereIds;
+		mesh->lods.push_back({ 0, (unsigned int)sphereIds.size(), 0.0f });
+		mesh->layout = layout;
+		mesh->pack();
+		mesh->upload();
+		mesh->refCount = copies;
+
+		vector<Object3D*> objects;
+		for (int i = 0; i < copies; i++) {
+			Object3D* obj = new Object3D(make_vector((float)i * 2.5f, 0.0f, -5.0f, 1.0f));
+			obj->mesh = mesh;
+			obj->updateProgram();
+			render->putObject(obj);
+			objects.push_back(obj);
+		}
+		render->updateSceneGraph();
+		render->prepareFrame();
+
+		// Solo la etapa de vertices: sin rasterizar, el tiempo lo marca la lectura de atributos
+		glEnable(GL_RASTERIZER_DISCARD);
+		double best = 1e30;
+		for (int r = 0; r < repetitions; r++) {
+			glFinish();
+			glBeginQuery(GL_TIME_ELAPSED, query);
+			for (int f = 0; f < frames; f++)
+				render->drawBatches();
+			glEndQuery(GL_TIME_ELAPSED);
+			GLuint64 ns = 0;
+			glGetQueryObjectui64v(query, GL_QUERY_RESULT, &ns);
+			best = std::min(best, (double)ns / frames / 1e6);
+		}
+		glDisable(GL_RASTERIZER_DISCARD);
+		res.gpuMsPerFrame = best;
+		res.fetchGBs = best > 0.0 ? (double)res.largeBytes * copies / (best * 1e6) : 0.0;
+		vertexResults.push_back(res);
+
+		for (Object3D* obj : objects) {
+			render->removeObject(obj);
+			delete obj;
+		}
+	}
+
+	glDeleteQueries(1, &query);
+	render->frustumCulling = savedCulling;
+	render->meshLOD = savedLOD;
+	for (Mesh* mesh : sampleMeshes)
+		delete mesh;
+}
+
+void RenderBenchmark::runMeshOptimizer(int side)
+{
+	// triangulos.fiis no tiene normales ni texturas y Mesh::loadFromFile no la puede leer
+	const char* samples[] = { "data/cubo.fiis", "data/floor.fiis", "data/icosfera.fiis",
+		"data/spaceShip.fiis", "data/sun.fiis" };
+	vector<Mesh*> meshes;
+	for (const char* file : samples) {
+		Mesh* mesh = new Mesh();
+		if (mesh->loadFromFile(file))
+			meshes.push_back(mesh);
+		else
+			delete mesh;
+	}
+
+	// Esfera como la exportaria una herramienta sin indexar: tres vertices propios por triangulo
+	// y los triangulos en orden aleatorio
+	Mesh* sphere = new Mesh();
+	sphere->fileName = "esfera_" + std::to_string(side);
+	auto point = [side](int r, int s) {
+		float theta = 3.14159265f * r / side, phi = 6.2831853f * s / side;
+		vertex_t v;
+		v.vNormal = { sinf(theta) * cosf(phi), cosf(theta), sinf(theta) * sinf(phi), 0 };
+		v.vPos = { v.vNormal.x, v.vNormal.y, v.vNormal.z, 1 };
+		v.vColor = { 1, 1, 1, 1 };
+		v.vTextureCoord = { (float)s / side, (float)r / side, 0, 0 };
+		return v;
+	};
+	vector<int> order(side * side * 2);
+	for (size_t t = 0; t < order.size(); t++)
+		order[t] = (int)t;
+	std::shuffle(order.begin(), order.end(), std::mt19937(1));
+	for (int t : order) {
+		int r = t / 2 / side, s = t / 2 % side;
+		vertex_t quad[2][3] = {
+			{ point(r, s), point(r + 1, s), point(r, s + 1) },
+			{ point(r, s + 1), point(r + 1, s), point(r + 1, s + 1) } };
+		for (const vertex_t& v : quad[t & 1]) {
+			sphere->idList.push_back((int)sphere->vertexList.size());
+			sphere->vertexList.push_back(v);
+		}
+	}
+	meshes.push_back(sphere);
+
+	unsigned int stride = MeshLibrary::vertexLayout->stride;
+	for (Mesh* mesh : meshes) {
+		meshOptResult_t res = {};
+		res.mesh = mesh->fileName;
+		res.before = MeshOptimizer::analyze(mesh->vertexList, mesh->idList.data(), mesh->idList.size(), stride, 4);
+
+		// Lo mismo que hace MeshLibrary al cargar
+		auto t0 = std::chrono::high_resolution_clock::now();
+		mesh->weldVertices();
+		mesh->buildLods();
+		mesh->optimize();
+		auto t1 = std::chrono::high_resolution_clock::now();
+		res.optimizeMs = std::chrono::duration<double, std::milli>(t1 - t0).count();
+
+		// Nivel 0, con el tamano de indice que elegira upload
+		res.after = MeshOptimizer::analyze(mesh->vertexList, mesh->idList.data(), mesh->idList.size(), stride,
+			mesh->vertexList.size() <= 65536 ? 2 : 4);
+		meshOptResults.push_back(res);
+		delete mesh;
+	}
+}
+
+bool RenderBenchmark::writeJSON(string fileName) const
+{
+	ofstream f(fileName);
+	if (!f.is_open()) {
+		cout << "ERROR: " << __FILE__ << ":" << __LINE__ << " (" << __func__ << ") No se pudo crear " << fileName << endl;
+		return false;
+	}
+
+	f << "{\n";
+	f << "  \"frames\": " << frames << ",\n";
+	f << "  \"objects_per_frame\": " << objectsPerFrame << ",\n";
+	f << "  \"repetitions\": " << repetitions << ",\n";
+	f << "  \"uniforms\": [\n";
+	for (size_t i = 0; i < uniformResults.size(); i++) {
+		const uniformResult_t& r = uniformResults[i];
+		f << "    { \"lights\": " << r.numLights << ", \"moving\": " << (r.movingLights ? "true" : "false")
+			<< std::fixed << std::setprecision(2)
+			<< ", \"ns_per_draw_strings\": " << r.nsPerDrawStrings
+			<< ", \"ns_per_draw_blocks\": " << r.nsPerDrawBlocks
+			<< ", \"calls_per_draw_strings\": " << r.callsPerDrawStrings
+			<< ", \"calls_per_draw_blocks\": " << r.callsPerDrawBlocks << " }"
+			<< (i + 1 < uniformResults.size() ? "," : "") << "\n";
+	}
+	f << "  ],\n";
+	f << "  \"programs\": [\n";
+	for (size_t i = 0; i < programResults.size(); i++) {
+		const programResult_t& r = programResults[i];
+		f << "    { \"defines\": \"" << r.defines << "\"" << std::fixed << std::setprecision(3)
+			<< ", \"cold_ms\": " << r.coldMs << ", \"warm_ms\": " << r.warmMs
+			<< ", \"from_cache\": " << (r.fromCache ? "true" : "false") << " }"
+			<< (i + 1 < programResults.size() ? "," : "") << "\n";
+	}
+	f << "  ],\n";
+	f << "  \"instancing\": [\n";
+	for (size_t i = 0; i < instancingResults.size(); i++) {
+		const instancingResult_t& r = instancingResults[i];
+		f << "    { \"objects\": " << r.objects << ", \"meshes_loaded\": " << r.meshesLoaded
+			<< std::fixed << std::setprecision(3)
+			<< ", \"load_ms\": " << r.loadMs
+			<< ", \"ms_per_frame_instanced\": " << r.msPerFrameInstanced
+			<< ", \"ms_per_frame_objects\": " << r.msPerFrameObjects
+			<< ", \"draw_calls_instanced\": " << r.drawCallsInstanced
+			<< ", \"draw_calls_objects\": " << r.drawCallsObjects << " }"
+			<< (i + 1 < instancingResults.size() ? "," : "") << "\n";
+	}
+	f << "  ],\n";
+	f << "  \"culling\": [\n";
+	for (size_t i = 0; i < cullingResults.size(); i++) {
+		const cullingResult_t& r = cullingResults[i];
+		f << "    { \"objects\": " << r.objects << ", \"visible\": " << r.visible
+			<< ", \"bvh_nodes_visited\": " << r.bvhNodesVisited
+			<< std::fixed << std::setprecision(3)
+			<< ", \"ms_cull_scalar\": " << r.msCullScalar
+			<< ", \"ms_cull_sse\": " << r.msCullSSE
+			<< ", \"ms_cull_bvh\": " << r.msCullBVH
+			<< ", \"ms_frame_no_culling\": " << r.msFrameNoCulling
+			<< ", \"ms_frame_culling\": " << r.msFrameCulling
+			<< ", \"ms_frame_bvh\": " << r.msFrameBVH << " }"
+			<< (i + 1 < cullingResults.size() ? "," : "") << "\n";
+	}
+	f << "  ],\n";
+	f << "  \"lod\": [\n";
+	for (size_t i = 0; i < lodResults.size(); i++) {
+		const lodResult_t& r = lodResults[i];
+		f << "    { \"distance\": " << r.distance << ", \"objects\": " << r.objects
+			<< ", \"triangles_full\": " << r.trianglesFull << ", \"triangles_lod\": " << r.trianglesLOD
+			<< std::fixed << std::setprecision(3)
+			<< ", \"pixels_per_object\": " << r.pixelsPerObject
+			<< ", \"ms_frame_full\": " << r.msFrameFull
+			<< ", \"ms_frame_lod\": " << r.msFrameLOD << " }" << std::defaultfloat
+			<< (i + 1 < lodResults.size() ? "," : "") << "\n";
+	}
+	f << "  ],\n";
+	f << "  \"vertex_formats\": [\n";
+	for (size_t i = 0; i < vertexResults.size(); i++) {
+		const vertexFormatResult_t& r = vertexResults[i];
+		f << "    { \"layout\": \"" << r.layout << "\", \"stride\": " << r.stride
+			<< ", \"sample_bytes\": " << r.sampleBytes << ", \"large_bytes\": " << r.largeBytes
+			<< ", \"large_vertices\": " << r.largeVertices
+			<< std::fixed << std::setprecision(4)
+			<< ", \"max_normal_error_deg\": " << r.maxNormalErrorDeg
+			<< ", \"max_uv_error\": " << r.maxUVError
+			<< ", \"gpu_ms_per_frame\": " << r.gpuMsPerFrame
+			<< ", \"fetch_gb_s\": " << r.fetchGBs << " }" << std::defaultfloat
+			<< (i + 1 < vertexResults.size() ? "," : "") << "\n";
+	}
+	f << "  ],\n";
+	f << "  \"multi_draw\": [\n";
+	for (size_t i = 0; i < multiDrawResults.size(); i++) {
+		const multiDrawResult_t& r = multiDrawResults[i];
+		f << "    { \"objects\": " << r.objects << ", \"batches\": " << r.batches << ", \"groups\": " << r.groups
+			<< ", \"multi_draw_supported\": " << (r.multiDrawSupported ? "true" : "false")
+			<< ", \"draw_calls_batches\": " << r.drawCallsBatches << ", \"draw_calls_multi_draw\": " << r.drawCallsMultiDraw
+			<< std::fixed << std::setprecision(3)
+			<< ", \"ms_per_frame_batches\": " << r.msPerFrameBatches
+			<< ", \"ms_per_frame_multi_draw\": " << r.msPerFrameMultiDraw << " }" << std::defaultfloat
+			<< (i + 1 < multiDrawResults.size() ? "," : "") << "\n";
+	}
+	f << "  ],\n";
+	f << "  \"headless\": [\n";
+	for (size_t i = 0; i < headlessResults.size(); i++) {
+		const headlessResult_t& r = headlessResults[i];
+		f << "    { \"frames\": " << r.frames << ", \"width\": " << r.width << ", \"height\": " << r.height
+			<< ", \"context\": \"" << r.context << "\", \"renderer\": \"" << r.renderer << "\", \"image\": \"" << r.image << "\""
+			<< std::fixed << std::setprecision(3)
+			<< ", \"ms_mean\": " << r.msMean << ", \"ms_min\": " << r.msMin << ", \"ms_p50\": " << r.msP50
+			<< ", \"ms_p95\": " << r.msP95 << ", \"ms_p99\": " << r.msP99 << ", \"ms_max\": " << r.msMax
+			<< ", \"camera\": [" << r.cameraPosition.x << ", " << r.cameraPosition.y << ", " << r.cameraPosition.z << "], \"frame_ms\": [";
+		for (size_t j = 0; j < r.frameMs.size(); j++)
+			f << (j ? ", " : "") << r.frameMs[j];
+		f << "] }" << std::defaultfloat << (i + 1 < headlessResults.size() ? "," : "") << "\n";
+	}
+	f << "  ],\n";
+	f << "  \"profiler\": [\n";
+	for (size_t i = 0; i < profilerResults.size(); i++) {
+		const profilerResult_t& r = profilerResults[i];
+		f << "    { \"objects\": " << r.objects << std::fixed << std::setprecision(3)
+			<< ", \"ms_frame_disabled\": " << r.msFrameDisabled << ", \"ms_frame_enabled\": " << r.msFrameEnabled
+			<< ", \"checks_per_frame\": " << r.checksPerFrame
+			<< ", \"ns_per_disabled_check\": " << r.nsPerDisabledCheck << ", \"ns_per_enabled_zone\": " << r.nsPerEnabledZone
+			<< ", \"disabled_overhead_pct\": " << r.disabledOverheadPct << ", \"zones_ms_per_frame\": {";
+		size_t z = 0;
+		for (const auto& [name, s] : r.zones)
+			f << (z++ ? ", " : " ") << "\"" << name << "\": " << s.ms;
+		f << " } }" << std::defaultfloat << (i + 1 < profilerResults.size() ? "," : "") << "\n";
+	}
+	f << "  ],\n";
+	f << "  \"lighting\": [\n";
+	for (size_t i = 0; i < lightingResults.size(); i++) {
+		const lightingResult_t& r = lightingResults[i];
+		f << "    { \"lights\": " << r.lights << ", \"visible_lights\": " << r.visibleLights
+			<< ", \"light_cluster_pairs\": " << r.lightClusterPairs << ", \"max_lights_per_cluster\": " << r.maxLightsPerCluster
+			<< std::fixed << std::setprecision(3) << ", \"lights_per_cluster\": " << r.lightsPerCluster
+			<< ", \"ms_assign\": " << r.msAssign << ", \"ms_frame_clustered\": " << r.msFrameClustered
+			<< ", \"ms_frame_single\": ";
+		if (r.msFrameSingle > 0) f << r.msFrameSingle;
+		else f << "null";
+		f << " }" << std::defaultfloat
+			<< (i + 1 < lightingResults.size() ? "," : "") << "\n";
+	}
+	f << "  ],\n";
+	f << "  \"textures\": [\n";
+	for (size_t i = 0; i < textureResults.size(); i++) {
+		const textureResult_t& r = textureResults[i];
+		f << "    { \"file\": \"" << r.file << "\", \"width\": " << r.width << ", \"height\": " << r.height
+			<< ", \"format\": \"" << TextureEncoder::formatName(r.format) << "\", \"levels\": " << r.levels
+			<< ", \"bytes_baseline\": " << r.bytesBaseline << ", \"bytes_gpu\": " << r.bytesGPU
+			<< std::fixed << std::setprecision(3) << ", \"cold_ms\": " << r.coldMs << ", \"warm_ms\": " << r.warmMs
+			<< ", \"upload_ms\": " << r.uploadMs << ", \"from_cache\": " << (r.fromCache ? "true" : "false")
+			<< ", \"psnr\": " << r.psnr << " }" << std::defaultfloat
+			<< (i + 1 < textureResults.size() ? "," : "") << "\n";
+	}
+	f << "  ],\n";
+	f << "  \"texture_sampling\": [\n";
+	for (size_t i = 0; i < textureSamplingResults.size(); i++) {
+		const textureSamplingResult_t& r = textureSamplingResults[i];
+		f << "    { \"objects\": " << r.objects << ", \"bytes_baseline\": " << r.bytesBaseline
+			<< ", \"bytes_compressed\": " << r.bytesCompressed << std::fixed << std::setprecision(3)
+			<< ", \"ms_frame_baseline\": " << r.msFrameBaseline << ", \"ms_frame_trilinear\": " << r.msFrameTrilinear
+			<< ", \"ms_frame_compressed\": " << r.msFrameCompressed
+			<< " }" << std::defaultfloat << (i + 1 < textureSamplingResults.size() ? "," : "") << "\n";
+	}
+	f << "  ],\n";
+	f << "  \"streaming\": [\n";
+	for (size_t i = 0; i < streamingResults.size(); i++) {
+		const streamingResult_t& r = streamingResults[i];
+		f << "    { \"objects\": " << r.objects << ", \"async\": " << (r.async ? "true" : "false") << ", \"threads\": " << r.threads
+			<< ", \"asset_bytes\": " << r.assetBytes << std::fixed << std::setprecision(3)
+			<< ", \"ms_first_frame\": " << r.msFirstFrame << ", \"ms_all_loaded\": " << r.msAllLoaded
+			<< ", \"ms_frame_max\": " << r.msFrameMax << ", \"ms_frame_loaded\": " << r.msFrameLoaded
+			<< ", \"ms_update_max\": " << r.msUpdateMax << ", \"frames_loading\": " << r.framesLoading
+			<< " }" << std::defaultfloat << (i + 1 < streamingResults.size() ? "," : "") << "\n";
+	}
+	f << "  ],\n";
+	f << "  \"texture_arrays\": [\n";
+	for (size_t i = 0; i < textureArrayResults.size(); i++) {
+		const textureArrayResult_t& r = textureArrayResults[i];
+		f << "    { \"mode\": \"" << r.mode << "\", \"objects\": " << r.objects << ", \"textures\": " << r.textures
+			<< ", \"bindings\": " << r.bindings << ", \"texture_bytes\": " << r.textureBytes
+			<< ", \"batches\": " << r.batches << ", \"groups\": " << r.groups << std::fixed << std::setprecision(3)
+			<< ", \"ms_frame_batches\": " << r.msFrameBatches << ", \"ms_frame_multidraw\": " << r.msFrameMultiDraw
+			<< ", \"draw_calls_batches\": " << r.drawCallsBatches << ", \"draw_calls_multidraw\": " << r.drawCallsMultiDraw
+			<< ", \"texture_binds_batches\": " << r.textureBindsBatches << ", \"texture_binds_multidraw\": " << r.textureBindsMultiDraw
+			<< " }" << std::defaultfloat << (i + 1 < textureArrayResults.size() ? "," : "") << "\n";
+	}
+	f << "  ],\n";
+	f << "  \"depth_prepass\": [\n";
+	for (size_t i = 0; i < depthPrepassResults.size(); i++) {
+		const depthPrepassResult_t& r = depthPrepassResults[i];
+		f << "    { \"mode\": \"" << r.mode << "\", \"objects\": " << r.objects
+			<< ", \"fragment_invocations\": " << r.fragmentInvocations << ", \"samples_passed\": " << r.samplesPassed
+			<< std::fixed << std::setprecision(3)
+			<< ", \"ms_frame\": " << r.msFrame << ", \"draw_calls\": " << r.drawCalls << ", \"max_diff\": " << r.maxDiff
+			<< " }" << std::defaultfloat << (i + 1 < depthPrepassResults.size() ? "," : "") << "\n";
+	}
+	f << "  ],\n";
+	f << "  \"mesh_optimizer\": [\n";
+	for (size_t i = 0; i < meshOptResults.size(); i++) {
+		const meshOptResult_t& r = meshOptResults[i];
+		f << "    { \"mesh\": \"" << r.mesh << "\", \"triangles\": " << r.before.triangles
+			<< ", \"vertices_before\": " << r.before.vertices << ", \"vertices_after\": " << r.after.vertices
+			<< ", \"vertex_bytes_before\": " << r.before.vertexBytes << ", \"vertex_bytes_after\": " << r.after.vertexBytes
+			<< ", \"index_bytes_before\": " << r.before.indexBytes << ", \"index_bytes_after\": " << r.after.indexBytes
+			<< std::fixed << std::setprecision(3)
+			<< ", \"acmr_before\": " << r.before.acmr << ", \"acmr_after\": " << r.after.acmr
+			<< ", \"atvr_before\": " << r.before.atvr << ", \"atvr_after\": " << r.after.atvr
+			<< ", \"overdraw_before\": " << r.before.overdraw << ", \"overdraw_after\": " << r.after.overdraw
+			<< ", \"optimize_ms\": " << r.optimizeMs << " }" << std::defaultfloat
+			<< (i + 1 < meshOptResults.size() ? "," : "") << "\n";
+	}
+	f << "  ]\n";
+	f << "}\n";
+	return true;
+}
+
+void RenderBenchmark::print() const
+{
+	if (!programResults.empty()) {
+		double cold = 0, warm = 0;
+		cout << std::left << std::setw(20) << "variante" << std::setw(12) << "frio ms" << std::setw(12) << "caliente ms" << "cache" << endl;
+		for (const auto& r : programResults) {
+			cout << std::left << std::setw(20) << r.defines << std::fixed << std::setprecision(2) << std::setw(12) << r.coldMs
+				<< std::setw(12) << r.warmMs << (r.fromCache ? "si" : "no") << endl;
+			cold += r.coldMs;
+			warm += r.warmMs;
+		}
+		cout << "Total: frio " << cold << " ms, caliente " << warm << " ms" << endl << std::defaultfloat;
+	}
+	for (const auto& r : instancingResults) {
+		cout << r.objects << " objetos: " << r.meshesLoaded << " malla(s) leida(s), carga " << std::fixed << std::setprecision(2)
+			<< r.loadMs << " ms" << endl;
+		cout << "  instanciado: " << r.msPerFrameInstanced << " ms/frame, " << r.drawCallsInstanced << " llamadas" << endl;
+		cout << "  por objeto:  " << r.msPerFrameObjects << " ms/frame, " << r.drawCallsObjects << " llamadas" << endl << std::defaultfloat;
+	}
+	for (const auto& r : cullingResults) {
+		cout << r.objects << " objetos, " << r.visible << " visibles" << std::fixed << std::setprecision(3) << endl;
+		cout << "  culling: escalar " << r.msCullScalar << " ms, SSE " << r.msCullSSE << " ms, BVH " << r.msCullBVH
+			<< " ms (" << r.bvhNodesVisited << " nodos)" << endl;
+		cout << "  frame: sin culling " << r.msFrameNoCulling << " ms, culling " << r.msFrameCulling
+			<< " ms, culling BVH " << r.msFrameBVH << " ms" << endl << std::defaultfloat;
+	}
+	if (!lodResults.empty()) {
+		cout << std::left << std::setw(12) << "distancia" << std::setw(16) << "pixeles/obj" << std::setw(16) << "triang. sin LOD"
+			<< std::setw(16) << "triang. LOD" << std::setw(14) << "ms sin LOD" << "ms LOD" << endl;
+		for (const auto& r : lodResults) {
+			cout << std::left << std::setw(12) << r.distance << std::fixed << std::setprecision(1) << std::setw(16) << r.pixelsPerObject
+				<< std::setw(16) << r.trianglesFull << std::setw(16) << r.trianglesLOD << std::setprecision(3)
+				<< std::setw(14) << r.msFrameFull << r.msFrameLOD << endl << std::defaultfloat;
+		}
+	}
+	if (!vertexResults.empty()) {
+		cout << std::left << std::setw(20) << "formato" << std::setw(8) << "bytes" << std::setw(14) << "data/ bytes"
+			<< std::setw(14) << "esfera bytes" << std::setw(14) << "normal grados" << std::setw(12) << "error uv"
+			<< std::setw(12) << "ms GPU" << "GB/s" << endl;
+		for (const auto& r : vertexResults) {
+			cout << std::left << std::setw(20) << r.layout << std::setw(8) << r.stride << std::setw(14) << r.sampleBytes
+				<< std::setw(14) << r.largeBytes << std::fixed << std::setprecision(4) << std::setw(14) << r.maxNormalErrorDeg
+				<< std::setw(12) << r.maxUVError << std::setprecision(3) << std::setw(12) << r.gpuMsPerFrame << r.fetchGBs
+				<< endl << std::defaultfloat;
+		}
+	}
+	for (const auto& r : multiDrawResults) {
+		cout << r.objects << " objetos, " << r.batches << " lotes, " << r.groups << " grupo(s)"
+			<< (r.multiDrawSupported ? "" : " (sin GL 4.3: no hay multi-draw)") << std::fixed << std::setprecision(3) << endl;
+		cout << "  por lote:   " << r.msPerFrameBatches << " ms/frame, " << r.drawCallsBatches << " llamadas" << endl;
+		cout << "  multi-draw: " << r.msPerFrameMultiDraw << " ms/frame, " << r.drawCallsMultiDraw << " llamadas" << endl << std::defaultfloat;
+	}
+	for (const auto& r : headlessResults) {
+		cout << r.frames << " frames de " << r.width << "x" << r.height << " sin ventana (" << r.context << ", " << r.renderer << ")"
+			<< std::fixed << std::setprecision(3) << endl;
+		cout << "  ms/frame: media " << r.msMean << ", min " << r.msMin << ", p50 " << r.msP50 << ", p95 " << r.msP95
+			<< ", p99 " << r.msP99 << ", max " << r.msMax << endl;
+		cout << "  camara al final: " << r.cameraPosition.x << ", " << r.cameraPosition.y << ", " << r.cameraPosition.z << endl << std::defaultfloat;
+		if (!r.image.empty())
+			cout << "  ultimo frame en " << r.image << endl;
+	}
+	for (const auto& r : profilerResults) {
+		cout << r.objects << " objetos" << std::fixed << std::setprecision(3) << endl;
+		cout << "  perfilador desactivado: " << r.msFrameDisabled << " ms/frame, activado: " << r.msFrameEnabled << " ms/frame" << endl;
+		cout << "  zona vacia: " << r.nsPerDisabledCheck << " ns desactivado, " << r.nsPerEnabledZone << " ns activado; "
+			<< std::setprecision(1) << r.checksPerFrame << " comprobaciones por frame = " << std::setprecision(4)
+			<< r.disabledOverheadPct << " % del frame" << endl << std::setprecision(3);
+		for (const auto& [name, s] : r.zones)
+			cout << "    " << std::left << std::setw(24) << name << s.ms << " ms/frame" << endl;
+		cout << std::defaultfloat << std::right;
+	}
+	for (const auto& r : lightingResults) {
+		cout << r.lights << " luces puntuales, " << r.visibleLights << " en camara" << std::fixed << std::setprecision(3) << endl;
+		cout << "  clusters: " << r.lightClusterPairs << " entradas, " << r.lightsPerCluster << " luces de media y "
+			<< r.maxLightsPerCluster << " como mucho por cluster ocupado; reparto " << r.msAssign << " ms" << endl;
+		cout << "  frame: con clusters " << r.msFrameClustered << " ms, un solo cluster ";
+		if (r.msFrameSingle > 0) cout << r.msFrameSingle << " ms" << endl;
+		else cout << "sin medir" << endl;
+		cout << std::defaultfloat;
+	}
+	if (!textureResults.empty()) {
+		size_t baseline = 0, gpu = 0;
+		cout << std::left << std::setw(30) << "textura" << std::setw(12) << "tamano" << std::setw(8) << "formato" << std::setw(8) << "niveles"
+			<< std::setw(12) << "KB antes" << std::setw(12) << "KB ahora" << std::setw(10) << "frio ms" << std::setw(12) << "cache ms"
+			<< std::setw(10) << "subir ms" << "PSNR dB" << endl;
+		for (const auto& r : textureResults) {
+			cout << std::left << std::setw(30) << r.file << std::setw(12) << (to_string(r.width) + "x" + to_string(r.height))
+				<< std::setw(8) << TextureEncoder::formatName(r.format) << std::setw(8) << r.levels
+				<< std::setw(12) << r.bytesBaseline / 1024 << std::setw(12) << r.bytesGPU / 1024 << std::fixed << std::setprecision(2)
+				<< std::setw(10) << r.coldMs;
+			if (r.fromCache) cout << std::setw(12) << r.warmMs;
+			else cout << std::setw(12) << "sin cache";
+			cout << std::setw(10) << r.uploadMs << r.psnr << endl << std::defaultfloat;
+			baseline += r.bytesBaseline;
+			gpu += r.bytesGPU;
+		}
+		cout << std::right << "Memoria de video: " << baseline / 1024 << " KB sin mipmaps ni compresion, " << gpu / 1024
+			<< " KB con ellos (" << std::fixed << std::setprecision(2) << (double)baseline / std::max<size_t>(gpu, 1) << "x menos)" << endl << std::defaultfloat;
+	}
+	for (const auto& r : textureSamplingResults) {
+		cout << r.objects << " cubos hasta el horizonte, ms por frame: " << std::fixed << std::setprecision(3) << r.msFrameBaseline
+			<< " con RGBA8 sin mipmaps (" << r.bytesBaseline / 1024 << " KB), " << r.msFrameTrilinear << " con mipmaps y compresion ("
+			<< r.bytesCompressed / 1024 << " KB), " << r.msFrameCompressed << " ademas con filtro anisotropico" << endl << std::defaultfloat;
+	}
+	if (!streamingResults.empty()) {
+		cout << std::left << std::setw(10) << "objetos" << std::setw(12) << "MB" << std::setw(16) << "carga" << std::setw(16) << "primer frame ms"
+			<< std::setw(14) << "todos ms" << std::setw(16) << "peor frame ms" << std::setw(16) << "frame final ms" << std::setw(14) << "subida max" << "frames" << endl;
+		for (const auto& r : streamingResults) {
+			cout << std::left << std::setw(10) << r.objects << std::fixed << std::setprecision(1) << std::setw(12) << r.assetBytes / (1024.0 * 1024.0)
+				<< std::setw(16) << (r.async ? to_string(r.threads) + " hilos" : "sincrona") << std::setprecision(2) << std::setw(16) << r.msFirstFrame
+				<< std::setw(14) << r.msAllLoaded << std::setw(16) << r.msFrameMax << std::setw(16) << r.msFrameLoaded << std::setw(14) << r.msUpdateMax << r.framesLoading << endl << std::defaultfloat;
+		}
+		cout << std::right;
+	}
+	if (!textureArrayResults.empty()) {
+		cout << std::left << std::setw(14) << "modo" << std::setw(10) << "objetos" << std::setw(10) << "enlaces" << std::setw(10) << "KB"
+			<< std::setw(8) << "lotes" << std::setw(8) << "grupos" << std::setw(14) << "ms por lote" << std::setw(14) << "ms multidraw"
+			<< std::setw(14) << "llamadas" << "texturas enlazadas" << endl;
+		for (const auto& r : textureArrayResults) {
+			cout << std::left << std::setw(14) << r.mode << std::setw(10) << r.objects << std::setw(10) << r.bindings
+				<< std::setw(10) << r.textureBytes / 1024 << std::setw(8) << r.batches << std::setw(8) << r.groups
+				<< std::fixed << std::setprecision(2) << std::setw(14) << r.msFrameBatches << std::setw(14) << r.msFrameMultiDraw
+				<< std::setw(14) << (to_string(r.drawCallsBatches) + " / " + to_string(r.drawCallsMultiDraw))
+				<< r.textureBindsBatches << " / " << r.textureBindsMultiDraw << endl << std::defaultfloat;
+		}
+		cout << std::right;
+	}
+	if (!depthPrepassResults.empty()) {
+		cout << std::left << std::setw(28) << "modo" << std::setw(10) << "objetos" << std::setw(20) << "fragment shaders"
+			<< std::setw(20) << "pasan la Z" << std::setw(12) << "ms frame" << std::setw(10) << "llamadas" << "dif. imagen" << endl;
+		for (const auto& r : depthPrepassResults) {
+			cout << std::left << std::setw(28) << r.mode << std::setw(10) << r.objects
+				<< std::setw(20) << (r.fragmentInvocations < 0 ? string("n/d") : to_string(r.fragmentInvocations))
+				<< std::setw(20) << r.samplesPassed
+				<< std::fixed << std::setprecision(2) << std::setw(12) << r.msFrame << std::setw(10) << r.drawCalls
+				<< r.maxDiff << endl << std::defaultfloat;
+		}
+		cout << std::right;
+	}
+	for (const auto& r : meshOptResults) {
+		cout << r.mesh << ": " << r.before.triangles << " triangulos, optimizada en " << std::fixed << std::setprecision(2)
+			<< r.optimizeMs << " ms" << endl << std::setprecision(3);
+		cout << "  antes:   " << r.before.vertices << " vertices, ACMR " << r.before.acmr << ", ATVR " << r.before.atvr
+			<< ", overdraw " << r.before.overdraw << ", VBO " << r.before.vertexBytes << " B, IBO " << r.before.indexBytes << " B" << endl;
+		cout << "  despues: " << r.after.vertices << " vertices, ACMR " << r.after.acmr << ", ATVR " << r.after.atvr
+			<< ", overdraw " << r.after.overdraw << ", VBO " << r.after.vertexBytes << " B, IBO " << r.after.indexBytes << " B"
+			<< endl << std::defaultfloat;
+	}
+	if (uniformResults.empty()) return;
+
+	cout << std::left << std::setw(8) << "luces" << std::setw(10) << "mueven" << std::setw(16) << "ns nombres"
+		<< std::setw(16) << "ns bloques" << std::setw(18) << "llamadas nombres" << "llamadas bloques" << endl;
+	for (const auto& r : uniformResults) {
+		cout << std::left << std::setw(8) << r.numLights << std::setw(10) << (r.movingLights ? "si" : "no")
+			<< std::fixed << std::setprecision(1) << std::setw(16) << r.nsPerDrawStrings
+			<< std::setw(16) << r.nsPerDrawBlocks << std::setw(18) << r.callsPerDrawStrings << r.callsPerDrawBlocks << endl;
+	}
+	cout << std::defaultfloat;
+}
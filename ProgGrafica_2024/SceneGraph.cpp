@@ -0,0 +1,217 @@
+#include "libprgr/SceneGraph.h"
+#include <algorithm>
+#include <cstring>
+
+int SceneGraph::createNode(int parent)
+{
+	if (parent != NO_PARENT && !isValid(parent)) {
+		cout << "ERROR: " << __FILE__ << ":" << __LINE__ << " (" << __func__ << ") Padre no valido " << parent << endl;
+		parent = NO_PARENT;
+	}
+
+	// Reutilizamos handles libres si los hay
+	int handle;
+	if (!freeHandles.empty()) {
+		handle = freeHandles.back();
+		freeHandles.pop_back();
+	}
+	else {
+		handle = (int)nodes.size();
+		nodes.push_back({});
+		handleIndex.push_back(-1);
+	}
+	nodes[handle].parent = parent;
+	nodes[handle].children.clear();
+	nodes[handle].alive = true;
+
+	// Se anade al final de los arrays: si es raiz el preorden sigue siendo valido
+	int index = (int)order.size();
+	order.push_back(handle);
+	parentIndex.push_back(-1);
+	subtreeSize.push_back(1);
+	localMatrices.push_back(make_identity());
+	worldMatrices.push_back(make_identity());
+	dirtyFlags.push_back(0);
+	handleIndex[handle] = index;
+
+	if (parent != NO_PARENT) {
+		nodes[parent].children.push_back(handle);
+		orderDirty = true;
+	}
+	else {
+		markDirty(index);
+	}
+	return handle;
+}
+
+void SceneGraph::removeNode(int node)
+{
+	if (!isValid(node)) return;
+
+	detach(node);
+	for (int child : nodes[node].children)
+		nodes[child].parent = NO_PARENT;
+
+	nodes[node].children.clear();
+	nodes[node].alive = false;
+	handleIndex[node] = -1;
+	freeHandles.push_back(node);
+	orderDirty = true;
+}
+
+void SceneGraph::setParent(int node, int parent)
+{
+	if (!isValid(node) || (parent != NO_PARENT && !isValid(parent))) return;
+	if (nodes[node].parent == parent) return;
+
+	// Evitamos ciclos: el nuevo padre no puede estar en el subarbol del nodo
+	for (int p = parent; p != NO_PARENT; p = nodes[p].parent) {
+		if (p == node) {
+			cout << "ERROR: " << __FILE__ << ":" << __LINE__ << " (" << __func__ << ") El nodo " << parent << " es descendiente de " << node << endl;
+			return;
+		}
+	}
+
+	detach(node);
+	nodes[node].parent = parent;
+	if (parent != NO_PARENT)
+		nodes[parent].children.push_back(node);
+	orderDirty = true;
+}
+
+int SceneGraph::getParent(int node) const
+{
+	return isValid(node) ? nodes[node].parent : NO_PARENT;
+}
+
+void SceneGraph::setLocalMatrix(int node, const matrix4x4f& local)
+{
+	if (!isValid(node)) return;
+
+	int index = handleIndex[node];
+	if (memcmp(&localMatrices[index], &local, sizeof(matrix4x4f)) == 0) return;
+
+	localMatrices[index] = local;
+	markDirty(index);
+}
+
+const matrix4x4f& SceneGraph::getLocalMatrix(int node) const
+{
+	return localMatrices[handleIndex[node]];
+}
+
+const matrix4x4f& SceneGraph::getWorldMatrix(int node) const
+{
+	return worldMatrices[handleIndex[node]];
+}
+
+vector4f SceneGraph::getWorldPosition(int node) const
+{
+	const matrix4x4f& m = worldMatrices[handleIndex[node]];
+	return make_vector(m.mat2D[0][3], m.mat2D[1][3], m.mat2D[2][3], 1.0f);
+}
+
+bool SceneGraph::isValid(int node) const
+{
+	return node >= 0 && node < (int)nodes.size() && nodes[node].alive;
+}
+
+int SceneGraph::update()
+{
+	if (orderDirty) rebuildOrder();
+
+	updatedNodes.clear();
+	if (dirtyRoots.empty()) return 0;
+
+	// Orden ascendente: un subarbol marcado dentro de otro ya procesado se salta
+	std::sort(dirtyRoots.begin(), dirtyRoots.end());
+
+	int count = 0;
+	int end = 0;
+	for (int root : dirtyRoots) {
+		dirtyFlags[root] = 0;
+		if (root < end) continue;
+
+		end = root + subtreeSize[root];
+		for (int i = root; i < end; i++) {
+			// El padre o esta antes en este mismo rango o esta limpio
+			int p = parentIndex[i];
+			worldMatrices[i] = (p < 0) ? localMatrices[i] : worldMatrices[p] * localMatrices[i];
+			updatedNodes.push_back(order[i]);
+			count++;
+		}
+	}
+	dirtyRoots.clear();
+	return count;
+}
+
+void SceneGraph::markDirty(int index)
+{
+	if (dirtyFlags[index]) return;
+	dirtyFlags[index] = 1;
+	dirtyRoots.push_back(index);
+}
+
+void SceneGraph::detach(int node)
+{
+	int parent = nodes[node].parent;
+	if (parent == NO_PARENT) return;
+
+	vector<int>& siblings = nodes[parent].children;
+	siblings.erase(std::remove(siblings.begin(), siblings.end(), node), siblings.end());
+	nodes[node].parent = NO_PARENT;
+}
+
+void SceneGraph::rebuildOrder()
+{
+	vector<int> newOrder;
+	vector<int> newParent;
+	vector<matrix4x4f> newLocal;
+	vector<int> newIndex(nodes.size(), -1);
+	newOrder.reserve(nodes.size());
+
+	// Recorrido en profundidad (preorden) desde cada raiz, en orden de handle
+	vector<int> stack;
+	for (int root = 0; root < (int)nodes.size(); root++) {
+		if (!nodes[root].alive || nodes[root].parent != NO_PARENT) continue;
+
+		stack.push_back(root);
+		while (!stack.empty()) {
+			int h = stack.back();
+			stack.pop_back();
+
+			newIndex[h] = (int)newOrder.size();
+			newOrder.push_back(h);
+			newParent.push_back(nodes[h].parent == NO_PARENT ? -1 : newIndex[nodes[h].parent]);
+			newLocal.push_back(localMatrices[handleIndex[h]]);
+
+			// Hijos en orden inverso para visitarlos en su orden original
+			const vector<int>& children = nodes[h].children;
+			for (auto it = children.rbegin(); it != children.rend(); ++it)
+				stack.push_back(*it);
+		}
+	}
+
+	// Tamanos de subarbol: recorriendo hacia atras cada hijo suma al padre
+	int n = (int)newOrder.size();
+	vector<int> newSubtree(n, 1);
+	for (int i = n - 1; i >= 0; i--)
+		if (newParent[i] >= 0) newSubtree[newParent[i]] += newSubtree[i];
+
+	order = std::move(newOrder);
+	parentIndex = std::move(newParent);
+	localMatrices = std::move(newLocal);
+	subtreeSize = std::move(newSubtree);
+	worldMatrices.assign(n, make_identity());
+	dirtyFlags.assign(n, 0);
+
+	for (int h = 0; h < (int)nodes.size(); h++)
+		handleIndex[h] = newIndex[h];
+
+	// Tras reordenar se recalcula todo
+	dirtyRoots.clear();
+	for (int i = 0; i < n; i++)
+		if (parentIndex[i] < 0) markDirty(i);
+
+	orderDirty = false;
+}
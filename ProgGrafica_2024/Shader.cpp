@@ -1,6 +1,7 @@
 #include "libprgr/Shader.h"
+#include <algorithm>
 
-Shader::Shader(string fileName) : fileName(fileName)
+Shader::Shader(string fileName, const vector<string>& defines, bool compile) : fileName(fileName), defines(defines)
 {
 	if (fileName.ends_with(".vert")) {
 		shaderType = GL_VERTEX_SHADER;
@@ -13,8 +14,11 @@ Shader::Shader(string fileName) : fileName(fileName)
 	}
 
 	readSource();
-	compileShader();
-	checkErrors();
+	injectDefines();
+	if (compile) {
+		compileShader();
+		checkErrors();
+	}
 }
 
 void Shader::readSource()
@@ -28,6 +32,32 @@ void Shader::readSource()
 	}
 }
 
+void Shader::injectDefines()
+{
+	if (defines.empty()) return;
+
+	string block;
+	for (const string& define : defines)
+		block += "#define " + define + "\n";
+
+	// #version tiene que ser la primera directiva: los defines van justo detras.
+	// #line mantiene los numeros de linea de los errores iguales a los del fichero.
+	size_t pos = source.find("#version");
+	if (pos == string::npos) {
+		source = block + "#line 1\n" + source;
+		return;
+	}
+
+	size_t eol = source.find('\n', pos);
+	if (eol == string::npos) {
+		source += "\n" + block;
+		return;
+	}
+
+	int versionLine = 1 + (int)std::count(source.begin(), source.begin() + eol, '\n');
+	source.insert(eol + 1, block + "#line " + to_string(versionLine + 1) + "\n");
+}
+
 void Shader::compileShader()
 {
 	const char* shaderCode = source.c_str(); // Convertir el string a un puntero de char para pasarlo a OpenGL
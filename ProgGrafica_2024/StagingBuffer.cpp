@@ -0,0 +1,50 @@
+#include "libprgr/StagingBuffer.h"
+#include <cstring>
+#include <algorithm>
+
+#define STAGING_ALIGNMENT 16 // Los offsets de los datos de textura deben ser multiplo del tamano del texel
+
+StagingBuffer::StagingBuffer(size_t capacity) : capacity(capacity)
+{
+	glGenBuffers(1, &idBuffer);
+	glBindBuffer(GL_COPY_READ_BUFFER, idBuffer);
+	glBufferData(GL_COPY_READ_BUFFER, capacity, nullptr, GL_STREAM_DRAW);
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+}
+
+StagingBuffer::~StagingBuffer()
+{
+	glDeleteBuffers(1, &idBuffer);
+}
+
+size_t StagingBuffer::write(GLenum target, const void* data, size_t bytes)
+{
+	size_t offset = (head + STAGING_ALIGNMENT - 1) / STAGING_ALIGNMENT * STAGING_ALIGNMENT;
+	glBindBuffer(target, idBuffer);
+	if (bytes == 0)
+		return offset;
+
+	// Lleno: almacenamiento nuevo (y mas grande si hace falta) en vez de esperar a las copias pendientes
+	if (offset + bytes > capacity) {
+		capacity = std::max(capacity, bytes);
+		glBufferData(target, capacity, nullptr, GL_STREAM_DRAW);
+		offset = 0;
+		orphans++;
+	}
+
+	// Nadie lee ya este tramo: no hace falta sincronizar con la GPU
+	void* dst = glMapBufferRange(target, offset, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+	if (dst) {
+		memcpy(dst, data, bytes);
+		if (!glUnmapBuffer(target))
+			cout << "ERROR: " << __FILE__ << ":" << __LINE__ << " (" << __func__ << ") Buffer de subida corrompido al desmapearlo" << endl;
+	}
+	else {
+		cout << "ERROR: " << __FILE__ << ":" << __LINE__ << " (" << __func__ << ") No se pudo mapear el buffer de subida" << endl;
+		glBufferSubData(target, offset, bytes, data);
+	}
+
+	head = offset + bytes;
+	bytesWritten += bytes;
+	return offset;
+}
@@ -1,16 +1,193 @@
 #include "libprgr/Texture.h"
+#include "libprgr/HeadlessContext.h"
 #define STB_IMAGE_IMPLEMENTATION
 #include <GLFW/stb_image.h>
 #include <iostream>
+#include <cstring>
+#include <cstdio>
+#include <thread>
+
+// S3TC no esta en el nucleo de GL ni en glad
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+// Cabecera de los ficheros .ptex; detras van los niveles: ancho, alto, bytes y datos
+typedef struct {
+	char magic[4];        // "PRGT"
+	uint32_t version;     // Version del formato (y de los codificadores)
+	uint64_t sourceHash;  // FNV-1a del fichero original
+	uint32_t requested;   // Formato pedido (Texture::compression)
+	uint32_t format;      // Formato guardado
+	uint32_t mipmaps;     // Se generaron los mipmaps
+	uint32_t opaque;      // Todos los texels tenian alfa 255
+	int32_t width, height;
+	uint32_t levels;
+} textureCacheHeader_t;
+
+static const uint32_t TEXTURE_CACHE_VERSION = 1;
+
+// FNV-1a de 64 bits
+static uint64_t fnv1a(const void* data, size_t size, uint64_t hash = 14695981039346656037ull)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	for (size_t i = 0; i < size; i++) {
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+void Texture::queryGLSupport()
+{
+	supportsS3TC = HeadlessContext::hasExtension("GL_EXT_texture_compression_s3tc");
+	supportsBPTC = GLAD_GL_VERSION_4_2 || HeadlessContext::hasExtension("GL_ARB_texture_compression_bptc");
+	maxAnisotropy = 1.0f;
+	if (GLAD_GL_VERSION_4_6 || HeadlessContext::hasExtension("GL_ARB_texture_filter_anisotropic") || HeadlessContext::hasExtension("GL_EXT_texture_filter_anisotropic"))
+		glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY, &maxAnisotropy);
+}
+
+textureFormat_e Texture::resolveFormat(textureFormat_e requested, bool opaque)
+{
+	if (requested == TEXTURE_AUTO)
+		requested = opaque ? TEXTURE_BC1 : TEXTURE_BC7;
+	if (requested == TEXTURE_BC7 && !supportsBPTC)
+		requested = TEXTURE_BC3;
+	if ((requested == TEXTURE_BC1 || requested == TEXTURE_BC3) && !supportsS3TC)
+		requested = TEXTURE_RGBA8;
+	return requested;
+}
+
+GLenum Texture::internalFormat(textureFormat_e format)
+{
+	static const GLenum formats[] = { GL_RGBA8, GL_COMPRESSED_RGB_S3TC_DXT1_EXT, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, GL_COMPRESSED_RGBA_BPTC_UNORM };
+	return formats[format];
+}
+
+void Texture::setSampling(GLenum target, int levels)
+{
+	if (levels > 1) {
+		// Trilineal: interpola entre los dos niveles mas cercanos, y anisotropico si la GPU lo tiene
+		glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		if (maxAnisotropy > 1.0f)
+			glTexParameterf(target, GL_TEXTURE_MAX_ANISOTROPY, std::clamp(anisotropy, 1.0f, maxAnisotropy));
+	}
+	else {
+		glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_NEAREST); // Establece el filtro de minificacin, esto es lo que se usa cuando la textura es ms pequea que el rea de textura
+		glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_NEAREST); // Establece el filtro de magnificacin, esto es lo que se usa cuando la textura es ms grande que el rea de textura
+	}
+	glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_REPEAT); // Establece el modo de envoltura en el eje S (horizontal)
+	glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_REPEAT); // Establece el modo de envoltura en el eje T (vertical)
+	glTexParameteri(target, GL_TEXTURE_BASE_LEVEL, 0);
+	glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, levels - 1);
+}
+
+Texture::~Texture()
+{
+	if (array)
+		array->removeLayer(layer); // La capa se queda para otra textura
+	else if (textureID != -1)
+		glDeleteTextures(1, &textureID);
+	totalGPUBytes -= gpuBytes;
+}
+
+bool Texture::loadCache(const string& cacheFile, uint64_t sourceHash, textureFormat_e requested, int width, int height)
+{
+	ifstream f(cacheFile, ios::binary);
+	if (!f.is_open()) return false;
+
+	// Vale si es del mismo fichero, con las mismas opciones y en el formato y tamano que se elegirian ahora
+	textureCacheHeader_t header;
+	if (!f.read((char*)&header, sizeof(header)) || memcmp(header.magic, "PRGT", 4) != 0 ||
+		header.version != TEXTURE_CACHE_VERSION || header.sourceHash != sourceHash ||
+		header.requested != (uint32_t)requested || header.mipmaps != (uint32_t)mipmaps ||
+		header.format != (uint32_t)resolveFormat(requested, header.opaque != 0) || header.levels == 0 ||
+		header.width != width || header.height != height)
+		return false;
+
+	vector<textureLevel_t> read(header.levels);
+	for (textureLevel_t& level : read) {
+		uint32_t size = 0;
+		if (!f.read((char*)&level.w, sizeof(level.w)) || !f.read((char*)&level.h, sizeof(level.h)) || !f.read((char*)&size, sizeof(size)) ||
+			size != TextureEncoder::levelSize((textureFormat_e)header.format, level.w, level.h))
+			return false;
+		level.data.resize(size);
+		if (!f.read((char*)level.data.data(), size))
+			return false;
+	}
+
+	w = header.width;
+	h = header.height;
+	format = (textureFormat_e)header.format;
+	opaque = header.opaque != 0;
+	levels = std::move(read);
+	return true;
+}
+
+void Texture::saveCache(const string& cacheFile, uint64_t sourceHash, textureFormat_e requested, bool opaque) const
+{
+	// Se escribe aparte y se renombra: otro hilo puede estar guardando o leyendo la misma textura
+	string tempFile = cacheFile + "." + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id())) + ".tmp";
+	ofstream f(tempFile, ios::binary);
+	if (!f.is_open()) {
+		cout << "ERROR: " << __FILE__ << ":" << __LINE__ << " (" << __func__ << ") No se pudo crear " << cacheFile << endl;
+		return;
+	}
+
+	textureCacheHeader_t header = { { 'P', 'R', 'G', 'T' }, TEXTURE_CACHE_VERSION, sourceHash, (uint32_t)requested, (uint32_t)format,
+		(uint32_t)mipmaps, (uint32_t)opaque, w, h, (uint32_t)levels.size() };
+	f.write((const char*)&header, sizeof(header));
+	for (const textureLevel_t& level : levels) {
+		uint32_t size = (uint32_t)level.data.size();
+		f.write((const char*)&level.w, sizeof(level.w));
+		f.write((const char*)&level.h, sizeof(level.h));
+		f.write((const char*)&size, sizeof(size));
+		f.write((const char*)level.data.data(), size);
+	}
+	f.close();
+
+	// En Windows rename no sustituye un fichero existente. Si otro hilo gana la carrera vale el suyo
+	std::remove(cacheFile.c_str());
+	if (std::rename(tempFile.c_str(), cacheFile.c_str()) != 0)
+		std::remove(tempFile.c_str());
+}
 
 // Carga de textura a grfica.
 void Texture::loadFile(string fileName) 
 {
+    levels.clear();
+    fromCache = false;
+    layered = false; // Solo si se carga: una textura fallida no cuenta como capa de un array
+
+    // El fichero se lee entero una vez: su hash valida la cache y, si no vale, se decodifica de memoria
+    ifstream file(fileName, ios::binary);
+    vector<unsigned char> bytes;
+    if (file.is_open())
+        bytes.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    uint64_t sourceHash = fnv1a(bytes.data(), bytes.size());
+
+    // Tamano con el que se guardaria: el del fichero o, para un array, layerSize
+    int width = 0, height = 0, sourceChannels = 0;
+    if (!bytes.empty())
+        stbi_info_from_memory(bytes.data(), (int)bytes.size(), &width, &height, &sourceChannels);
+    if (useArrays && layerSize > 0)
+        width = height = layerSize;
+
+    textureFormat_e requested = compression;
+    string cacheFile = cacheFileName(fileName);
+    if (useCache && !bytes.empty() && loadCache(cacheFile, sourceHash, requested, width, height)) {
+        fromCache = true;
+        layered = useArrays;
+        return;
+    }
+
     // Las texturas tienen cuatro canales de informacin (r, g, b, a).
     int channels = 4;
 
     // Carga esta informacin.
-    unsigned char* data = stbi_load(fileName.c_str(), &w, &h, &channels, 4);
+    unsigned char* data = bytes.empty() ? nullptr : stbi_load_from_memory(bytes.data(), (int)bytes.size(), &w, &h, &channels, 4);
 
     if (data == nullptr || w == 0 || h == 0) 
     {
@@ -27,32 +204,114 @@ void Texture::loadFile(string fileName)
         memcpy(pixels.data(), data, pixels.size() * sizeof(pixel_t));
         stbi_image_free(data);
     }
+
+    // Todas las capas de un array miden lo mismo
+    if (w != width || h != height) {
+        vector<uint8_t> resized = TextureEncoder::resize((const uint8_t*)pixels.data(), w, h, width, height);
+        w = width;
+        h = height;
+        pixels.resize((size_t)w * h);
+        memcpy(pixels.data(), resized.data(), resized.size());
+    }
+
+    // Cadena de mipmaps (o solo el nivel 0) y compresion de cada nivel
+    const uint8_t* rgba = (const uint8_t*)pixels.data();
+    opaque = TextureEncoder::isOpaque(rgba, pixels.size());
+    format = resolveFormat(requested, opaque);
+    if (mipmaps)
+        levels = TextureEncoder::buildMipChain(rgba, w, h);
+    else
+        levels.push_back({ w, h, vector<uint8_t>(rgba, rgba + pixels.size() * sizeof(pixel_t)) });
+    for (textureLevel_t& level : levels)
+        level = TextureEncoder::encode(level, format);
+    pixels.clear();
+    pixels.shrink_to_fit();
+    layered = useArrays;
+
+    if (useCache)
+        saveCache(cacheFile, sourceHash, requested, opaque);
 }
 
 // Sube la textura a GPU.   
-void Texture::updateGPU()
+void Texture::updateGPU(StagingBuffer* staging)
 {
-    // En el caso de ya no tener un id se le da uno.
-    if (textureID == -1) 
-		glGenTextures(1, &textureID);
+	if (levels.empty()) return; // No se cargo nada (o ya esta subida)
 
-	glBindTexture(GL_TEXTURE_2D, textureID); // Vincula la textura 
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST); // Establece el filtro de minificacin, esto es lo que se usa cuando la textura es ms pequea que el rea de textura
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST); // Establece el filtro de magnificacin, esto es lo que se usa cuando la textura es ms grande que el rea de textura
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT); // Establece el modo de envoltura en el eje S (horizontal)
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT); // Establece el modo de envoltura en el eje T (vertical)
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data()); // Carga la textura en la GPU
+	for (size_t i = 0; i < levels.size(); i++)
+		uploadLevel((int)i, staging);
+	finishUpload();
+}
+
+void Texture::uploadLevel(int i, StagingBuffer* staging)
+{
+	if (i < 0 || i >= (int)levels.size()) return;
+	const textureLevel_t& level = levels[i];
+
+	if (i == 0) {
+		totalGPUBytes -= gpuBytes;
+		gpuBytes = 0;
+		mipLevels = 0; // Hasta finishUpload no se puede usar
+	}
+
+	if (layered) {
+		// Una capa del array de su formato, tamano y niveles (la de antes se devuelve si se vuelve a subir)
+		if (i == 0) {
+			if (array) array->removeLayer(layer);
+			array = TextureArray::get(format, level.w, level.h, (int)levels.size());
+			layer = array->addLayer();
+		}
+		array->upload(layer, i, level, staging);
+	}
+	else {
+		// En el caso de ya no tener un id se le da uno.
+		if (textureID == -1) 
+			glGenTextures(1, &textureID);
+
+		glBindTexture(GL_TEXTURE_2D, textureID); // Vincula la textura 
+		if (i == 0)
+			setSampling(GL_TEXTURE_2D, (int)levels.size());
+
+		// Ya en su formato: los comprimidos los guarda la GPU tal cual. Con staging los datos salen del
+		// buffer de subida (el puntero es su offset) y la llamada no espera a la copia
+		const void* data = level.data.data();
+		if (staging)
+			data = (const void*)(uintptr_t)staging->write(GL_PIXEL_UNPACK_BUFFER, level.data.data(), level.data.size());
+
+		if (format == TEXTURE_RGBA8)
+			glTexImage2D(GL_TEXTURE_2D, i, GL_RGBA8, level.w, level.h, 0, GL_RGBA, GL_UNSIGNED_BYTE, data); // Carga la textura en la GPU
+		else
+			glCompressedTexImage2D(GL_TEXTURE_2D, i, internalFormat(format), level.w, level.h, 0, (GLsizei)level.data.size(), data);
+
+		if (staging)
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0); // Las demas subidas leen de memoria de CPU
+	}
+	gpuBytes += level.data.size();
+	totalGPUBytes += level.data.size();
+}
+
+void Texture::finishUpload()
+{
+	if (levels.empty()) return;
+	mipLevels = (int)levels.size();
+
+	// Los niveles ya estan en la GPU
+	levels.clear();
+	levels.shrink_to_fit();
 }
 
 // Bindea la textura a grfica.
 void Texture::bind(int textureUnit)
 {
-    if (textureID == -1 || pixels.empty()) 
+    if ((textureID == -1 && !array) || mipLevels == 0) 
     {
         cout << "ERROR: " << __FILE__ << ":" << __LINE__ << " (" << __func__ << ") Vinculando textura no vlida" << endl;
         return;
     }
 
+    if (array) {
+        array->bind(textureUnit);
+        return;
+    }
 	glActiveTexture(GL_TEXTURE0 + textureUnit); // Activa la unidad de textura
 	glBindTexture(GL_TEXTURE_2D, textureID); // Vincula la textura
 }
\ No newline at end of file
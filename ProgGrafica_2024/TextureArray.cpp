@@ -0,0 +1,147 @@
+#include "libprgr/TextureArray.h"
+#include "libprgr/Texture.h"
+#include <algorithm>
+
+#pragma region --- TEXTURE ARRAY ---
+
+TextureArray::TextureArray(textureFormat_e format, int w, int h, int levels, int capacity) :
+	format(format), w(w), h(h), levels(levels), capacity(capacity)
+{
+	idTexture = create(capacity);
+	for (int layer = capacity - 1; layer >= 0; layer--)
+		freeLayers.push_back(layer);
+}
+
+TextureArray::~TextureArray()
+{
+	glDeleteTextures(1, &idTexture);
+}
+
+int TextureArray::maxLayers()
+{
+	static GLint layers = 0;
+	if (layers == 0)
+		glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &layers);
+	return layers;
+}
+
+TextureArray* TextureArray::get(textureFormat_e format, int w, int h, int levels)
+{
+	for (TextureArray* array : arrays)
+		if (array->format == format && array->w == w && array->h == h && array->levels == levels &&
+			(!array->freeLayers.empty() || array->capacity < maxLayers()))
+			return array;
+
+	TextureArray* array = new TextureArray(format, w, h, levels);
+	arrays.push_back(array);
+	return array;
+}
+
+void TextureArray::clear()
+{
+	for (TextureArray* array : arrays)
+		delete array;
+	arrays.clear();
+}
+
+unsigned int TextureArray::create(int layers)
+{
+	unsigned int id;
+	glGenTextures(1, &id);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, id);
+	Texture::setSampling(GL_TEXTURE_2D_ARRAY, levels);
+
+	// Todos los niveles reservados de una vez (sin glTexStorage3D, que es de GL 4.2)
+	gpuBytes = 0;
+	for (int i = 0, lw = w, lh = h; i < levels; i++, lw = std::max(lw / 2, 1), lh = std::max(lh / 2, 1)) {
+		size_t bytes = TextureEncoder::levelSize(format, lw, lh) * layers;
+		if (format == TEXTURE_RGBA8)
+			glTexImage3D(GL_TEXTURE_2D_ARRAY, i, GL_RGBA8, lw, lh, layers, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+		else
+			glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, i, Texture::internalFormat(format), lw, lh, layers, 0, (GLsizei)bytes, nullptr);
+		gpuBytes += bytes;
+	}
+	return id;
+}
+
+void TextureArray::grow(int newCapacity)
+{
+	unsigned int bigger = create(newCapacity);
+	unsigned int pbo;
+	glGenBuffers(1, &pbo);
+	for (int i = 0, lw = w, lh = h; i < levels; i++, lw = std::max(lw / 2, 1), lh = std::max(lh / 2, 1)) {
+		// El nivel con todas sus capas: del array viejo al PBO y del PBO al nuevo
+		size_t bytes = TextureEncoder::levelSize(format, lw, lh) * capacity;
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo);
+		glBufferData(GL_PIXEL_PACK_BUFFER, bytes, nullptr, GL_STREAM_COPY);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, idTexture);
+		if (format == TEXTURE_RGBA8)
+			glGetTexImage(GL_TEXTURE_2D_ARRAY, i, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+		else
+			glGetCompressedTexImage(GL_TEXTURE_2D_ARRAY, i, nullptr);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, bigger);
+		if (format == TEXTURE_RGBA8)
+			glTexSubImage3D(GL_TEXTURE_2D_ARRAY, i, 0, 0, 0, lw, lh, capacity, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+		else
+			glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, i, 0, 0, 0, lw, lh, capacity, Texture::internalFormat(format), (GLsizei)bytes, nullptr);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	}
+	glDeleteBuffers(1, &pbo);
+	glDeleteTextures(1, &idTexture);
+	idTexture = bigger;
+
+	for (int layer = newCapacity - 1; layer >= capacity; layer--)
+		freeLayers.push_back(layer);
+	capacity = newCapacity;
+}
+
+int TextureArray::addLayer()
+{
+	if (freeLayers.empty()) {
+		if (capacity >= maxLayers()) {
+			cout << "ERROR: " << __FILE__ << ":" << __LINE__ << " (" << __func__ << ") El array de texturas ya tiene " << capacity << " capas" << endl;
+			return -1;
+		}
+		grow(std::min(capacity * 2, maxLayers()));
+	}
+	int layer = freeLayers.back();
+	freeLayers.pop_back();
+	usedLayers++;
+	return layer;
+}
+
+void TextureArray::removeLayer(int layer)
+{
+	if (layer < 0 || layer >= capacity) return;
+	freeLayers.push_back(layer);
+	usedLayers--;
+}
+
+void TextureArray::upload(int layer, int i, const textureLevel_t& level, StagingBuffer* staging)
+{
+	if (layer < 0 || i < 0 || i >= levels) return;
+
+	const void* data = level.data.data();
+	if (staging)
+		data = (const void*)(uintptr_t)staging->write(GL_PIXEL_UNPACK_BUFFER, level.data.data(), level.data.size());
+
+	glBindTexture(GL_TEXTURE_2D_ARRAY, idTexture);
+	if (format == TEXTURE_RGBA8)
+		glTexSubImage3D(GL_TEXTURE_2D_ARRAY, i, 0, 0, layer, level.w, level.h, 1, GL_RGBA, GL_UNSIGNED_BYTE, data);
+	else
+		glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, i, 0, 0, layer, level.w, level.h, 1, Texture::internalFormat(format), (GLsizei)level.data.size(), data);
+
+	if (staging)
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void TextureArray::bind(int textureUnit)
+{
+	glActiveTexture(GL_TEXTURE0 + textureUnit);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, idTexture);
+}
+
+#pragma endregion
@@ -0,0 +1,565 @@
+#include "libprgr/TextureEncoder.h"
+#include <algorithm>
+#include <cfloat>
+#include <climits>
+#include <cstring>
+
+#pragma region --- TEXTURE ENCODER ---
+
+const char* TextureEncoder::formatName(textureFormat_e format)
+{
+	static const char* names[] = { "RGBA8", "BC1", "BC3", "BC7", "AUTO" };
+	return names[format];
+}
+
+size_t TextureEncoder::levelSize(textureFormat_e format, int w, int h)
+{
+	size_t blocks = (size_t)((w + 3) / 4) * ((h + 3) / 4);
+	switch (format) {
+	case TEXTURE_BC1: return blocks * 8;
+	case TEXTURE_BC3:
+	case TEXTURE_BC7: return blocks * 16;
+	default: return (size_t)w * h * 4;
+	}
+}
+
+int TextureEncoder::levelCount(int w, int h)
+{
+	int levels = 1;
+	while (w > 1 || h > 1) {
+		w = std::max(w / 2, 1);
+		h = std::max(h / 2, 1);
+		levels++;
+	}
+	return levels;
+}
+
+bool TextureEncoder::isOpaque(const uint8_t* rgba, size_t texels)
+{
+	for (size_t i = 0; i < texels; i++)
+		if (rgba[i * 4 + 3] != 255) return false;
+	return true;
+}
+
+// sRGB <-> lineal con tablas: 256 entradas de ida y 4096 de vuelta
+static const float* srgbToLinear()
+{
+	static float table[256];
+	static bool ready = false;
+	if (!ready) {
+		for (int i = 0; i < 256; i++) {
+			float c = i / 255.0f;
+			table[i] = c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+		}
+		ready = true;
+	}
+	return table;
+}
+
+static uint8_t linearToSrgb(float c)
+{
+	static uint8_t table[4096];
+	static bool ready = false;
+	if (!ready) {
+		for (int i = 0; i < 4096; i++) {
+			float l = i / 4095.0f;
+			float s = l <= 0.0031308f ? l * 12.92f : 1.055f * powf(l, 1.0f / 2.4f) - 0.055f;
+			table[i] = (uint8_t)std::clamp((int)(s * 255.0f + 0.5f), 0, 255);
+		}
+		ready = true;
+	}
+	return table[std::clamp((int)(c * 4095.0f + 0.5f), 0, 4095)];
+}
+
+// Reduce un eje a la mitad: texels de 4 floats (color lineal y alfa), count texels separados por stride.
+// El color se pondera por alfa y, si todos los alfas son 0, se queda la media sin ponderar.
+static void downsampleLine(const float* src, int count, size_t stride, float* dst, size_t dstStride)
+{
+	int n = std::max(count / 2, 1);
+	for (int x = 0; x < n; x++) {
+		float w[3];
+		int taps;
+		if (count == 1) { w[0] = 1.0f; taps = 1; }
+		else if (count % 2 == 0) { w[0] = w[1] = 0.5f; taps = 2; }
+		else {
+			float inv = 1.0f / (2 * n + 1);
+			w[0] = (n - x) * inv;
+			w[1] = n * inv;
+			w[2] = (x + 1) * inv;
+			taps = 3;
+		}
+
+		float weighted[3] = { 0, 0, 0 }, plain[3] = { 0, 0, 0 }, alpha = 0;
+		for (int t = 0; t < taps; t++) {
+			const float* s = src + (size_t)(count == 1 ? 0 : 2 * x + t) * stride;
+			for (int c = 0; c < 3; c++) {
+				weighted[c] += w[t] * s[3] * s[c];
+				plain[c] += w[t] * s[c];
+			}
+			alpha += w[t] * s[3];
+		}
+		float* d = dst + (size_t)x * dstStride;
+		for (int c = 0; c < 3; c++)
+			d[c] = alpha > 1e-6f ? weighted[c] / alpha : plain[c];
+		d[3] = alpha;
+	}
+}
+
+vector<textureLevel_t> TextureEncoder::buildMipChain(const uint8_t* rgba, int w, int h)
+{
+	vector<textureLevel_t> levels;
+	levels.reserve(levelCount(w, h));
+	levels.push_back({ w, h, vector<uint8_t>(rgba, rgba + (size_t)w * h * 4) });
+
+	// Los niveles se calculan uno desde otro en float, sin redondear a 8 bits entre medias
+	const float* toLinear = srgbToLinear();
+	vector<float> current((size_t)w * h * 4), temp, next;
+	for (size_t i = 0; i < (size_t)w * h; i++) {
+		for (int c = 0; c < 3; c++)
+			current[i * 4 + c] = toLinear[rgba[i * 4 + c]];
+		current[i * 4 + 3] = rgba[i * 4 + 3] / 255.0f;
+	}
+
+	while (w > 1 || h > 1) {
+		int nw = std::max(w / 2, 1), nh = std::max(h / 2, 1);
+
+		// Primero las filas (w -> nw) y luego las columnas (h -> nh)
+		temp.resize((size_t)nw * h * 4);
+		for (int y = 0; y < h; y++)
+			downsampleLine(&current[(size_t)y * w * 4], w, 4, &temp[(size_t)y * nw * 4], 4);
+		next.resize((size_t)nw * nh * 4);
+		for (int x = 0; x < nw; x++)
+			downsampleLine(&temp[(size_t)x * 4], h, (size_t)nw * 4, &next[(size_t)x * 4], (size_t)nw * 4);
+
+		textureLevel_t level = { nw, nh, vector<uint8_t>((size_t)nw * nh * 4) };
+		for (size_t i = 0; i < (size_t)nw * nh; i++) {
+			for (int c = 0; c < 3; c++)
+				level.data[i * 4 + c] = linearToSrgb(next[i * 4 + c]);
+			level.data[i * 4 + 3] = (uint8_t)std::clamp((int)(next[i * 4 + 3] * 255.0f + 0.5f), 0, 255);
+		}
+		levels.push_back(std::move(level));
+
+		current.swap(next);
+		w = nw;
+		h = nh;
+	}
+	return levels;
+}
+
+// Remuestrea un eje de count a n texels (mismo formato que downsampleLine). Al reducir, cada texel
+// nuevo es la media de los que cubre, con el peso de la parte de cada uno que cae dentro; al
+// ampliar, interpolacion lineal entre los dos mas cercanos.
+static void resampleLine(const float* src, int count, size_t stride, float* dst, int n, size_t dstStride)
+{
+	float scale = (float)count / n;
+	for (int x = 0; x < n; x++) {
+		float weighted[3] = { 0, 0, 0 }, plain[3] = { 0, 0, 0 }, alpha = 0, total = 0;
+		auto tap = [&](int i, float w) {
+			const float* s = src + (size_t)std::clamp(i, 0, count - 1) * stride;
+			for (int c = 0; c < 3; c++) {
+				weighted[c] += w * s[3] * s[c];
+				plain[c] += w * s[c];
+			}
+			alpha += w * s[3];
+			total += w;
+		};
+		if (scale > 1.0f) {
+			float begin = x * scale, end = begin + scale;
+			for (int i = (int)begin; i < (int)ceilf(end); i++)
+				tap(i, std::min(end, i + 1.0f) - std::max(begin, (float)i));
+		}
+		else {
+			float center = (x + 0.5f) * scale - 0.5f;
+			int i = (int)floorf(center);
+			float t = center - i;
+			tap(i, 1.0f - t);
+			tap(i + 1, t);
+		}
+		float* d = dst + (size_t)x * dstStride;
+		for (int c = 0; c < 3; c++)
+			d[c] = alpha > 1e-6f ? weighted[c] / alpha : plain[c] / total;
+		d[3] = alpha / total;
+	}
+}
+
+vector<uint8_t> TextureEncoder::resize(const uint8_t* rgba, int w, int h, int nw, int nh)
+{
+	// Como buildMipChain: en lineal, con el color ponderado por alfa, primero filas y luego columnas
+	const float* toLinear = srgbToLinear();
+	vector<float> source((size_t)w * h * 4);
+	for (size_t i = 0; i < (size_t)w * h; i++) {
+		for (int c = 0; c < 3; c++)
+			source[i * 4 + c] = toLinear[rgba[i * 4 + c]];
+		source[i * 4 + 3] = rgba[i * 4 + 3] / 255.0f;
+	}
+
+	vector<float> temp((size_t)nw * h * 4), result((size_t)nw * nh * 4);
+	for (int y = 0; y < h; y++)
+		resampleLine(&source[(size_t)y * w * 4], w, 4, &temp[(size_t)y * nw * 4], nw, 4);
+	for (int x = 0; x < nw; x++)
+		resampleLine(&temp[(size_t)x * 4], h, (size_t)nw * 4, &result[(size_t)x * 4], nh, (size_t)nw * 4);
+
+	vector<uint8_t> out((size_t)nw * nh * 4);
+	for (size_t i = 0; i < (size_t)nw * nh; i++) {
+		for (int c = 0; c < 3; c++)
+			out[i * 4 + c] = linearToSrgb(result[i * 4 + c]);
+		out[i * 4 + 3] = (uint8_t)std::clamp((int)(result[i * 4 + 3] * 255.0f + 0.5f), 0, 255);
+	}
+	return out;
+}
+
+textureLevel_t TextureEncoder::encode(const textureLevel_t& level, textureFormat_e format)
+{
+	if (format == TEXTURE_RGBA8 || format == TEXTURE_AUTO)
+		return level;
+
+	textureLevel_t out = { level.w, level.h, vector<uint8_t>(levelSize(format, level.w, level.h)) };
+	size_t blockBytes = format == TEXTURE_BC1 ? 8 : 16;
+	uint8_t* dst = out.data.data();
+	uint8_t block[64];
+	for (int by = 0; by < level.h; by += 4) {
+		for (int bx = 0; bx < level.w; bx += 4) {
+			// Los bloques que se salen del nivel repiten el ultimo texel de la fila o columna
+			for (int y = 0; y < 4; y++) {
+				int sy = std::min(by + y, level.h - 1);
+				for (int x = 0; x < 4; x++) {
+					int sx = std::min(bx + x, level.w - 1);
+					memcpy(&block[(y * 4 + x) * 4], &level.data[((size_t)sy * level.w + sx) * 4], 4);
+				}
+			}
+			if (format == TEXTURE_BC1) encodeBC1(block, dst);
+			else if (format == TEXTURE_BC3) encodeBC3(block, dst);
+			else encodeBC7(block, dst);
+			dst += blockBytes;
+		}
+	}
+	return out;
+}
+
+// Eje principal de n puntos de dim componentes (potencia iterada sobre la covarianza).
+// Devuelve la media en mean y el eje (sin normalizar si el bloque es plano) en axis.
+static void principalAxis(const float* points, int n, int dim, float* mean, float* axis)
+{
+	for (int c = 0; c < dim; c++) {
+		mean[c] = 0;
+		for (int i = 0; i < n; i++) mean[c] += points[i * dim + c];
+		mean[c] /= n;
+	}
+	float cov[4][4] = {};
+	for (int i = 0; i < n; i++)
+		for (int a = 0; a < dim; a++)
+			for (int b = a; b < dim; b++)
+				cov[a][b] += (points[i * dim + a] - mean[a]) * (points[i * dim + b] - mean[b]);
+	for (int a = 0; a < dim; a++)
+		for (int b = 0; b < a; b++)
+			cov[a][b] = cov[b][a];
+
+	// Se empieza por la fila de la covarianza con mas varianza (nunca perpendicular al eje buscado);
+	// si es nula el bloque es de un solo color y el eje se queda a 0
+	int k = 0;
+	for (int c = 1; c < dim; c++)
+		if (cov[c][c] > cov[k][k]) k = c;
+	for (int c = 0; c < dim; c++) axis[c] = cov[k][c];
+	for (int iter = 0; iter < 8; iter++) {
+		float v[4] = {};
+		for (int a = 0; a < dim; a++)
+			for (int b = 0; b < dim; b++)
+				v[a] += cov[a][b] * axis[b];
+		float len = 0;
+		for (int c = 0; c < dim; c++) len = std::max(len, fabsf(v[c]));
+		if (len < 1e-8f) return;
+		for (int c = 0; c < dim; c++) axis[c] = v[c] / len;
+	}
+}
+
+// Extremos del segmento de los puntos sobre el eje
+static void axisEndpoints(const float* points, int n, int dim, const float* mean, const float* axis, float* e0, float* e1)
+{
+	float len2 = 0;
+	for (int c = 0; c < dim; c++) len2 += axis[c] * axis[c];
+	float tMin = 0, tMax = 0;
+	if (len2 > 0) {
+		tMin = FLT_MAX;
+		tMax = -FLT_MAX;
+		for (int i = 0; i < n; i++) {
+			float t = 0;
+			for (int c = 0; c < dim; c++) t += (points[i * dim + c] - mean[c]) * axis[c];
+			tMin = std::min(tMin, t / len2);
+			tMax = std::max(tMax, t / len2);
+		}
+	}
+	for (int c = 0; c < dim; c++) {
+		e0[c] = std::clamp(mean[c] + axis[c] * tMax, 0.0f, 255.0f);
+		e1[c] = std::clamp(mean[c] + axis[c] * tMin, 0.0f, 255.0f);
+	}
+}
+
+// Minimos cuadrados de los extremos con los pesos ya elegidos: punto i = (1 - w_i) * e0 + w_i * e1.
+// false si el sistema es singular (todos los texels con el mismo indice).
+static bool refineEndpoints(const float* points, const float* weights, int n, int dim, float* e0, float* e1)
+{
+	float aa = 0, ab = 0, bb = 0, ax[4] = {}, bx[4] = {};
+	for (int i = 0; i < n; i++) {
+		float b = weights[i], a = 1.0f - b;
+		aa += a * a;
+		ab += a * b;
+		bb += b * b;
+		for (int c = 0; c < dim; c++) {
+			ax[c] += a * points[i * dim + c];
+			bx[c] += b * points[i * dim + c];
+		}
+	}
+	float det = aa * bb - ab * ab;
+	if (fabsf(det) < 1e-6f) return false;
+	for (int c = 0; c < dim; c++) {
+		e0[c] = std::clamp((ax[c] * bb - bx[c] * ab) / det, 0.0f, 255.0f);
+		e1[c] = std::clamp((bx[c] * aa - ax[c] * ab) / det, 0.0f, 255.0f);
+	}
+	return true;
+}
+
+static uint16_t packRGB565(const float* c)
+{
+	int r = std::clamp((int)(c[0] * 31.0f / 255.0f + 0.5f), 0, 31);
+	int g = std::clamp((int)(c[1] * 63.0f / 255.0f + 0.5f), 0, 63);
+	int b = std::clamp((int)(c[2] * 31.0f / 255.0f + 0.5f), 0, 31);
+	return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+static void unpackRGB565(uint16_t v, int* c)
+{
+	int r = v >> 11, g = (v >> 5) & 63, b = v & 31;
+	c[0] = (r << 3) | (r >> 2);
+	c[1] = (g << 2) | (g >> 4);
+	c[2] = (b << 3) | (b >> 2);
+}
+
+// Indices de BC1 en el modo de 4 colores para los extremos c0 y c1. Devuelve el error total.
+static int bc1Indices(const float* points, uint16_t c0, uint16_t c1, uint8_t* indices)
+{
+	int p[4][3];
+	unpackRGB565(c0, p[0]);
+	unpackRGB565(c1, p[1]);
+	for (int c = 0; c < 3; c++) {
+		p[2][c] = (2 * p[0][c] + p[1][c]) / 3;
+		p[3][c] = (p[0][c] + 2 * p[1][c]) / 3;
+	}
+	int total = 0;
+	for (int i = 0; i < 16; i++) {
+		int best = INT_MAX;
+		for (int k = 0; k < 4; k++) {
+			int e = 0;
+			for (int c = 0; c < 3; c++) {
+				int d = (int)points[i * 3 + c] - p[k][c];
+				e += d * d;
+			}
+			if (e < best) {
+				best = e;
+				indices[i] = (uint8_t)k;
+			}
+		}
+		total += best;
+	}
+	return total;
+}
+
+void TextureEncoder::encodeBC1(const uint8_t block[64], uint8_t out[8])
+{
+	float points[16 * 3];
+	for (int i = 0; i < 16; i++)
+		for (int c = 0; c < 3; c++)
+			points[i * 3 + c] = block[i * 4 + c];
+
+	float mean[3], axis[3], e0[3], e1[3];
+	principalAxis(points, 16, 3, mean, axis);
+	axisEndpoints(points, 16, 3, mean, axis, e0, e1);
+
+	uint16_t c0 = packRGB565(e0), c1 = packRGB565(e1);
+	uint8_t indices[16];
+	int error = bc1Indices(points, c0, c1, indices);
+
+	// Una pasada de minimos cuadrados con los indices elegidos (peso de c1 de cada indice)
+	static const float weightOf[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+	float weights[16];
+	for (int i = 0; i < 16; i++) weights[i] = weightOf[indices[i]];
+	if (refineEndpoints(points, weights, 16, 3, e0, e1)) {
+		uint16_t r0 = packRGB565(e0), r1 = packRGB565(e1);
+		uint8_t refined[16];
+		int refinedError = bc1Indices(points, r0, r1, refined);
+		if (refinedError < error) {
+			c0 = r0;
+			c1 = r1;
+			memcpy(indices, refined, 16);
+		}
+	}
+
+	// El modo de 4 colores necesita c0 > c1: si no, se cambian (0 <-> 1 y 2 <-> 3). Iguales: todo a c0
+	if (c0 < c1) {
+		std::swap(c0, c1);
+		for (int i = 0; i < 16; i++) indices[i] ^= 1;
+	}
+	else if (c0 == c1) {
+		memset(indices, 0, 16);
+	}
+
+	uint32_t bits = 0;
+	for (int i = 0; i < 16; i++)
+		bits |= (uint32_t)indices[i] << (i * 2);
+	out[0] = (uint8_t)c0;
+	out[1] = (uint8_t)(c0 >> 8);
+	out[2] = (uint8_t)c1;
+	out[3] = (uint8_t)(c1 >> 8);
+	for (int k = 0; k < 4; k++)
+		out[4 + k] = (uint8_t)(bits >> (k * 8));
+}
+
+void TextureEncoder::encodeAlphaBlock(const uint8_t block[64], uint8_t out[8])
+{
+	// Modo de 8 niveles entre el maximo (a0) y el minimo (a1) del bloque
+	int a0 = 0, a1 = 255;
+	for (int i = 0; i < 16; i++) {
+		a0 = std::max(a0, (int)block[i * 4 + 3]);
+		a1 = std::min(a1, (int)block[i * 4 + 3]);
+	}
+	int palette[8] = { a0, a1 };
+	for (int k = 2; k < 8; k++)
+		palette[k] = ((8 - k) * a0 + (k - 1) * a1) / 7;
+
+	uint64_t bits = 0;
+	if (a0 != a1) {
+		for (int i = 0; i < 16; i++) {
+			int a = block[i * 4 + 3], best = INT_MAX, index = 0;
+			for (int k = 0; k < 8; k++) {
+				int d = abs(a - palette[k]);
+				if (d < best) {
+					best = d;
+					index = k;
+				}
+			}
+			bits |= (uint64_t)index << (i * 3);
+		}
+	}
+	out[0] = (uint8_t)a0;
+	out[1] = (uint8_t)a1;
+	for (int k = 0; k < 6; k++)
+		out[2 + k] = (uint8_t)(bits >> (k * 8));
+}
+
+void TextureEncoder::encodeBC3(const uint8_t block[64], uint8_t out[16])
+{
+	encodeAlphaBlock(block, out);
+	encodeBC1(block, out + 8);
+}
+
+// Pesos de interpolacion de BC7 para indices de 4 bits (sobre 64)
+static const int BC7_WEIGHTS4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+// Extremo RGBA del modo 6: 7 bits por canal y un bit p comun. Se prueba p = 0 y p = 1 y se
+// devuelve el de menor error; value recibe el extremo ya expandido a 8 bits.
+static void quantizeBC7Endpoint(const float* e, int* q, int& p, int* value)
+{
+	int bestError = INT_MAX;
+	for (int pb = 0; pb < 2; pb++) {
+		int cq[4], cv[4], error = 0;
+		for (int c = 0; c < 4; c++) {
+			cq[c] = std::clamp((int)((e[c] - pb) * 0.5f + 0.5f), 0, 127);
+			cv[c] = (cq[c] << 1) | pb;
+			int d = cv[c] - (int)(e[c] + 0.5f);
+			error += d * d;
+		}
+		if (error < bestError) {
+			bestError = error;
+			p = pb;
+			for (int c = 0; c < 4; c++) {
+				q[c] = cq[c];
+				value[c] = cv[c];
+			}
+		}
+	}
+}
+
+// Indices del modo 6 para dos extremos ya cuantizados. Devuelve el error total.
+static int bc7Indices(const float* points, const int* v0, const int* v1, uint8_t* indices)
+{
+	int palette[16][4];
+	for (int k = 0; k < 16; k++)
+		for (int c = 0; c < 4; c++)
+			palette[k][c] = ((64 - BC7_WEIGHTS4[k]) * v0[c] + BC7_WEIGHTS4[k] * v1[c] + 32) >> 6;
+
+	int total = 0;
+	for (int i = 0; i < 16; i++) {
+		int best = INT_MAX;
+		for (int k = 0; k < 16; k++) {
+			int e = 0;
+			for (int c = 0; c < 4; c++) {
+				int d = (int)points[i * 4 + c] - palette[k][c];
+				e += d * d;
+			}
+			if (e < best) {
+				best = e;
+				indices[i] = (uint8_t)k;
+			}
+		}
+		total += best;
+	}
+	return total;
+}
+
+void TextureEncoder::encodeBC7(const uint8_t block[64], uint8_t out[16])
+{
+	float points[16 * 4];
+	for (int i = 0; i < 64; i++) points[i] = block[i];
+
+	float mean[4], axis[4], e0[4], e1[4];
+	principalAxis(points, 16, 4, mean, axis);
+	axisEndpoints(points, 16, 4, mean, axis, e0, e1);
+
+	int q0[4], q1[4], v0[4], v1[4], p0, p1;
+	quantizeBC7Endpoint(e0, q0, p0, v0);
+	quantizeBC7Endpoint(e1, q1, p1, v1);
+	uint8_t indices[16];
+	int error = bc7Indices(points, v0, v1, indices);
+
+	float weights[16];
+	for (int i = 0; i < 16; i++) weights[i] = BC7_WEIGHTS4[indices[i]] / 64.0f;
+	if (refineEndpoints(points, weights, 16, 4, e0, e1)) {
+		int r0[4], r1[4], rv0[4], rv1[4], rp0, rp1;
+		quantizeBC7Endpoint(e0, r0, rp0, rv0);
+		quantizeBC7Endpoint(e1, r1, rp1, rv1);
+		uint8_t refined[16];
+		int refinedError = bc7Indices(points, rv0, rv1, refined);
+		if (refinedError < error) {
+			memcpy(q0, r0, sizeof(q0));
+			memcpy(q1, r1, sizeof(q1));
+			p0 = rp0;
+			p1 = rp1;
+			memcpy(indices, refined, 16);
+		}
+	}
+
+	// El indice del texel 0 (ancla) se guarda con 3 bits: su bit alto tiene que ser 0
+	if (indices[0] & 8) {
+		std::swap(q0, q1);
+		std::swap(p0, p1);
+		for (int i = 0; i < 16; i++) indices[i] = (uint8_t)(15 - indices[i]);
+	}
+
+	// Bits de menor a mayor: modo (0000001), R0 R1 G0 G1 B0 B1 A0 A1, P0 P1, indices
+	memset(out, 0, 16);
+	int pos = 0;
+	auto put = [&](uint32_t value, int bits) {
+		for (int b = 0; b < bits; b++, pos++)
+			if ((value >> b) & 1) out[pos >> 3] |= (uint8_t)(1 << (pos & 7));
+	};
+	put(1 << 6, 7);
+	for (int c = 0; c < 4; c++) {
+		put(q0[c], 7);
+		put(q1[c], 7);
+	}
+	put(p0, 1);
+	put(p1, 1);
+	for (int i = 0; i < 16; i++)
+		put(indices[i], i == 0 ? 3 : 4);
+}
+
+#pragma endregion
@@ -0,0 +1,98 @@
+#include "libprgr/UniformBuffer.h"
+#include "libprgr/Profiler.h"
+#include <cstring>
+
+UniformBuffer::UniformBuffer(size_t segmentSize, int numSegments) :
+	segmentSize(segmentSize), numSegments(numSegments)
+{
+	GLint align = 0;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &align);
+	if (align > 0) alignment = (size_t)align;
+
+	this->segmentSize = alignedSize(segmentSize);
+	fences.assign(numSegments, nullptr);
+
+	glGenBuffers(1, &idBuffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, idBuffer);
+	glBufferData(GL_UNIFORM_BUFFER, this->segmentSize * numSegments, nullptr, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+UniformBuffer::~UniformBuffer()
+{
+	for (GLsync& fence : fences)
+		if (fence) glDeleteSync(fence);
+	glDeleteBuffers(1, &idBuffer);
+}
+
+size_t UniformBuffer::alignedSize(size_t size) const
+{
+	return (size + alignment - 1) / alignment * alignment;
+}
+
+void UniformBuffer::waitFence(int segment)
+{
+	GLsync& fence = fences[segment];
+	if (!fence) return;
+
+	GLenum res = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000); // 1 s
+	if (res == GL_TIMEOUT_EXPIRED || res == GL_WAIT_FAILED)
+		cout << "ERROR: " << __FILE__ << ":" << __LINE__ << " (" << __func__ << ") Espera de fence fallida en el tramo " << segment << endl;
+
+	glDeleteSync(fence);
+	fence = nullptr;
+}
+
+void UniformBuffer::resize(size_t newSegmentSize)
+{
+	// La GPU no puede estar usando el buffer antiguo mientras se redimensiona
+	for (int i = 0; i < numSegments; i++)
+		waitFence(i);
+
+	segmentSize = alignedSize(newSegmentSize);
+	glBindBuffer(GL_UNIFORM_BUFFER, idBuffer);
+	glBufferData(GL_UNIFORM_BUFFER, segmentSize * numSegments, nullptr, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void UniformBuffer::beginFrame(size_t bytesNeeded)
+{
+	// El fence del tramo anterior cubre todos los dibujados que lo han leido
+	if (current >= 0)
+		fences[current] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	if (bytesNeeded > segmentSize)
+		resize(bytesNeeded * 2);
+
+	current = (current + 1) % numSegments;
+	waitFence(current);
+	staging.clear();
+}
+
+size_t UniformBuffer::push(const void* data, size_t size)
+{
+	size_t offset = staging.size();
+	staging.resize(offset + alignedSize(size));
+	memcpy(staging.data() + offset, data, size);
+
+	if (staging.size() > segmentSize) {
+		cout << "ERROR: " << __FILE__ << ":" << __LINE__ << " (" << __func__ << ") El frame no cabe en el tramo (" << staging.size() << " > " << segmentSize << ")" << endl;
+	}
+	return current * segmentSize + offset;
+}
+
+void UniformBuffer::endFrame()
+{
+	if (staging.empty()) return;
+
+	size_t bytes = std::min(staging.size(), segmentSize);
+	glBindBuffer(GL_UNIFORM_BUFFER, idBuffer);
+	glBufferSubData(GL_UNIFORM_BUFFER, current * segmentSize, bytes, staging.data());
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	PROFILE_COUNT(COUNTER_UNIFORM_UPLOADS, 1);
+}
+
+void UniformBuffer::bindRange(unsigned int bindingPoint, size_t offset, size_t size)
+{
+	glBindBufferRange(GL_UNIFORM_BUFFER, bindingPoint, idBuffer, offset, size);
+}
@@ -0,0 +1,288 @@
+#include "libprgr/VertexLayout.h"
+#include <algorithm>
+#include <cstring>
+
+#pragma region --- CONVERSIONES ---
+
+// float -> half con redondeo al par mas cercano (incluye subnormales, infinito y NaN).
+static unsigned short floatToHalf(float f)
+{
+	unsigned int x;
+	memcpy(&x, &f, sizeof(x));
+	unsigned int sign = (x >> 16) & 0x8000;
+	unsigned int exponent = (x >> 23) & 0xff;
+	unsigned int mantissa = x & 0x7fffff;
+
+	if (exponent == 0xff)
+		return (unsigned short)(sign | 0x7c00 | (mantissa ? 0x200 : 0));
+
+	int e = (int)exponent - 127 + 15;
+	if (e >= 31)
+		return (unsigned short)(sign | 0x7c00);
+
+	if (e <= 0) {
+		if (e < -10) return (unsigned short)sign;
+		mantissa |= 0x800000;
+		unsigned int shift = 14 - e;
+		unsigned int h = mantissa >> shift;
+		unsigned int rest = mantissa & ((1u << shift) - 1), halfway = 1u << (shift - 1);
+		if (rest > halfway || (rest == halfway && (h & 1))) h++;
+		return (unsigned short)(sign | h);
+	}
+
+	unsigned int h = ((unsigned int)e << 10) | (mantissa >> 13);
+	unsigned int rest = mantissa & 0x1fff;
+	if (rest > 0x1000 || (rest == 0x1000 && (h & 1))) h++; // El acarreo puede subir el exponente: es correcto
+	return (unsigned short)(sign | h);
+}
+
+static float halfToFloat(unsigned short h)
+{
+	unsigned int sign = (unsigned int)(h & 0x8000) << 16;
+	unsigned int exponent = (h >> 10) & 0x1f;
+	unsigned int mantissa = h & 0x3ff;
+
+	if (exponent == 0) {
+		float v = ldexpf((float)mantissa, -24);
+		return sign ? -v : v;
+	}
+
+	unsigned int x = exponent == 31 ?
+		sign | 0x7f800000 | (mantissa << 13) :
+		sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+	float f;
+	memcpy(&f, &x, sizeof(f));
+	return f;
+}
+
+static int toSnorm(float v, int maxValue)
+{
+	return (int)roundf(std::clamp(v, -1.0f, 1.0f) * maxValue);
+}
+
+// Normal unitaria -> octaedro plegado sobre el cuadrado [-1, 1]^2.
+static void octahedralEncode(const vector4f& n, float& u, float& v)
+{
+	float l1 = fabsf(n.x) + fabsf(n.y) + fabsf(n.z);
+	if (l1 == 0.0f) { u = 0.0f; v = 0.0f; return; }
+
+	float x = n.x / l1, y = n.y / l1;
+	if (n.z < 0.0f) {
+		float fx = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+		float fy = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+		x = fx;
+		y = fy;
+	}
+	u = x;
+	v = y;
+}
+
+// Misma decodificacion que shader.vert con VERTEX_OCT_NORMAL.
+static vector4f octahedralDecode(float u, float v)
+{
+	vector4f n = { u, v, 1.0f - fabsf(u) - fabsf(v), 0.0f };
+	float t = std::max(-n.z, 0.0f);
+	n.x += n.x >= 0.0f ? -t : t;
+	n.y += n.y >= 0.0f ? -t : t;
+	float len = length(n);
+	if (len > 0.0f) { n.x /= len; n.y /= len; n.z /= len; }
+	return n;
+}
+
+#pragma endregion
+
+#pragma region --- VERTEX LAYOUT ---
+
+GLint VertexLayout::components(vertexFormat_e format)
+{
+	switch (format) {
+	case VERTEX_FLOAT4: return 4;
+	case VERTEX_FLOAT3: return 3;
+	case VERTEX_HALF2: return 2;
+	case VERTEX_UNORM8x4: return 4;
+	case VERTEX_SNORM_10_10_10_2: return 4;
+	case VERTEX_OCT_SNORM16x2: return 2;
+	}
+	return 0;
+}
+
+GLenum VertexLayout::glType(vertexFormat_e format)
+{
+	switch (format) {
+	case VERTEX_FLOAT4: return GL_FLOAT;
+	case VERTEX_FLOAT3: return GL_FLOAT;
+	case VERTEX_HALF2: return GL_HALF_FLOAT;
+	case VERTEX_UNORM8x4: return GL_UNSIGNED_BYTE;
+	case VERTEX_SNORM_10_10_10_2: return GL_INT_2_10_10_10_REV;
+	case VERTEX_OCT_SNORM16x2: return GL_SHORT;
+	}
+	return GL_FLOAT;
+}
+
+GLboolean VertexLayout::normalized(vertexFormat_e format)
+{
+	return format == VERTEX_UNORM8x4 || format == VERTEX_SNORM_10_10_10_2 || format == VERTEX_OCT_SNORM16x2;
+}
+
+unsigned int VertexLayout::size(vertexFormat_e format)
+{
+	switch (format) {
+	case VERTEX_FLOAT4: return 16;
+	case VERTEX_FLOAT3: return 12;
+	default: return 4;
+	}
+}
+
+void VertexLayout::add(string attributeName, vertexSemantic_e semantic, vertexFormat_e format)
+{
+	attributes.push_back({ attributeName, semantic, format, stride });
+	stride += size(format);
+}
+
+void VertexLayout::pack(const vector<vertex_t>& vertices, vector<unsigned char>& out) const
+{
+	out.assign(vertices.size() * stride, 0);
+
+	for (size_t i = 0; i < vertices.size(); i++) {
+		const vertex_t& vx = vertices[i];
+		unsigned char* base = out.data() + i * stride;
+
+		for (const vertexAttribute_t& a : attributes) {
+			const vector4f& v = a.semantic == VERTEX_POSITION ? vx.vPos :
+				a.semantic == VERTEX_COLOR ? vx.vColor :
+				a.semantic == VERTEX_NORMAL ? vx.vNormal : vx.vTextureCoord;
+			unsigned char* dst = base + a.offset;
+
+			switch (a.format) {
+			case VERTEX_FLOAT4:
+				memcpy(dst, v.data, 16);
+				break;
+			case VERTEX_FLOAT3:
+				memcpy(dst, v.data, 12);
+				break;
+			case VERTEX_HALF2: {
+				unsigned short h[2] = { floatToHalf(v.x), floatToHalf(v.y) };
+				memcpy(dst, h, 4);
+				break;
+			}
+			case VERTEX_UNORM8x4:
+				for (int c = 0; c < 4; c++)
+					dst[c] = (unsigned char)roundf(std::clamp(v.data[c], 0.0f, 1.0f) * 255.0f);
+				break;
+			case VERTEX_SNORM_10_10_10_2: {
+				unsigned int packed =
+					((unsigned int)toSnorm(v.x, 511) & 0x3ff) |
+					(((unsigned int)toSnorm(v.y, 511) & 0x3ff) << 10) |
+					(((unsigned int)toSnorm(v.z, 511) & 0x3ff) << 20) |
+					(((unsigned int)toSnorm(v.w, 1) & 0x3) << 30);
+				memcpy(dst, &packed, 4);
+				break;
+			}
+			case VERTEX_OCT_SNORM16x2: {
+				float u, w;
+				octahedralEncode(v, u, w);
+				short s[2] = { (short)toSnorm(u, 32767), (short)toSnorm(w, 32767) };
+				memcpy(dst, s, 4);
+				break;
+			}
+			}
+		}
+	}
+}
+
+vertex_t VertexLayout::unpack(const unsigned char* data) const
+{
+	vertex_t vx = {};
+	vx.vPos.w = 1.0f;
+
+	for (const vertexAttribute_t& a : attributes) {
+		vector4f& v = a.semantic == VERTEX_POSITION ? vx.vPos :
+			a.semantic == VERTEX_COLOR ? vx.vColor :
+			a.semantic == VERTEX_NORMAL ? vx.vNormal : vx.vTextureCoord;
+		const unsigned char* src = data + a.offset;
+
+		switch (a.format) {
+		case VERTEX_FLOAT4:
+			memcpy(v.data, src, 16);
+			break;
+		case VERTEX_FLOAT3:
+			memcpy(v.data, src, 12);
+			v.w = 1.0f;
+			break;
+		case VERTEX_HALF2: {
+			unsigned short h[2];
+			memcpy(h, src, 4);
+			v = { halfToFloat(h[0]), halfToFloat(h[1]), 0.0f, 1.0f };
+			break;
+		}
+		case VERTEX_UNORM8x4:
+			for (int c = 0; c < 4; c++)
+				v.data[c] = src[c] / 255.0f;
+			break;
+		case VERTEX_SNORM_10_10_10_2: {
+			unsigned int packed;
+			memcpy(&packed, src, 4);
+			// Extension de signo de cada campo
+			int x = (int)(packed << 22) >> 22, y = (int)(packed << 12) >> 22, z = (int)(packed << 2) >> 22, w = (int)packed >> 30;
+			v = { std::max(x / 511.0f, -1.0f), std::max(y / 511.0f, -1.0f), std::max(z / 511.0f, -1.0f), std::max((float)w, -1.0f) };
+			break;
+		}
+		case VERTEX_OCT_SNORM16x2: {
+			short s[2];
+			memcpy(s, src, 4);
+			v = octahedralDecode(std::max(s[0] / 32767.0f, -1.0f), std::max(s[1] / 32767.0f, -1.0f));
+			break;
+		}
+		}
+	}
+	return vx;
+}
+
+vector<string> VertexLayout::shaderDefines() const
+{
+	for (const vertexAttribute_t& a : attributes)
+		if (a.format == VERTEX_OCT_SNORM16x2)
+			return { "VERTEX_OCT_NORMAL" };
+	return {};
+}
+
+const VertexLayout& VertexLayout::full()
+{
+	static VertexLayout layout = [] {
+		VertexLayout l("full");
+		l.add("vPos", VERTEX_POSITION, VERTEX_FLOAT4);
+		l.add("vColor", VERTEX_COLOR, VERTEX_FLOAT4);
+		l.add("vNormal", VERTEX_NORMAL, VERTEX_FLOAT4);
+		l.add("vTextureCoord", VERTEX_TEXCOORD, VERTEX_FLOAT4);
+		return l;
+	}();
+	return layout;
+}
+
+const VertexLayout& VertexLayout::packed()
+{
+	static VertexLayout layout = [] {
+		VertexLayout l("packed");
+		l.add("vPos", VERTEX_POSITION, VERTEX_FLOAT3);
+		l.add("vColor", VERTEX_COLOR, VERTEX_UNORM8x4);
+		l.add("vNormal", VERTEX_NORMAL, VERTEX_SNORM_10_10_10_2);
+		l.add("vTextureCoord", VERTEX_TEXCOORD, VERTEX_HALF2);
+		return l;
+	}();
+	return layout;
+}
+
+const VertexLayout& VertexLayout::packedOctahedral()
+{
+	static VertexLayout layout = [] {
+		VertexLayout l("packed_octahedral");
+		l.add("vPos", VERTEX_POSITION, VERTEX_FLOAT3);
+		l.add("vColor", VERTEX_COLOR, VERTEX_UNORM8x4);
+		l.add("vNormal", VERTEX_NORMAL, VERTEX_OCT_SNORM16x2);
+		l.add("vTextureCoord", VERTEX_TEXCOORD, VERTEX_HALF2);
+		return l;
+	}();
+	return layout;
+}
+
+#pragma endregion
@@ -0,0 +1,6 @@
+#version 330
+
+// Prepass de profundidad (Render::depthPrepass) con data/shader.vert: solo escribe la profundidad de
+// los objetos opacos, para que la pasada normal sombree cada pixel una sola vez
+void main() {
+}
@@ -3,21 +3,45 @@
 #define MAX_LIGHTS 8
 
 struct Light {
-    int type;         // 0 = directional, 1 = point
     vec4 position;
     vec4 color;
-    float intensity;
     vec4 direction;
+    int type;         // 0 = directional, 1 = point
+    float intensity;
 };
 
-uniform Light uLights[MAX_LIGHTS];
-uniform int uNumLights;
+// Bloques uniform (std140), misma declaracion que en shader.vert y Render.h
+layout(std140, row_major) uniform FrameData {
+    mat4 uView;
+    mat4 uProjection;
+    mat4 uViewProjection;
+    vec4 uViewPos;
+    mat4 uClusterView;    // Vista con la que se repartieron las luces puntuales (w: la de clip)
+    vec4 uClusterParams;  // Escala x e y de la proyeccion, zNear, cortes por unidad de log(profundidad / zNear)
+    ivec4 uClusterGrid;   // Columnas, filas, cortes, luces puntuales
+    int uNumLights;       // Direccionales
+    Light uLights[MAX_LIGHTS];
+};
+
+layout(std140) uniform MaterialData {
+    float uKd;        // Coef. difuso
+    float uKs;        // Coef. especular
+    int uShininess;
+};
 
+// Con TEXTURE_ARRAY la textura es una capa (la de la instancia) de un TextureArray
+#ifdef TEXTURE_ARRAY
+uniform sampler2DArray uTexture;
+flat in float fTextureLayer;
+#else
 uniform sampler2D uTexture;
-uniform vec4 uViewPos;
-uniform float uKd = 0.8;  // Coef. difuso
-uniform float uKs = 0.5;  // Coef. especular
-uniform int uShininess = 32;
+#endif
+
+// Luces puntuales por clusters (ver LightClusters): dos texels por luz (posicion + radio, color +
+// intensidad), primera luz y cuantas de cada cluster, e indices de luz de todos los clusters
+uniform samplerBuffer uPointLights;
+uniform usamplerBuffer uClusterTable;
+uniform usamplerBuffer uClusterLights;
 
 in vec4 fColor;
 in vec4 fNormal;
@@ -26,37 +50,65 @@ in vec4 fTextureCoord;
 
 out vec4 FragColor;
 
+// Ambiental + difusa + especular de una luz que llega desde lightDir
+vec3 shade(vec3 lightDir, vec3 color, float intensity, vec3 norm, vec3 viewDir) {
+    // Ambiental
+    vec3 ambient = 0.1 * color;
+
+    // Difusa
+    float diff = max(dot(norm, lightDir), 0.0);
+    vec3 diffuse = uKd * diff * color;
+
+    // Epecular
+    vec3 reflectDir = reflect(-lightDir, norm);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), uShininess);
+    vec3 specular = uKs * spec * color;
+
+    return (ambient + diffuse + specular) * intensity;
+}
+
+// Cluster del fragmento: celda de pantalla y corte de profundidad con la vista del reparto
+int clusterIndex(vec4 worldPos) {
+    vec4 v = uClusterView * worldPos;
+    float depth = max(-v.z, uClusterParams.z);
+    int slice = clamp(int(log(depth / uClusterParams.z) * uClusterParams.w), 0, uClusterGrid.z - 1);
+    vec2 ndc = uClusterParams.xy * v.xy / max(v.w, 1e-6);
+    ivec2 tile = clamp(ivec2(floor((ndc * 0.5 + 0.5) * vec2(uClusterGrid.xy))), ivec2(0), uClusterGrid.xy - 1);
+    return (slice * uClusterGrid.y + tile.y) * uClusterGrid.x + tile.x;
+}
+
 void main() {
+#ifdef TEXTURE_ARRAY
+    vec4 texColor = texture(uTexture, vec3(fTextureCoord.xy, fTextureLayer));
+#else
     vec4 texColor = texture(uTexture, fTextureCoord.xy);
+#endif
+#ifdef ALPHA_TEST
+    // Solo en los materiales con transparencias: un discard obliga a sombrear antes de probar la
+    // profundidad (sin early-Z), asi que los opacos usan la variante sin el
     if (texColor.a < 0.1) discard;
+#endif
 
     vec3 result = vec3(0.0);
     vec3 norm = normalize(fNormal.xyz);
     vec3 viewDir = normalize(uViewPos.xyz - fFragPos.xyz);
 
-    for (int i = 0; i < uNumLights; ++i) { // Iterar sobre las luces y calcular la iluminacin
-        vec3 lightDir;
-
-        if (uLights[i].type == 0) {
-            lightDir = normalize(-uLights[i].direction.xyz);  // Direccional
-        } else {
-            lightDir = normalize(uLights[i].position.xyz - fFragPos.xyz);  // Puntual
-        }
-
-        // Ambiental
-        vec3 ambient = 0.1 * uLights[i].color.rgb;
+    for (int i = 0; i < uNumLights; ++i) // Direccionales: todas en todos los fragmentos
+        result += shade(normalize(-uLights[i].direction.xyz), uLights[i].color.rgb, uLights[i].intensity, norm, viewDir);
 
-        // Difusa
-        float diff = max(dot(norm, lightDir), 0.0);
-        vec3 diffuse = uKd * diff * uLights[i].color.rgb;
+    // Puntuales: solo las del cluster, atenuadas hasta 0 en su radio
+    uvec2 range = texelFetch(uClusterTable, clusterIndex(fFragPos)).xy;
+    for (uint k = 0u; k < range.y; ++k) {
+        int light = int(texelFetch(uClusterLights, int(range.x + k)).r);
+        vec4 positionRadius = texelFetch(uPointLights, light * 2);
+        vec4 colorIntensity = texelFetch(uPointLights, light * 2 + 1);
 
-        // Epecular
-        vec3 reflectDir = reflect(-lightDir, norm);
-        float spec = pow(max(dot(viewDir, reflectDir), 0.0), uShininess);
-        vec3 specular = uKs * spec * uLights[i].color.rgb;
+        vec3 toLight = positionRadius.xyz - fFragPos.xyz;
+        float ratio = dot(toLight, toLight) / (positionRadius.w * positionRadius.w);
+        float window = clamp(1.0 - ratio * ratio, 0.0, 1.0); // 1 - (d / radio)^4
+        if (window <= 0.0) continue;
 
-        // Resultado parcial
-        result += (ambient + diffuse + specular) * uLights[i].intensity;
+        result += shade(normalize(toLight), colorIntensity.rgb, colorIntensity.a, norm, viewDir) * (window * window);
     }
 
     result *= texColor.rgb * fColor.rgb;
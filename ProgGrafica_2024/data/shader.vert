@@ -2,36 +2,94 @@
 
 attribute vec4 vPos;         // Posicin del vrtice (x,y,z,w)
 attribute vec4 vColor;       // Color RGBA
-attribute vec4 vNormal;      // Normal del vrtice (x,y,z,w)
+attribute vec4 vNormal;      // Normal del vertice (x,y,z,w); con VERTEX_OCT_NORMAL solo xy, en octaedrica
 attribute vec4 vTextureCoord;  // Coordenadas de textura (4 componentes, aunque solo usaremos x,y)
 
-// Matrices de transformacin:
-uniform mat4 uModel;
-uniform mat4 uView;
-uniform mat4 uProjection;
+// Atributos por instancia (divisor 1), ver Render::drawBatch.
+// Filas 0..2 de la matriz de modelo y de la matriz normal: la fila 3 siempre es (0,0,0,1).
+// La w de las filas de la normal no se usa (la normal va con w = 0): iNormal0.w lleva la capa de la
+// textura con TEXTURE_ARRAY.
+attribute vec4 iModel0;
+attribute vec4 iModel1;
+attribute vec4 iModel2;
+attribute vec4 iNormal0;
+attribute vec4 iNormal1;
+attribute vec4 iNormal2;
+
+#define MAX_LIGHTS 8
+
+struct Light {
+    vec4 position;
+    vec4 color;
+    vec4 direction;
+    int type;         // 0 = directional, 1 = point
+    float intensity;
+};
+
+// Bloques uniform (std140), misma declaracin que en shader.frag y Render.h.
+// Las matrices vienen por filas desde la CPU (row_major).
+layout(std140, row_major) uniform FrameData {
+    mat4 uView;
+    mat4 uProjection;
+    mat4 uViewProjection; // Proyeccion * vista, calculada en la CPU
+    vec4 uViewPos;
+    mat4 uClusterView;    // Vista con la que se repartieron las luces puntuales (w: la de clip)
+    vec4 uClusterParams;  // Escala x e y de la proyeccion, zNear, cortes por unidad de log(profundidad / zNear)
+    ivec4 uClusterGrid;   // Columnas, filas, cortes, luces puntuales
+    int uNumLights;       // Direccionales
+    Light uLights[MAX_LIGHTS];
+};
+
+layout(std140) uniform MaterialData {
+    float uKd;
+    float uKs;
+    int uShininess;
+};
 
 // Variables de salida hacia el fragment shader:
 out vec4 fColor;      
 out vec4 fNormal;     
 out vec4 fFragPos;    
 out vec4 fTextureCoord;   
+#ifdef TEXTURE_ARRAY
+flat out float fTextureLayer;
+#endif
+
+// Misma profundidad en todos los programas que usan este shader: el prepass de profundidad
+// (data/depth.frag) la escribe y la pasada normal la compara con GL_LEQUAL
+invariant gl_Position;
+
+// Normal unitaria desde el octaedro plegado en [-1, 1]^2 (VertexLayout::packedOctahedral)
+vec3 decodeOctahedral(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
 
 void main() {
-    // Transformacin de posicin:
-    vec4 worldPos = uModel * vPos;
+    // Transformacin de posicin (matriz de modelo de la instancia, por filas):
+    vec4 worldPos = vec4(dot(iModel0, vPos), dot(iModel1, vPos), dot(iModel2, vPos), 1.0);
     
     // Posicin final en clip space:
-    gl_Position = uProjection * uView * worldPos;
+    gl_Position = uViewProjection * worldPos;
 
     // Pasamos datos al fragment shader:
     fFragPos = worldPos;
     
     // Transformacin de normales:
     // Usamos la matriz normal (transpuesta de la inversa) para mantener ortogonalidad
-    fNormal = transpose(inverse(uModel)) * vNormal;
-    fNormal.w = 0.0; // Aseguramos que w sea 0 para que sea un vector y no un punto
+#ifdef VERTEX_OCT_NORMAL
+    vec4 normal = vec4(decodeOctahedral(vNormal.xy), 0.0);
+#else
+    vec4 normal = vec4(vNormal.xyz, 0.0); // w = 0 para que sea un vector y no un punto
+#endif
+    fNormal = vec4(dot(iNormal0, normal), dot(iNormal1, normal), dot(iNormal2, normal), 0.0);
     
     // Datos directos:
     fColor = vColor;
     fTextureCoord = vTextureCoord;
+#ifdef TEXTURE_ARRAY
+    fTextureLayer = iNormal0.w;
+#endif
 }
\ No newline at end of file
@@ -0,0 +1,94 @@
+#pragma once
+#include "common.h"
+#include "Object3D.h"
+#include "StagingBuffer.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+
+#pragma region --- ASSET LOADER ---
+
+// Carga de objetos en segundo plano.
+//
+// load() solo apunta el pedido. Un grupo de hilos lee el .fiis, decodifica la textura (o la lee de su
+// cache .ptex), suelda, genera los LOD, empaqueta y calcula el prototipo del colisionador
+// (MeshLibrary::build). Al hilo GL le queda lo que necesita el contexto, y lo hace en update() con un
+// limite de tiempo por frame. Sube la textura nivel a nivel y la geometria a traves de un
+// StagingBuffer. Despues registra la malla en MeshLibrary y termina cada objeto con Object3D::setMesh
+// (colisionador y programa). Asi el primer frame no espera a los ficheros, y un fichero grande
+// reparte su subida entre varios frames en vez de dar un tiron.
+//
+// Los pedidos del mismo fichero comparten un solo trabajo. Si la malla ya esta en MeshLibrary no se
+// lee nada: solo se termina el objeto (o se sube lo que falte).
+class AssetLoader {
+public:
+
+	// Hilos de carga: 0 para uno por nucleo menos los del hilo GL y la simulacion (al menos uno).
+	// Se crean con el primer load().
+	AssetLoader(int threads = 0);
+	~AssetLoader();
+
+	// Pide cargar file en obj. El objeto no se toca hasta que update() lo devuelve terminado
+	// (como con loadFromFile). Hilo GL.
+	void load(Object3D* obj, const string& file);
+
+	// Hilo GL: sube y termina lo que este listo hasta gastar budgetMs (al menos un paso, asi que
+	// siempre avanza) y devuelve los objetos terminados en este frame.
+	vector<Object3D*> update(double budgetMs);
+
+	// Hilo GL: update sin limite hasta que no quede nada pendiente. Devuelve los objetos terminados.
+	vector<Object3D*> finish();
+
+	// Para los hilos y descarta lo pendiente (los objetos pedidos se quedan sin malla). Necesita el
+	// contexto GL si se llego a subir algo.
+	void cancel();
+
+	// Objetos pedidos que aun no estan terminados (hilo GL).
+	size_t pending() const { return pendingObjects; }
+
+	int threadCount() const { return (int)workers.size(); }
+
+	// Estadisticas desde el arranque
+	unsigned int loadedObjects = 0;  // Terminados
+	unsigned int failedObjects = 0;  // Su fichero no se pudo leer
+	unsigned int builtMeshes = 0;    // Ficheros leidos por los hilos
+	unsigned int uploadSteps = 0;    // Pasos de update (un nivel de textura, una geometria o un objeto)
+	double maxUpdateMs = 0.0;        // update() mas largo
+	StagingBuffer* staging = nullptr; // Buffer de subida (se crea en el primer update que lo necesita)
+
+private:
+
+	// Un fichero en curso y los objetos que lo esperan
+	typedef struct {
+		string file;
+		Mesh* mesh = nullptr;        // La del hilo de carga o la de MeshLibrary (con una referencia del trabajo)
+		bool built = false;          // El hilo de carga ha terminado (mesh puede ser nullptr si fallo)
+		bool registered = false;     // mesh ya esta en MeshLibrary
+		int nextLevel = 0;           // Siguiente nivel de textura que subir
+		vector<Object3D*> objects;   // Pendientes de terminar
+	} job_t;
+
+	int threadTarget;
+	vector<std::thread> workers;
+
+	// Compartido con los hilos de carga
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::deque<job_t*> queue;    // Trabajos por leer
+	vector<job_t*> built;        // Leidos, esperando al hilo GL
+	bool stopping = false;
+
+	// Solo del hilo GL
+	map<string, job_t*> jobs;    // Trabajos en curso por fichero
+	vector<job_t*> uploading;    // Leidos (o ya cargados), en orden de llegada
+	size_t pendingObjects = 0;
+
+	void startWorkers();
+	void workerLoop();
+
+	// Un paso de subida del primer trabajo de uploading. Devuelve false si no habia nada que hacer.
+	bool step(vector<Object3D*>& ready);
+};
+
+#pragma endregion
@@ -1,8 +1,13 @@
 #pragma once
 #include "common.h"
 #include "vectorMath.h"
+#include "fastMath.h"
 using namespace libPRGR;
 
+// Nivel de precision de los tests de colision (ver fastMath.h). Las distancias de
+// colision toleran el error de mathFast; las matrices de camara siguen siendo exactas.
+typedef mathFast colliderMath;
+
 typedef enum {
     sphere, AABB_t
 } collTypes;
@@ -80,6 +85,18 @@ public:
 
     // Obtener tamao
     virtual vector4f getSize() const = 0;
+
+    // Copia profunda (incluye la jerarquia de sons)
+    virtual Collider* clone() const = 0;
+
+protected:
+
+    // Sustituye cada hijo por su copia (tras copiar el vector de punteros)
+    void cloneSons() {
+        for (auto& son : sons) {
+            son = son->clone();
+        }
+    }
 };
 
 class Sphere : public Collider {
@@ -102,6 +119,7 @@ public:
     // Mtodos especficos de Sphere
     vector4f getCenter() const override;
     vector4f getSize() const override;
+    Collider* clone() const override;
     void computeBoundingSphere();
 };
 
@@ -125,5 +143,6 @@ public:
     // Mtodos especficos de AABB
     vector4f getCenter() const override;
     vector4f getSize() const override;
+    Collider* clone() const override;
     void computeBoundingBox();
 };
\ No newline at end of file
@@ -1,6 +1,10 @@
 #pragma once
 #include "common.h"
+#include <atomic>
+#include <cstdint>
 
+// El estado lo escriben los callbacks de GLFW en el hilo principal y lo lee la simulacion
+// (Render::threadedSimulation) en el suyo: tablas fijas de atomicos en vez de map.
 class EventManager {
 
 public:
@@ -12,11 +16,11 @@ public:
 	// --- RATN ---
 
 	typedef struct {
-		double posX, posY; // Coordenadas X e Y de la posicin del mouse
-		std::map<int, bool> buttons; // Mapa que almacena el estado de los botones del mouse(presionado o no)
+		std::atomic<double> posX, posY; // Coordenadas X e Y de la posicion del mouse
+		std::atomic<bool> buttons[GLFW_MOUSE_BUTTON_LAST + 1]; // Estado de los botones del mouse (presionado o no)
 	} mouseState_t;
 
-	static inline mouseState_t mouseState = { 0, 0 };
+	static inline mouseState_t mouseState; // Estatico: empieza a cero
 
 	// Gestor de los botones del ratn.
 	static void mouseButtonManager(GLFWwindow* window, int button, int action, int mods);
@@ -27,9 +31,94 @@ public:
 	
 	// --- TECLADO ---
 
-	inline static map <int, bool> keyState;
+	inline static std::atomic<bool> keyState[GLFW_KEY_LAST + 1] = {};
 
 	// Gestor del input del teclado.
 	static void keyEventManager(GLFWwindow* window, int key, int scancode, int action, int mods);
 
+
+	// --- GRABACION Y REPRODUCCION ---
+
+	// Se graban los cambios de estado que ve cada tick de simulacion, no la hora de cada evento:
+	// al reproducirlos cada tick lee exactamente lo mismo, vaya la maquina rapida o lenta. Una
+	// pulsacion que empieza y acaba entre dos ticks no se graba, pero la simulacion tampoco la vio.
+	// Fichero: cabecera (inputFileHeader_t) y eventos de la forma [ticks desde el anterior (varint),
+	// tipo (inputEvent_e), tecla o boton (2 bytes) | posicion del raton (2 doubles)].
+
+	typedef enum {
+		INPUT_KEY_DOWN,
+		INPUT_KEY_UP,
+		INPUT_BUTTON_DOWN,
+		INPUT_BUTTON_UP,
+		INPUT_MOUSE_POS
+	} inputEvent_e;
+
+	// Graba desde el siguiente tick hasta stop(). simulationRate se guarda para reproducir con los
+	// mismos ticks. Devuelve false si no se pudo crear el fichero.
+	static bool startRecording(const string& fileName, double simulationRate);
+
+	// Lee la grabacion y la reproduce desde el siguiente tick; mientras dura se ignora el teclado
+	// y el raton. Al acabar se vuelve a leer la entrada normal.
+	static bool startReplay(const string& fileName);
+
+	// Termina la grabacion (y escribe el fichero) o la reproduccion
+	static void stop();
+
+	// Al empezar cada tick (Render::updateScene, en el hilo de la simulacion): graba los cambios
+	// desde el tick anterior o aplica los de la grabacion para este tick
+	static void beginTick();
+
+	static bool isRecording() { return mode == MODE_RECORDING; }
+	static bool isReplaying() { return mode == MODE_REPLAYING; }
+
+	// Ticks que dura la grabacion cargada y ticks por segundo con los que se grabo (hay que usar
+	// los mismos en Render::simulationRate para repetir el recorrido)
+	static uint32_t replayTicks() { return replayLength; }
+	static double replayRate() { return replaySimulationRate; }
+
+private:
+
+	static const uint32_t INPUT_FILE_VERSION = 1;
+
+	typedef struct {
+		char magic[4];       // "PRGI"
+		uint32_t version;    // INPUT_FILE_VERSION
+		uint32_t ticks;      // Ticks grabados
+		double simulationRate; // Ticks por segundo con los que se grabo
+	} inputFileHeader_t;
+
+	typedef struct {
+		uint32_t tick;
+		uint8_t type; // inputEvent_e
+		uint16_t code;
+		double x, y;
+	} inputRecord_t;
+
+	typedef enum {
+		MODE_IDLE,
+		MODE_RECORDING,
+		MODE_REPLAYING
+	} inputMode_e;
+
+	// Los callbacks lo leen en el hilo principal; beginTick lo cambia al acabar la reproduccion
+	inline static std::atomic<int> mode = MODE_IDLE;
+	inline static uint32_t tick = 0; // Ticks desde startRecording / startReplay
+
+	// Grabacion: ultimo estado grabado y eventos codificados
+	inline static string recordFileName;
+	inline static bool recordedKeys[GLFW_KEY_LAST + 1] = {};
+	inline static bool recordedButtons[GLFW_MOUSE_BUTTON_LAST + 1] = {};
+	inline static double recordedX = 0, recordedY = 0;
+	inline static uint32_t lastEventTick = 0;
+	inline static double recordSimulationRate = 0;
+	inline static vector<uint8_t> recordBuffer;
+	static void writeEvent(inputEvent_e type, uint16_t code, double x = 0, double y = 0);
+
+	// Reproduccion
+	inline static vector<inputRecord_t> replayEvents;
+	inline static size_t replayCursor = 0;
+	inline static uint32_t replayLength = 0;
+	inline static double replaySimulationRate = 0;
+
+	static void clearState();
 };
\ No newline at end of file
@@ -0,0 +1,95 @@
+#pragma once
+#include "common.h"
+#include "vectorMath.h"
+#include "fastMath.h"
+#include "Collider.h"
+
+using namespace libPRGR;
+
+// Radio de los objetos sin colisionador: siempre visibles (finito para que las cajas del BVH no den NaN).
+#define CULL_UNBOUNDED_RADIUS 1e30f
+
+#pragma region --- FRUSTUM CULLER ---
+
+// Culling de volumenes envolventes contra los 6 planos del frustum.
+//
+// Los volumenes se guardan como estructura de arrays (SoA): centro, semiejes y radio.
+// Una esfera es centro + radio con semiejes 0 y una AABB es centro + semiejes con radio 0.
+// Para cada plano (n, w) el volumen esta fuera si n*c + w < -(radio + |n|*semiejes), que
+// para la caja es el test del vertice positivo. Esferas y cajas pasan por el mismo bucle,
+// de 4 en 4 con SSE2.
+class FrustumCuller {
+public:
+
+	vector<float> centerX, centerY, centerZ;
+	vector<float> extentX, extentY, extentZ;
+	vector<float> radius;
+
+	void clear();
+	size_t size() const { return centerX.size(); }
+
+	// Anade el volumen en mundo del colisionador (Sphere o AABB). Sin colisionador, siempre visible.
+	void add(const Collider* collider);
+	void addSphere(const vector4f& center, float r);
+	void addAABB(const vector4f& min, const vector4f& max);
+
+	// visible[i] = 1 si el volumen i toca el frustum, 0 si no. Devuelve cuantos son visibles.
+	size_t cull(const vector4f planes[6], vector<unsigned char>& visible) const;
+
+	// Mismo resultado sin SSE (referencia para el benchmark).
+	size_t cullScalar(const vector4f planes[6], vector<unsigned char>& visible) const;
+
+	// Prueba solo los volumenes indicados contra numPlanes planos y escribe visible[indices[k]].
+	size_t cullIndices(const vector4f* planes, int numPlanes, const int* indices, size_t count, unsigned char* visible) const;
+};
+
+#pragma endregion
+
+#pragma region --- CULLING BVH ---
+
+// Jerarquia de cajas sobre los volumenes de un FrustumCuller para culling jerarquico.
+//
+// Un nodo fuera de un plano descarta todo su subarbol sin probar sus objetos; un nodo
+// completamente dentro de un plano deja de probar ese plano en sus hijos, y si esta dentro
+// de los 6 marca todo el subarbol como visible. La topologia se construye al cambiar el
+// conjunto de objetos (build) y cada frame solo se reajustan las cajas (refit, O(N)).
+class CullingBVH {
+public:
+
+	// Objetos por hoja como maximo.
+	static const int LEAF_SIZE = 16;
+
+	// Construye el arbol (particion por la mediana del eje mas largo).
+	void build(const FrustumCuller& bounds);
+
+	// Recalcula las cajas con los volumenes actuales sin cambiar la topologia.
+	void refit(const FrustumCuller& bounds);
+
+	// Igual que FrustumCuller::cull recorriendo el arbol. Devuelve cuantos son visibles.
+	size_t cull(const FrustumCuller& bounds, const vector4f planes[6], vector<unsigned char>& visible);
+
+	// Objetos indexados (debe coincidir con bounds.size() para refit).
+	size_t size() const { return indices.size(); }
+
+	// Nodos visitados en el ultimo cull.
+	unsigned int nodesVisited = 0;
+
+private:
+
+	typedef struct {
+		float min[3];
+		float max[3];
+		int left;  // Hijo izquierdo (el derecho es left + 1); -1 en las hojas
+		int first; // Rango [first, first + count) de indices que cubre el subarbol
+		int count;
+	} node_t;
+
+	vector<node_t> nodes;
+	vector<int> indices; // Objetos ordenados de forma que cada subarbol es un rango contiguo
+
+	void buildNode(const FrustumCuller& bounds, int node, int first, int count);
+	void fitLeaf(const FrustumCuller& bounds, node_t& node) const;
+	size_t cullNode(const FrustumCuller& bounds, int node, const vector4f planes[6], int planeMask, unsigned char* visible);
+};
+
+#pragma endregion
@@ -0,0 +1,72 @@
+#pragma once
+#include "common.h"
+#include "VertexLayout.h"
+#include "StagingBuffer.h"
+
+class Mesh;
+
+#pragma region --- GEOMETRY ARENA ---
+
+// Buffers de geometria estatica compartidos: un VBO y un IBO grandes por formato de vertices y tipo
+// de indice, con las mallas subreservadas dentro. Las mallas de una misma arena se pueden dibujar
+// juntas con glMultiDrawElementsIndirect (un VAO y unos buffers para todas).
+//
+// Los indices de cada malla se guardan relativos a su primer vertice (baseVertex), asi que una malla
+// de hasta 65536 vertices usa indices de 16 bits aunque la arena tenga muchos mas.
+class GeometryArena {
+public:
+
+	const VertexLayout* layout;
+	GLenum indexType; // GL_UNSIGNED_SHORT o GL_UNSIGNED_INT
+
+	unsigned int idArray = 0;       // VAO (los atributos los pone Render segun el programa)
+	unsigned int idVertexArray = 0; // VBO
+	unsigned int idIndexArray = 0;  // IBO
+
+	GeometryArena(const VertexLayout* layout, GLenum indexType, size_t vertexCapacity = 64 * 1024, size_t indexCapacity = 192 * 1024);
+	~GeometryArena();
+
+	// Sube la malla empaquetada (packedVertices) y sus indices (todos los LOD) y rellena
+	// mesh->arena, mesh->baseVertex y mesh->arenaFirstIndex. Los buffers crecen si no cabe.
+	// Con staging los datos se copian de el con glCopyBufferSubData en vez de glBufferSubData.
+	void add(Mesh* mesh, const void* indices, size_t indexCount, StagingBuffer* staging = nullptr);
+
+	// Devuelve el hueco de la malla a la arena.
+	void remove(Mesh* mesh);
+
+	unsigned int indexSize() const { return indexType == GL_UNSIGNED_SHORT ? 2 : 4; }
+
+	// Vertices e indices ocupados y reservados.
+	size_t usedVertices = 0, usedIndices = 0;
+	size_t vertexCapacity, indexCapacity;
+
+	// Arena de ese formato y tipo de indice (se crea la primera vez).
+	static GeometryArena* get(const VertexLayout* layout, GLenum indexType);
+
+	// Arenas creadas.
+	static size_t size() { return arenas.size(); }
+
+	// Borra todas las arenas (Render::deinitGLFW, con el contexto aun activo y sin mallas en ellas).
+	static void clear();
+
+private:
+
+	// Tramo libre, en vertices o en indices
+	typedef struct {
+		size_t first;
+		size_t count;
+	} range_t;
+
+	vector<range_t> freeVertices = {}, freeIndices = {};
+
+	// Primer hueco libre que quepa (first fit). Si no hay, crece el buffer y se vuelve a buscar.
+	size_t allocate(vector<range_t>& freeList, size_t& capacity, size_t count, unsigned int& buffer, size_t elementSize);
+	void release(vector<range_t>& freeList, size_t first, size_t count);
+
+	// Copia el buffer a uno nuevo de newBytes (glCopyBufferSubData, sin pasar por CPU).
+	static void grow(unsigned int& buffer, size_t oldBytes, size_t newBytes);
+
+	inline static vector<GeometryArena*> arenas;
+};
+
+#pragma endregion
@@ -0,0 +1,46 @@
+#pragma once
+#include "common.h"
+
+#pragma region --- HEADLESS CONTEXT ---
+
+// Contexto GL sin ventana ni pantalla, para benchmarks y pruebas en maquinas sin display.
+// En Linux es un contexto EGL sin superficie (EGL_MESA_platform_surfaceless; con Mesa llvmpipe
+// basta con la libreria) o, si el driver no lo permite, con un pbuffer de 1x1 en el display
+// por defecto. Se dibuja siempre en un FBO (ver Render::initHeadless), asi que la superficie
+// no se usa. En el resto de sistemas es una ventana GLFW oculta.
+class HeadlessContext {
+public:
+
+	// Crea el contexto y lo deja como actual. Devuelve false si no se pudo.
+	static bool create();
+
+	static void destroy();
+
+	// Funcion de carga para gladLoadGL
+	static GLADloadfunc loader();
+
+	// true mientras el contexto sin ventana es el que se usa
+	static bool active() { return created; }
+
+	// Extension del contexto actual, sea cual sea (glfwExtensionSupported necesita una ventana GLFW)
+	static bool hasExtension(const char* name);
+
+	// Como se creo (para los informes)
+	static const string& description() { return info; }
+
+private:
+
+	inline static string info;
+	inline static bool created = false;
+
+#ifdef __linux__
+	inline static void* display = nullptr; // EGLDisplay
+	inline static void* context = nullptr; // EGLContext
+	inline static void* surface = nullptr; // EGLSurface (solo el pbuffer)
+	static bool createEGL(bool surfaceless);
+#else
+	inline static GLFWwindow* hiddenWindow = nullptr;
+#endif
+};
+
+#pragma endregion
@@ -0,0 +1,21 @@
+#pragma once
+#include "common.h"
+#include <cstdint>
+
+#pragma region --- IMAGE WRITER ---
+
+// Escritura de imagenes RGBA de 8 bits a PNG sin dependencias: los datos van en bloques deflate
+// sin comprimir (ocupa lo mismo que la imagen en bruto, pero cualquier visor o script la lee).
+class ImageWriter {
+public:
+
+	// rgba: width * height pixeles de 4 bytes, fila a fila. Con flipY la primera fila es la de
+	// abajo (como devuelve glReadPixels).
+	static bool writePNG(const string& fileName, int width, int height, const uint8_t* rgba, bool flipY = true);
+
+private:
+
+	static uint32_t crc32(uint32_t crc, const uint8_t* data, size_t size);
+};
+
+#pragma endregion
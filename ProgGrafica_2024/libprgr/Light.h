@@ -2,9 +2,12 @@
 
 #include "common.h"
 #include "vectorMath.h"
+#include "fastMath.h"
 
 using namespace libPRGR;
 
+#define DFT_LIGHT_RADIUS 50.0f // Radio de influencia por defecto de las luces puntuales
+
 #pragma region --- LIGHT ---
 
 class Light {
@@ -23,6 +26,16 @@ public:
     lightTypes_e type;
     vector4f direction ;
 
+    // Las luces puntuales no iluminan mas alla de radius (se atenuan hasta 0 al llegar): con eso se
+    // reparten en clusters y cada fragmento solo recorre las que tiene cerca (ver LightClusters).
+    float radius = DFT_LIGHT_RADIUS;
+
+    // Jerarquia: si la luz esta enganchada a un nodo del SceneGraph, position es relativa
+    // al padre y worldPosition es la que se envia al shader.
+    int sceneNode = -1;
+    vector4f worldPosition;
+    vector4f previousWorldPosition; // Al empezar el tick (se dibuja interpolando entre las dos)
+
     // Constructor de la clase
     Light(lightTypes_e type, vector4f position, vector4f color, float I, vector4f direction = { 0, 0, 0, 0 }) :
         type(type), position(position), color(color), i(I), direction(direction) {
@@ -32,8 +45,12 @@ public:
             this->i = 0;
         }
         this->color = normalizeColor(color);
+        this->worldPosition = position;
+        this->previousWorldPosition = position;
     };
 
+    virtual ~Light() = default;
+
     // Funcin move delegada (la luz estndar no se mueve)
     virtual void move(double timeStep);
 
@@ -50,12 +67,12 @@ public:
 
     // Variables para el movimiento orbital
     vector4f center;
-    float radius;
+    float orbitRadius; // Distancia al centro (Light::radius sigue siendo el alcance de la luz)
     float speed;
     vector4f rotationAxis;
 
     // Constructor con eje de rotacin personalizado
-    OrbitalLight(vector4f center, float radius, float speed,
+    OrbitalLight(vector4f center, float orbitRadius, float speed,
         vector4f color = { 1.0f, 1.0f, 1.0f, 1.0f },
         float intensity = 1.0f,
         vector4f rotationAxis = { 0.0f, 1.0f, 0.0f, 0.0f });
@@ -0,0 +1,84 @@
+#pragma once
+#include "common.h"
+#include "vectorMath.h"
+#include "fastMath.h"
+#include <cstdint>
+
+using namespace libPRGR;
+
+#define CLUSTER_TILES_X 16 // Columnas de clusters en pantalla
+#define CLUSTER_TILES_Y 9  // Filas
+#define CLUSTER_SLICES 24  // Cortes en profundidad, exponenciales entre zNear y zFar
+
+#pragma region --- LIGHT CLUSTERS ---
+
+// Luz puntual tal como la lee shader.frag del buffer de luces: dos texels RGBA32F.
+typedef struct {
+	vector4f positionRadius; // Posicion en mundo y radio de influencia
+	vector4f colorIntensity; // Color e intensidad
+} pointLight_t;
+
+static_assert(sizeof(pointLight_t) == 32, "pointLight_t tiene relleno");
+
+// Reparto de luces puntuales en clusters del frustum (froxels) para el sombreado forward por clusters.
+//
+// La vista se divide en tilesX x tilesY celdas de pantalla y slices cortes de profundidad
+// exponenciales, y cada cluster guarda su caja en espacio de vista (SoA). assign prueba la esfera
+// de influencia de cada luz contra las cajas de las celdas que cubre su proyeccion, de 4 en 4 con
+// SSE2, y deja a cada cluster un tramo de la lista de indices. El fragment shader busca su cluster
+// y solo recorre esas luces: el coste por fragmento depende de las luces cercanas, no del total.
+class LightClusters {
+public:
+
+	// Cluster c = (slice * tilesY + fila) * tilesX + columna:
+	// table[2c] = primera luz en indices, table[2c + 1] = cuantas
+	vector<uint32_t> table;
+	vector<uint32_t> indices;
+
+	// Estadisticas del ultimo assign
+	unsigned int visibleLights = 0;       // Luces que tocan algun cluster
+	unsigned int maxLightsPerCluster = 0;
+
+	// Rejilla de clusters (1x1x1: todas las luces que tocan el frustum en todos los fragmentos)
+	void setGrid(int tilesX, int tilesY, int slices);
+	int tilesX() const { return gridX; }
+	int tilesY() const { return gridY; }
+	int slices() const { return gridZ; }
+	size_t clusterCount() const { return (size_t)gridX * gridY * gridZ; }
+
+	// Proyeccion con la que se reparten las luces y planos cercano y lejano. De la matriz se usan
+	// la escala de x e y ([0][0] y [1][1]) y la fila de w: la de Camera da w = profundidad + 1,
+	// no la profundidad. Las cajas solo se recalculan si algo cambia.
+	void setProjection(const matrix4x4f& projection, float zNear, float zFar);
+
+	// Corte de una profundidad d: log(d / zNear) * sliceScale()
+	float sliceScale() const { return sliceFactor; }
+
+	// Reparte count luces con la vista dada y rellena table e indices. Con previous (las mismas
+	// luces en el tick anterior) cada esfera crece hasta cubrir las dos posiciones, porque se
+	// dibujan interpoladas entre ambas. Devuelve las parejas luz-cluster.
+	size_t assign(const matrix4x4f& view, const pointLight_t* lights, const pointLight_t* previous, size_t count);
+
+private:
+
+	int gridX = CLUSTER_TILES_X, gridY = CLUSTER_TILES_Y, gridZ = CLUSTER_SLICES;
+	float projX = 0, projY = 0, nearZ = 0, farZ = 0;
+	float projW = 1, projW0 = 0; // w de clip = projW * profundidad + projW0
+	float sliceFactor = 0;
+	bool boxesDirty = true;
+
+	// Cajas en vista, con 3 de relleno al final para leer siempre de 4 en 4
+	vector<float> minX, minY, minZ;
+	vector<float> maxX, maxY, maxZ;
+	void buildBoxes();
+
+	// Parejas del ultimo assign antes de ordenarlas por cluster
+	vector<uint32_t> pairCluster, pairLight;
+	vector<uint32_t> counts;
+
+	float clipW(float depth) const { return projW * depth + projW0; }
+	int sliceOf(float depth) const;
+	int tileOf(float ndc, int tiles) const;
+};
+
+#pragma endregion
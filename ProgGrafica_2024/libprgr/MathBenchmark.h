@@ -0,0 +1,97 @@
+#pragma once
+#include "common.h"
+#include "vectorMath.h"
+#include "fastMath.h"
+
+using namespace libPRGR;
+
+#pragma region --- MATH BENCHMARK ---
+
+// Micro-benchmark de las primitivas de vectorMath.h.
+// Se lanza desde la linea de comandos con "--bench-math [fichero.json]" y no necesita contexto GL.
+class MathBenchmark {
+public:
+
+	// Modo de medicion.
+	typedef enum {
+		LATENCY,    // Cada operacion depende del resultado de la anterior (cadena de dependencias)
+		THROUGHPUT  // Operaciones independientes sobre entradas distintas
+	} benchMode_e;
+
+	// Resultado de tiempos de una funcion.
+	typedef struct {
+		string name;
+		benchMode_e mode;
+		size_t iterations;
+		double nsPerOp; // Mejor tiempo de todas las repeticiones
+	} benchResult_t;
+
+	// Resultado de precision frente a la referencia en doble precision.
+	typedef struct {
+		string name;
+		double maxAbsError;
+		double maxRelError; // |f - ref| / max(1, |ref|)
+		double tolerance;
+		bool passed;
+	} accuracyResult_t;
+
+	vector<benchResult_t> results;
+	vector<accuracyResult_t> accuracy;
+
+	// Constructor. numInputs debe ser potencia de dos.
+	MathBenchmark(unsigned int seed = 1234, size_t numInputs = 4096, size_t iterations = 1 << 20, int repetitions = 5);
+
+	// Lanza tiempos y precision.
+	void run();
+
+	// Mide todas las funciones publicas de vectorMath.h (y los niveles de fastMath.h) en ambos modos.
+	void runTimings();
+
+	// Compara cada funcion con su implementacion en doble precision.
+	void runAccuracy();
+
+	// Devuelve false si alguna funcion supera su tolerancia.
+	bool accuracyPassed() const;
+
+	// Vuelca los resultados en formato JSON.
+	bool writeJSON(string fileName) const;
+
+	// Resumen por consola.
+	void print() const;
+
+private:
+
+	unsigned int seed;
+	size_t numInputs;
+	size_t iterations;
+	int repetitions;
+
+	// Entradas aleatorias (se generan una vez en el constructor).
+	vector<float> scalars;
+	vector<float> angles;
+	vector<vector4f> vectorsA;
+	vector<vector4f> vectorsB;
+	vector<matrix3x3f> matrices3;
+	vector<matrix4x4f> matricesA;
+	vector<matrix4x4f> matricesB;
+	vector<matrix4x4f> transforms; // Matrices TRS bien condicionadas (para inverse)
+
+	void generateInputs();
+
+	template <typename F>
+	void time(string name, F op);
+
+	template <typename F>
+	double timeMode(benchMode_e mode, F op);
+
+	// Mide una funcion por lotes (sincos de arrays) en ns por elemento.
+	template <typename F>
+	void timeBatch(string name, F batch);
+
+	template <typename P>
+	void runTierAccuracy(string tier);
+
+	void addAccuracy(string name, double maxAbs, double maxRel, double tolerance);
+};
+
+#pragma endregion
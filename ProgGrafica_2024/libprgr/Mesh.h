@@ -0,0 +1,145 @@
+#pragma once
+#include "common.h"
+#include "vertex.h"
+#include "Texture.h"
+#include "Collider.h"
+#include "VertexLayout.h"
+#include "GeometryArena.h"
+#include "StagingBuffer.h"
+
+#define MESH_MAX_LODS 5              // Niveles de detalle por malla, incluido el original
+#define MESH_LOD_MIN_TRIANGLES 64    // Por debajo no se generan LOD
+#define MESH_LOD_MAX_ERROR 0.25f     // Error maximo de un nivel, relativo al radio de la malla (los mas gruesos solo se ven de lejos)
+
+// Nivel de detalle: tramo del buffer de indices de la malla y su error geometrico.
+typedef struct {
+	unsigned int firstIndex;
+	unsigned int indexCount;
+	float error; // Desviacion maxima respecto al original, en unidades del objeto
+}meshLod_t;
+
+#pragma region --- MESH ---
+
+// Geometria inmutable de un fichero .fiis: vertices, indices, textura, su hueco en la arena de GPU y
+// prototipos de colisionador. La comparten todos los objetos que cargan el mismo fichero.
+class Mesh {
+public:
+
+	string fileName;
+	vector<vertex_t> vertexList; // lista de vertices
+	vector<int> idList; // lista de indices de vertices
+	Texture* texture = nullptr; // Textura indicada en el fichero (puede no haber). Se sube en upload()
+
+	// Niveles de detalle: el 0 es idList y el resto van detras en el mismo IBO, con error creciente
+	vector<int> lodIdList; // Indices de los niveles 1..n seguidos
+	vector<meshLod_t> lods;
+	vector4f boundsCenter = { 0, 0, 0, 1 }; // Esfera envolvente en espacio de objeto
+	float boundsRadius = 0.0f;
+
+	// Formato de los vertices en GPU. vertexList se sigue usando en CPU (colisionadores, LOD, oclusion)
+	const VertexLayout* layout = &VertexLayout::packed();
+	vector<unsigned char> packedVertices; // vertexList empaquetada segun layout (se libera al subirla)
+	size_t vertexBytes = 0; // Tamano del VBO
+
+	// Indices en GPU: de 16 bits si hay 65536 vertices o menos, si no de 32 (se elige en upload)
+	GLenum indexType = GL_UNSIGNED_INT;
+	unsigned int indexSize() const { return indexType == GL_UNSIGNED_SHORT ? 2 : 4; }
+
+	// Hueco en la arena de su formato (ver GeometryArena), se reserva en upload()
+	GeometryArena* arena = nullptr;
+	unsigned int baseVertex = 0;      // Primer vertice de la malla en el VBO de la arena
+	unsigned int arenaFirstIndex = 0; // Primer indice de la malla en el IBO de la arena (los de lods son relativos a este)
+	bool uploaded = false;
+	int refCount = 0; // Objetos que usan la malla (ver MeshLibrary)
+
+	Mesh() {};
+	~Mesh();
+
+	// Carga la malla desde un fichero. Devuelve false si no se pudo abrir. No usa GL.
+	bool loadFromFile(string file);
+
+	// Lectores de cada seccion del fichero
+	void leerVertices(std::ifstream& f);
+	void leerColores(std::ifstream& f);
+	void leerNormales(std::ifstream& f);
+	void leerTexturas(std::ifstream& f);
+	void leerCaras(std::ifstream& f);
+
+	// Funde los vertices identicos de vertexList y actualiza idList (ver MeshOptimizer).
+	void weldVertices();
+
+	// Genera los LOD simplificando idList (ver MeshSimplifier). Se llama al cargar la malla.
+	void buildLods();
+
+	// Reordena los triangulos de cada LOD (cache y overdraw) y despues los vertices por primer uso.
+	void optimize();
+
+	// Empaqueta vertexList con layout. Se llama al cargar la malla.
+	void pack();
+
+	// Sube vertices e indices (todos los LOD) a la arena de su formato y la textura (solo la primera
+	// vez), a traves de staging si se indica.
+	void upload(StagingBuffer* staging = nullptr);
+
+	// Copia del colisionador de la malla. El prototipo (con su jerarquia) se calcula una vez por tipo.
+	Collider* createCollider(collTypes type);
+
+	// Calcula el prototipo de ese tipo si aun no esta (para hacerlo fuera del hilo que crea los objetos).
+	void prepareCollider(collTypes type);
+
+private:
+
+	Collider* prototypes[2] = { nullptr, nullptr }; // Indexado por collTypes
+
+	Collider* buildCollider(collTypes type) const;
+};
+
+#pragma endregion
+
+#pragma region --- MESH LIBRARY ---
+
+// Registro de mallas compartidas por nombre de fichero, con cuenta de referencias.
+class MeshLibrary {
+public:
+
+	// Devuelve la malla del fichero (la carga la primera vez) y suma una referencia. nullptr si no existe.
+	static Mesh* acquire(const string& fileName);
+
+	// Como acquire, pero sin leer nada: nullptr si el fichero aun no esta cargado.
+	static Mesh* acquireLoaded(const string& fileName);
+
+	// Lee y prepara la malla de un fichero sin registrarla (nullptr si no existe). No toca la libreria
+	// ni GL, asi que vale desde cualquier hilo (ver AssetLoader); usa vertexLayout y optimizeMeshes.
+	static Mesh* build(const string& fileName);
+
+	// Registra una malla de build y suma una referencia. Si entretanto se cargo el mismo fichero se
+	// borra mesh y se devuelve la que ya habia.
+	static Mesh* adopt(Mesh* mesh);
+
+	// Igual que acquire para mallas generadas por codigo: build rellena la malla la primera vez.
+	static Mesh* acquireProcedural(const string& name, void (*build)(Mesh* mesh));
+
+	// Resta una referencia; con la ultima se borra la malla.
+	static void release(Mesh* mesh);
+
+	// Mallas distintas cargadas.
+	static size_t size() { return meshes.size(); }
+
+	// Ficheros leidos desde el arranque (no cuenta los reutilizados).
+	inline static unsigned int loadedMeshes = 0;
+
+	// Formato de vertices de las mallas que se carguen a partir de ahora.
+	inline static const VertexLayout* vertexLayout = &VertexLayout::packed();
+
+	// Soldar y reordenar las mallas al cargarlas (weldVertices + optimize).
+	inline static bool optimizeMeshes = true;
+
+private:
+
+	inline static map<string, Mesh*> meshes;
+
+	// Soldado, LOD, reordenado y empaquetado de una malla recien leida o generada
+	static void prepare(Mesh* mesh);
+};
+
+#pragma endregion
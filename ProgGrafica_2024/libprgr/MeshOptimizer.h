@@ -0,0 +1,59 @@
+#pragma once
+#include "common.h"
+#include "vertex.h"
+
+#pragma region --- MESH OPTIMIZER ---
+
+// Optimizacion de mallas al cargarlas (ver Mesh::optimize), en el orden en que se aplica:
+//  1. weldVertices: vertices identicos (mismos bytes) se funden en uno, buscandolos por hash.
+//  2. optimizeVertexCache: reordena triangulos para la cache post-transformacion (Tipsify).
+//  3. optimizeOverdraw: reordena los grupos de triangulos de Tipsify de fuera hacia dentro para
+//     que los primeros tapen a los siguientes, si la cache no empeora mas de un umbral.
+//  4. optimizeVertexFetch: reordena los vertices en orden de primer uso (lectura secuencial del VBO).
+// analyze mide ACMR/ATVR, overdraw y bytes para comparar antes y despues.
+class MeshOptimizer {
+public:
+
+	static const int CACHE_SIZE = 16; // Entradas de la cache FIFO simulada
+
+	typedef struct {
+		size_t vertices;    // Vertices referenciados
+		size_t triangles;
+		float acmr;         // Fallos de cache por triangulo (0.5 es el minimo en mallas grandes)
+		float atvr;         // Fallos de cache por vertice (1 = cada vertice se transforma una vez)
+		float overdraw;     // Pixeles sombreados / pixeles cubiertos, media de 6 vistas
+		size_t vertexBytes; // VBO con el stride indicado
+		size_t indexBytes;  // IBO con el tamano de indice indicado
+	} meshStats_t;
+
+	// Funde los vertices identicos y compacta la lista. Devuelve la tabla indice viejo -> nuevo.
+	static vector<int> weldVertices(vector<vertex_t>& vertices);
+
+	// Reordena los vertices por su primer uso en indices y quita los que no se usan (quedan a -1 en la tabla).
+	static vector<int> optimizeVertexFetch(vector<vertex_t>& vertices, const vector<int>& indices);
+
+	// Aplica una tabla de weldVertices/optimizeVertexFetch a una lista de indices.
+	static void remapIndices(vector<int>& indices, const vector<int>& remap);
+
+	// Tipsify sobre count indices. En clusters devuelve el primer triangulo de cada grupo
+	// (cada vez que el algoritmo salta a una zona nueva de la malla).
+	static void optimizeVertexCache(int* indices, size_t count, size_t vertexCount, vector<unsigned int>* clusters = nullptr);
+
+	// Ordena los grupos de optimizeVertexCache de fuera hacia dentro. Se deshace si el ACMR
+	// resultante supera threshold veces el de partida.
+	static void optimizeOverdraw(int* indices, size_t count, const vector<vertex_t>& vertices,
+		const vector<unsigned int>& clusters, float threshold = 1.05f);
+
+	static meshStats_t analyze(const vector<vertex_t>& vertices, const int* indices, size_t count,
+		unsigned int vertexStride, unsigned int indexSize);
+
+	// Fallos de una cache FIFO de cacheSize entradas al recorrer los indices.
+	static size_t cacheMisses(const int* indices, size_t count, size_t vertexCount, int cacheSize = CACHE_SIZE);
+
+	// Overdraw en orden de envio: 6 vistas ortograficas (+-x, +-y, +-z) de gridSize^2 pixeles,
+	// con test de profundidad y descartando caras traseras (antihorario = delante, como GL por defecto;
+	// es la metrica habitual aunque Render no active GL_CULL_FACE).
+	static float overdraw(const vector<vertex_t>& vertices, const int* indices, size_t count, int gridSize = 256);
+};
+
+#pragma endregion
@@ -0,0 +1,61 @@
+#pragma once
+#include "common.h"
+#include "vertex.h"
+
+#pragma region --- MESH SIMPLIFIER ---
+
+// Simplificacion de mallas por colapso de aristas con metricas de error cuadraticas (QEM).
+//
+// Cada vertice acumula la cuadrica de los planos de sus triangulos (ponderada por area) y una
+// cuadrica de atributos (normal, coordenadas de textura y color) que mide cuanto se alejan los
+// atributos del vertice superviviente de los de todos los vertices que ha absorbido. Los colapsos
+// son de media arista (un vertice se funde en otro ya existente), asi que un LOD es solo una lista
+// de indices nueva que comparte el buffer de vertices de la malla base.
+//
+// Los vertices del borde (aristas con un solo triangulo) y los de las costuras (misma posicion con
+// normal, textura o color distintos) no se mueven nunca: la silueta de las mallas abiertas y el
+// mapeado de texturas se conservan en todos los niveles.
+class MeshSimplifier {
+public:
+
+	// Peso de cada atributo frente al error de posicion (ambos relativos al tamano de la malla)
+	float normalWeight = 0.05f;
+	float uvWeight = 0.05f;
+	float colorWeight = 0.01f;
+
+	MeshSimplifier(const vector<vertex_t>& vertices);
+
+	// Colapsa aristas hasta dejar como mucho targetIndexCount indices o hasta que el siguiente colapso
+	// supere maxError (distancia en unidades del objeto). En error devuelve el mayor error aplicado.
+	vector<int> simplify(const vector<int>& indices, size_t targetIndexCount, float maxError, float* error = nullptr);
+
+	// Esfera que envuelve la malla (su radio es la escala de referencia de los errores).
+	vector4f getCenter() const { return center; }
+	float getExtent() const { return extent; }
+
+private:
+
+	static const int ATTRIBUTES = 9; // Normal (3) + textura (2) + color (4)
+
+	// Cuadrica de posicion (matriz simetrica 4x4) y cuadrica isotropica de atributos.
+	typedef struct {
+		double a00, a01, a02, a03, a11, a12, a13, a22, a23, a33;
+		double attrB[ATTRIBUTES]; // Suma de w * atributo
+		double attrC;             // Suma de w * |atributo|^2
+		double weight;            // Suma de w (area de los triangulos)
+	} quadric_t;
+
+	const vector<vertex_t>& vertices;
+	vector<int> attributeRemap; // Vertice -> primer vertice identico (posicion y atributos)
+	vector<int> positionRemap;  // Vertice -> primer vertice con la misma posicion
+	vector<unsigned char> seam; // Por vertice de positionRemap: hay atributos distintos en esa posicion
+	vector4f center = { 0, 0, 0, 1 };
+	float extent = 0.0f;
+
+	void attributes(int v, double* out) const;
+	void addTriangle(vector<quadric_t>& quadrics, int i0, int i1, int i2) const;
+	double collapseError(const quadric_t& qa, const quadric_t& qb, int b) const;
+	bool flips(const vector<int>& indices, const int* triangles, int count, int a, int b) const;
+};
+
+#pragma endregion
@@ -5,12 +5,7 @@
 #include "Program.h"
 #include "Texture.h"
 #include "Collider.h"
-
-typedef struct {
-	unsigned int idArray; // Identificador de array.
-	unsigned int idVertexArray; // Identificador de vertices.
-	unsigned int idIndexArray; // Identificador de indices de vertices.
-}bufferObject;
+#include "Mesh.h"
 
 using namespace libPRGR;
 
@@ -23,6 +18,10 @@ private:
 
 	static int idCounter; // Conteo de objetos.
 
+	// Ultima transformacion usada en updateModelMatrix (para no recalcular si no cambia).
+	vector4f lastPosition, lastRotation, lastScale;
+	bool transformCached = false;
+
 public:
 
 	int id = 0; // Identificador propio.
@@ -36,17 +35,24 @@ public:
 	ColliderType colliderType = COLLIDER_SPHERE;
 	Collider* collider = nullptr;
 
+	// Se rasteriza como oclusor en el culling por oclusion (suelo, paredes, mallas grandes)
+	bool occluder = false;
+
 	// MATERIAL
 
 	typedef struct {
 
 		float Ks, Kd;  // Reflexion especular y difusa
 		float shine; // Brillo
-		Texture* texture; // Textura de un Objeto.
+		Texture* texture; // Textura de un Objeto (por defecto la de su malla).
 
 	}material_t; // Estructura de material del objeto;
 
-	material_t material;
+	material_t material = {};
+
+	// Su textura tiene texels transparentes: programa con discard (ALPHA_TEST), fuera del prepass de
+	// profundidad y dibujado despues de los opacos. Lo decide setMesh por el alfa de la textura.
+	bool alphaTested = false;
 
 
 	// POSICIN, ESCALA Y ROTACIN 
@@ -54,15 +60,26 @@ public:
 	vector4f position;
 	vector4f scale;
 	vector4f rotation;
-	matrix4x4f modelMatrix;
+	matrix4x4f modelMatrix; // Matriz de mundo (igual a la local si el objeto no tiene padre)
+	matrix4x4f localMatrix = make_identity(); // Traslacion * rotacion * escalado, relativa al padre
+
+	// Matriz derivada que calcula el Render solo cuando cambia modelMatrix
+	matrix4x4f normalMatrix = make_identity(); // Transpuesta de la inversa de modelMatrix
+
+	// Matrices del tick de simulacion anterior: el Render interpola entre ellas y las actuales
+	matrix4x4f previousModelMatrix = make_identity();
+	matrix4x4f previousNormalMatrix = make_identity();
+
+	// JERARQUIA
+	int sceneNode = -1; // Nodo en el SceneGraph del Render (-1 si no esta en ninguno)
 
 
 	// VRTICES 
 
-	vector<vertex_t> vertexList; // lista de vertices del objeto
-	vector<int> idList; // lista de indices de vertices 
+	Mesh* mesh = nullptr; // Geometria compartida con los demas objetos del mismo fichero (ver MeshLibrary)
+	int lod = 0; // Nivel de detalle elegido por el Render en el ultimo frame (Mesh::lods)
 
-	Program* program; // programa que se utilizara para dibujar el objeto
+	Program* program = nullptr; // programa que se utilizara para dibujar el objeto (compartido, ver ProgramLibrary)
 
 	// ROTACION ESTNDAR.
 	bool standartRotation = true;
@@ -80,32 +97,32 @@ public:
 	// Constructor que carga el objeto desde un archivo
 	Object3D(string file);
 
+	// Suelta la malla y el programa (MeshLibrary y ProgramLibrary) y borra el colisionador
+	virtual ~Object3D();
+
+	// Las referencias a la malla y al programa son de cada objeto: no se copian
+	Object3D(const Object3D&) = delete;
+	Object3D& operator=(const Object3D&) = delete;
+
 	// Crea un triangulo
 	void createTriangle();
 
-	// Actualiza la matriz de modelo
+	// Actualiza la matriz de modelo (no hace nada si posicion, rotacion y escala no han cambiado)
 	void updateModelMatrix();
 
 	// Mueve el objeto
 	virtual void move(double timeStep);
 
-	// Carga un objeto desde un archivo
+	// Carga un objeto desde un archivo (la malla solo se lee la primera vez)
 	void loadFromFile(string file);
 
-	// Lee los vertices de un archivo
-	void leerVertices(std::ifstream& f);
-
-	// Lee los colores de un archivo
-	void leerColores(std::ifstream& f);
-
-	// Lee las caras de un archivo
-	void leerCaras(std::ifstream& f);
-
-	// Lee las texturas de un archivo
-	void leerTexturas(std::ifstream& f);
+	// Usa una malla de MeshLibrary (con una referencia ya sumada para el objeto): textura, colisionador
+	// y programa. Es lo que hace loadFromFile tras leer la malla; AssetLoader lo llama al terminar.
+	void setMesh(Mesh* loaded);
 
-	// Lee las normales de un archivo
-	void leerNormales(std::ifstream& f);
+	// Elige el programa segun el formato de la malla, la textura del material y alphaTested
+	// (hay que volver a llamarlo si cambian).
+	void updateProgram();
 
 	// Mtodos para configurar el tipo de colisionador
 	void setColliderType(ColliderType type) { colliderType = type; }
@@ -0,0 +1,106 @@
+#pragma once
+#include "common.h"
+#include "vectorMath.h"
+#include "fastMath.h"
+#include "vertex.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+using namespace libPRGR;
+
+#pragma region --- OCCLUSION CULLER ---
+
+// Culling por oclusion en CPU con un buffer de profundidad de baja resolucion.
+//
+// Los oclusores designados (Object3D::occluder) se rasterizan en un buffer pequeno
+// (256x128 por defecto) dividido en tiles que se reparten entre hilos (creados una vez y
+// dormidos entre frames); cada fila de un tile
+// se recorre de 4 en 4 pixeles con SSE2. La profundidad es conservadora: cada triangulo
+// escribe la profundidad de su vertice mas lejano y los triangulos que cruzan el plano
+// cercano no se rasterizan, asi que el buffer nunca esta mas cerca que la escena real.
+//
+// Despues se construye una piramide de maximos (Hi-Z) y cada objeto se prueba con la caja
+// de su colisionador: esta oculto si su punto mas cercano queda detras de la profundidad
+// maxima de todos los texeles que cubre.
+//
+// No usa GL: rasterizeReference/isVisibleReference son la version directa pixel a pixel
+// con la que se validan las decisiones (ver OcclusionValidator y "--test-occlusion").
+class OcclusionCuller {
+public:
+
+	int width, height;
+	int tilesX, tilesY;
+	int threads; // Hilos de rasterizado, contando el que llama (1 = solo el que llama)
+
+	OcclusionCuller(int width = 256, int height = 128, int tilesX = 4, int tilesY = 4, int threads = 0);
+	~OcclusionCuller();
+
+	// Empieza un frame: vacia triangulos y fija la vista-proyeccion de la camara.
+	void begin(const matrix4x4f& viewProjection);
+
+	// Anade los triangulos de un oclusor (vertices en espacio de objeto).
+	void addOccluder(const vector<vertex_t>& vertices, const vector<int>& indices, const matrix4x4f& model);
+
+	// Rasteriza los triangulos anadidos (tiles en paralelo) y construye la piramide Hi-Z.
+	void rasterize();
+
+	// false si la caja en mundo [min, max] queda completamente oculta tras los oclusores.
+	bool isVisible(const vector4f& min, const vector4f& max) const;
+
+	// Rasterizado de referencia: escalar, sin tiles ni hilos, sobre un buffer aparte.
+	void rasterizeReference(vector<float>& depthOut) const;
+
+	// Test de referencia: compara pixel a pixel con el buffer de referencia (sin Hi-Z).
+	bool isVisibleReference(const vector<float>& depthRef, const vector4f& min, const vector4f& max) const;
+
+	// Profundidad del ultimo rasterize() en [0, 1] (1 = vacio), fila a fila.
+	const vector<float>& getDepth() const { return hiZ[0]; }
+
+	// Triangulos anadidos en el frame actual.
+	size_t triangleCount() const { return triangles.size(); }
+
+private:
+
+	// Triangulo en coordenadas de pixel con los coeficientes de sus aristas: E(x,y) = a*x + (b*y + c).
+	typedef struct {
+		float a[3], b[3], c[3];
+		float depth; // Profundidad del vertice mas lejano
+		int minX, minY, maxX, maxY; // Caja en pixeles (incluida)
+	} screenTriangle_t;
+
+	// Rectangulo de un objeto en pixeles y su profundidad mas cercana.
+	typedef struct {
+		int minX, minY, maxX, maxY;
+		float nearDepth;
+		bool testable; // false si cruza el plano cercano o cae fuera de la pantalla
+	} screenRect_t;
+
+	matrix4x4f viewProjection;
+	vector<screenTriangle_t> triangles;
+	vector<vector<float>> hiZ; // Nivel 0 = buffer de profundidad; nivel k = maximo de 2x2 del k-1
+
+	// Hilos que ayudan al que llama a rasterize(): esperan a la siguiente generacion, cogen tiles de
+	// nextTile hasta acabarlos y avisan con pending. Se crean en el primer rasterize() en paralelo.
+	vector<std::thread> workers;
+	std::mutex poolMutex;
+	std::condition_variable wake, done;
+	unsigned long long generation = 0; // rasterize() en paralelo lanzados
+	int pending = 0;                   // Hilos que no han terminado el actual
+	bool stopping = false;
+	std::atomic<int> nextTile = 0;
+
+	void startWorkers(int count);
+	void stopWorkers();
+	void workerLoop(unsigned long long seen);
+	void rasterizeTiles(); // Tiles de nextTile hasta que no quede ninguno
+
+	void rasterizeTile(int tile);
+	void rasterizeRows(const screenTriangle_t& tri, int x0, int x1, int y0, int y1, float* depth) const;
+	void rasterizeRowsScalar(const screenTriangle_t& tri, int x0, int x1, int y0, int y1, float* depth) const;
+	void buildHiZ();
+	screenRect_t projectBox(const vector4f& min, const vector4f& max) const;
+};
+
+#pragma endregion
@@ -0,0 +1,51 @@
+#pragma once
+#include "common.h"
+#include "OcclusionCuller.h"
+
+#pragma region --- OCCLUSION VALIDATOR ---
+
+// Validacion del culling por oclusion sin GPU: "--test-occlusion [fichero.json]".
+// Genera escenas aleatorias (paredes y cajas como oclusores, cajas como objetos a probar)
+// y compara OcclusionCuller (SSE, tiles e hilos, Hi-Z) con su rasterizado de referencia.
+// Falla si el buffer de profundidad difiere en algun pixel o si el Hi-Z oculta un objeto
+// que la referencia ve; que el Hi-Z deje visible algo que la referencia oculta es normal.
+class OcclusionValidator {
+public:
+
+	// Resultado de una configuracion de hilos.
+	typedef struct {
+		int threads;
+		int scenes;
+		size_t objects;
+		size_t occludedReference; // Ocultos segun la referencia pixel a pixel
+		size_t occludedHiZ;       // Ocultos segun el Hi-Z
+		size_t falseOcclusions;   // Ocultos por el Hi-Z pero visibles en la referencia (debe ser 0)
+		size_t depthMismatches;   // Pixeles distintos entre rasterize() y rasterizeReference() (debe ser 0)
+		double msRasterize;       // Media por escena
+		double msReference;
+	} validationResult_t;
+
+	vector<validationResult_t> results;
+
+	OcclusionValidator(unsigned int seed = 1234, int scenes = 50, int occluders = 8, int objects = 500);
+
+	// Ejecuta las escenas con 1 hilo y con varios (al menos 4).
+	void run();
+
+	bool passed() const;
+
+	bool writeJSON(string fileName) const;
+
+	void print() const;
+
+private:
+
+	unsigned int seed;
+	int scenes;
+	int occluders;
+	int objects;
+
+	validationResult_t runScenes(int threads);
+};
+
+#pragma endregion
@@ -0,0 +1,193 @@
+#pragma once
+#include "common.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+// Con PRGR_PROFILE a 0 las macros PROFILE_* desaparecen. Compilado, el perfilador empieza
+// desactivado y cada zona solo cuesta leer Profiler::enabled.
+#ifndef PRGR_PROFILE
+#define PRGR_PROFILE 1
+#endif
+
+#pragma region --- PROFILER ---
+
+typedef enum {
+	COUNTER_DRAW_CALLS,       // glDrawElements* y glMultiDrawElementsIndirect
+	COUNTER_PROGRAM_SWITCHES, // glUseProgram
+	COUNTER_UNIFORM_UPLOADS,  // glUniform* y subidas del buffer de uniforms
+	COUNTER_TRIANGLES,        // Triangulos enviados
+	COUNTER_COLLISION_NODES,  // Nodos de colisionador visitados por test()
+	COUNTER_COUNT
+} profileCounter_e;
+
+// Perfilador de frames de CPU y GPU.
+//  - Zonas de CPU (PROFILE_SCOPE): inicio y fin en un buffer circular por hilo, sin bloqueos.
+//  - Pasadas de GPU (PROFILE_GPU_SCOPE): consultas GL_TIME_ELAPSED de un pool por frame que se leen
+//    GPU_FRAMES_IN_FLIGHT frames despues, sin esperar a la GPU. No se pueden anidar (lo impide GL).
+//  - Contadores (PROFILE_COUNT): por frame.
+// endFrame cierra el frame (hilo GL, tras el swap) y cada statsInterval frames imprime la media de
+// zonas, pasadas y contadores. writeTrace guarda todo en formato de trazas de Chrome/Perfetto.
+class Profiler {
+public:
+
+	static const int RING_SIZE = 1 << 16;          // Zonas guardadas por hilo (potencia de 2)
+	static const int HISTORY_SIZE = 1 << 12;       // Frames guardados para la traza
+	static const int GPU_QUERIES_PER_FRAME = 16;
+	static const int GPU_FRAMES_IN_FLIGHT = 4;
+
+	// Tiempos en ns desde que arranca el programa
+	typedef struct {
+		const char* name;
+		int64_t start;
+		int64_t end;
+	} zone_t;
+
+	// Media por frame de una zona o pasada en la ventana de estadisticas
+	typedef struct {
+		double ms;
+		double calls;
+	} zoneStats_t;
+
+	inline static int statsInterval = 120; // Frames entre volcados de estadisticas (0 = no imprimir)
+
+	static bool isEnabled() { return enabled.load(std::memory_order_relaxed); }
+	static void setEnabled(bool value);
+
+	static int64_t now()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+	}
+
+	// Zona de CPU desde el constructor hasta el destructor. name debe vivir siempre (un literal).
+	class Scope {
+	public:
+		Scope(const char* name)
+		{
+			if (Profiler::isEnabled()) {
+				this->name = name;
+				start = Profiler::now();
+			}
+		}
+		~Scope()
+		{
+			if (name) Profiler::record(name, start, Profiler::now());
+		}
+	private:
+		const char* name = nullptr;
+		int64_t start = 0;
+	};
+
+	// Pasada de GPU. Solo en el hilo GL; si ya hay una abierta esta no se mide.
+	class GpuScope {
+	public:
+		GpuScope(const char* name) : query(Profiler::isEnabled() ? Profiler::beginGpu(name) : -1) {}
+		~GpuScope()
+		{
+			if (query >= 0) Profiler::endGpu();
+		}
+	private:
+		int query;
+	};
+
+	static void record(const char* name, int64_t start, int64_t end);
+	static void add(profileCounter_e counter, uint64_t value) { counters[counter].fetch_add(value, std::memory_order_relaxed); }
+
+	// Nombre del hilo que llama en la traza
+	static void setThreadName(const string& name);
+
+	// Cierra el frame: recoge las consultas de GPU listas, suma las zonas y contadores del frame
+	// y vuelca las estadisticas si toca. Hilo GL, una vez por frame.
+	static void endFrame();
+
+	// Medias por frame de la ultima ventana de estadisticas
+	static const map<string, zoneStats_t>& cpuStats() { return lastCpu; }
+	static const map<string, zoneStats_t>& gpuStats() { return lastGpu; }
+	static double counterStats(profileCounter_e counter) { return lastCounters[counter]; }
+	static double frameMsStats() { return lastFrameMs; }
+
+	// Zonas guardadas por todos los hilos desde el arranque
+	static uint64_t zonesRecorded();
+
+	// Cierra la ventana de estadisticas (medias en cpuStats, gpuStats...), la imprime si
+	// statsInterval no es 0 y empieza otra
+	static void printStats();
+
+	// Zonas de todos los hilos, pasadas de GPU y contadores por frame en el formato
+	// JSON de trazas de Chrome (chrome://tracing, ui.perfetto.dev).
+	static bool writeTrace(const string& fileName);
+
+	// Libera las consultas de GPU (antes de destruir el contexto)
+	static void deinit();
+
+	static const char* counterName(profileCounter_e counter);
+
+private:
+
+	typedef struct {
+		zone_t zones[RING_SIZE];
+		std::atomic<uint64_t> written; // Zonas escritas desde el arranque (solo la escribe su hilo)
+		int tid;
+		string name;
+	} threadRing_t;
+
+	typedef struct {
+		int64_t end;
+		double ms;
+		uint64_t counters[COUNTER_COUNT];
+	} frameRecord_t;
+
+	inline static std::atomic<bool> enabled = false;
+	inline static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+	inline static std::atomic<uint64_t> counters[COUNTER_COUNT] = {};
+
+	// Los anillos se crean la primera vez que un hilo guarda algo y no se liberan nunca
+	inline static std::mutex ringsMutex;
+	inline static vector<threadRing_t*> rings;
+	inline static thread_local threadRing_t* localRing = nullptr;
+	static threadRing_t* threadRing();
+
+	// Pool de consultas: GPU_QUERIES_PER_FRAME por frame en vuelo
+	inline static unsigned int queries[GPU_FRAMES_IN_FLIGHT][GPU_QUERIES_PER_FRAME] = {};
+	inline static const char* queryNames[GPU_FRAMES_IN_FLIGHT][GPU_QUERIES_PER_FRAME] = {};
+	inline static int64_t queryStarts[GPU_FRAMES_IN_FLIGHT][GPU_QUERIES_PER_FRAME] = {};
+	inline static int queriesUsed[GPU_FRAMES_IN_FLIGHT] = {};
+	inline static int gpuSlot = 0;
+	inline static bool gpuOpen = false;
+	inline static bool queriesCreated = false;
+	static int beginGpu(const char* name);
+	static void endGpu();
+	static void collectGpu(int slot);
+
+	// Pasadas de GPU ya leidas, colocadas en el tiempo de CPU en que se enviaron (hilo GL)
+	inline static vector<zone_t> gpuZones;
+
+	// Frames cerrados por endFrame (circular) y la ventana de estadisticas en curso
+	inline static vector<frameRecord_t> history;
+	inline static uint64_t framesRecorded = 0;
+	inline static int64_t frameStart = 0;
+	inline static int windowFrames = 0;
+	inline static double windowMs = 0;
+	inline static double windowCounters[COUNTER_COUNT] = {};
+	inline static map<string, zoneStats_t> windowCpu, windowGpu;
+
+	inline static map<string, zoneStats_t> lastCpu, lastGpu;
+	inline static double lastCounters[COUNTER_COUNT] = {};
+	inline static double lastFrameMs = 0;
+};
+
+#if PRGR_PROFILE
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(name) Profiler::Scope PROFILE_CONCAT(profileScope_, __LINE__)(name)
+#define PROFILE_GPU_SCOPE(name) Profiler::GpuScope PROFILE_CONCAT(profileGpuScope_, __LINE__)(name)
+// value solo se evalua con el perfilador activado
+#define PROFILE_COUNT(counter, value) do { if (Profiler::isEnabled()) Profiler::add(counter, (uint64_t)(value)); } while (0)
+#else
+#define PROFILE_SCOPE(name) ((void)0)
+#define PROFILE_GPU_SCOPE(name) ((void)0)
+#define PROFILE_COUNT(counter, value) ((void)0)
+#endif
+
+#pragma endregion
@@ -15,18 +15,41 @@ public:
 		light
 	} dataType_e;
 
+	// Uniform resuelto tras linkProgram(): se accede por handle (indice en uniformList)
+	typedef struct {
+		string name;
+		GLint location;
+		GLenum glType;
+		float shadow[16]; // Copia del ultimo valor subido (hasta una mat4)
+		bool uploaded;    // false hasta la primera subida
+	} uniform_t;
+
 	// Atributos
 	unsigned int idProgram = -1; // Identificador de programa
 	vector<Shader*> shaderList; // Lista de shaders que componen el programa
 	map<string, unsigned int > varList; // Lista de variables del programa
+	vector<uniform_t> uniformList; // Uniforms activos indexados por handle
+	map<string, int> uniformHandles; // Nombre -> handle (solo se consulta al resolver handles)
+
+	// Estadisticas de subidas de uniforms (las redundantes no llegan al driver)
+	unsigned int uniformUploads = 0;
+	unsigned int uniformSkips = 0;
 
 	string attributeVertPos; // Nombre del atributo de posicion
 	string attributeVertColor; // Nombre del atributo de color
 	string uniformMVP; // Nombre del uniform de matriz MVP
 
+	// Programas compartidos (ver ProgramLibrary)
+	string libraryKey; // Clave en ProgramLibrary (vacia si no viene de la libreria)
+	int refCount = 0;  // Objetos que usan el programa
+
+	// Distinto en cada programa creado: uno nuevo puede ocupar la direccion de otro ya borrado,
+	// asi que lo que se guarde por programa (Render::uniformCache) va por generation y no por Program*
+	unsigned int generation;
+
 	// Mtodos
 	Program(); // Constructor
-	void addShader(string fileName); // Agrega un shader al programa
+	void addShader(string fileName, const vector<string>& defines = {}); // Agrega un shader al programa
 	void loadDescription(string fileName); // Carga la descripcion del programa, es decir los nombres de las variables y atributos
 
 	// Mtodos para obtener la localizacin de los atributos y uniforms, const porque no modifican el estado del objeto
@@ -37,14 +60,50 @@ public:
 	GLint getUniformMVPLocation() const; 
 	GLint getAttributeVertPosLocation() const;
 
+	// Construye el programa a partir de ficheros de shader. Si cacheDir no esta vacio busca primero
+	// el binario guardado (glProgramBinary); si no existe o el driver lo rechaza compila, enlaza y lo
+	// guarda. Devuelve true si el programa se ha cargado de la cache.
+	bool build(const vector<string>& shaderFiles, const vector<string>& defines = {}, const string& cacheDir = "");
+
+	// Clave de la cache: hash de las fuentes (con defines) y de vendor/renderer/version del driver.
+	static string binaryCacheKey(const vector<Shader*>& shaders);
+
+	bool loadBinary(const string& fileName); // Carga un binario de glGetProgramBinary. false si falta o no es valido
+	bool saveBinary(const string& fileName) const; // Guarda el binario del programa ya enlazado
+	bool isLinked() const;
+
 	void linkProgram(); // Linkea el programa
 	void checkErrors(); // Revisa si hubo errores al linkear el programa
 	void clean(); // Limpia el programa
 	void readVarList(); // Lee las variables del programa
 	void use(); // Usa el programa
 
-	void setUniformData(dataType_e tipo, void* dato, string nombre); // Establece datos de GPU de tipo Uniform, los de tipo uniform son variables que se envian al shader y no cambian durante el ciclo de vida del shader
-	void setAttributeData(string nombre, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const GLvoid* pointer); // Establecen datos de GPU de tipo Attribute, los de tipo attribute son variables que se envian al shader y cambian durante el ciclo de vida del shader
+	void setUniformData(dataType_e tipo, void* dato, const string& nombre); // Establece datos de GPU de tipo Uniform, los de tipo uniform son variables que se envian al shader y no cambian durante el ciclo de vida del shader
+
+	// Handle de un uniform (-1 si no existe o el compilador lo ha eliminado). Se resuelve una vez, no por frame.
+	int getUniformHandle(const string& nombre) const;
+
+	// Setters por handle: el programa debe estar en uso. Si el valor coincide con la copia no se sube.
+	void setUniform(int handle, int value);
+	void setUniform(int handle, float value);
+	void setUniform(int handle, const vector4f& value);
+	void setUniform(int handle, const matrix4x4f& value);
+
+	// Asocia un bloque uniform (UBO) a un punto de enlace. Devuelve false si el programa no lo usa.
+	bool bindUniformBlock(const string& blockName, unsigned int bindingPoint);
+
+	// Localizacion de un atributo (-1 si no existe o el compilador lo ha eliminado). Se resuelve una vez, no por frame.
+	int getAttributeLocation(const string& nombre) const;
+
+	void setAttributeData(const string& nombre, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const GLvoid* pointer, GLuint divisor = 0); // Establecen datos de GPU de tipo Attribute, los de tipo attribute son variables que se envian al shader y cambian durante el ciclo de vida del shader
+	void setAttributeData(int location, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const GLvoid* pointer, GLuint divisor = 0); // Igual, con la localizacion ya resuelta (-1 no hace nada)
 	void setLightUniform(const Light& light, int index); // Establece los datos de la luz en el shader
+
+private:
+
+	inline static unsigned int generations = 0;
+
+	void addUniform(const string& nombre, GLenum type);
+	bool updateShadow(int handle, const void* dato, size_t bytes); // true si hay que subir el valor
 };
 
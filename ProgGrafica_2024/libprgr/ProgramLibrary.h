@@ -0,0 +1,44 @@
+#pragma once
+#include "common.h"
+#include "Program.h"
+
+#pragma region --- PROGRAM LIBRARY ---
+
+// Libreria de programas compartidos.
+// Cada combinacion de ficheros de shader + defines se compila y enlaza una sola vez; los
+// objetos que la piden reciben el mismo Program y la libreria cuenta cuantos lo usan.
+// Con 1000 objetos y un unico shader hay 1 programa, no 1000.
+class ProgramLibrary {
+public:
+
+	// Devuelve el programa para esos shaders y defines (lo crea la primera vez) y suma una referencia.
+	static Program* acquire(const vector<string>& shaderFiles, const vector<string>& defines = {});
+
+	// Resta una referencia; con la ultima se borra el programa.
+	static void release(Program* program);
+
+	// Programas distintos cargados.
+	static size_t size() { return programs.size(); }
+
+	// Programas compilados desde el arranque (no cuenta los reutilizados ni los cargados de cache).
+	inline static unsigned int compiledPrograms = 0;
+
+	// Programas cargados de la cache de binarios.
+	inline static unsigned int cachedPrograms = 0;
+
+	// Directorio de la cache de binarios de programa (vacio para desactivarla).
+	inline static string binaryCacheDir = "cache/programs";
+
+	// Pide al driver que compile en varios hilos si soporta GL_KHR_parallel_shader_compile
+	// (o su version ARB). Se llama sola en el primer acquire. Devuelve true si esta disponible.
+	static bool enableParallelCompile();
+
+private:
+
+	inline static map<string, Program*> programs;
+	inline static bool initialized = false;
+
+	static string makeKey(const vector<string>& shaderFiles, const vector<string>& defines);
+};
+
+#pragma endregion
@@ -3,11 +3,21 @@
 #include <map>
 #include <iostream>
 #include <vector>
+#include <atomic>
 
 #include "EventManager.h"
 #include "Object3D.h"
 #include "Camera.h"
 #include "Light.h"
+#include "SceneGraph.h"
+#include "UniformBuffer.h"
+#include "FrustumCuller.h"
+#include "OcclusionCuller.h"
+#include "TripleBuffer.h"
+#include "Profiler.h"
+#include "HeadlessContext.h"
+#include "LightClusters.h"
+#include "AssetLoader.h"
 
 // Declaracin anticipada
 class Camera;
@@ -15,54 +25,383 @@ class Camera;
 using namespace std;
 using namespace libPRGR;
 
+#define MAX_SHADER_LIGHTS 8 // Luces direccionales en FrameData; debe coincidir con MAX_LIGHTS de shader.frag
+
+// Bloques uniform std140 compartidos con data/shader.vert y data/shader.frag.
+// El orden y el relleno de cada struct deben coincidir con la declaracion GLSL.
+#define UBO_FRAME_BINDING 0    // Bloque FrameData: camara y luces (una vez por frame)
+#define UBO_MATERIAL_BINDING 1 // Bloque MaterialData: coeficientes de material (uno por frame, el mismo para todos los lotes)
+
+// Unidades de textura de los buffers de luces puntuales (la 0 es la de la textura del material)
+#define TEXTURE_UNIT_POINT_LIGHTS 1    // uPointLights: pointLight_t, dos texels RGBA32F por luz
+#define TEXTURE_UNIT_CLUSTER_TABLE 2   // uClusterTable: primera luz y cuantas por cluster (RG32UI)
+#define TEXTURE_UNIT_CLUSTER_LIGHTS 3  // uClusterLights: indices de luz de todos los clusters (R32UI)
+
+typedef struct {
+    vector4f position;
+    vector4f color;
+    vector4f direction;
+    int type;
+    float intensity;
+    float pad[2];
+} lightBlock_t;
+
+typedef struct {
+    matrix4x4f view;       // Las matrices van por filas (row_major en GLSL)
+    matrix4x4f projection;
+    matrix4x4f viewProjection;
+    vector4f viewPos;
+    matrix4x4f clusterView;  // Vista con la que se repartieron las luces (la del tick, sin interpolar), con la fila w de clip
+    vector4f clusterParams;  // projection[0][0], projection[1][1], zNear, LightClusters::sliceScale
+    int clusterGrid[4];      // Columnas, filas y cortes de la rejilla y luces puntuales
+    int numLights;           // Direccionales
+    int pad[3];
+    lightBlock_t lights[MAX_SHADER_LIGHTS];
+} frameBlock_t;
+
+typedef struct {
+    float kd;
+    float ks;
+    int shininess;
+    int pad;
+} materialBlock_t;
+
+static_assert(sizeof(lightBlock_t) == 64, "lightBlock_t no sigue std140");
+static_assert(sizeof(frameBlock_t) == 320 + 64 * MAX_SHADER_LIGHTS, "frameBlock_t no sigue std140");
+static_assert(sizeof(materialBlock_t) == 16, "materialBlock_t no sigue std140");
+
+// Datos por instancia en el buffer de instancias (atributos iModel0..2 e iNormal0..2 de shader.vert).
+// Solo las filas 0..2: en matrices afines la fila 3 es siempre (0,0,0,1). normal[0].w, que no afecta a
+// la normal, es la capa de la textura del objeto si esta en un TextureArray.
+typedef struct {
+    vector4f model[3];
+    vector4f normal[3];
+} instanceData_t;
+
+static_assert(sizeof(instanceData_t) == 96, "instanceData_t tiene relleno");
+
+// Objetos con el mismo programa, malla y textura: una sola llamada glDrawElementsInstanced.
+// Con texturas en un TextureArray basta con que esten en el mismo array.
+typedef struct {
+    Program* program;
+    Mesh* mesh;
+    Texture* texture; // La del primer objeto (la que se enlaza: su array si lo tiene)
+    int lod; // Nivel de detalle de la malla (indice en Mesh::lods)
+    unsigned int firstInstance; // Primera instancia del lote en el buffer de instancias
+    unsigned int instanceCount;
+    bool alphaTested; // Programa con discard (Object3D::alphaTested): fuera del prepass y despues de los opacos
+    float depth; // Profundidad en vista de su instancia mas cercana
+} drawBatch_t;
+
+// Comando de glMultiDrawElementsIndirect (el formato lo fija GL). baseInstance elige las filas
+// del buffer de instancias, asi que cada dibujado del grupo lee sus propias matrices.
+typedef struct {
+    unsigned int count;
+    unsigned int instanceCount;
+    unsigned int firstIndex;   // En la arena
+    int baseVertex;            // Primer vertice de la malla en la arena
+    unsigned int baseInstance; // drawBatch_t::firstInstance
+} drawIndirectCommand_t;
+
+static_assert(sizeof(drawIndirectCommand_t) == 20, "drawIndirectCommand_t tiene relleno");
+
+// Lotes seguidos con el mismo programa, textura (o array) y arena de geometria: un solo glMultiDrawElementsIndirect.
+// Se dibujan en el orden de drawGroups, que no tiene por que ser el de los lotes (ver sortFrontToBack).
+typedef struct {
+    unsigned int firstBatch; // Primer lote del grupo (y su comando en el buffer indirecto)
+    unsigned int batchCount;
+    float depth; // La de su lote mas cercano
+} drawGroup_t;
+
+#define MOVE_REFERENCE_RATE 60.0 // Los pasos de move() de camara, luces y objetos estan pensados para un tick a 60 Hz
+
+// Todo lo que necesita el hilo GL para dibujar un frame, calculado por la simulacion (ver buildSnapshot).
+// Una vez publicada no la modifica nadie mas que el hilo GL, que se lleva sus listas en submitSnapshot.
+// Lleva el estado del ultimo tick y el del anterior para que el hilo GL interpole entre los dos.
+typedef struct {
+    frameBlock_t frame; // Camara y luces, ya con el formato del UBO
+    frameBlock_t previousFrame; // Lo mismo en el tick anterior
+    vector<drawBatch_t> batches;
+    vector<drawIndirectCommand_t> drawCommands;
+    vector<drawGroup_t> drawGroups;
+    vector<instanceData_t> instanceData; // Matrices de los objetos visibles, en el orden de los lotes
+    vector<instanceData_t> previousInstanceData; // Sus matrices en el tick anterior
+    vector<pointLight_t> pointLights; // Luces puntuales en este tick y en el anterior
+    vector<pointLight_t> previousPointLights;
+    vector<uint32_t> clusterTable; // LightClusters::table e indices de este tick
+    vector<uint32_t> clusterLights;
+    double tickTime; // Segundos desde el inicio del bucle hasta el final del tick
+    vector<unsigned int> retiredPrograms; // Program::generation de los que ya no usa ningun objeto: el hilo GL olvida sus handles (se vacia al leerla)
+} frameSnapshot_t;
+
+// Estado de la camara calculado una vez por frame.
+typedef struct {
+    matrix4x4f view;
+    matrix4x4f projection;
+    matrix4x4f viewProjection;
+    vector4f position;
+    vector4f frustumPlanes[6]; // Izquierda, derecha, abajo, arriba, cerca, lejos. Dentro si (x,y,z)*p + w >= 0
+    float pixelScale; // Pixeles que ocupa una unidad a distancia 1 (alto del framebuffer * proyeccion[1][1] / 2)
+    float zNear, zFar; // Planos de la camara (cortes de los clusters de luces)
+} viewState_t;
+
 class Render {
 public:
 
     // --- VENTANA GL ---
-    GLFWwindow* window; // Ventana de GLFW que utilizaremos para dibujar
+    GLFWwindow* window = nullptr; // Ventana de GLFW que utilizaremos para dibujar
 
     void initGL(int width, int height);
     void deinitGLFW();
 
+    // Sin ventana ni pantalla (ver HeadlessContext): se dibuja en un FBO de width x height.
+    // No hay entrada ni swap; los frames se lanzan con runFrames. Devuelve false si no hay contexto.
+    bool initHeadless(int width, int height);
+    bool headless = false;
+
+    // frames frames seguidos con un tick fijo por frame y glFinish al final de cada uno.
+    // Devuelve lo que ha tardado cada frame en ms (CPU + GPU).
+    vector<double> runFrames(int frames);
+
+    // Pixeles RGBA del ultimo frame dibujado (del FBO sin ventana), de abajo arriba
+    vector<uint8_t> readFramebuffer(int& width, int& height);
+
 
     // --- CMARA ---
-    Camera* camera;
+    Camera* camera = nullptr;
+    viewState_t view = {}; // Matrices y planos de la camara del frame actual
+
     void putCamera(Camera* camera); // Establece la cmara a utilizar
+    void updateView(); // Calcula vista, proyeccion y planos del frustum una vez por frame
     bool cameraCollision(Camera* camera);
 
 
     // --- LUCES ---
     vector<Light*> lights; // Lista de luces que utilizaremos para iluminar los objetos
 
+    // Las luces puntuales se reparten cada frame en clusters de la vista (LightClusters) y no tienen
+    // limite; las direccionales van en FrameData, como mucho MAX_SHADER_LIGHTS.
+    bool clusteredLighting = true; // false: un solo cluster, cada fragmento recorre todas las luces visibles
+    LightClusters lightClusters;
+    unsigned int clusteredLights = 0; // Luces puntuales que tocan algun cluster en el frame actual
+
     void putLight(Light* light); // Aade una luz a la lista de luces
     void putLight(vector<Light*> lights); // Aade mltiples luces a la lista
 
 
     // --- OBJETOS ---
     inline static map<int, Object3D*> objectList; // Lista de objetos a dibujar 
-    map<int, bufferObject> bufferList; // Lista de buffers de objetos
 
-    void setUpObject(Object3D* obj); // Configura un objeto para ser dibujado
+    void setUpObject(Object3D* obj); // Sube la malla del objeto a GPU si es la primera que la usa
     void putObject(Object3D* obj); // Agrega un objeto a la lista de objetos a dibujar
     void putObject(int ID, Object3D* obj);
     Object3D* getObject(int ID);
     void removeObject(Object3D* obj); // Elimina un objeto de la lista de objetos a dibujar
 
+    // Carga en segundo plano (ver AssetLoader): loadObject pide el fichero y el objeto entra en la escena
+    // (putObject) en el primer tick despues de terminar. Cada frame el hilo GL dedica como mucho
+    // assetBudgetMs a subir lo que ya se haya leido.
+    AssetLoader assetLoader;
+    double assetBudgetMs = 2.0;
+
+    void loadObject(Object3D* obj, const string& file); // Hilo GL, tambien durante el bucle
+    void finishLoading(); // Espera a que terminen todos los pedidos y anade sus objetos a la escena (hilo GL, fuera del bucle)
+
+
+    // --- JERARQUIA ---
+    SceneGraph sceneGraph; // Transformaciones padre/hijo de objetos y luces
+    vector<Object3D*> nodeObjects; // Handle de nodo -> objeto (nullptr si no es un objeto)
+    vector<Light*> nodeLights; // Handle de nodo -> luz (nullptr si no es una luz)
+
+    void attachObject(Object3D* child, Object3D* parent); // Engancha un objeto a otro (parent = nullptr para soltarlo)
+    void attachLight(Light* light, Object3D* parent); // Engancha una luz a un objeto (parent = nullptr para soltarla)
+
+
+    // --- CULLING ---
+    bool frustumCulling = true; // Descartar los objetos cuyo colisionador queda fuera del frustum
+    bool cullingBVH = false; // Recorrer un BVH de la escena en vez de probar todos los objetos
+    unsigned int visibleObjects = 0; // Objetos que pasaron el culling en el frame actual
+    unsigned int culledObjects = 0; // Objetos descartados en el frame actual (frustum + oclusion)
+    bool occlusionCulling = false; // Probar ademas contra la profundidad de los oclusores (Object3D::occluder), rasterizada en CPU
+    unsigned int occludedObjects = 0; // Objetos dentro del frustum descartados por oclusion
+    OcclusionCuller occlusion; // Buffer de profundidad de CPU (256x128) y su Hi-Z
+
+
+    // --- NIVEL DE DETALLE ---
+    bool meshLOD = true; // Elegir el LOD de cada objeto por su tamano en pantalla
+    float lodPixelError = 1.0f; // Error maximo de un LOD proyectado en pantalla, en pixeles
+    float lodHysteresis = 0.5f; // Un LOD mas simple solo se elige si su error baja de lodPixelError * (1 - lodHysteresis)
+    unsigned int renderedTriangles = 0; // Triangulos enviados en el frame actual (todas las instancias)
+
 
     // --- RENDERIZADO ---
-    void drawGl(Object3D* obj); // Dibuja un objeto en la ventana
+    UniformBuffer* uniformBuffer = nullptr; // UBO en anillo con los bloques FrameData y MaterialData
+    unsigned int instanceBuffer = 0; // VBO con un instanceData_t por objeto, reescrito cada frame
+    size_t instanceCapacity = 0; // Instancias que caben en instanceBuffer
+
+    Program* currentProgram = nullptr; // Programa en uso: evita glUseProgram redundantes
+    unsigned int programSwitches = 0; // Cambios de programa en el frame actual
+    unsigned int drawCalls = 0; // Llamadas de dibujo en el frame actual
+    unsigned int textureBinds = 0; // Texturas (o arrays) enlazadas en el frame actual
+
+    bool multiDrawIndirect = true; // Un glMultiDrawElementsIndirect por grupo (necesita GL 4.3; si no, una llamada por lote)
+    unsigned int indirectBuffer = 0; // GL_DRAW_INDIRECT_BUFFER con un comando por lote, reescrito cada frame
+    size_t indirectCapacity = 0; // Comandos que caben en indirectBuffer
+
+    vector<drawBatch_t> batches; // Lotes del frame, en orden de dibujado
+    vector<drawIndirectCommand_t> drawCommands; // Un comando por lote, mismo orden que batches
+    vector<drawGroup_t> drawGroups; // Grupos de lotes que van en una sola llamada, en orden de dibujado
+    vector<instanceData_t> instanceData; // Copia en CPU del buffer de instancias
+
+    // Los objetos opacos (sin Object3D::alphaTested) van antes que los de alpha test. Con sortFrontToBack
+    // se dibujan ademas de delante atras: las instancias de cada lote y, dentro de cada programa, los
+    // grupos, para que el early-Z descarte lo tapado antes de sombrearlo.
+    bool sortFrontToBack = true;
+
+    // Prepass de profundidad: los opacos se dibujan antes solo con la posicion (data/depth.frag, sin
+    // color) y la pasada normal los compara con GL_LEQUAL sin escribir profundidad, asi que el shader
+    // de iluminacion se ejecuta una vez por pixel. Cuesta dibujar dos veces la geometria opaca.
+    bool depthPrepass = false;
+
+    void prepareFrame(); // buildSnapshot + submitSnapshot en el mismo hilo; debe llamarse antes de dibujar
+    void buildSnapshot(frameSnapshot_t& snap); // Culling, LOD, lotes, instancias y comandos. Solo CPU: vale desde cualquier hilo
+    void submitSnapshot(frameSnapshot_t& snap); // Se queda con las listas de la instantanea y sube los comandos (hilo GL)
+    void interpolateFrame(float alpha); // Matrices, camara y luces entre el tick anterior (0) y el ultimo (1); sube instancias y bloques
+    void drawBatches(); // Dibuja todos los lotes del frame (por grupos si hay multi-draw indirecto)
+    bool useMultiDraw() const; // multiDrawIndirect y el contexto lo soporta
+    const vector<Object3D*>& getDrawList(); // Objetos ordenados por alpha test, programa, textura (o array), arena y malla
 
 
     // --- BUCLE PRINCIPAL ---
+    // Con threadedSimulation la camara, las luces, los objetos, las colisiones y la preparacion del frame van en
+    // un hilo propio y el hilo principal solo sube y dibuja instantaneas: el frame cuesta max(sim, render) y no
+    // sim + render. Mientras dura el bucle la escena es de la simulacion: no se anaden ni quitan objetos ni luces,
+    // y los contadores de culling y LOD (visibleObjects, renderedTriangles...) los escribe ese hilo.
+    bool threadedSimulation = true;
+
+    // La simulacion avanza en ticks fijos de 1 / simulationRate segundos medidos con reloj real (acumulador),
+    // independientes de los frames: el movimiento es el mismo en cualquier maquina y su coste por segundo
+    // esta acotado. Cada frame se dibuja interpolando entre los dos ultimos ticks.
+    double simulationRate = 60.0; // Ticks por segundo
+    int maxFrameRate = 0; // Limite de frames por segundo del hilo GL (0 = sin limite aparte del vsync)
+    int swapInterval = 1; // 0 sin vsync, 1 vsync, -1 vsync adaptativa (si el driver no la tiene, 1)
+    unsigned long long simulationTicks = 0; // Ticks desde el arranque
+
+    void setSwapInterval(int interval); // Cambia swapInterval y lo aplica al contexto (hilo GL)
+    void updateScene(double timeStep); // Un tick de simulacion: camara, luces, objetos y jerarquia
     void mainLoop(); // Loop principal de la aplicacin
 
 private:
 
-    // Funciones auxiliares para el renderizado
-    void setupProgramAndMatrices(Object3D* obj);
-    void setupLights(Program* prg);
-    void setupMaterial(Object3D* obj);
-    void setupVertexAttributes(Object3D* obj);
-    void renderObject(Object3D* obj);
+    friend class RenderBenchmark;
+
+    // Handles de los uniforms sueltos que usa Render (el resto va en los bloques), resueltos una vez por programa
+    typedef struct {
+        int texture;
+        int pointLights, clusterTable, clusterLights;
+    } renderUniforms_t;
+
+    map<unsigned int, renderUniforms_t> uniformCache; // Por Program::generation. Solo lo toca el hilo GL
+
+    // Localizaciones de los atributos de un programa con un formato de vertices, resueltas una vez
+    typedef struct {
+        vector<int> vertex; // Una por atributo de VertexLayout::attributes, en el mismo orden
+        int modelRows[3], normalRows[3]; // iModel0..2 e iNormal0..2
+    } renderAttributes_t;
+
+    // Por Program::generation y formato: el programa del prepass se usa con todos los formatos. Solo lo toca el hilo GL
+    map<pair<unsigned int, const VertexLayout*>, renderAttributes_t> attributeCache;
+
+    // Programas que ha dejado de usar removeObject (hilo de simulacion), hasta pasar a una instantanea
+    vector<unsigned int> retiredPrograms;
+
+    const void* currentTexture = nullptr; // Texture::binding de lo enlazado en la unidad 0 durante drawBatches
+
+    Program* depthProgram = nullptr; // El del prepass de profundidad (se crea la primera vez que se usa)
+
+    // buildSnapshot: instancias visibles del lote en construccion con su profundidad en vista
+    vector<std::pair<float, size_t>> instanceOrder;
+
+    // Instantaneas de frame: triple buffer entre simulacion y GL, o una sola sin hilos (prepareFrame)
+    TripleBuffer<frameSnapshot_t> snapshots;
+    frameSnapshot_t frameSnapshot;
+
+    // Estado del que interpola el hilo GL: el de la ultima instantanea subida
+    frameBlock_t frameFrom = {}, frameTo = {};
+    vector<instanceData_t> instancesFrom, instancesTo;
+    vector<pointLight_t> pointLightsFrom, pointLightsTo;
+    vector<pointLight_t> pointLightData; // Interpoladas, copia en CPU de pointLightBuffer
+
+    // Buffers de las luces puntuales y los clusters, leidos como texturas de buffer
+    unsigned int pointLightBuffer = 0, clusterTableBuffer = 0, clusterLightBuffer = 0;
+    unsigned int pointLightTexture = 0, clusterTableTexture = 0, clusterLightTexture = 0;
+    void bindLightBuffers();
+
+    // Objetos que ha terminado assetLoader en el hilo GL y aun no estan en la escena (los anade updateScene)
+    std::mutex loadedMutex;
+    vector<Object3D*> loadedObjects;
+    void streamAssets(); // Un frame de subidas de assetLoader (hilo GL)
+    void addLoadedObjects(); // putObject de loadedObjects (hilo de simulacion)
+    void insertObject(int ID, Object3D* obj); // putObject sin setUpObject: no hace llamadas GL
+
+    // Camara y luces al principio del tick en curso (hilo de simulacion)
+    frameBlock_t previousTickFrame = {};
+    void fillFrameBlock(frameBlock_t& frame);
+
+    // Luces puntuales de la instantanea y su reparto en clusters con la vista del tick
+    void clusterPointLights(frameSnapshot_t& snap);
+
+    // Alto del framebuffer: lo lee el hilo principal y lo usa updateView en el de simulacion
+    std::atomic<int> framebufferHeight = 0;
+    void updateFramebufferSize();
+
+    void mainLoopThreaded();
+
+    // Partes del frame del hilo GL, separadas para medirlas con el perfilador
+    void pollInput();
+    void clearFrame();
+    void endFrame(std::chrono::steady_clock::time_point frameStart); // Swap, limite de frames y Profiler::endFrame
+
+    // Estado GL comun a la ventana y al modo sin ventana
+    void initGLState();
+
+    // FBO del modo sin ventana
+    unsigned int offscreenFBO = 0, offscreenColor = 0, offscreenDepth = 0;
+    int offscreenWidth = 0, offscreenHeight = 0;
+
+    vector<Object3D*> drawList; // Cache de getDrawList()
+    bool drawListDirty = true; // Se reordena al anadir o quitar objetos
+    const renderUniforms_t& getUniforms(Program* prg);
+    const renderAttributes_t& getAttributes(Program* prg, const VertexLayout* layout);
+
+    // Volumenes de drawList (mismo orden), su BVH y el resultado del culling del frame
+    FrustumCuller culler;
+    CullingBVH bvh;
+    bool bvhDirty = true; // La lista de objetos cambio: hay que reconstruir el BVH
+    vector<unsigned char> visibility;
+
+    // Rellena visibility para la lista de dibujado, antes de tocar ningun estado GL
+    void cullObjects(const vector<Object3D*>& list);
+    void cullOccluded(const vector<Object3D*>& list);
+
+    // LOD del objeto segun el error proyectado de cada nivel; parte del LOD del frame anterior (histeresis)
+    int selectLod(Object3D* obj);
+
+    // Funciones auxiliares para el renderizado de un lote. Con depthOnly solo la profundidad: ese
+    // programa, sin material y solo con las posiciones.
+    void drawBatch(const drawBatch_t& batch, Program* depthOnly = nullptr);
+    void setupProgram(const drawBatch_t& batch);
+    void setupMaterial(const drawBatch_t& batch);
+    void setupVertexAttributes(const drawBatch_t& batch, unsigned int firstInstance, bool positionOnly = false);
+    void renderBatch(const drawBatch_t& batch);
+
+    // Todos los lotes de un grupo: un glMultiDrawElementsIndirect o, sin multi-draw, uno a uno
+    void drawGroup(const drawGroup_t& group, Program* depthOnly = nullptr);
+    void drawDepthPrepass(); // Profundidad de los grupos opacos, sin escribir color
+    uint64_t groupTriangles(const drawGroup_t& group) const; // Para el contador del perfilador
+
+    // Recalcula las matrices de mundo modificadas y las copia a objetos, colisionadores y luces
+    void updateSceneGraph();
+    void bindNode(int node, Object3D* obj, Light* light);
 
 };
\ No newline at end of file
@@ -0,0 +1,346 @@
+#pragma once
+#include "common.h"
+#include "Render.h"
+#include "MeshOptimizer.h"
+
+#pragma region --- RENDER BENCHMARK ---
+
+// Benchmarks de CPU del camino de dibujado. Necesitan el contexto GL creado por Render::initGL.
+// "--bench-uniforms [fichero.json]": tiempo de CPU por llamada de dibujo (uniforms + glDrawElements)
+// con 1, 8 y 64 luces, comparando los glUniform* por nombre de antes con los bloques uniform (UBO)
+// actuales. Cada frame dibuja objectsPerFrame objetos.
+// "--bench-programs [fichero.json]": arranque en frio (compilar y guardar el binario) y en
+// caliente (cargar el binario de la cache) de varias variantes del programa principal.
+// "--bench-instancing [fichero.json]": 10000 copias de cubo.fiis; tiempo de carga, mallas
+// leidas y CPU por frame con un glDrawElementsInstanced por lote frente a uno por objeto.
+// "--bench-culling [fichero.json]": 50000 cubos repartidos por un plano, la mayoria fuera de
+// la camara; coste del culling escalar, SSE y con BVH y CPU por frame con y sin culling.
+// "--bench-lod [fichero.json]": copias de icosfera.fiis a distancias crecientes; triangulos
+// enviados con y sin LOD frente a los pixeles que ocupa cada objeto.
+// "--bench-vertex [fichero.json]": memoria de VBO y precision de cada VertexLayout con las mallas
+// de data/ y con una esfera generada grande; tiempo de GPU solo de vertices (GL_RASTERIZER_DISCARD).
+// "--bench-meshopt [fichero.json]": ACMR/ATVR, overdraw y bytes de VBO/IBO de las mallas de data/ y
+// de una esfera con vertices duplicados y triangulos desordenados, antes y despues de optimizarlas.
+// "--bench-mdi [fichero.json]": 1000, 4000 y 16000 objetos con una malla distinta cada uno; CPU por
+// frame y llamadas con un dibujado por lote frente a un glMultiDrawElementsIndirect por grupo.
+// "--bench-profiler [fichero.json]": CPU por frame (tick + prepareFrame + drawBatches) con el perfilador
+// desactivado y activado, coste de una zona desactivada y sobrecoste estimado de tenerlo compilado.
+// "--bench-lights [fichero.json]": 64, 512 y 4096 luces puntuales de radio 3 sobre un suelo; coste del
+// reparto en clusters, luces por cluster y frame (CPU + GPU) con clusters frente a un solo cluster.
+// "--bench-textures [fichero.json]": cada textura de data/textures sin cache y desde la cache .ptex,
+// memoria de video y PSNR del nivel 0 frente al original; frame (CPU + GPU) de una rejilla de cubos
+// que se pierde en el horizonte con la textura RGBA8 sin mipmaps frente a la comprimida con mipmaps.
+// "--bench-streaming [fichero.json]": 4, 16 y 64 copias de cada malla de data/ cargadas con loadFromFile
+// antes del primer frame frente a Render::loadObject (AssetLoader); tiempo hasta el primer frame, hasta
+// que estan todas y peor frame mientras se cargan.
+// "--bench-texarrays [fichero.json]": cubos con las texturas de data/textures repartidas; lotes, grupos,
+// llamadas, texturas enlazadas y frame (CPU + GPU) con una textura por objeto frente a TextureArray con
+// su tamano y reescaladas a un solo tamano.
+// "--bench-prepass [fichero.json]": cubos en desorden que se tapan unos a otros; fragment shaders
+// ejecutados (consultas de estadisticas del pipeline, si las hay; algunos drivers los cuentan antes de
+// la prueba de profundidad), muestras que la pasan y frame (CPU + GPU) con alpha test en todos, sin el
+// en los opacos, ordenados de delante atras y con prepass de profundidad.
+// "--headless [frames] [imagen.png] [fichero.json]": la escena normal sin ventana (Render::initHeadless);
+// tiempos por frame y, si se indica, el ultimo frame en PNG para compararlo con una imagen de referencia.
+// Con "--headless --replay entrada.inp" el recorrido es el de la grabacion (EventManager), un frame por tick.
+// "--headless --bench-..." lanza cualquiera de los anteriores sin ventana.
+class RenderBenchmark {
+public:
+
+	// Resultado de un escenario.
+	typedef struct {
+		int numLights;
+		bool movingLights;       // Las luces cambian en cada frame
+		double nsPerDrawStrings; // Busqueda por nombre (std::string + map) y glUniform* en cada dibujado
+		double nsPerDrawBlocks;  // UBO e instancias escritos una vez por frame + un dibujado instanciado por lote
+		double callsPerDrawStrings; // glUniform* por dibujado
+		double callsPerDrawBlocks;  // glUniform* + glBindBufferRange por dibujado
+	} uniformResult_t;
+
+	// Resultado de dibujar muchas copias de la misma malla.
+	typedef struct {
+		int objects;
+		double loadMs;             // Crear y cargar todos los objetos
+		unsigned int meshesLoaded; // Ficheros .fiis leidos durante la carga
+		double msPerFrameInstanced; // CPU por frame: prepareFrame + drawBatches
+		double msPerFrameObjects;   // CPU por frame: prepareFrame + un dibujado por objeto
+		unsigned int drawCallsInstanced;
+		unsigned int drawCallsObjects;
+	} instancingResult_t;
+
+	// Resultado del culling de una escena grande.
+	typedef struct {
+		int objects;
+		unsigned int visible;
+		double msCullScalar; // Un plano tras otro, objeto a objeto
+		double msCullSSE;    // 4 objetos por iteracion
+		double msCullBVH;    // refit + recorrido del BVH
+		unsigned int bvhNodesVisited;
+		double msFrameNoCulling; // prepareFrame + drawBatches
+		double msFrameCulling;
+		double msFrameBVH;
+	} cullingResult_t;
+
+	// Resultado del LOD con todos los objetos a la misma distancia.
+	typedef struct {
+		float distance;
+		int objects;
+		double pixelsPerObject;     // Area aproximada de la esfera de la malla en pantalla
+		unsigned int trianglesFull; // Sin LOD
+		unsigned int trianglesLOD;
+		double msFrameFull;         // prepareFrame + drawBatches
+		double msFrameLOD;
+	} lodResult_t;
+
+	// Resultado de un formato de vertices.
+	typedef struct {
+		string layout;
+		unsigned int stride;
+		size_t sampleBytes;     // VBO de todas las mallas de data/
+		size_t largeBytes;      // VBO de la esfera generada
+		size_t largeVertices;
+		float maxNormalErrorDeg; // Peor normal tras empaquetar y desempaquetar
+		float maxUVError;
+		double gpuMsPerFrame;   // Copias de la esfera sin rasterizar: lectura de vertices + shader
+		double fetchGBs;        // largeBytes * copias / gpuMsPerFrame
+	} vertexFormatResult_t;
+
+	// Resultado de optimizar una malla (ver MeshOptimizer).
+	typedef struct {
+		string mesh;
+		MeshOptimizer::meshStats_t before; // Como se lee del fichero, indices de 32 bits
+		MeshOptimizer::meshStats_t after;  // Soldada, reordenada e indices de 16 bits si caben
+		double optimizeMs;                 // weldVertices + buildLods + optimize
+	} meshOptResult_t;
+
+	// Resultado de dibujar muchas mallas distintas (un lote por objeto).
+	typedef struct {
+		int objects;
+		unsigned int batches;
+		unsigned int groups;            // Grupos de multi-draw (programa + textura + arena)
+		double msPerFrameBatches;       // CPU por frame: prepareFrame + una llamada por lote
+		double msPerFrameMultiDraw;     // CPU por frame: prepareFrame + una llamada por grupo
+		unsigned int drawCallsBatches;
+		unsigned int drawCallsMultiDraw;
+		bool multiDrawSupported;        // Contexto 4.3 o mayor (si no, las dos columnas miden lo mismo)
+	} multiDrawResult_t;
+
+	// Resultado del perfilador en una escena de cubos.
+	typedef struct {
+		int objects;
+		double msFrameDisabled;      // CPU por frame con el perfilador compilado y desactivado
+		double msFrameEnabled;       // Activado: zonas, consultas de GPU y contadores
+		double checksPerFrame;       // Zonas + contadores por frame (cada uno mira si esta activado)
+		double nsPerDisabledCheck;   // Coste de una zona vacia con el perfilador desactivado
+		double nsPerEnabledZone;     // Idem activado
+		double disabledOverheadPct;  // checksPerFrame * nsPerDisabledCheck frente a msFrameDisabled
+		map<string, Profiler::zoneStats_t> zones; // Medias por frame con el perfilador activado
+	} profilerResult_t;
+
+	// Resultado de iluminar un suelo con muchas luces puntuales pequenas.
+	typedef struct {
+		int lights;
+		unsigned int visibleLights;      // Tocan algun cluster
+		unsigned int lightClusterPairs;  // Entradas de la lista de indices
+		double lightsPerCluster;         // Media en los clusters con alguna luz
+		unsigned int maxLightsPerCluster;
+		double msAssign;                 // CPU: reparto en clusters (LightClusters::assign)
+		double msFrameClustered;         // CPU + GPU por frame con clusters
+		double msFrameSingle;            // Con un solo cluster: cada fragmento recorre todas las luces visibles (0: sin medir)
+	} lightingResult_t;
+
+	// Resultado de cargar una textura con las opciones actuales de Texture.
+	typedef struct {
+		string file;
+		int width, height;
+		textureFormat_e format;
+		int levels;
+		size_t bytesBaseline;  // Un nivel RGBA8, sin mipmaps
+		size_t bytesGPU;       // Todos los niveles en su formato
+		double coldMs;         // Sin cache: decodificar, mipmaps, comprimir, guardar la cache y subir
+		double warmMs;         // Desde la cache (sin subir)
+		double uploadMs;       // Subir los niveles
+		bool fromCache;        // La carga en caliente vino realmente de la cache
+		double psnr;           // Nivel 0 leido de la GPU frente al fichero, en dB (RGB; 100: identico)
+	} textureResult_t;
+
+	// Resultado de muestrear una textura en una rejilla de cubos hasta el horizonte.
+	typedef struct {
+		int objects;
+		size_t bytesBaseline, bytesCompressed;
+		double msFrameBaseline;    // RGBA8, un nivel, GL_NEAREST
+		double msFrameTrilinear;   // Con las opciones actuales pero sin filtro anisotropico
+		double msFrameCompressed;  // Con las opciones actuales (mipmaps, compresion y anisotropico)
+	} textureSamplingResult_t;
+
+	// Resultado de cargar muchas mallas distintas con sus texturas.
+	typedef struct {
+		int objects;
+		bool async;             // Render::loadObject (si no, loadFromFile + putObject antes del primer frame)
+		int threads;            // Hilos de carga (0 sin AssetLoader)
+		size_t assetBytes;      // Ficheros .fiis, texturas y sus caches .ptex
+		double msFirstFrame;    // Desde el primer pedido hasta terminar el primer frame
+		double msAllLoaded;     // Hasta terminar el primer frame con todos los objetos
+		double msFrameMax;      // Peor frame mientras se cargaban (con la carga sincrona, la carga entera)
+		double msFrameLoaded;   // Un frame con todo cargado, como referencia
+		double msUpdateMax;     // AssetLoader::update mas largo (limite: Render::assetBudgetMs mas un paso)
+		int framesLoading;      // Frames hasta tenerlos todos
+	} streamingResult_t;
+
+	// Resultado de dibujar la misma malla con texturas distintas.
+	typedef struct {
+		string mode;                  // "texturas", "arrays" o "arrays <lado>"
+		int objects;
+		int textures;                 // Texturas distintas repartidas entre los objetos
+		unsigned int bindings;        // Texturas o arrays distintos que enlazar
+		size_t textureBytes;          // Memoria de video (de los arrays, todas las capas reservadas)
+		unsigned int batches;
+		unsigned int groups;
+		double msFrameBatches;        // CPU + GPU por frame con una llamada por lote
+		double msFrameMultiDraw;      // Con un glMultiDrawElementsIndirect por grupo
+		unsigned int drawCallsBatches, drawCallsMultiDraw;
+		unsigned int textureBindsBatches, textureBindsMultiDraw;
+	} textureArrayResult_t;
+
+	// Resultado de dibujar objetos que se tapan con cada forma de tratar la profundidad.
+	typedef struct {
+		string mode;                  // "alpha test", "opacos", "opacos + orden" u "opacos + orden + prepass"
+		int objects;
+		int64_t fragmentInvocations;  // Fragment shaders de un frame, con los del prepass (-1 sin GL_ARB_pipeline_statistics_query)
+		int64_t samplesPassed;        // Muestras que pasan la prueba de profundidad (GL_SAMPLES_PASSED), con las del prepass
+		double msFrame;               // CPU + GPU por frame
+		unsigned int drawCalls;
+		int maxDiff;                  // Mayor diferencia de un canal con la imagen del primer modo
+	} depthPrepassResult_t;
+
+	// Resultado de dibujar la escena cargada sin ventana.
+	typedef struct {
+		int frames;
+		int width, height;
+		string context;   // Como se creo el contexto (HeadlessContext::description)
+		string renderer;  // GL_RENDERER
+		double msMean, msMin, msP50, msP95, msP99, msMax; // Por frame, CPU + GPU
+		string image;     // PNG del ultimo frame (vacio si no se pidio o no se pudo escribir)
+		vector<double> frameMs; // Cada frame, para comparar frame a frame dos ejecuciones de la misma grabacion
+		vector4f cameraPosition; // Donde acaba la camara (el mismo con la misma grabacion)
+	} headlessResult_t;
+
+	// Resultado de la cache de binarios para una variante de programa.
+	typedef struct {
+		string defines;
+		double coldMs;  // Compilar + enlazar + guardar el binario
+		double warmMs;  // Cargar el binario guardado
+		bool fromCache; // La carga en caliente vino realmente de la cache
+	} programResult_t;
+
+	vector<uniformResult_t> uniformResults;
+	vector<programResult_t> programResults;
+	vector<instancingResult_t> instancingResults;
+	vector<cullingResult_t> cullingResults;
+	vector<lodResult_t> lodResults;
+	vector<vertexFormatResult_t> vertexResults;
+	vector<meshOptResult_t> meshOptResults;
+	vector<multiDrawResult_t> multiDrawResults;
+	vector<profilerResult_t> profilerResults;
+	vector<headlessResult_t> headlessResults;
+	vector<lightingResult_t> lightingResults;
+	vector<textureResult_t> textureResults;
+	vector<textureSamplingResult_t> textureSamplingResults;
+	vector<streamingResult_t> streamingResults;
+	vector<textureArrayResult_t> textureArrayResults;
+	vector<depthPrepassResult_t> depthPrepassResults;
+
+	RenderBenchmark(Render* render, int frames = 50, int objectsPerFrame = 64, int repetitions = 5);
+
+	// Mide la preparacion de uniforms + glDrawElements de cada objeto.
+	void runUniforms();
+
+	// Mide la cache de binarios con tantas variantes (defines distintos) como se indique.
+	void runPrograms(int variants = 8);
+
+	// Mide carga y dibujado de tantas copias de cubo.fiis como se indique.
+	void runInstancing(int objects = 10000);
+
+	// Mide el culling con tantos cubos como se indique (la mayoria fuera de la camara).
+	void runCulling(int objects = 50000);
+
+	// Mide triangulos y CPU por frame con y sin LOD para tantas copias de icosfera.fiis como se indique.
+	void runLOD(int objects = 1000);
+
+	// Mide cada formato de vertices con las mallas de data/ y una esfera de (lado + 1)^2 vertices.
+	void runVertexFormats(int side = 512, int copies = 16);
+
+	// Compara las mallas de data/ y una esfera de (lado + 1)^2 vertices antes y despues de optimizarlas.
+	void runMeshOptimizer(int side = 128);
+
+	// Mide el dibujado de tantos objetos como se indique, cada uno con su propia malla (cubo).
+	void runMultiDraw(int objects = 4000);
+
+	// Mide el perfilador con tantos cubos como se indique.
+	void runProfiler(int objects = 1000);
+
+	// Mide el sombreado por clusters con tantas luces puntuales como se indique.
+	// Con un solo cluster solo se mide hasta singleLimit luces: por encima un rasterizador por
+	// software tarda segundos en cada frame.
+	void runLighting(int lights = 1024, int singleLimit = 1024);
+
+	// Carga cada textura de data/textures sin cache y desde ella y mide la memoria y la calidad.
+	void runTextures();
+
+	// Mide el frame con tantos cubos como se indique con la textura sin comprimir ni mipmaps, con ellos
+	// y ademas con filtro anisotropico.
+	void runTextureSampling(int objects = 4096);
+
+	// Carga copies copias de cada malla de data/ (cada una es un fichero distinto) de golpe y en segundo plano.
+	void runStreaming(int copies = 16);
+
+	// Dibuja tantos cubos como se indique con las texturas de data/textures repartidas entre ellos, sin
+	// TextureArray, con arrays por tamano y con todas reescaladas a layerSize.
+	void runTextureArrays(int objects = 1024, int layerSize = 512);
+
+	// Dibuja tantos cubos como se indique, en desorden y tapandose, con el programa con discard en todos
+	// (como antes), solo en los que tienen transparencias, ordenados de delante atras y con prepass.
+	void runDepthPrepass(int objects = 4096);
+
+	// Dibuja la escena que haya en el Render tantos frames como se indique (Render::runFrames) y
+	// guarda el ultimo en imageFile si no esta vacio.
+	void runHeadless(int frames = 300, string imageFile = "");
+
+	bool writeJSON(string fileName) const;
+
+	void print() const;
+
+private:
+
+	Render* render;
+	int frames;
+	int objectsPerFrame;
+	int repetitions;
+	unsigned int stringCalls = 0;
+
+	// Reproduce el camino por nombres anterior a los handles y UBOs (para comparar).
+	void drawWithStrings(Object3D* obj);
+	void setUniformByName(Program* prg, Program::dataType_e tipo, const void* dato, string nombre);
+
+	// Un dibujado por objeto con el mismo estado que los lotes (para comparar con el instanciado).
+	void drawPerObject();
+
+	// Mejor tiempo de frames llamadas a frame(), en ns por cada uno de los itemsPerFrame elementos del frame.
+	template <typename F>
+	double timeFrames(F frame, int itemsPerFrame);
+
+	// Un frame del Render: instantanea y dibujado. Con waitGPU tambien borra la pantalla y espera a la GPU.
+	void renderFrame(bool waitGPU);
+
+	// Un frame de calentamiento y el mejor tiempo de renderFrame, en ms.
+	double timeRenderFrames(bool waitGPU);
+
+	// Rejilla de objects cubos (data/cubo.fiis) cada spacing unidades en x y hacia -z, ya en la escena.
+	// centered la centra en x; shuffled los anade en desorden (llegan al dibujado con cualquier profundidad).
+	vector<Object3D*> buildCubeGrid(int objects, float spacing = 2.0f, bool centered = false, bool shuffled = false);
+
+	// Saca los objetos de la escena y los borra.
+	void removeObjects(vector<Object3D*>& list);
+};
+
+#pragma endregion
@@ -0,0 +1,86 @@
+#pragma once
+#include "common.h"
+#include "vectorMath.h"
+
+using namespace libPRGR;
+
+#pragma region --- SCENE GRAPH ---
+
+// Jerarquia de transformaciones padre/hijo.
+//
+// Los nodos se guardan en arrays ordenados en preorden (el padre siempre va antes que
+// sus hijos y cada subarbol ocupa un rango contiguo [i, i + tamanoSubarbol)). Las
+// matrices locales y de mundo quedan cacheadas; al cambiar una matriz local solo se
+// marca la raiz del subarbol afectado, y update() recalcula esos rangos en una unica
+// pasada lineal: con k nodos afectados el trabajo es O(k), no O(N).
+//
+// Los cambios de estructura (crear con padre, reparentar, borrar) reordenan los arrays
+// en el siguiente update() y recalculan todo; se esperan solo en tiempo de carga.
+class SceneGraph {
+public:
+
+	static const int NO_PARENT = -1;
+
+	// Crea un nodo (con matriz local identidad) y devuelve su handle, estable durante toda su vida.
+	int createNode(int parent = NO_PARENT);
+
+	// Borra un nodo. Sus hijos pasan a ser raices (conservan su matriz local).
+	void removeNode(int node);
+
+	// Cambia el padre de un nodo (NO_PARENT para convertirlo en raiz).
+	void setParent(int node, int parent);
+
+	int getParent(int node) const;
+
+	// Establece la matriz local. Si no cambia no marca nada.
+	void setLocalMatrix(int node, const matrix4x4f& local);
+
+	const matrix4x4f& getLocalMatrix(int node) const;
+
+	// Matriz de mundo calculada en el ultimo update().
+	const matrix4x4f& getWorldMatrix(int node) const;
+
+	// Posicion en mundo del origen del nodo.
+	vector4f getWorldPosition(int node) const;
+
+	bool isValid(int node) const;
+
+	// Recalcula las matrices de mundo de los subarboles marcados. Devuelve cuantas se recalcularon.
+	int update();
+
+	// Handles cuyas matrices de mundo se recalcularon en el ultimo update().
+	const vector<int>& getUpdatedNodes() const { return updatedNodes; }
+
+	size_t size() const { return order.size(); }
+
+private:
+
+	// Informacion estructural por handle.
+	typedef struct {
+		int parent;
+		vector<int> children;
+		bool alive;
+	} nodeInfo_t;
+
+	vector<nodeInfo_t> nodes;   // Indexado por handle
+	vector<int> freeHandles;    // Handles reutilizables
+	vector<int> handleIndex;    // Handle -> indice en los arrays ordenados (-1 si libre)
+
+	// Arrays ordenados en preorden (indexados por posicion)
+	vector<int> order;          // Indice -> handle
+	vector<int> parentIndex;    // Indice -> indice del padre (-1 si es raiz)
+	vector<int> subtreeSize;    // Indice -> tamano del subarbol incluyendo el propio nodo
+	vector<matrix4x4f> localMatrices;
+	vector<matrix4x4f> worldMatrices;
+	vector<unsigned char> dirtyFlags;
+
+	vector<int> dirtyRoots;     // Indices marcados desde el ultimo update()
+	vector<int> updatedNodes;
+	bool orderDirty = false;
+
+	void markDirty(int index);
+	void detach(int node);
+	void rebuildOrder();
+};
+
+#pragma endregion
@@ -5,17 +5,22 @@
 class Shader
 {
 public:
-    unsigned int shaderId; // ID del shader generado por OpenGL
+    unsigned int shaderId = 0; // ID del shader generado por OpenGL (0 hasta compilar)
     string fileName;       // Nombre del archivo del shader
     GLenum shaderType;     // Tipo de shader (GL_VERTEX_SHADER o GL_FRAGMENT_SHADER)
     string source;         // Cdigo fuente del shader
+    vector<string> defines; // Macros aadidas tras #version ("NOMBRE" o "NOMBRE VALOR")
 
-    // Constructor: Inicializa el shader con el nombre del archivo
-    Shader(string fileName);
+    // Constructor: Inicializa el shader con el nombre del archivo.
+    // Con compile = false solo lee la fuente (para buscarla en la cache de binarios o compilar mas tarde).
+    Shader(string fileName, const vector<string>& defines = {}, bool compile = true);
 
     // Lee el cdigo fuente del shader desde un archivo
     void readSource();
 
+    // Inserta los #define detras de la linea #version
+    void injectDefines();
+
     // Compila el shader en OpenGL
     void compileShader();
 
@@ -0,0 +1,35 @@
+#pragma once
+#include "common.h"
+
+#pragma region --- STAGING BUFFER ---
+
+// Buffer de subida para texturas y geometria (PBO / buffer de copia).
+//
+// Los datos se copian al buffer mapeado y la GPU los lleva a su destino desde ahi (glTexImage2D con
+// GL_PIXEL_UNPACK_BUFFER o glCopyBufferSubData), asi que la llamada vuelve sin esperar a que la copia
+// termine. Se escribe de forma lineal con mapas sin sincronizar: un tramo no se reutiliza nunca
+// mientras el buffer es el mismo. Cuando se llena se pide almacenamiento nuevo con glBufferData
+// (orphaning) y el driver libera el anterior cuando la GPU deja de leerlo.
+class StagingBuffer {
+public:
+
+	unsigned int idBuffer = 0; // Identificador del buffer GL
+
+	StagingBuffer(size_t capacity = 8 * 1024 * 1024);
+	~StagingBuffer();
+
+	// Copia bytes al buffer y lo deja enlazado a target. Devuelve el offset de los datos dentro del
+	// buffer (el "puntero" de glTexImage2D o el origen de glCopyBufferSubData). Si no cabe crece.
+	size_t write(GLenum target, const void* data, size_t bytes);
+
+	// Bytes escritos y veces que se ha pedido almacenamiento nuevo desde el arranque.
+	size_t bytesWritten = 0;
+	unsigned int orphans = 0;
+
+private:
+
+	size_t capacity;
+	size_t head = 0; // Primer byte libre
+};
+
+#pragma endregion
@@ -1,6 +1,9 @@
 #pragma once
 #include <string>
 #include "common.h"
+#include "TextureEncoder.h"
+#include "StagingBuffer.h"
+#include "TextureArray.h"
 
 using namespace std;
 
@@ -14,6 +17,50 @@ public:
     int w = 0; 
     int h = 0; 
 
+    // Niveles de mipmap en el formato en que se suben (loadFile los rellena y updateGPU los sube y
+    // los libera).
+    textureFormat_e format = TEXTURE_RGBA8;
+    vector<textureLevel_t> levels;
+    int mipLevels = 0;       // Niveles en GPU
+    size_t gpuBytes = 0;     // Memoria de video de todos ellos
+    bool fromCache = false;  // Los niveles se leyeron del fichero de cache
+    bool opaque = true;      // Todos los texels con alfa 255 (lo mira loadFile): el material no necesita alpha test
+
+    // En una capa de un TextureArray (useArrays al cargarla) en vez de en su propia textura GL
+    bool layered = false;
+    TextureArray* array = nullptr;
+    int layer = -1;
+
+    // Opciones de carga: se leen en cada loadFile / updateGPU.
+    inline static textureFormat_e compression = TEXTURE_AUTO;
+    inline static bool mipmaps = true;       // Sin mipmaps: un solo nivel con filtro GL_NEAREST
+    inline static float anisotropy = 8.0f;   // Muestras del filtro anisotropico (1: desactivado)
+    inline static bool useCache = true;      // Lee y guarda los niveles en cacheFileName(fichero)
+    inline static bool useArrays = false;    // Capas de TextureArray: objetos con texturas distintas en un mismo lote
+    inline static int layerSize = 0;         // Con useArrays, lado al que se reescalan para compartir array (0: su tamano; la cache guarda el ultimo)
+
+    // Memoria de video de todas las texturas cargadas.
+    inline static size_t totalGPUBytes = 0;
+
+    // Lo que admite la GPU. Lo rellena queryGLSupport, con el contexto GL ya creado.
+    inline static bool supportsS3TC = false;  // BC1 y BC3
+    inline static bool supportsBPTC = false;  // BC7
+    inline static float maxAnisotropy = 1.0f;
+    static void queryGLSupport();
+
+    // Fichero de cache de una textura: junto al original, con la extension .ptex anadida.
+    static string cacheFileName(const string& fileName) { return fileName + ".ptex"; }
+
+    // Formato en que se guarda una textura pedida como requested (resuelve TEXTURE_AUTO y cambia
+    // a uno que la GPU admita).
+    static textureFormat_e resolveFormat(textureFormat_e requested, bool opaque);
+
+    // Formato interno de GL de cada formato (GL_RGBA8 o el comprimido)
+    static GLenum internalFormat(textureFormat_e format);
+
+    // Filtros y repeticion de la textura enlazada a target con levels niveles (tambien los arrays)
+    static void setSampling(GLenum target, int levels);
+
     // Informacin de un pixel. Su color.
     typedef struct {
         unsigned char r;
@@ -22,24 +69,43 @@ public:
         unsigned char a;
     } pixel_t;
 
-    vector<pixel_t> pixels; 
+    vector<pixel_t> pixels; // Solo mientras loadFile prepara los niveles: despues se vacia
 
     // Archivo de la textura.
 	string fileName = ""; 
 
 	
-    // Constructor.
-    Texture(string fileName) : fileName(fileName) { 
+    // Constructor. Sin upload solo se prepara en CPU (vale desde cualquier hilo) y se sube despues
+    // con updateGPU o nivel a nivel con uploadLevel.
+    Texture(string fileName, bool upload = true) : fileName(fileName) { 
         loadFile(fileName);
-        updateGPU();
+        if (upload)
+            updateGPU();
     };
 
-    // Carga una textura desde un archivo.
+    ~Texture();
+
+    // Carga una textura desde un archivo: de la cache si esta al dia; si no decodifica el fichero,
+    // genera los mipmaps, los comprime y guarda la cache. No usa GL.
     void loadFile(string fileName);
 
     // Sube la textura a grfica.
-    void updateGPU();
+    void updateGPU(StagingBuffer* staging = nullptr);
+
+    // Subida por partes, para repartirla entre frames (ver AssetLoader): uploadLevel sube el nivel i
+    // (el 0 crea la textura y pone los filtros), a traves de staging si se indica, y finishUpload la
+    // deja lista para bind y libera los niveles en CPU.
+    void uploadLevel(int i, StagingBuffer* staging = nullptr);
+    void finishUpload();
 
     // Bindea la textura a grfica.
     void bind(int textureUnit);
+
+    // Lo que enlaza bind: las texturas del mismo array se dibujan sin volver a enlazar nada
+    const void* binding() const { return array ? (const void*)array : (const void*)this; }
+
+private:
+
+    bool loadCache(const string& cacheFile, uint64_t sourceHash, textureFormat_e requested, int width, int height);
+    void saveCache(const string& cacheFile, uint64_t sourceHash, textureFormat_e requested, bool opaque) const;
 };
\ No newline at end of file
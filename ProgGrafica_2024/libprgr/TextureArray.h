@@ -0,0 +1,63 @@
+#pragma once
+#include "common.h"
+#include "TextureEncoder.h"
+#include "StagingBuffer.h"
+
+#pragma region --- TEXTURE ARRAY ---
+
+// Texturas del mismo formato, tamano y numero de niveles como capas de un GL_TEXTURE_2D_ARRAY.
+// Los objetos con texturas distintas de un mismo array se dibujan sin cambiar de textura: el shader
+// (TEXTURE_ARRAY) lee la capa de cada instancia, asi que caben en el mismo lote o grupo de multi-draw.
+//
+// Cada array empieza con una capa y dobla la reserva cuando se llena, copiando las capas ocupadas a
+// traves de un PBO (sin pasar por CPU). Las capas que se liberan se reutilizan.
+class TextureArray {
+public:
+
+	textureFormat_e format;
+	int w, h;        // Del nivel 0 de cada capa
+	int levels;      // Niveles de mipmap de cada capa
+
+	unsigned int idTexture = 0;
+	int capacity;           // Capas reservadas
+	int usedLayers = 0;
+	size_t gpuBytes = 0;    // Todas las capas reservadas, ocupadas o no
+
+	TextureArray(textureFormat_e format, int w, int h, int levels, int capacity = 1);
+	~TextureArray();
+
+	// Capa libre para una textura (el array crece si no queda ninguna) y su devolucion.
+	int addLayer();
+	void removeLayer(int layer);
+
+	// Sube el nivel i de una capa; con staging los datos salen del buffer de subida.
+	void upload(int layer, int i, const textureLevel_t& level, StagingBuffer* staging = nullptr);
+
+	void bind(int textureUnit);
+
+	// Array con sitio para una textura de ese formato, tamano y niveles (se crea si no hay ninguno).
+	static TextureArray* get(textureFormat_e format, int w, int h, int levels);
+
+	// Arrays creados.
+	static size_t size() { return arrays.size(); }
+
+	// Borra todos los arrays (Render::deinitGLFW, con el contexto aun activo y sin texturas en ellos).
+	static void clear();
+
+private:
+
+	vector<int> freeLayers;
+
+	// Textura GL con capacity capas sin datos, con los filtros de Texture
+	unsigned int create(int layers);
+
+	// Pasa las capas a una textura de newCapacity capas, nivel a nivel por un PBO
+	void grow(int newCapacity);
+
+	// GL_MAX_ARRAY_TEXTURE_LAYERS (se consulta la primera vez)
+	static int maxLayers();
+
+	inline static vector<TextureArray*> arrays;
+};
+
+#pragma endregion
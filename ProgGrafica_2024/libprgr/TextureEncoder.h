@@ -0,0 +1,71 @@
+#pragma once
+#include "common.h"
+#include <cstdint>
+
+#pragma region --- TEXTURE ENCODER ---
+
+// Formato de los niveles de una textura en memoria y en GPU
+typedef enum {
+	TEXTURE_RGBA8, // Sin comprimir: 4 bytes por texel
+	TEXTURE_BC1,   // DXT1: 8 bytes por bloque de 4x4 (0.5 bytes por texel), sin alfa
+	TEXTURE_BC3,   // DXT5: BC1 para el color + 8 bytes de alfa (1 byte por texel)
+	TEXTURE_BC7,   // BPTC: 16 bytes por bloque (1 byte por texel), RGBA con mas calidad que BC3
+	TEXTURE_AUTO   // BC1 si la textura es opaca; si no BC7 (o BC3 si la GPU no tiene BPTC)
+} textureFormat_e;
+
+// Un nivel de la cadena de mipmaps, ya en su formato
+typedef struct {
+	int w, h;
+	vector<uint8_t> data;
+} textureLevel_t;
+
+// Mipmaps y compresion por bloques en CPU, sin dependencias.
+//
+// buildMipChain reduce cada nivel a la mitad (redondeando hacia abajo, hasta 1x1) con un filtro de
+// caja en espacio lineal: los texels se pasan de sRGB a lineal, se ponderan por su alfa (para que
+// los transparentes no oscurezcan los bordes) y se vuelven a sRGB. Con lados impares cada texel
+// mezcla 3 del nivel anterior con los pesos que reparten exactamente su area.
+//
+// Los codificadores trabajan por bloques de 4x4 (los bordes repiten el ultimo texel):
+//  - BC1: extremos en el eje principal del color del bloque (potencia iterada sobre la covarianza)
+//    y un ajuste por minimos cuadrados con los indices elegidos.
+//  - BC3: el color como BC1 y el alfa como BC4 (minimo y maximo del bloque, 8 niveles).
+//  - BC7: solo el modo 6 (un subconjunto, extremos RGBA de 7 bits + bit p, indices de 4 bits), con
+//    el eje principal en RGBA. No es el optimo de un codificador completo, pero es rapido.
+class TextureEncoder {
+public:
+
+	// "RGBA8", "BC1", ... para mostrarlo
+	static const char* formatName(textureFormat_e format);
+
+	// Bytes de un nivel de w x h en ese formato
+	static size_t levelSize(textureFormat_e format, int w, int h);
+
+	// Niveles de w x h hasta 1x1 (incluido el primero)
+	static int levelCount(int w, int h);
+
+	// Cadena completa desde rgba (w x h texels de 4 bytes), en RGBA8
+	static vector<textureLevel_t> buildMipChain(const uint8_t* rgba, int w, int h);
+
+	// rgba (w x h) remuestreada a nw x nh con el mismo filtro (media por area al reducir, lineal al
+	// ampliar), para meter texturas de tamanos distintos en capas iguales de un TextureArray
+	static vector<uint8_t> resize(const uint8_t* rgba, int w, int h, int nw, int nh);
+
+	// true si todos los texels tienen alfa 255
+	static bool isOpaque(const uint8_t* rgba, size_t texels);
+
+	// Comprime un nivel RGBA8 (format no puede ser TEXTURE_AUTO)
+	static textureLevel_t encode(const textureLevel_t& level, textureFormat_e format);
+
+	// Un bloque de 4x4 texels RGBA8 (fila a fila). BC1 siempre usa el modo de 4 colores, que es
+	// tambien el del color de BC3
+	static void encodeBC1(const uint8_t block[64], uint8_t out[8]);
+	static void encodeBC3(const uint8_t block[64], uint8_t out[16]);
+	static void encodeBC7(const uint8_t block[64], uint8_t out[16]);
+
+private:
+
+	static void encodeAlphaBlock(const uint8_t block[64], uint8_t out[8]);
+};
+
+#pragma endregion
@@ -0,0 +1,51 @@
+#pragma once
+#include <atomic>
+
+#pragma region --- TRIPLE BUFFER ---
+
+// Triple buffer sin bloqueos para un productor y un consumidor en hilos distintos.
+//
+// El productor escribe en su hueco (writeBuffer) y lo publica; el consumidor se queda con el
+// ultimo publicado (acquire) y lo lee en el suyo (readBuffer). Los huecos se intercambian con
+// un solo exchange atomico sobre el hueco del medio, asi que ninguno de los dos espera al otro
+// y cada uno tiene su hueco en exclusiva hasta el siguiente intercambio.
+template <typename T>
+class TripleBuffer {
+public:
+
+	// Hueco del productor.
+	T& writeBuffer() { return slots[back]; }
+
+	// Publica el hueco del productor y recibe el que estaba en medio para el siguiente frame.
+	void publish()
+	{
+		back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & INDEX;
+	}
+
+	// Si hay uno publicado sin leer, pasa a ser el hueco del consumidor. Devuelve false si no hay nada nuevo.
+	bool acquire()
+	{
+		if (!(middle.load(std::memory_order_relaxed) & FRESH))
+			return false;
+		front = middle.exchange(front, std::memory_order_acq_rel) & INDEX;
+		return true;
+	}
+
+	// Hueco del consumidor (el ultimo adquirido).
+	T& readBuffer() { return slots[front]; }
+
+	// Hay un hueco publicado que el consumidor aun no ha adquirido.
+	bool pending() const { return (middle.load(std::memory_order_acquire) & FRESH) != 0; }
+
+private:
+
+	static const int INDEX = 3; // Bits del indice de hueco
+	static const int FRESH = 4; // El hueco del medio tiene datos sin leer
+
+	T slots[3];
+	int back = 0;               // Solo lo toca el productor
+	int front = 1;              // Solo lo toca el consumidor
+	std::atomic<int> middle = 2;
+};
+
+#pragma endregion
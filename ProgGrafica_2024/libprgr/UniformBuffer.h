@@ -0,0 +1,50 @@
+#pragma once
+#include "common.h"
+
+#pragma region --- UNIFORM BUFFER ---
+
+// Buffer de uniforms (UBO) en anillo para datos que se reescriben cada frame.
+//
+// El buffer se divide en numSegments tramos; cada frame escribe en el siguiente. Los
+// bloques se acumulan en memoria de CPU con push() y endFrame() los sube con una sola
+// glBufferSubData. Antes de reutilizar un tramo se espera a su fence, de modo que nunca
+// se sobrescriben datos que la GPU todavia esta leyendo.
+class UniformBuffer {
+public:
+
+	unsigned int idBuffer = 0; // Identificador del buffer GL
+
+	UniformBuffer(size_t segmentSize = 64 * 1024, int numSegments = 3);
+	~UniformBuffer();
+
+	// Empieza un frame en el siguiente tramo. Si bytesNeeded no cabe el buffer crece.
+	void beginFrame(size_t bytesNeeded);
+
+	// Copia un bloque al tramo actual respetando GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT.
+	// Devuelve el offset absoluto dentro del buffer (para bindRange).
+	size_t push(const void* data, size_t size);
+
+	// Sube al buffer todo lo escrito en el frame.
+	void endFrame();
+
+	// Enlaza [offset, offset + size) al punto de enlace indicado.
+	void bindRange(unsigned int bindingPoint, size_t offset, size_t size);
+
+	// Tamano que ocupa un bloque una vez alineado.
+	size_t alignedSize(size_t size) const;
+
+private:
+
+	size_t segmentSize;
+	int numSegments;
+	int current = -1;    // Tramo del frame actual
+	size_t alignment = 256;
+
+	vector<unsigned char> staging; // Datos del frame actual
+	vector<GLsync> fences;         // Un fence por tramo (nullptr si esta libre)
+
+	void waitFence(int segment);
+	void resize(size_t newSegmentSize);
+};
+
+#pragma endregion
@@ -0,0 +1,68 @@
+#pragma once
+#include "common.h"
+#include "vertex.h"
+
+#pragma region --- VERTEX LAYOUT ---
+
+// Campo de vertex_t del que sale cada atributo.
+typedef enum {
+	VERTEX_POSITION,
+	VERTEX_COLOR,
+	VERTEX_NORMAL,
+	VERTEX_TEXCOORD
+} vertexSemantic_e;
+
+// Formato de un atributo en el VBO. Todos ocupan un multiplo de 4 bytes.
+typedef enum {
+	VERTEX_FLOAT4,          // 16 bytes, sin perdida (formato de vertex_t)
+	VERTEX_FLOAT3,          // 12 bytes, w = 1 en el shader
+	VERTEX_HALF2,           // 4 bytes, x e y en coma flotante de 16 bits
+	VERTEX_UNORM8x4,        // 4 bytes, RGBA de 8 bits normalizados a [0, 1]
+	VERTEX_SNORM_10_10_10_2, // 4 bytes, xyz con signo de 10 bits normalizados a [-1, 1] (GL_INT_2_10_10_10_REV)
+	VERTEX_OCT_SNORM16x2    // 4 bytes, normal unitaria en codificacion octaedrica; se decodifica en shader.vert
+} vertexFormat_e;
+
+typedef struct {
+	string name;               // Atributo de shader.vert
+	vertexSemantic_e semantic;
+	vertexFormat_e format;
+	unsigned int offset;       // Bytes desde el inicio del vertice
+} vertexAttribute_t;
+
+// Descriptor del formato de los vertices en GPU: que atributos hay, como se empaquetan y donde.
+// Las mallas se empaquetan al cargarse (Mesh::pack) y Render configura los atributos recorriendo
+// el descriptor, asi que cambiar de formato no toca ni el cargador ni el bucle de dibujado.
+class VertexLayout {
+public:
+
+	string name;
+	vector<vertexAttribute_t> attributes;
+	unsigned int stride = 0;
+
+	VertexLayout(string name) : name(name) {};
+
+	// Anade un atributo detras del ultimo.
+	void add(string attributeName, vertexSemantic_e semantic, vertexFormat_e format);
+
+	// Empaqueta los vertices segun el descriptor (stride bytes por vertice).
+	void pack(const vector<vertex_t>& vertices, vector<unsigned char>& out) const;
+
+	// Vuelve a vertex_t un vertice empaquetado (para medir la precision perdida).
+	vertex_t unpack(const unsigned char* data) const;
+
+	// Defines que necesita shader.vert para leer este formato.
+	vector<string> shaderDefines() const;
+
+	// Componentes, tipo GL y normalizacion de un formato (para glVertexAttribPointer).
+	static GLint components(vertexFormat_e format);
+	static GLenum glType(vertexFormat_e format);
+	static GLboolean normalized(vertexFormat_e format);
+	static unsigned int size(vertexFormat_e format);
+
+	// Formatos predefinidos.
+	static const VertexLayout& full();             // 4 x vec4 en float: 64 bytes (el formato anterior)
+	static const VertexLayout& packed();           // float3 + RGBA8 + normal 10_10_10_2 + half2: 24 bytes
+	static const VertexLayout& packedOctahedral(); // float3 + RGBA8 + normal octaedrica 16x2 + half2: 24 bytes
+};
+
+#pragma endregion
@@ -16,6 +16,7 @@
 
 #include <map>
 #include <string>
+#include <algorithm>
 #include <math.h>
 
 #include <iostream>
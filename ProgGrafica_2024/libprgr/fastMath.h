@@ -0,0 +1,225 @@
+#pragma once
+#include "vectorMath.h"
+#include <stddef.h>
+#include <string.h>
+
+// SSE2 esta garantizado en x64 (MSVC) y cuando el compilador lo anuncia.
+#if defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PRGR_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace libPRGR {
+
+	//			NIVELES DE PRECISION (POLITICAS)
+	// ------------------------------------------------
+	// Cada politica expone la misma interfaz estatica (sqrt, rsqrt, sin, cos, sincos y
+	// sincos por lotes), de modo que el codigo elige el nivel en tiempo de compilacion:
+	//
+	//     float d = distance<mathFast>(a, b);   // colisiones
+	//     matrix4x4f v = camera->computeViewMatrix(); // sigue usando la version exacta
+	//
+	// Las funciones sin parametro de plantilla de vectorMath.h siguen siendo exactas.
+	// Los errores maximos estan medidos con "--bench-math" (ver MathBenchmark).
+
+
+	// Exacto: funciones de la libreria estandar.
+	// Error maximo: el de libm (< 1 ulp).
+	struct mathExact {
+
+		// Cotas de error documentadas (las comprueba MathBenchmark::runAccuracy).
+		static constexpr double maxRelErrorSqrt = 2e-7;
+		static constexpr double maxAbsErrorSinCos = 2e-7;
+
+		static inline float sqrt(float x) { return ::sqrtf(x); }
+
+		static inline float rsqrt(float x) { return 1.0f / ::sqrtf(x); }
+
+		static inline float sin(float x) { return ::sinf(x); }
+
+		static inline float cos(float x) { return ::cosf(x); }
+
+		static inline void sincos(float x, float& s, float& c) {
+			s = ::sinf(x);
+			c = ::cosf(x);
+		}
+
+		static inline void sincos(const float* angles, float* s, float* c, size_t n) {
+			for (size_t i = 0; i < n; i++)
+				sincos(angles[i], s[i], c[i]);
+		}
+	};
+
+
+	// Rapido: rsqrt estimada + un paso de Newton y seno/coseno con polinomios minimax.
+	// Error relativo maximo de rsqrt/sqrt: 5e-7 (SSE) o 5e-6 (sin SSE).
+	// Error absoluto maximo de sin/cos: 2e-7 para |x| <= 8192 rad.
+	struct mathFast {
+
+#ifdef PRGR_SSE2
+		static constexpr double maxRelErrorSqrt = 5e-7;
+#else
+		static constexpr double maxRelErrorSqrt = 5e-6;
+#endif
+		static constexpr double maxAbsErrorSinCos = 2e-7;
+
+		// 1/sqrt(x) para x > 0.
+		static inline float rsqrt(float x) {
+#ifdef PRGR_SSE2
+			// rsqrtss tiene 12 bits de precision, un paso de Newton la deja en ~22 bits
+			float y = _mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss(x)));
+			return y * (1.5f - 0.5f * x * y * y);
+#else
+			// Aproximacion inicial por bits + dos pasos de Newton
+			unsigned int i;
+			float y;
+			memcpy(&i, &x, sizeof(i));
+			i = 0x5f375a86u - (i >> 1);
+			memcpy(&y, &i, sizeof(y));
+			y = y * (1.5f - 0.5f * x * y * y);
+			return y * (1.5f - 0.5f * x * y * y);
+#endif
+		}
+
+		// sqrt(x) = x * rsqrt(x), con sqrt(0) = 0.
+		static inline float sqrt(float x) {
+			return (x > 0.0f) ? x * rsqrt(x) : 0.0f;
+		}
+
+		// Polinomios sobre [-pi/4, pi/4] (coeficientes minimax de Cephes).
+		static inline float sinPoly(float r) {
+			float r2 = r * r;
+			return r + r * r2 * (-1.6666654611e-1f + r2 * (8.3321608736e-3f + r2 * -1.9515295891e-4f));
+		}
+
+		static inline float cosPoly(float r) {
+			float r2 = r * r;
+			return 1.0f - 0.5f * r2 + r2 * r2 * (4.166664568298827e-2f + r2 * (-1.388731625493765e-3f + r2 * 2.443315711809948e-5f));
+		}
+
+		// Reduce x a r en [-pi/4, pi/4] y devuelve el cuadrante (reduccion de Cody-Waite en tres partes).
+		static inline int reduce(float x, float& r) {
+			float q = nearbyintf(x * 0.63661977236f); // 2/pi
+			r = ((x - q * 1.5703125f) - q * 4.8375129699707031e-4f) - q * 7.5497899548918821e-8f;
+			return (int)q;
+		}
+
+		static inline void sincos(float x, float& s, float& c) {
+			float r;
+			int q = reduce(x, r);
+			float sr = sinPoly(r);
+			float cr = cosPoly(r);
+			switch (q & 3) {
+			case 0: s = sr;  c = cr;  break;
+			case 1: s = cr;  c = -sr; break;
+			case 2: s = -sr; c = -cr; break;
+			default: s = -cr; c = sr; break;
+			}
+		}
+
+		static inline float sin(float x) {
+			float s, c;
+			sincos(x, s, c);
+			return s;
+		}
+
+		static inline float cos(float x) {
+			float s, c;
+			sincos(x, s, c);
+			return c;
+		}
+
+		static inline void sincos(const float* angles, float* s, float* c, size_t n) {
+			for (size_t i = 0; i < n; i++)
+				sincos(angles[i], s[i], c[i]);
+		}
+	};
+
+
+	// SIMD: mismos resultados que mathFast para valores sueltos; sincos por lotes
+	// procesa 4 angulos por instruccion con SSE2 (sin ramas). Mismo error que mathFast.
+	struct mathSimd : public mathFast {
+
+		using mathFast::sincos;
+
+		static inline void sincos(const float* angles, float* s, float* c, size_t n) {
+			size_t i = 0;
+#ifdef PRGR_SSE2
+			const __m128 twoOverPi = _mm_set1_ps(0.63661977236f);
+			const __m128 c1 = _mm_set1_ps(1.5703125f);
+			const __m128 c2 = _mm_set1_ps(4.8375129699707031e-4f);
+			const __m128 c3 = _mm_set1_ps(7.5497899548918821e-8f);
+			const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32((int)0x80000000u));
+			const __m128i one = _mm_set1_epi32(1);
+			const __m128i two = _mm_set1_epi32(2);
+
+			for (; i + 4 <= n; i += 4) {
+				__m128 x = _mm_loadu_ps(angles + i);
+
+				// Cuadrante y reduccion (cvtps redondea al par mas cercano, como nearbyintf)
+				__m128i qi = _mm_cvtps_epi32(_mm_mul_ps(x, twoOverPi));
+				__m128 q = _mm_cvtepi32_ps(qi);
+				__m128 r = _mm_sub_ps(x, _mm_mul_ps(q, c1));
+				r = _mm_sub_ps(r, _mm_mul_ps(q, c2));
+				r = _mm_sub_ps(r, _mm_mul_ps(q, c3));
+				__m128 r2 = _mm_mul_ps(r, r);
+
+				// Polinomios
+				__m128 sp = _mm_add_ps(_mm_set1_ps(8.3321608736e-3f), _mm_mul_ps(r2, _mm_set1_ps(-1.9515295891e-4f)));
+				sp = _mm_add_ps(_mm_set1_ps(-1.6666654611e-1f), _mm_mul_ps(r2, sp));
+				sp = _mm_add_ps(r, _mm_mul_ps(_mm_mul_ps(r, r2), sp));
+
+				__m128 cp = _mm_add_ps(_mm_set1_ps(-1.388731625493765e-3f), _mm_mul_ps(r2, _mm_set1_ps(2.443315711809948e-5f)));
+				cp = _mm_add_ps(_mm_set1_ps(4.166664568298827e-2f), _mm_mul_ps(r2, cp));
+				cp = _mm_mul_ps(_mm_mul_ps(r2, r2), cp);
+				cp = _mm_add_ps(_mm_sub_ps(_mm_set1_ps(1.0f), _mm_mul_ps(_mm_set1_ps(0.5f), r2)), cp);
+
+				// Cuadrantes impares intercambian seno y coseno
+				__m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(qi, one), one));
+				__m128 sv = _mm_or_ps(_mm_and_ps(swap, cp), _mm_andnot_ps(swap, sp));
+				__m128 cv = _mm_or_ps(_mm_and_ps(swap, sp), _mm_andnot_ps(swap, cp));
+
+				// Signo del seno: cuadrantes 2 y 3. Signo del coseno: cuadrantes 1 y 2.
+				__m128i sSign = _mm_slli_epi32(_mm_and_si128(qi, two), 30);
+				__m128i cSign = _mm_slli_epi32(_mm_and_si128(_mm_add_epi32(qi, one), two), 30);
+				sv = _mm_xor_ps(sv, _mm_and_ps(_mm_castsi128_ps(sSign), signMask));
+				cv = _mm_xor_ps(cv, _mm_and_ps(_mm_castsi128_ps(cSign), signMask));
+
+				_mm_storeu_ps(s + i, sv);
+				_mm_storeu_ps(c + i, cv);
+			}
+#endif
+			// Cola (o todo el lote si no hay SSE2)
+			for (; i < n; i++)
+				mathFast::sincos(angles[i], s[i], c[i]);
+		}
+	};
+
+
+	//			FUNCIONES VECTORIALES POR NIVEL
+	// ------------------------------------------------
+
+	// Tamano del vector con la politica P.
+	template <typename P>
+	inline float length(vector4f v) {
+		return P::sqrt(v.x * v.x + v.y * v.y + v.z * v.z);
+	}
+
+	// Distancia entre dos puntos con la politica P.
+	template <typename P>
+	inline float distance(const vector4f& v1, const vector4f& v2) {
+		float dx = v2.x - v1.x;
+		float dy = v2.y - v1.y;
+		float dz = v2.z - v1.z;
+		return P::sqrt(dx * dx + dy * dy + dz * dz);
+	}
+
+	// Normalizacion con la politica P: una rsqrt y tres multiplicaciones en vez de sqrt y tres divisiones.
+	template <typename P>
+	inline vector4f normalize(vector4f v) {
+		float inv = P::rsqrt(v.x * v.x + v.y * v.y + v.z * v.z);
+		vector4f vectorRes = { v.x * inv, v.y * inv, v.z * inv, v.w };
+		return vectorRes;
+	}
+
+}